@@ -26,10 +26,14 @@ For more information please visit:  http://bitmagic.io
 namespace libbm
 {
 
-#if defined(BMSSE2OPT) || defined(BMSSE42OPT)
+#if defined(BM_SIMD_DISPATCH)
+#define BM_ALLOC_ALIGN 32
+#elif defined(BMSSE2OPT) || defined(BMSSE42OPT)
 #define BM_ALLOC_ALIGN 16
 #endif
-#if defined(BMAVX2OPT)
+#if defined(BMAVX512OPT)
+#define BM_ALLOC_ALIGN 64
+#elif defined(BMAVX2OPT)
 #define BM_ALLOC_ALIGN 32
 #endif
 
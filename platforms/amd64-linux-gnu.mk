@@ -1,6 +1,8 @@
 ifeq ($(COMPILER),GNU_CC)
 
-    ifeq ($(BMOPTFLAGS),-DBMAVX2OPT)
+    ifeq ($(BMOPTFLAGS),-DBMAVX512OPT)
+        CXXARCHFLAGS=-march=native -mavx512f -mavx512bw -mavx512vpopcntdq
+    else ifeq ($(BMOPTFLAGS),-DBMAVX2OPT)
         CXXARCHFLAGS=-march=native -mavx2
     else
         ifeq ($(BMOPTFLAGS),-DBMSSE42OPT)
@@ -359,7 +359,7 @@ public:
 #ifndef BM_NO_STL
         typedef std::output_iterator_tag  iterator_category;
 #endif
-        typedef unsigned value_type;
+        typedef bm::id_t value_type;
         typedef void difference_type;
         typedef void pointer;
         typedef void reference;
@@ -426,10 +426,10 @@ public:
 #ifndef BM_NO_STL
         typedef std::input_iterator_tag  iterator_category;
 #endif
-        typedef unsigned   value_type;
-        typedef unsigned   difference_type;
-        typedef unsigned*  pointer;
-        typedef unsigned&  reference;
+        typedef bm::id_t   value_type;
+        typedef bm::id_t   difference_type;
+        typedef bm::id_t*  pointer;
+        typedef bm::id_t&  reference;
 
     public:
         enumerator() : iterator_base()
@@ -710,7 +710,7 @@ public:
 
             if (this->block_type_) // gap
             {
-                this->position_ = nb * bm::set_block_size * 32;
+                this->position_ = bm::id_t(nb) * bm::set_block_size * 32;
                 search_in_gapblock();
                 
                 if (this->position_ == pos)
@@ -751,7 +751,7 @@ public:
                 bdescr->bit_.ptr = this->block_ + (nword - parity);
                 bdescr->bit_.cnt = bm::bitscan_wave(bdescr->bit_.ptr, bdescr->bit_.bits);
                 BM_ASSERT(bdescr->bit_.cnt);
-                bdescr->bit_.pos = (nb * bm::set_block_size * 32) + ((nword - parity) * 32);
+                bdescr->bit_.pos = (bm::id_t(nb) * bm::set_block_size * 32) + ((nword - parity) * 32);
                 bdescr->bit_.idx = 0;
                 nbit &= bm::set_word_mask;
                 nbit += 32 * parity;
@@ -934,8 +934,10 @@ public:
         {}
     };
     
+#ifndef BM64ADDR
     /*! @brief structure for bit counts per block (prefix sum)
         Structure is used to accelerate bit range scans
+        @note not available in 64-bit address mode (BM64ADDR)
     */
     struct blocks_count
     {
@@ -951,6 +953,206 @@ public:
             ::memcpy(this->cnt, bc.cnt, sizeof(this->cnt));
         }
     };
+#endif
+
+    /*! @brief Rank-Select index: running bit counts per block and
+        per 512-bit sub-block (for bit blocks).
+        Structure is used to accelerate rank(), select() and prefix sum
+        based address translations. Only non-empty sub-arrays of the
+        blocks tree are indexed, so memory follows the vector population.
+        Index is a snapshot of the vector, it has to be rebuilt after any
+        modification.
+        \sa build_rs_index
+    */
+    class rs_index
+    {
+    public:
+        typedef typename Alloc::block_allocator_type block_allocator_type;
+        friend class bvector<Alloc>;
+    public:
+        rs_index()
+        : sarr_count_(0), bit_blocks_(0),
+          sarr_idx_(0), bcount_(0), sub_idx_(0), subcount_(0),
+          buf_(0), buf_words_(0)
+        {}
+        rs_index(const rs_index& rsi)
+        : sarr_count_(0), bit_blocks_(0),
+          sarr_idx_(0), bcount_(0), sub_idx_(0), subcount_(0),
+          buf_(0), buf_words_(0)
+        {
+            copy_from(rsi);
+        }
+        ~rs_index() { free_buffer(); }
+
+        rs_index& operator=(const rs_index& rsi)
+        {
+            if (this != &rsi)
+                copy_from(rsi);
+            return *this;
+        }
+
+        /// copy index content
+        void copy_from(const rs_index& rsi)
+        {
+            resize(rsi.sarr_count_, rsi.bit_blocks_);
+            if (buf_words_)
+                ::memcpy(buf_, rsi.buf_, buf_words_ * sizeof(bm::word_t));
+        }
+
+        /// exchange content of two indexes
+        void swap(rs_index& rsi) BMNOEXEPT
+        {
+            bm::xor_swap(sarr_count_, rsi.sarr_count_);
+            bm::xor_swap(bit_blocks_, rsi.bit_blocks_);
+            unsigned* si = sarr_idx_; sarr_idx_ = rsi.sarr_idx_; rsi.sarr_idx_ = si;
+            bm::id_t* bc = bcount_; bcount_ = rsi.bcount_; rsi.bcount_ = bc;
+            si = sub_idx_; sub_idx_ = rsi.sub_idx_; rsi.sub_idx_ = si;
+            bm::gap_word_t* sc = subcount_; subcount_ = rsi.subcount_; rsi.subcount_ = sc;
+            bm::word_t* b = buf_; buf_ = rsi.buf_; rsi.buf_ = b;
+            size_t bw = buf_words_; buf_words_ = rsi.buf_words_; rsi.buf_words_ = bw;
+        }
+
+        /// free index memory
+        void clear() BMNOEXEPT { free_buffer(); }
+
+        /// number of blocks covered by the index
+        unsigned total_blocks() const
+        {
+            return sarr_count_ ?
+                (sarr_idx_[sarr_count_-1] + 1) << bm::set_array_shift : 0;
+        }
+
+        /// total population count of the indexed vector
+        bm::id_t count() const
+        {
+            return sarr_count_ ?
+                bcount_[(size_t(sarr_count_) << bm::set_array_shift) - 1] : 0;
+        }
+
+        /*!
+            \brief running count of all blocks before the target block
+            \param nb - block number
+            \param sub_cnt - [out] sub-block running counts of the block
+                             (NULL if block is not a bit block)
+        */
+        bm::id_t count_before(unsigned nb, const bm::gap_word_t** sub_cnt) const
+        {
+            BM_ASSERT(sub_cnt);
+            *sub_cnt = 0;
+            unsigned i = nb >> bm::set_array_shift;
+            unsigned lo = 0, hi = sarr_count_;
+            while (lo < hi)
+            {
+                unsigned mid = lo + ((hi - lo) >> 1);
+                if (sarr_idx_[mid] < i)
+                    lo = mid + 1;
+                else
+                    hi = mid;
+            }
+            size_t idx = size_t(lo) << bm::set_array_shift;
+            if (lo == sarr_count_ || sarr_idx_[lo] != i) // empty sub-array
+                return idx ? bcount_[idx-1] : 0;
+            idx += nb & bm::set_array_mask;
+            *sub_cnt = get_subcount(idx);
+            return idx ? bcount_[idx-1] : 0;
+        }
+
+        /*!
+            \brief find block containing the bit of the specified rank
+            \param rank - rank of the bit (1-based), must be <= count()
+            \param cnt_before - [out] running count of all blocks before
+            \param sub_cnt - [out] sub-block running counts of the block
+            \return block number
+        */
+        unsigned find_block(bm::id_t                rank,
+                            bm::id_t*               cnt_before,
+                            const bm::gap_word_t**  sub_cnt) const
+        {
+            BM_ASSERT(rank && rank <= count());
+            unsigned lo = 0, hi = sarr_count_ - 1;
+            while (lo < hi)
+            {
+                unsigned mid = lo + ((hi - lo) >> 1);
+                if (bcount_[(size_t(mid) << bm::set_array_shift) + bm::set_array_mask] < rank)
+                    lo = mid + 1;
+                else
+                    hi = mid;
+            }
+            const bm::id_t* row = bcount_ + (size_t(lo) << bm::set_array_shift);
+            unsigned j = 0, j_hi = bm::set_array_mask;
+            while (j < j_hi)
+            {
+                unsigned mid = j + ((j_hi - j) >> 1);
+                if (row[mid] < rank)
+                    j = mid + 1;
+                else
+                    j_hi = mid;
+            }
+            size_t idx = (size_t(lo) << bm::set_array_shift) + j;
+            *cnt_before = idx ? bcount_[idx-1] : 0;
+            *sub_cnt = get_subcount(idx);
+            return (sarr_idx_[lo] << bm::set_array_shift) + j;
+        }
+
+    private:
+        const bm::gap_word_t* get_subcount(size_t idx) const
+        {
+            unsigned si = sub_idx_[idx];
+            if (si == bm::rs_no_sub_count)
+                return 0;
+            return subcount_ + size_t(si) * (bm::rs_sub_block_count - 1);
+        }
+
+        void resize(unsigned sarr_count, unsigned bit_blocks)
+        {
+            size_t blocks = size_t(sarr_count) << bm::set_array_shift;
+            size_t bytes =
+                blocks * sizeof(bm::id_t) +
+                blocks * sizeof(unsigned) +
+                sarr_count * sizeof(unsigned) +
+                size_t(bit_blocks) * (bm::rs_sub_block_count - 1) * sizeof(bm::gap_word_t);
+            size_t words = (bytes + sizeof(bm::id64_t)) / sizeof(bm::word_t);
+            if (!sarr_count)
+                words = 0;
+            if (words != buf_words_)
+            {
+                free_buffer();
+                if (words)
+                {
+                    buf_ = block_allocator_type::allocate(words, 0);
+                    buf_words_ = words;
+                }
+            }
+            sarr_count_ = sarr_count;
+            bit_blocks_ = bit_blocks;
+            if (!buf_)
+                return;
+            bcount_ = (bm::id_t*) buf_;
+            sub_idx_ = (unsigned*) (bcount_ + blocks);
+            sarr_idx_ = sub_idx_ + blocks;
+            subcount_ = (bm::gap_word_t*) (sarr_idx_ + sarr_count);
+        }
+
+        void free_buffer() BMNOEXEPT
+        {
+            if (buf_)
+                block_allocator_type::deallocate(buf_, buf_words_);
+            sarr_count_ = bit_blocks_ = 0;
+            sarr_idx_ = 0; bcount_ = 0; sub_idx_ = 0; subcount_ = 0;
+            buf_ = 0; buf_words_ = 0;
+        }
+
+    private:
+        unsigned         sarr_count_;   ///< number of indexed sub-arrays
+        unsigned         bit_blocks_;   ///< number of bit blocks with sub-counts
+        unsigned*        sarr_idx_;     ///< sorted list of indexed sub-arrays
+        bm::id_t*        bcount_;       ///< running count per block
+        unsigned*        sub_idx_;      ///< sub-counts row index per block
+        bm::gap_word_t*  subcount_;     ///< sub-block running counts
+        bm::word_t*      buf_;          ///< index memory
+        size_t           buf_words_;    ///< index memory size in words
+    };
+    typedef rs_index rs_index_type;
 
 public:
 
@@ -1296,6 +1498,21 @@ public:
                               bm::id_t right,
                               bool     value = true);
 
+
+    /*!
+        \brief Import (OR) sorted array of bit indexes
+        
+        Indexes are grouped per block, every block is built in one pass
+        in the optimal representation: GAP block when the runs of the
+        block fit into GAP levels, bit block otherwise.
+        Vector is resized if indexes are beyond its size.
+        
+        \param ids - array of indexes sorted in ascending order
+                     (duplicates are allowed)
+        \param size - array size
+    */
+    void import_sorted(const bm::id_t* ids, size_t size);
+
     
     /*! Function erturns insert iterator for this bitvector */
     insert_iterator inserter()
@@ -1396,6 +1613,7 @@ public:
                          bm::id_t right, 
                          const unsigned* block_count_arr=0) const;
     
+#ifndef BM64ADDR
     /*! \brief compute running total of all blocks in bit vector
         \param blocks_cnt - out pointer to counting structure, holding the array
         Function will fill full array of running totals
@@ -1427,6 +1645,42 @@ public:
         \sa count_to
     */
     bm::id_t count_to_test(bm::id_t right, const blocks_count&  blocks_cnt) const;
+#endif
+
+    /*! \brief compute rank-select index of the bit vector
+        \param rs_idx - [out] index to build
+        \sa rank, select
+    */
+    void build_rs_index(rs_index_type* rs_idx) const;
+
+    /*!
+       \brief Returns rank of the bit: count of 1 bits in [0..n] range.
+       \param n - index of the bit
+       \param rs_idx - rank-select index, prepared using build_rs_index
+       \return population count in the diapason
+       \sa build_rs_index, select
+    */
+    bm::id_t rank(bm::id_t n, const rs_index_type& rs_idx) const;
+
+    /*!
+        \brief Returns count of 1 bits (population) in [0..right] range if test(right) == true.
+        \param right - index of last bit
+        \param rs_idx - rank-select index, prepared using build_rs_index
+        \return population count in the diapason or 0 if right bit test failed
+        \sa build_rs_index, rank
+    */
+    bm::id_t count_to_test(bm::id_t right, const rs_index_type& rs_idx) const;
+
+    /*!
+        \brief Finds position of the n-th 1 bit (select operation).
+        \param rank - rank of the bit to find (1-based: 1 is the first 1 bit)
+        \param pos  - [out] position of the found bit
+        \param rs_idx - rank-select index, prepared using build_rs_index
+        \return true if the bit was found, false if rank is 0 or larger
+                 than the vector population count
+        \sa build_rs_index, rank
+    */
+    bool select(bm::id_t rank, bm::id_t& pos, const rs_index_type& rs_idx) const;
 
     /*! Recalculate bitcount
         this function only make sense when BMCOUNTOPT is defined
@@ -1452,6 +1706,9 @@ public:
 
     /*!
         \brief Inverts all bits.
+        
+        @note In 64-bit address mode (BM64ADDR) inversion is limited 
+        by the vector's current capacity.
     */
     bvector<Alloc>& invert();
 
@@ -1581,6 +1838,19 @@ public:
         return (++prev == bm::id_max) ? 0 : check_or_next_extract(prev);
     }
 
+    /*!
+       \brief Bulk decode of indexes of ON bits into array.
+       Blocks are decoded as a whole (SIMD decoding of bit blocks when
+       available), paging is supported by resuming from the bit after
+       the last decoded index.
+       \param arr - destination array
+       \param size - destination array capacity
+       \param from - index to start decoding from
+       \return number of decoded indexes (less than size at the end)
+       \sa get_first, get_next, enumerator
+    */
+    size_t decode(bm::id_t* arr, size_t size, bm::id_t from = 0) const;
+
 
     /*!
        @brief Calculates bitvector statistics.
@@ -1780,6 +2050,41 @@ public:
     void combine_operation(const bm::bvector<Alloc>& bvect, 
                             bm::operation            opcode);
 
+    /**
+        \brief Prepare vector for the combine operation with the argument
+        (size adjustment, capacity reservation, tail clearing for AND)
+
+        After this call all top level blocks below the returned size
+        are pre-reserved, so disjoint ranges of top blocks can be processed
+        independently with combine_operation_range().
+
+        \param bvect  - argument vector
+        \param opcode - operation code
+        \return number of top level blocks to process (0 - nothing to do)
+        \internal
+    */
+    unsigned combine_operation_prepare(const bm::bvector<Alloc>& bvect,
+                                       bm::operation             opcode);
+
+    /**
+        \brief Combine a range of top level blocks [top_from, top_to)
+        with the argument vector. Vector must be prepared with
+        combine_operation_prepare().
+
+        \param bvect      - argument vector
+        \param opcode     - operation code
+        \param top_from   - first top level block to process
+        \param top_to     - top level block to stop at (not included)
+        \param temp_block - temporary bit-block for the range (if 0 shared
+                            temp block of the vector is used)
+        \internal
+    */
+    void combine_operation_range(const bm::bvector<Alloc>& bvect,
+                                 bm::operation             opcode,
+                                 unsigned                  top_from,
+                                 unsigned                  top_to,
+                                 bm::word_t*               temp_block = 0);
+
     /**
         \brief get access to internal block by number
      
@@ -1840,16 +2145,19 @@ private:
                                       bm::word_t* blk,
                                       const bm::word_t* arg_blk,
                                       bool arg_gap,
-                                      bm::operation opcode);
+                                      bm::operation opcode,
+                                      bm::word_t* temp_block = 0);
 public:
     void combine_operation_with_block(unsigned nb,
                                       const bm::word_t* arg_blk,
                                       bool arg_gap,
-                                      bm::operation opcode)
+                                      bm::operation opcode,
+                                      bm::word_t* temp_block = 0)
     {
         bm::word_t* blk = const_cast<bm::word_t*>(get_block(nb));
         bool gap = BM_IS_GAP(blk);
-        combine_operation_with_block(nb, gap, blk, arg_blk, arg_gap, opcode);
+        combine_operation_with_block(nb, gap, blk, arg_blk, arg_gap, opcode,
+                                     temp_block);
     }
 private:
 #if 0
@@ -1881,6 +2189,12 @@ private:
     void set_range_no_check(bm::id_t left,
                             bm::id_t right,
                             bool     value);
+
+    /**
+       \brief Import sorted indexes of one block
+       \return number of indexes consumed
+    */
+    size_t import_block(const bm::id_t* ids, size_t size, unsigned nb);
 public:
 
     const blocks_manager_type& get_blocks_manager() const
@@ -2053,6 +2367,8 @@ void bvector<Alloc>::resize(size_type new_size)
 
 // -----------------------------------------------------------------------
 
+#ifndef BM64ADDR
+
 template<typename Alloc>
 void bvector<Alloc>::running_count_blocks(blocks_count* blocks_cnt) const
 {
@@ -2153,6 +2469,194 @@ bm::id_t bvector<Alloc>::count_to_test(bm::id_t right,
     return cnt;
 }
 
+#endif
+
+// -----------------------------------------------------------------------
+
+template<typename Alloc>
+void bvector<Alloc>::build_rs_index(rs_index_type* rs_idx) const
+{
+    BM_ASSERT(rs_idx);
+
+    if (!blockman_.is_init())
+    {
+        rs_idx->clear();
+        return;
+    }
+    bm::word_t*** blk_root = blockman_.top_blocks_root();
+    unsigned top_size = blockman_.top_block_size();
+
+    // count non-empty sub-arrays and bit blocks
+    unsigned sarr_count = 0;
+    unsigned bit_blocks = 0;
+    for (unsigned i = 0; i < top_size; ++i)
+    {
+        bm::word_t** blk_blk = blk_root[i];
+        if (!blk_blk)
+            continue;
+        ++sarr_count;
+        for (unsigned j = 0; j < bm::set_array_size; ++j)
+        {
+            const bm::word_t* block = blk_blk[j];
+            if (IS_VALID_ADDR(block) && !BM_IS_GAP(block))
+                ++bit_blocks;
+        }
+    }
+    rs_idx->resize(sarr_count, bit_blocks);
+
+    // compute running counts
+    bm::id_t cnt = 0;
+    unsigned sub_idx = 0;
+    size_t idx = 0;
+    for (unsigned i = 0, k = 0; i < top_size; ++i)
+    {
+        bm::word_t** blk_blk = blk_root[i];
+        if (!blk_blk)
+            continue;
+        rs_idx->sarr_idx_[k++] = i;
+        for (unsigned j = 0; j < bm::set_array_size; ++j, ++idx)
+        {
+            const bm::word_t* block = blk_blk[j];
+            rs_idx->sub_idx_[idx] = bm::rs_no_sub_count;
+            if (block)
+            {
+                if (BM_IS_GAP(block))
+                {
+                    cnt += bm::gap_bit_count_unr(BMGAP_PTR(block));
+                }
+                else
+                if (IS_FULL_BLOCK(block))
+                {
+                    cnt += bm::bits_in_block;
+                }
+                else
+                {
+                    bm::gap_word_t* sub_cnt =
+                        rs_idx->subcount_ + size_t(sub_idx) * (bm::rs_sub_block_count - 1);
+                    cnt += bm::bit_block_calc_subcount(block, sub_cnt);
+                    rs_idx->sub_idx_[idx] = sub_idx++;
+                }
+            }
+            rs_idx->bcount_[idx] = cnt;
+        } // for j
+    } // for i
+    BM_ASSERT(sub_idx == bit_blocks);
+}
+
+// -----------------------------------------------------------------------
+
+template<typename Alloc>
+bm::id_t bvector<Alloc>::rank(bm::id_t n, const rs_index_type& rs_idx) const
+{
+    unsigned nb = unsigned(n >> bm::set_block_shift);
+
+    // running count of all blocks before target
+    //
+    const bm::gap_word_t* sub_cnt;
+    bm::id_t cnt = rs_idx.count_before(nb, &sub_cnt);
+
+    const bm::word_t* block = blockman_.get_block_ptr(nb);
+    if (!block)
+        return cnt;
+
+    unsigned nbit = unsigned(n & bm::set_block_mask);
+    if (BM_IS_GAP(block))
+    {
+        cnt += bm::gap_bit_count_to(BMGAP_PTR(block), (gap_word_t)nbit);
+    }
+    else
+    if (IS_FULL_BLOCK(block))
+    {
+        cnt += nbit + 1;
+    }
+    else
+    {
+        BM_ASSERT(sub_cnt);
+        unsigned sub = nbit >> bm::rs_sub_block_shift;
+        if (sub)
+            cnt += sub_cnt[sub-1];
+        cnt += bm::bit_block_calc_count_range(block, sub << bm::rs_sub_block_shift, nbit);
+    }
+    return cnt;
+}
+
+// -----------------------------------------------------------------------
+
+template<typename Alloc>
+bm::id_t bvector<Alloc>::count_to_test(bm::id_t right,
+                                       const rs_index_type& rs_idx) const
+{
+    unsigned nb = unsigned(right >> bm::set_block_shift);
+    const bm::word_t* block = blockman_.get_block_ptr(nb);
+    if (!block)
+        return 0;
+
+    unsigned nbit = unsigned(right & bm::set_block_mask);
+    if (BM_IS_GAP(block))
+    {
+        if (!bm::gap_test_unr(BMGAP_PTR(block), (gap_word_t)nbit))
+            return 0;
+    }
+    else
+    if (!IS_FULL_BLOCK(block))
+    {
+        unsigned nword = nbit >> bm::set_word_shift;
+        if (!(block[nword] & (1u << (nbit & bm::set_word_mask))))
+            return 0;
+    }
+    return rank(right, rs_idx);
+}
+
+// -----------------------------------------------------------------------
+
+template<typename Alloc>
+bool bvector<Alloc>::select(bm::id_t rank, bm::id_t& pos,
+                            const rs_index_type& rs_idx) const
+{
+    if (!rank || rank > rs_idx.count())
+        return false;
+
+    bm::id_t cnt_before;
+    const bm::gap_word_t* sub_cnt;
+    unsigned nb = rs_idx.find_block(rank, &cnt_before, &sub_cnt);
+    unsigned rank_in_block = unsigned(rank - cnt_before);
+    BM_ASSERT(rank_in_block);
+
+    const bm::word_t* block = blockman_.get_block_ptr(nb);
+    BM_ASSERT(block);
+
+    unsigned nbit;
+    if (BM_IS_GAP(block))
+    {
+        nbit = bm::gap_find_rank(BMGAP_PTR(block), rank_in_block);
+    }
+    else
+    if (IS_FULL_BLOCK(block))
+    {
+        nbit = rank_in_block - 1;
+    }
+    else
+    {
+        BM_ASSERT(sub_cnt);
+        // binary search for the first sub-block with running count >= rank
+        unsigned lo = 0, hi = bm::rs_sub_block_count - 1;
+        while (lo < hi)
+        {
+            unsigned mid = lo + ((hi - lo) >> 1);
+            if (sub_cnt[mid] < rank_in_block)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        if (lo)
+            rank_in_block -= sub_cnt[lo-1];
+        nbit = bm::bit_find_rank(block, rank_in_block, lo << bm::rs_sub_block_shift);
+    }
+    BM_ASSERT(nbit < bm::bits_in_block);
+    pos = bm::id_t(nb) * bm::bits_in_block + nbit;
+    return true;
+}
+
 
 // -----------------------------------------------------------------------
 
@@ -2170,7 +2674,7 @@ bm::id_t bvector<Alloc>::count_range(bm::id_t left,
     if (!blockman_.is_init())
         return 0;
 
-    unsigned cnt = 0;
+    bm::id_t cnt = 0;
 
     // calculate logical number of start and destination blocks
     unsigned nblock_left  = unsigned(left  >>  bm::set_block_shift);
@@ -2269,6 +2773,17 @@ bvector<Alloc>& bvector<Alloc>::invert()
     bm::word_t*** blk_root = blockman_.top_blocks_root();
     typename blocks_manager_type::block_invert_func func(blockman_);    
     for_each_block(blk_root, blockman_.top_block_size(), func);
+#ifdef BM64ADDR
+    // 64-bit tree is allocated on demand, inversion covers 
+    // the current capacity, bits above it remain 0
+    bm::id_t last = blockman_.capacity();
+    if (last != bm::id_max)
+        --last;
+    if (size_ <= last)
+    {
+        set_range_no_check(size_, last, false);
+    }
+#else
     if (size_ == bm::id_max) 
     {
         set_bit_no_check(bm::id_max, false);
@@ -2277,6 +2792,7 @@ bvector<Alloc>& bvector<Alloc>::invert()
     {
         set_range_no_check(size_, bm::id_max, false);
     }
+#endif
 
     return *this;
 }
@@ -2377,8 +2893,9 @@ void bvector<Alloc>::optimize_gap_size()
     gap_word_t opt_glen[bm::gap_levels];
     ::memcpy(opt_glen, st.gap_levels, bm::gap_levels * sizeof(*opt_glen));
 
+    unsigned gap_cnt = bm::min_value(st.gap_blocks, bm::set_total_blocks32);
     improve_gap_levels(st.gap_length, 
-                            st.gap_length + st.gap_blocks, 
+                            st.gap_length + gap_cnt, 
                             opt_glen);
     
     set_gap_levels(opt_glen);
@@ -2870,6 +3387,174 @@ bool bvector<Alloc>::find(bm::id_t from, bm::id_t& pos) const
 }
 
 
+//---------------------------------------------------------------------
+
+template<class Alloc> 
+void bvector<Alloc>::import_sorted(const bm::id_t* ids, size_t size)
+{
+    if (!size)
+        return;
+    BM_ASSERT(ids);
+    if (ids[size-1] >= size_)
+        resize(ids[size-1] + 1);
+    if (!blockman_.is_init())
+        blockman_.init_tree();
+
+    BM_SET_MMX_GUARD
+    BMCOUNT_VALID(false)
+
+    for (size_t i = 0; i < size; )
+    {
+        unsigned nb = unsigned(ids[i] >> bm::set_block_shift);
+        i += import_block(ids + i, size - i, nb);
+    }
+}
+
+//---------------------------------------------------------------------
+
+template<class Alloc> 
+size_t bvector<Alloc>::import_block(const bm::id_t* ids, 
+                                    size_t size, 
+                                    unsigned nb)
+{
+    BM_ASSERT(size);
+    const bm::id_t base = bm::id_t(nb) << bm::set_block_shift;
+    const unsigned max_gap_len = blockman_.glen(bm::gap_max_level);
+
+    // GAP image of the block: runs of ones, until it gets too long
+    gap_word_t gap_buf[bm::gap_max_buff_len + 4];
+    gap_word_t* pcurr = gap_buf + 1;
+    bool fits_gap = true;
+
+    unsigned first = unsigned(ids[0] - base);
+    unsigned prev = first;
+    unsigned bit_cnt = 1;
+    if (first)
+        *pcurr++ = gap_word_t(first - 1);
+    size_t i = 1;
+    for (; i < size; ++i)
+    {
+        bm::id_t id = ids[i];
+        BM_ASSERT(id >= ids[i-1]); // must be sorted
+        if ((id >> bm::set_block_shift) != nb)
+            break;
+        unsigned curr = unsigned(id - base);
+        if (curr == prev) // duplicate
+            continue;
+        ++bit_cnt;
+        if (curr != prev + 1 && fits_gap) // new run
+        {
+            *pcurr++ = gap_word_t(prev);
+            *pcurr++ = gap_word_t(curr - 1);
+            fits_gap = unsigned(pcurr - gap_buf) < max_gap_len - 1;
+        }
+        prev = curr;
+    } // for i
+    const size_t consumed = i;
+
+    bm::word_t* blk = blockman_.get_block_ptr(nb);
+    if (IS_FULL_BLOCK(blk)) // X OR 1 == 1
+        return consumed;
+
+    if (bit_cnt == bm::gap_max_bits) // all bits set
+    {
+        set_range_no_check(base, base + bm::gap_max_bits - 1, true);
+        return consumed;
+    }
+
+    if (fits_gap)
+    {
+        *pcurr = gap_word_t(prev);
+        if (prev != bm::gap_max_bits - 1)
+            *++pcurr = gap_word_t(bm::gap_max_bits - 1);
+        unsigned end = unsigned(pcurr - gap_buf);
+        gap_buf[0] = gap_word_t((end << 3) | (first == 0)); // GAP header
+        bm::word_t* arg_blk = (bm::word_t*)gap_buf;
+        BMSET_PTRGAP(arg_blk);
+        combine_operation_with_block(nb, BM_IS_GAP(blk), blk, 
+                                     arg_blk, true, BM_OR);
+        return consumed;
+    }
+
+    // too many runs for GAP: bit block
+    bm::word_t* bit_blk = blk ? blockman_.check_allocate_tempblock()
+                              : blockman_.get_allocator().alloc_bit_block();
+    bm::bit_block_set(bit_blk, 0);
+    for (size_t j = 0; j < consumed; ++j)
+    {
+        unsigned nbit = unsigned(ids[j] - base);
+        bit_blk[nbit >> bm::set_word_shift] |= 
+                            (1u << (nbit & bm::set_word_mask));
+    }
+    if (blk)
+        combine_operation_with_block(nb, BM_IS_GAP(blk), blk, 
+                                     bit_blk, false, BM_OR);
+    else
+        blockman_.set_block(nb, bit_blk);
+    return consumed;
+}
+
+//---------------------------------------------------------------------
+
+template<class Alloc> 
+size_t bvector<Alloc>::decode(bm::id_t* arr, size_t size, bm::id_t from) const
+{
+    if (!size || !blockman_.is_init() || from >= size_)
+        return 0;
+
+    size_t cnt = 0;
+    unsigned nb = unsigned(from >> bm::set_block_shift);
+    unsigned nbit = unsigned(from & bm::set_block_mask);
+    unsigned top_size = blockman_.top_block_size();
+    for (unsigned i = nb >> bm::set_array_shift; i < top_size; ++i)
+    {
+        const bm::word_t* const* blk_blk = blockman_.get_topblock(i);
+        unsigned j = 0;
+        if (i == (nb >> bm::set_array_shift))
+            j = nb & bm::set_array_mask;
+        else
+            nbit = 0;
+        if (!blk_blk)
+            continue;
+        for (; j < bm::set_array_size; ++j, nbit = 0)
+        {
+            const bm::word_t* blk = blk_blk[j];
+            if (!blk)
+                continue;
+            bm::id_t base = 
+                bm::id_t(i * bm::set_array_size + j) << bm::set_block_shift;
+            size_t rest = size - cnt;
+            unsigned block_rest = 
+                unsigned(rest < bm::gap_max_bits ? rest : bm::gap_max_bits);
+            unsigned n;
+            if (BM_IS_GAP(blk))
+            {
+                n = bm::gap_block_decode(BMGAP_PTR(blk), nbit, 
+                                         arr + cnt, block_rest, base);
+            }
+            else
+            if (IS_FULL_BLOCK(blk))
+            {
+                n = bm::gap_max_bits - nbit;
+                if (n > block_rest)
+                    n = block_rest;
+                bm::id_t* BMRESTRICT parr = arr + cnt;
+                for (unsigned k = 0; k < n; ++k)
+                    parr[k] = base + nbit + k;
+            }
+            else
+            {
+                n = bm::bit_block_decode(blk, nbit, arr + cnt, 
+                                         block_rest, base);
+            }
+            cnt += n;
+            if (cnt == size)
+                return cnt;
+        } // for j
+    } // for i
+    return cnt;
+}
+
 //---------------------------------------------------------------------
 
 template<class Alloc> 
@@ -2880,7 +3565,7 @@ bm::id_t bvector<Alloc>::check_or_next(bm::id_t prev) const
     for (;;)
     {
         unsigned nblock = unsigned(prev >> bm::set_block_shift); 
-        if (nblock >= bm::set_total_blocks) 
+        if ((nblock >> bm::set_array_shift) >= blockman_.top_block_size()) 
             break;
 
         if (blockman_.is_subblock_null(nblock >> bm::set_array_shift))
@@ -2944,7 +3629,8 @@ bm::id_t bvector<Alloc>::check_or_next_extract(bm::id_t prev)
     for (;;)
     {
         unsigned nblock = unsigned(prev >> bm::set_block_shift); 
-        if (nblock >= bm::set_total_blocks) break;
+        if ((nblock >> bm::set_array_shift) >= blockman_.top_block_size()) 
+            break;
 
         if (blockman_.is_subblock_null(nblock >> bm::set_array_shift))
         {
@@ -3038,12 +3724,24 @@ template<class Alloc>
 void bvector<Alloc>::combine_operation(
                                   const bm::bvector<Alloc>& bv,
                                   bm::operation             opcode)
+{
+    unsigned top_blocks = combine_operation_prepare(bv, opcode);
+    if (top_blocks)
+        combine_operation_range(bv, opcode, 0, top_blocks);
+}
+
+//---------------------------------------------------------------------
+
+template<class Alloc> 
+unsigned bvector<Alloc>::combine_operation_prepare(
+                                  const bm::bvector<Alloc>& bv,
+                                  bm::operation             opcode)
 {
     if (!blockman_.is_init())
     {
         if (opcode == BM_AND || opcode == BM_SUB)
         {
-            return;
+            return 0;
         }
         blockman_.init_tree();
     }
@@ -3053,7 +3751,10 @@ void bvector<Alloc>::combine_operation(
 
     if (size_ == bv.size_)
     {
+#ifndef BM64ADDR
+        // 64-bit trees of the same size grow independently
         BM_ASSERT(top_blocks >= arg_top_blocks);
+#endif
     }
     else
     if (size_ < bv.size_) // this vect shorter than the arg.
@@ -3076,12 +3777,6 @@ void bvector<Alloc>::combine_operation(
             }
         }
     }
-    
-    bm::word_t*** blk_root = blockman_.top_blocks_root();
-    unsigned block_idx = 0;
-    unsigned i, j;
-
-    BM_SET_MMX_GUARD
 
     // calculate effective top size to avoid overscan
     top_blocks = blockman_.effective_top_block_size();
@@ -3090,25 +3785,45 @@ void bvector<Alloc>::combine_operation(
         if (opcode != BM_AND)
         {
             top_blocks = bv.blockman_.effective_top_block_size();
+            // argument tree can be wider (64-bit trees grow on demand)
+            blockman_.reserve_top_blocks(top_blocks);
+            // pre-set effective size, so block assignments in the range
+            // never need to update it
+            blockman_.set_effective_top_block_size(top_blocks);
         }
     }
+    return top_blocks;
+}
 
-    for (i = 0; i < top_blocks; ++i)
+//---------------------------------------------------------------------
+
+template<class Alloc> 
+void bvector<Alloc>::combine_operation_range(
+                                  const bm::bvector<Alloc>& bv,
+                                  bm::operation             opcode,
+                                  unsigned                  top_from,
+                                  unsigned                  top_to,
+                                  bm::word_t*               temp_block)
+{
+    BM_ASSERT(top_to <= blockman_.top_block_size());
+    BM_ASSERT(top_from <= top_to);
+
+    unsigned i, j;
+
+    BM_SET_MMX_GUARD
+
+    bm::word_t*** blk_root = blockman_.top_blocks_root();
+
+    for (i = top_from; i < top_to; ++i)
     {
         bm::word_t** blk_blk = blk_root[i];
         if (blk_blk == 0) // not allocated
         {
             if (opcode == BM_AND) // 0 AND anything == 0
-            {
-                block_idx += bm::set_array_size;
                 continue; 
-            }
             const bm::word_t* const* bvbb = bv.blockman_.get_topblock(i);
             if (bvbb == 0) // skip it because 0 OP 0 == 0 
-            {
-                block_idx += bm::set_array_size;
                 continue; 
-            }
             // 0 - self, non-zero argument
             unsigned r = i * bm::set_array_size;
             for (j = 0; j < bm::set_array_size; ++j)
@@ -3118,7 +3833,7 @@ void bvector<Alloc>::combine_operation(
                     combine_operation_with_block(r + j,
                                                  0, 0, 
                                                  arg_blk, BM_IS_GAP(arg_blk), 
-                                                 opcode);
+                                                 opcode, temp_block);
             } // for j
             continue;
         }
@@ -3136,7 +3851,7 @@ void bvector<Alloc>::combine_operation(
                         combine_operation_with_block(r + j,
                                                      BM_IS_GAP(blk), blk, 
                                                      arg_blk, BM_IS_GAP(arg_blk),
-                                                     opcode);                    
+                                                     opcode, temp_block);                    
                     else
                         blockman_.zero_block(i, j);
                 }
@@ -3153,7 +3868,7 @@ void bvector<Alloc>::combine_operation(
                 if (arg_blk || blk)
                     combine_operation_with_block(r + j, BM_IS_GAP(blk), blk, 
                                                  arg_blk, BM_IS_GAP(arg_blk),
-                                                 opcode);
+                                                 opcode, temp_block);
             } // for j
         }
     } // for i
@@ -3171,7 +3886,8 @@ bvector<Alloc>::combine_operation_with_block(unsigned          nb,
                                              bm::word_t*       blk,
                                              const bm::word_t* arg_blk,
                                              bool              arg_gap,
-                                             bm::operation     opcode)
+                                             bm::operation     opcode,
+                                             bm::word_t*       temp_block)
 {
     gap_word_t tmp_buf[bm::gap_equiv_len * 3]; // temporary result            
     const bm::gap_word_t* res;
@@ -3366,7 +4082,9 @@ bvector<Alloc>::combine_operation_with_block(unsigned          nb,
                 
                 // the worst case we need to convert argument block to 
                 // bitset type.
-                gap_word_t* temp_blk = (gap_word_t*) blockman_.check_allocate_tempblock();
+                if (!temp_block)
+                    temp_block = blockman_.check_allocate_tempblock();
+                gap_word_t* temp_blk = (gap_word_t*) temp_block;
                 arg_blk = 
                     gap_convert_to_bitset_smart((bm::word_t*)temp_blk, 
                                                 BMGAP_PTR(arg_blk), 
@@ -3559,6 +4277,12 @@ void bvector<Alloc>::set_range_no_check(bm::id_t left,
     {
         for (; nb < nb_to; ++nb)
         {
+            unsigned i = nb >> bm::set_array_shift;
+            if (!blockman_.get_topblock(i)) // whole sub-array is empty
+            {
+                nb = (i * bm::set_array_size) + (bm::set_array_size - 1);
+                continue;
+            }
             block = blockman_.get_block(nb);
             if (block == 0)  // nothing to do
                 continue;
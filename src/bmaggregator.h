@@ -0,0 +1,794 @@
+#ifndef BMAGGREGATOR__H__INCLUDED__
+#define BMAGGREGATOR__H__INCLUDED__
+/*
+Copyright(c) 2002-2017 Anatoliy Kuznetsov(anatoliy_kuznetsov at yahoo.com)
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+For more information please visit:  http://bitmagic.io
+*/
+
+/*! \file bmaggregator.h
+    \brief Algorithms for fast aggregation of a group of bit-vectors
+*/
+
+#include "bm.h"
+#include "bmfunc.h"
+#include "bmdef.h"
+
+
+namespace bm
+{
+
+/**
+    Algorithms for fast aggregation of a group of bit-vectors
+
+    Aggregator processes all arguments block by block (one 64K bits block
+    of all vectors at a time), so the target vector is constructed in one
+    pass and working set of the algorithm stays in CPU cache.
+    This is faster than pairwise bvector<>::bit_or() / bit_and() on large
+    groups of vectors.
+
+    \ingroup setalgo
+*/
+template<typename BV>
+class aggregator
+{
+public:
+    typedef BV                                    bvector_type;
+    typedef const bvector_type*                   bvector_type_const_ptr;
+    typedef typename bvector_type::allocator_type allocator_type;
+    typedef typename bvector_type::blocks_manager_type blocks_manager_type;
+
+    /// Maximum number of arguments in the group
+    enum max_size
+    {
+        max_aggregator_cap = 1024
+    };
+
+public:
+    aggregator();
+    ~aggregator();
+
+    /**
+        \brief Attach source bit-vector to the argument group
+        \param bv - input bit-vector pointer to attach
+        \param agr_group - argument group: 0 - AND (or OR) group,
+                           1 - SUB group (used by AND-SUB operations)
+        \return current number of arguments in the group
+    */
+    unsigned add(const bvector_type* bv, unsigned agr_group = 0);
+
+    /**
+        \brief Reset the argument groups
+    */
+    void reset() { arg_group0_cnt_ = arg_group1_cnt_ = 0; }
+
+    /**
+        \brief Aggregate added group of vectors using logical OR
+        \param bv_target - target vector (input is arg group)
+    */
+    void combine_or(bvector_type& bv_target);
+
+    /**
+        \brief Aggregate added group of vectors using logical AND
+        \param bv_target - target vector (input is arg group)
+    */
+    void combine_and(bvector_type& bv_target);
+
+    /**
+        \brief Aggregate group of vectors using logical OR
+        \param bv_target - target vector
+        \param bv_src    - array of pointers on bit-vector aggregate arguments
+        \param src_size  - size of bv_src (how many vectors to aggregate)
+    */
+    void combine_or(bvector_type& bv_target,
+                    const bvector_type_const_ptr* bv_src, unsigned src_size);
+
+    /**
+        \brief Aggregate group of vectors using logical AND
+        \param bv_target - target vector
+        \param bv_src    - array of pointers on bit-vector aggregate arguments
+        \param src_size  - size of bv_src (how many vectors to aggregate)
+    */
+    void combine_and(bvector_type& bv_target,
+                     const bvector_type_const_ptr* bv_src, unsigned src_size);
+
+    /**
+        \brief Aggregate added groups of vectors using fused logical AND-SUB
+        (group 0 AND-ed together, MINUS every vector of group 1)
+        \param bv_target - target vector (input is arg groups)
+        \param any - if true, stop at the first non-empty result block
+                     (existence check)
+        \return true if the result is not empty
+    */
+    bool combine_and_sub(bvector_type& bv_target, bool any = false);
+
+    /**
+        \brief Fused logical AND-SUB:
+        bv_src_and[0] AND ... bv_src_and[n] MINUS bv_src_sub[0] ... MINUS bv_src_sub[m]
+
+        Whole expression is evaluated block by block, blocks which become
+        empty are dropped from further processing.
+
+        \param bv_target    - target vector
+        \param bv_src_and   - array of pointers on bit-vectors for AND
+        \param src_and_size - size of bv_src_and
+        \param bv_src_sub   - array of pointers on bit-vectors for SUB
+        \param src_sub_size - size of bv_src_sub
+        \param any - if true, stop at the first non-empty result block
+                     (existence check)
+        \return true if the result is not empty
+    */
+    bool combine_and_sub(bvector_type& bv_target,
+                    const bvector_type_const_ptr* bv_src_and, unsigned src_and_size,
+                    const bvector_type_const_ptr* bv_src_sub, unsigned src_sub_size,
+                    bool any);
+
+    /**
+        \brief Find the first 1 bit of the AND-SUB expression of added groups
+        \param idx - [out] index of the first bit
+        \return true if found
+    */
+    bool find_first_and_sub(bm::id_t& idx);
+
+    /**
+        \brief Find the first 1 bit of the AND-SUB expression
+        \param idx - [out] index of the first bit
+        \param bv_src_and   - array of pointers on bit-vectors for AND
+        \param src_and_size - size of bv_src_and
+        \param bv_src_sub   - array of pointers on bit-vectors for SUB
+        \param src_sub_size - size of bv_src_sub
+        \return true if found
+    */
+    bool find_first_and_sub(bm::id_t& idx,
+                    const bvector_type_const_ptr* bv_src_and, unsigned src_and_size,
+                    const bvector_type_const_ptr* bv_src_sub, unsigned src_sub_size);
+
+protected:
+    /// block level operation result codes
+    enum block_result
+    {
+        blk_empty  = 0, ///< result block is empty
+        blk_temp   = 1, ///< result is in the temp block
+        blk_full   = 2, ///< result block is all 1s
+        blk_single = 3  ///< result is the single (first) input block
+    };
+
+    /// prepare target vector and compute the number of top blocks to scan
+    static
+    unsigned prepare_target(bvector_type& bv_target,
+                            const bvector_type_const_ptr* bv_src,
+                            unsigned src_size, bool is_and);
+
+    /// OR one block of all arguments into the target
+    void combine_or(unsigned nb, blocks_manager_type& bman_target,
+                    const bvector_type_const_ptr* bv_src, unsigned src_size);
+
+    /// AND one block of all arguments into the target
+    void combine_and(unsigned nb, blocks_manager_type& bman_target,
+                     const bvector_type_const_ptr* bv_src, unsigned src_size);
+
+    /// AND one block of all arguments
+    /// \param copy_single - allow blk_single result (no temp block)
+    /// \return block_result code
+    unsigned process_and(unsigned nb,
+                         const bvector_type_const_ptr* bv_src, unsigned src_size,
+                         bool copy_single);
+
+    /// AND-SUB one block of all arguments
+    /// \return block_result code (blk_empty, blk_temp or blk_full)
+    unsigned process_and_sub(unsigned nb,
+                    const bvector_type_const_ptr* bv_src_and, unsigned src_and_size,
+                    const bvector_type_const_ptr* bv_src_sub, unsigned src_sub_size);
+
+    /// compute the number of top blocks to scan for AND
+    static
+    unsigned and_top_size(const bvector_type_const_ptr* bv_src, unsigned src_size);
+
+    /// true if temp block is all zero
+    bool is_temp_zero() const
+    {
+        return bm::bit_is_all_zero((bm::wordop_t*)tb_,
+                                   (bm::wordop_t*)(tb_ + bm::set_block_size));
+    }
+
+    /// sort source blocks into bit and GAP lists, returns number of blocks
+    unsigned sort_input_blocks(unsigned nb,
+                               const bvector_type_const_ptr* bv_src,
+                               unsigned src_size,
+                               unsigned* bit_cnt, unsigned* gap_cnt,
+                               bool* has_full, bool* has_null);
+
+    /// place the temp block result into the target
+    void assign_target_block(unsigned nb, blocks_manager_type& bman_target);
+
+    /// copy single source (bit or GAP) block into the target
+    static
+    void copy_target_block(unsigned nb, blocks_manager_type& bman_target,
+                           const bm::word_t* block,
+                           const bm::gap_word_t* gap_block);
+
+    /// check if any argument has the sub-array allocated
+    static
+    bool any_sub_array(unsigned i,
+                       const bvector_type_const_ptr* bv_src, unsigned src_size);
+
+    /// check if all arguments have the sub-array allocated
+    static
+    bool all_sub_array(unsigned i,
+                       const bvector_type_const_ptr* bv_src, unsigned src_size);
+
+private:
+    aggregator(const aggregator&);
+    aggregator& operator=(const aggregator&);
+
+private:
+    const bvector_type*   arg_group0_[max_aggregator_cap]; ///< AND (OR) group
+    unsigned              arg_group0_cnt_;                 ///< group 0 size
+    const bvector_type*   arg_group1_[max_aggregator_cap]; ///< SUB group
+    unsigned              arg_group1_cnt_;                 ///< group 1 size
+
+    const bm::word_t*     v_arg_blk_[max_aggregator_cap];     ///< bit blocks
+    const bm::gap_word_t* v_arg_blk_gap_[max_aggregator_cap]; ///< GAP blocks
+
+    allocator_type        alloc_;       ///< allocator for the temp block
+    bm::word_t*           tb_;          ///< temp bit block
+};
+
+
+
+// ------------------------------------------------------------------------
+//
+// ------------------------------------------------------------------------
+
+
+template<typename BV>
+aggregator<BV>::aggregator()
+: arg_group0_cnt_(0),
+  arg_group1_cnt_(0)
+{
+    tb_ = alloc_.alloc_bit_block();
+}
+
+// ------------------------------------------------------------------------
+
+template<typename BV>
+aggregator<BV>::~aggregator()
+{
+    alloc_.free_bit_block(tb_);
+}
+
+// ------------------------------------------------------------------------
+
+template<typename BV>
+unsigned aggregator<BV>::add(const bvector_type* bv, unsigned agr_group)
+{
+    BM_ASSERT(bv);
+    BM_ASSERT(agr_group <= 1);
+
+    const bvector_type** arg_group = agr_group ? arg_group1_ : arg_group0_;
+    unsigned& arg_group_cnt = agr_group ? arg_group1_cnt_ : arg_group0_cnt_;
+
+    BM_ASSERT(arg_group_cnt < max_aggregator_cap);
+    BM_ASSERT_THROW(arg_group_cnt < max_aggregator_cap, BM_ERR_RANGE);
+
+    if (arg_group_cnt < max_aggregator_cap)
+        arg_group[arg_group_cnt++] = bv;
+    return arg_group_cnt;
+}
+
+// ------------------------------------------------------------------------
+
+template<typename BV>
+void aggregator<BV>::combine_or(bvector_type& bv_target)
+{
+    combine_or(bv_target, arg_group0_, arg_group0_cnt_);
+}
+
+// ------------------------------------------------------------------------
+
+template<typename BV>
+void aggregator<BV>::combine_and(bvector_type& bv_target)
+{
+    combine_and(bv_target, arg_group0_, arg_group0_cnt_);
+}
+
+// ------------------------------------------------------------------------
+
+template<typename BV>
+bool aggregator<BV>::combine_and_sub(bvector_type& bv_target, bool any)
+{
+    return combine_and_sub(bv_target,
+                           arg_group0_, arg_group0_cnt_,
+                           arg_group1_, arg_group1_cnt_, any);
+}
+
+// ------------------------------------------------------------------------
+
+template<typename BV>
+bool aggregator<BV>::find_first_and_sub(bm::id_t& idx)
+{
+    return find_first_and_sub(idx,
+                              arg_group0_, arg_group0_cnt_,
+                              arg_group1_, arg_group1_cnt_);
+}
+
+// ------------------------------------------------------------------------
+
+template<typename BV>
+void aggregator<BV>::combine_or(bvector_type& bv_target,
+                        const bvector_type_const_ptr* bv_src, unsigned src_size)
+{
+    unsigned top_size = prepare_target(bv_target, bv_src, src_size, false);
+    if (!top_size)
+        return;
+    blocks_manager_type& bman_target = bv_target.get_blocks_manager();
+    for (unsigned i = 0; i < top_size; ++i)
+    {
+        if (!any_sub_array(i, bv_src, src_size))
+            continue;
+        unsigned nb = i << bm::set_array_shift;
+        for (unsigned j = 0; j < bm::set_array_size; ++j, ++nb)
+        {
+            combine_or(nb, bman_target, bv_src, src_size);
+        } // for j
+    } // for i
+    bv_target.forget_count();
+}
+
+// ------------------------------------------------------------------------
+
+template<typename BV>
+void aggregator<BV>::combine_and(bvector_type& bv_target,
+                        const bvector_type_const_ptr* bv_src, unsigned src_size)
+{
+    unsigned top_size = prepare_target(bv_target, bv_src, src_size, true);
+    if (!top_size)
+        return;
+    blocks_manager_type& bman_target = bv_target.get_blocks_manager();
+    for (unsigned i = 0; i < top_size; ++i)
+    {
+        if (!all_sub_array(i, bv_src, src_size))
+            continue;
+        unsigned nb = i << bm::set_array_shift;
+        for (unsigned j = 0; j < bm::set_array_size; ++j, ++nb)
+        {
+            combine_and(nb, bman_target, bv_src, src_size);
+        } // for j
+    } // for i
+    bv_target.forget_count();
+}
+
+// ------------------------------------------------------------------------
+
+template<typename BV>
+bool aggregator<BV>::combine_and_sub(bvector_type& bv_target,
+                const bvector_type_const_ptr* bv_src_and, unsigned src_and_size,
+                const bvector_type_const_ptr* bv_src_sub, unsigned src_sub_size,
+                bool any)
+{
+    BM_ASSERT(src_sub_size <= max_aggregator_cap);
+    BM_ASSERT_THROW(src_sub_size <= max_aggregator_cap, BM_ERR_RANGE);
+
+    unsigned top_size = prepare_target(bv_target, bv_src_and, src_and_size, true);
+    if (!top_size)
+        return false;
+
+    bool found = false;
+    blocks_manager_type& bman_target = bv_target.get_blocks_manager();
+    for (unsigned i = 0; i < top_size; ++i)
+    {
+        if (!all_sub_array(i, bv_src_and, src_and_size))
+            continue;
+        unsigned nb = i << bm::set_array_shift;
+        for (unsigned j = 0; j < bm::set_array_size; ++j, ++nb)
+        {
+            switch (process_and_sub(nb, bv_src_and, src_and_size,
+                                        bv_src_sub, src_sub_size))
+            {
+            case blk_temp:
+                assign_target_block(nb, bman_target);
+                break;
+            case blk_full:
+                bman_target.set_block_all_set(nb);
+                break;
+            default:
+                continue;
+            } // switch
+            found = true;
+            if (any)
+                break;
+        } // for j
+        if (found && any)
+            break;
+    } // for i
+    bv_target.forget_count();
+    return found;
+}
+
+// ------------------------------------------------------------------------
+
+template<typename BV>
+bool aggregator<BV>::find_first_and_sub(bm::id_t& idx,
+                const bvector_type_const_ptr* bv_src_and, unsigned src_and_size,
+                const bvector_type_const_ptr* bv_src_sub, unsigned src_sub_size)
+{
+    BM_ASSERT(src_and_size <= max_aggregator_cap);
+    BM_ASSERT(src_sub_size <= max_aggregator_cap);
+
+    unsigned top_size = and_top_size(bv_src_and, src_and_size);
+    for (unsigned i = 0; i < top_size; ++i)
+    {
+        if (!all_sub_array(i, bv_src_and, src_and_size))
+            continue;
+        unsigned nb = i << bm::set_array_shift;
+        for (unsigned j = 0; j < bm::set_array_size; ++j, ++nb)
+        {
+            unsigned nbit;
+            switch (process_and_sub(nb, bv_src_and, src_and_size,
+                                        bv_src_sub, src_sub_size))
+            {
+            case blk_temp:
+                nbit = bm::bit_find_rank(tb_, 1, 0);
+                break;
+            case blk_full:
+                nbit = 0;
+                break;
+            default:
+                continue;
+            } // switch
+            idx = bm::id_t(nb) * bm::bits_in_block + nbit;
+            return true;
+        } // for j
+    } // for i
+    return false;
+}
+
+// ------------------------------------------------------------------------
+
+template<typename BV>
+unsigned aggregator<BV>::and_top_size(const bvector_type_const_ptr* bv_src,
+                                      unsigned src_size)
+{
+    unsigned top_size = src_size ? ~0u : 0u;
+    for (unsigned k = 0; k < src_size; ++k)
+    {
+        const blocks_manager_type& bman = bv_src[k]->get_blocks_manager();
+        unsigned arg_top_size = bman.is_init() ? bman.top_block_size() : 0;
+        if (arg_top_size < top_size)
+            top_size = arg_top_size;
+    } // for k
+    return top_size;
+}
+
+// ------------------------------------------------------------------------
+
+template<typename BV>
+unsigned aggregator<BV>::prepare_target(bvector_type& bv_target,
+                                        const bvector_type_const_ptr* bv_src,
+                                        unsigned src_size, bool is_and)
+{
+    BM_ASSERT(src_size <= max_aggregator_cap);
+    BM_ASSERT_THROW(src_size <= max_aggregator_cap, BM_ERR_RANGE);
+
+    bv_target.clear(true);
+    if (!src_size)
+        return 0;
+
+    typename bvector_type::size_type sz = 0;
+    unsigned top_size = is_and ? ~0u : 0u;
+    for (unsigned k = 0; k < src_size; ++k)
+    {
+        const bvector_type* bv = bv_src[k];
+        BM_ASSERT(bv);
+        BM_ASSERT(bv != &bv_target);
+        if (bv->size() > sz)
+            sz = bv->size();
+        const blocks_manager_type& bman = bv->get_blocks_manager();
+        unsigned arg_top_size = bman.is_init() ? bman.top_block_size() : 0;
+        if (is_and)
+        {
+            if (arg_top_size < top_size)
+                top_size = arg_top_size;
+        }
+        else
+        {
+            if (arg_top_size > top_size)
+                top_size = arg_top_size;
+        }
+    } // for k
+    if (sz > bv_target.size())
+        bv_target.resize(sz);
+    if (top_size)
+        bv_target.get_blocks_manager().reserve_top_blocks(top_size);
+    return top_size;
+}
+
+// ------------------------------------------------------------------------
+
+template<typename BV>
+bool aggregator<BV>::any_sub_array(unsigned i,
+                        const bvector_type_const_ptr* bv_src, unsigned src_size)
+{
+    for (unsigned k = 0; k < src_size; ++k)
+    {
+        const blocks_manager_type& bman = bv_src[k]->get_blocks_manager();
+        if (i < bman.top_block_size() && bman.top_blocks_root()[i])
+            return true;
+    }
+    return false;
+}
+
+// ------------------------------------------------------------------------
+
+template<typename BV>
+bool aggregator<BV>::all_sub_array(unsigned i,
+                        const bvector_type_const_ptr* bv_src, unsigned src_size)
+{
+    for (unsigned k = 0; k < src_size; ++k)
+    {
+        const blocks_manager_type& bman = bv_src[k]->get_blocks_manager();
+        if (i >= bman.top_block_size() || !bman.top_blocks_root()[i])
+            return false;
+    }
+    return true;
+}
+
+// ------------------------------------------------------------------------
+
+template<typename BV>
+unsigned aggregator<BV>::sort_input_blocks(unsigned nb,
+                                        const bvector_type_const_ptr* bv_src,
+                                        unsigned src_size,
+                                        unsigned* bit_cnt, unsigned* gap_cnt,
+                                        bool* has_full, bool* has_null)
+{
+    unsigned bc = 0, gc = 0;
+    *has_full = *has_null = false;
+    for (unsigned k = 0; k < src_size; ++k)
+    {
+        const bm::word_t* block =
+                    bv_src[k]->get_blocks_manager().get_block_ptr(nb);
+        if (!block)
+        {
+            *has_null = true;
+            continue;
+        }
+        if (BM_IS_GAP(block))
+        {
+            v_arg_blk_gap_[gc++] = BMGAP_PTR(block);
+        }
+        else
+        if (IS_FULL_BLOCK(block))
+        {
+            *has_full = true;
+        }
+        else
+        {
+            v_arg_blk_[bc++] = block;
+        }
+    } // for k
+    *bit_cnt = bc;
+    *gap_cnt = gc;
+    return bc + gc;
+}
+
+// ------------------------------------------------------------------------
+
+template<typename BV>
+void aggregator<BV>::combine_or(unsigned nb, blocks_manager_type& bman_target,
+                        const bvector_type_const_ptr* bv_src, unsigned src_size)
+{
+    unsigned bit_cnt, gap_cnt;
+    bool has_full, has_null;
+    unsigned blk_cnt =
+        sort_input_blocks(nb, bv_src, src_size,
+                          &bit_cnt, &gap_cnt, &has_full, &has_null);
+    if (has_full)
+    {
+        bman_target.set_block_all_set(nb);
+        return;
+    }
+    if (!blk_cnt)
+        return;
+    if (blk_cnt == 1)
+    {
+        copy_target_block(nb, bman_target,
+                          bit_cnt ? v_arg_blk_[0] : 0, v_arg_blk_gap_[0]);
+        return;
+    }
+
+    unsigned k, gap_from = 0;
+    if (bit_cnt)
+    {
+        bm::bit_block_copy(tb_, v_arg_blk_[0]);
+        for (k = 1; k < bit_cnt; ++k)
+            bm::bit_block_or(tb_, v_arg_blk_[k]);
+    }
+    else
+    {
+        bm::gap_convert_to_bitset(tb_, v_arg_blk_gap_[0]);
+        gap_from = 1;
+    }
+    for (k = gap_from; k < gap_cnt; ++k)
+        bm::gap_add_to_bitset(tb_, v_arg_blk_gap_[k]);
+
+    assign_target_block(nb, bman_target);
+}
+
+// ------------------------------------------------------------------------
+
+template<typename BV>
+void aggregator<BV>::combine_and(unsigned nb, blocks_manager_type& bman_target,
+                        const bvector_type_const_ptr* bv_src, unsigned src_size)
+{
+    switch (process_and(nb, bv_src, src_size, true))
+    {
+    case blk_temp:
+        assign_target_block(nb, bman_target);
+        break;
+    case blk_full:
+        bman_target.set_block_all_set(nb);
+        break;
+    case blk_single:
+        copy_target_block(nb, bman_target,
+                          v_arg_blk_gap_[0] ? 0 : v_arg_blk_[0],
+                          v_arg_blk_gap_[0]);
+        break;
+    default:
+        break;
+    } // switch
+}
+
+// ------------------------------------------------------------------------
+
+template<typename BV>
+unsigned aggregator<BV>::process_and(unsigned nb,
+                        const bvector_type_const_ptr* bv_src, unsigned src_size,
+                        bool copy_single)
+{
+    unsigned bit_cnt, gap_cnt;
+    bool has_full, has_null;
+    unsigned blk_cnt =
+        sort_input_blocks(nb, bv_src, src_size,
+                          &bit_cnt, &gap_cnt, &has_full, &has_null);
+    if (has_null) // AND with an empty block is empty
+        return blk_empty;
+    if (!blk_cnt) // all arguments are FULL blocks
+        return blk_full;
+    if (blk_cnt == 1 && copy_single)
+    {
+        if (bit_cnt)
+            v_arg_blk_gap_[0] = 0;
+        return blk_single;
+    }
+
+    // GAP blocks are cheap to apply, use them first to find
+    // empty result as early as possible
+    unsigned k, gap_from = 0;
+    if (bit_cnt)
+    {
+        bm::bit_block_copy(tb_, v_arg_blk_[0]);
+    }
+    else
+    {
+        bm::gap_convert_to_bitset(tb_, v_arg_blk_gap_[0]);
+        gap_from = 1;
+    }
+    for (k = gap_from; k < gap_cnt; ++k)
+    {
+        if (bm::gap_is_all_zero(v_arg_blk_gap_[k], bm::gap_max_bits))
+            return blk_empty;
+        bm::gap_and_to_bitset(tb_, v_arg_blk_gap_[k]);
+    }
+    if (gap_cnt && is_temp_zero())
+        return blk_empty;
+    for (k = 1; k < bit_cnt; ++k)
+    {
+        bm::bit_block_and(tb_, v_arg_blk_[k]);
+        if (is_temp_zero())
+            return blk_empty; // early exit: AND result is empty
+    }
+    return blk_temp;
+}
+
+// ------------------------------------------------------------------------
+
+template<typename BV>
+unsigned aggregator<BV>::process_and_sub(unsigned nb,
+                const bvector_type_const_ptr* bv_src_and, unsigned src_and_size,
+                const bvector_type_const_ptr* bv_src_sub, unsigned src_sub_size)
+{
+    unsigned res = process_and(nb, bv_src_and, src_and_size, false);
+    if (res == blk_empty || !src_sub_size)
+        return res;
+
+    unsigned bit_cnt, gap_cnt;
+    bool has_full, has_null;
+    unsigned blk_cnt =
+        sort_input_blocks(nb, bv_src_sub, src_sub_size,
+                          &bit_cnt, &gap_cnt, &has_full, &has_null);
+    if (has_full) // SUB of a FULL block is empty
+        return blk_empty;
+    if (!blk_cnt)
+        return res;
+    if (res == blk_full)
+        bm::bit_block_set(tb_, ~0u);
+
+    unsigned k;
+    for (k = 0; k < gap_cnt; ++k)
+        bm::gap_sub_to_bitset(tb_, v_arg_blk_gap_[k]);
+    if (gap_cnt && is_temp_zero())
+        return blk_empty;
+    for (k = 0; k < bit_cnt; ++k)
+    {
+        bm::bit_block_sub(tb_, v_arg_blk_[k]);
+        if (is_temp_zero())
+            return blk_empty; // early exit: result is empty
+    }
+    return blk_temp;
+}
+
+// ------------------------------------------------------------------------
+
+template<typename BV>
+void aggregator<BV>::assign_target_block(unsigned nb,
+                                         blocks_manager_type& bman_target)
+{
+    if (bm::bit_is_all_zero((bm::wordop_t*)tb_,
+                            (bm::wordop_t*)(tb_ + bm::set_block_size)))
+        return;
+    if (bm::is_bits_one((bm::wordop_t*)tb_,
+                        (bm::wordop_t*)(tb_ + bm::set_block_size)))
+    {
+        bman_target.set_block_all_set(nb);
+        return;
+    }
+    bm::word_t* blk = bman_target.get_allocator().alloc_bit_block();
+    bm::bit_block_copy(blk, tb_);
+    bm::word_t* old_blk = bman_target.set_block(nb, blk);
+    BM_ASSERT(!old_blk); (void) old_blk;
+}
+
+// ------------------------------------------------------------------------
+
+template<typename BV>
+void aggregator<BV>::copy_target_block(unsigned nb,
+                                       blocks_manager_type& bman_target,
+                                       const bm::word_t* block,
+                                       const bm::gap_word_t* gap_block)
+{
+    if (block)
+    {
+        bm::word_t* blk = bman_target.get_allocator().alloc_bit_block();
+        bm::bit_block_copy(blk, block);
+        bman_target.set_block(nb, blk);
+    }
+    else
+    {
+        BM_ASSERT(gap_block);
+        unsigned len = bm::gap_length(gap_block);
+        int level = bm::gap_calc_level(len, bman_target.glen());
+        bman_target.set_gap_block(nb, gap_block, level);
+    }
+}
+
+// ------------------------------------------------------------------------
+
+
+} // namespace bm
+
+#include "bmundef.h"
+
+#endif
@@ -62,7 +62,7 @@ void for_each_bit(const BV&    bv,
                 if (BM_IS_GAP(block))
                 {
                     bm::for_each_gap_blk(BMGAP_PTR(block),
-                                         nb * bm::bits_in_block,
+                                         bm::id_t(nb) * bm::bits_in_block,
                                          bit_functor);
                 }
                 else
@@ -70,7 +70,7 @@ void for_each_bit(const BV&    bv,
                     // TODO: optimize FULL BLOCK ADDRESS scan
                     block = BLOCK_ADDR_SAN(block);
                     
-                    bm::for_each_bit_blk(block, nb * bm::bits_in_block,
+                    bm::for_each_bit_blk(block, bm::id_t(nb) * bm::bits_in_block,
                                          bit_functor);
                 }
             }
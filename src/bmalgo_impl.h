@@ -731,7 +731,8 @@ void distance_operation(const BV& bv1,
 
     for (i = 0; i < effective_top_block_size; ++i)
     {
-        bm::word_t** blk_blk = blk_root ? blk_root[i] : 0;
+        bm::word_t** blk_blk = 
+            (blk_root && i < bman1.top_block_size()) ? blk_root[i] : 0;
 
         if (blk_blk == 0) // not allocated
         {
@@ -794,7 +795,7 @@ void distance_operation(const BV& bv1,
 */
 
 template<class BV>
-unsigned distance_and_operation(const BV& bv1, 
+bm::id_t distance_and_operation(const BV& bv1, 
                                 const BV& bv2)
 {
     const typename BV::blocks_manager_type& bman1 = bv1.get_blocks_manager();
@@ -805,7 +806,7 @@ unsigned distance_and_operation(const BV& bv1,
 
     bm::word_t*** blk_root     = bman1.top_blocks_root();
     bm::word_t*** blk_root_arg = bman2.top_blocks_root();
-    unsigned count = 0;
+    bm::id_t count = 0;
 
     BM_SET_MMX_GUARD
 
@@ -895,7 +896,8 @@ void distance_operation_any(const BV& bv1,
 
     for (i = 0; i < effective_top_block_size; ++i)
     {
-        bm::word_t** blk_blk = blk_root ? blk_root[i] : 0;
+        bm::word_t** blk_blk = 
+            (blk_root && i < bman1.top_block_size()) ? blk_root[i] : 0;
 
         if (blk_blk == 0) // not allocated
         {
@@ -1123,16 +1125,16 @@ bm::id_t any_or(const BV& bv1, const BV& bv2)
     \internal
 */
 template<class It>
-It block_range_scan(It  first, It last, unsigned nblock, unsigned* max_id)
+It block_range_scan(It  first, It last, unsigned nblock, bm::id_t* max_id)
 {
     It right;
     for (right = first; right != last; ++right)
     {
-        unsigned v = unsigned(*right);
+        bm::id_t v = bm::id_t(*right);
         BM_ASSERT(v < bm::id_max);
         if (v >= *max_id)
             *max_id = v;
-        unsigned nb = v >> bm::set_block_shift;
+        unsigned nb = unsigned(v >> bm::set_block_shift);
         if (nb != nblock)
             break;
     }
@@ -1159,7 +1161,7 @@ void combine_or(BV& bv, It  first, It last)
     if (!bman.is_init())
         bman.init_tree();
     
-    unsigned max_id = 0;
+    bm::id_t max_id = 0;
 
     while (first < last)
     {
@@ -1193,7 +1195,7 @@ void combine_or(BV& bv, It  first, It last)
             for (; first < right; ++first)
             {
                 unsigned is_set;
-                unsigned nbit   = (*first) & bm::set_block_mask; 
+                unsigned nbit   = unsigned(*first & bm::set_block_mask); 
                 
                 unsigned new_block_len =
                     gap_set_value(true, gap_blk, nbit, &is_set);
@@ -1241,7 +1243,7 @@ void combine_xor(BV& bv, It  first, It last)
     if (!bman.is_init())
         bman.init_tree();
     
-    unsigned max_id = 0;
+    bm::id_t max_id = 0;
 
     while (first < last)
     {
@@ -1275,7 +1277,7 @@ void combine_xor(BV& bv, It  first, It last)
             for (; first < right; ++first)
             {
                 unsigned is_set;
-                unsigned nbit   = (*first) & bm::set_block_mask; 
+                unsigned nbit   = unsigned(*first & bm::set_block_mask); 
                 
                 is_set = bm::gap_test_unr(gap_blk, nbit);
                 BM_ASSERT(is_set <= 1);
@@ -1328,7 +1330,7 @@ void combine_sub(BV& bv, It  first, It last)
     if (!bman.is_init())
         bman.init_tree();
     
-    unsigned max_id = 0;
+    bm::id_t max_id = 0;
 
     while (first < last)
     {
@@ -1363,7 +1365,7 @@ void combine_sub(BV& bv, It  first, It last)
             for (; first < right; ++first)
             {
                 unsigned is_set;
-                unsigned nbit   = (*first) & bm::set_block_mask; 
+                unsigned nbit   = unsigned(*first & bm::set_block_mask); 
                 
                 is_set = bm::gap_test_unr(gap_blk, nbit);
                 if (!is_set)
@@ -1674,7 +1676,7 @@ void for_each_bit_blk(const bm::word_t* block, bm::id_t offset,
 {
     unsigned char bits[bm::set_bitscan_wave_size*32];
 
-    unsigned offs = offset;
+    bm::id_t offs = offset;
     unsigned cnt;
     
     const word_t* block_end = block + bm::set_block_size;
@@ -24,10 +24,14 @@ For more information please visit:  http://bitmagic.io
 namespace bm
 {
 
-#if defined(BMSSE2OPT) || defined(BMSSE42OPT)
+#if defined(BM_SIMD_DISPATCH)
+#define BM_ALLOC_ALIGN 32
+#elif defined(BMSSE2OPT) || defined(BMSSE42OPT)
 #define BM_ALLOC_ALIGN 16
 #endif
-#if defined(BMAVX2OPT)
+#if defined(BMAVX512OPT)
+#define BM_ALLOC_ALIGN 64
+#elif defined(BMAVX2OPT)
 #define BM_ALLOC_ALIGN 32
 #endif
 
@@ -235,6 +239,266 @@ private:
 
 typedef mem_alloc<block_allocator, ptr_allocator> standard_allocator;
 
+// -------------------------------------------------------------------------
+
+/// Pooled allocator parameters
+enum alloc_pool_params
+{
+    /// max number of block sizes (bit block + GAP levels) kept in the pool
+    alloc_pool_size_classes = 8,
+    /// default limit of memory retained by the pool (bytes)
+    alloc_pool_retain_default = 16 * 1024 * 1024
+};
+
+/*! @brief Statistics of the block pool
+    @ingroup alloc
+*/
+struct alloc_pool_stat
+{
+    size_t  alloc_cnt;       ///< number of allocations
+    size_t  hit_cnt;         ///< allocations served from the pool
+    size_t  free_cnt;        ///< number of deallocations
+    size_t  retained_blocks; ///< number of free blocks kept in the pool
+    size_t  retained_mem;    ///< memory kept in the pool (bytes)
+
+    alloc_pool_stat() { reset(); }
+    void reset()
+    {
+        alloc_cnt = hit_cnt = free_cnt = retained_blocks = retained_mem = 0;
+    }
+    /// share of allocations served from the pool
+    double hit_rate() const
+    {
+        return alloc_cnt ? double(hit_cnt) / double(alloc_cnt) : 0.0;
+    }
+};
+
+/*! @brief Pool of free blocks on top of a block allocator.
+
+  Keeps free lists of blocks per size class (bit blocks and GAP levels,
+  allocations up to bm::set_block_size words), other sizes go directly
+  to the underlying allocator. Free blocks are linked through their
+  first word. Pool is not thread safe.
+
+  @ingroup alloc
+*/
+template<class BA = block_allocator>
+class block_pool
+{
+public:
+    block_pool(size_t max_retained = bm::alloc_pool_retain_default)
+    : class_cnt_(0), max_retained_(max_retained)
+    {}
+
+    ~block_pool() { free_pools(); }
+
+    /// Allocate n words (from the pool if possible)
+    bm::word_t* allocate(size_t n, const void* hint)
+    {
+        ++stat_.alloc_cnt;
+        unsigned c = find_class(n);
+        if (c < class_cnt_ && free_list_[c])
+        {
+            free_node* node = free_list_[c];
+            free_list_[c] = node->next;
+            ++stat_.hit_cnt;
+            --stat_.retained_blocks;
+            stat_.retained_mem -= n * sizeof(bm::word_t);
+            return (bm::word_t*) node;
+        }
+        return BA::allocate(n, hint);
+    }
+
+    /// Return n words block to the pool
+    void deallocate(bm::word_t* p, size_t n)
+    {
+        ++stat_.free_cnt;
+        size_t mem = n * sizeof(bm::word_t);
+        if (n <= bm::set_block_size && n * sizeof(bm::word_t) >= sizeof(void*) &&
+            stat_.retained_mem + mem <= max_retained_)
+        {
+            unsigned c = find_class(n);
+            if (c == class_cnt_ && class_cnt_ < bm::alloc_pool_size_classes)
+            {
+                class_size_[c] = n;
+                free_list_[c] = 0;
+                ++class_cnt_;
+            }
+            if (c < class_cnt_)
+            {
+                free_node* node = (free_node*) p;
+                node->next = free_list_[c];
+                free_list_[c] = node;
+                ++stat_.retained_blocks;
+                stat_.retained_mem += mem;
+                return;
+            }
+        }
+        BA::deallocate(p, n);
+    }
+
+    /// Release all retained blocks to the underlying allocator
+    void free_pools()
+    {
+        for (unsigned c = 0; c < class_cnt_; ++c)
+        {
+            while (free_list_[c])
+            {
+                free_node* node = free_list_[c];
+                free_list_[c] = node->next;
+                BA::deallocate((bm::word_t*) node, class_size_[c]);
+            }
+        }
+        stat_.retained_blocks = stat_.retained_mem = 0;
+    }
+
+    /// Set limit of memory retained by the pool (bytes)
+    void set_max_retained(size_t max_retained)
+        { max_retained_ = max_retained; }
+
+    size_t get_max_retained() const { return max_retained_; }
+
+    /// Pool statistics
+    const alloc_pool_stat& get_stat() const { return stat_; }
+
+    /// Reset allocation counters (retained memory is kept)
+    void reset_stat()
+    {
+        stat_.alloc_cnt = stat_.hit_cnt = stat_.free_cnt = 0;
+    }
+
+private:
+    block_pool(const block_pool&);
+    block_pool& operator=(const block_pool&);
+
+    struct free_node
+    {
+        free_node* next;
+    };
+
+    unsigned find_class(size_t n) const
+    {
+        unsigned c = 0;
+        for (; c < class_cnt_; ++c)
+            if (class_size_[c] == n)
+                break;
+        return c;
+    }
+
+private:
+    free_node*      free_list_[bm::alloc_pool_size_classes];
+    size_t          class_size_[bm::alloc_pool_size_classes];
+    unsigned        class_cnt_;
+    size_t          max_retained_;
+    alloc_pool_stat stat_;
+};
+
+#if !defined(BM_NO_CXX11) && !(defined(_MSC_VER) && _MSC_VER < 1900)
+
+/*! @brief Block allocator with a thread-local pool of free blocks.
+
+  Blocks released by a thread are re-used by the next allocations of
+  the same thread (blocks can be released by any thread).
+  Pool of a thread is released when the thread exits.
+  Use as bvector<> allocator via bm::pooled_allocator.
+
+  @ingroup alloc
+*/
+class pooled_block_allocator
+{
+public:
+    typedef bm::block_pool<bm::block_allocator> pool_type;
+
+    static bm::word_t* allocate(size_t n, const void* hint)
+    {
+        pool_type* pool = get_pool();
+        return pool ? pool->allocate(n, hint)
+                    : bm::block_allocator::allocate(n, hint);
+    }
+
+    static void deallocate(bm::word_t* p, size_t n)
+    {
+        pool_type* pool = get_pool();
+        if (pool)
+            pool->deallocate(p, n);
+        else
+            bm::block_allocator::deallocate(p, n);
+    }
+
+    /// Statistics of the pool of the calling thread
+    static alloc_pool_stat get_stat()
+    {
+        pool_type* pool = get_pool();
+        return pool ? pool->get_stat() : alloc_pool_stat();
+    }
+
+    /// Reset allocation counters of the calling thread
+    static void reset_stat()
+    {
+        pool_type* pool = get_pool();
+        if (pool)
+            pool->reset_stat();
+    }
+
+    /// Release memory retained by the pool of the calling thread
+    static void free_pools()
+    {
+        pool_type* pool = get_pool();
+        if (pool)
+            pool->free_pools();
+    }
+
+    /// Set limit of memory retained by the pool of the calling thread
+    static void set_max_retained(size_t max_retained)
+    {
+        pool_type* pool = get_pool();
+        if (pool)
+            pool->set_max_retained(max_retained);
+    }
+
+private:
+    /// pool of the thread destroyed on thread exit
+    struct pool_guard
+    {
+        ~pool_guard()
+        {
+            delete tls_pool();
+            tls_pool() = 0;
+            tls_exited() = true;
+        }
+    };
+
+    static pool_type*& tls_pool()
+    {
+        static thread_local pool_type* pool = 0;
+        return pool;
+    }
+
+    static bool& tls_exited()
+    {
+        static thread_local bool exited = false;
+        return exited;
+    }
+
+    /// thread pool (NULL after thread-local destruction on exit)
+    static pool_type* get_pool()
+    {
+        pool_type*& pool = tls_pool();
+        if (!pool && !tls_exited())
+        {
+            static thread_local pool_guard guard;
+            (void)guard;
+            pool = new pool_type();
+        }
+        return pool;
+    }
+};
+
+/// bvector<> allocator with thread-local pools of bit and GAP blocks
+typedef mem_alloc<pooled_block_allocator, ptr_allocator> pooled_allocator;
+
+#endif
+
 /** @} */
 
 #undef BM_ALLOC_ALIGN
@@ -800,6 +800,106 @@ bool avx2_is_all_one(const __m256i* BMRESTRICT block,
 
 
 
+/*!
+    @brief Decode 32-bit word into array of ON bit indexes (+ base)
+    Byte-wise table driven decoding, every byte is expanded into 8 
+    indexes, so up to 8 elements after the result get overwritten.
+    @return number of indexes
+    @ingroup AVX2
+*/
+inline
+unsigned avx2_bit_decode32(bm::word_t w, unsigned* BMRESTRICT arr, 
+                           unsigned base)
+{
+    unsigned* BMRESTRICT pcurr = arr;
+    const __m256i v8 = _mm256_set1_epi32(8);
+    __m256i vbase = _mm256_set1_epi32(int(base));
+    for (; w; w >>= 8, vbase = _mm256_add_epi32(vbase, v8))
+    {
+        unsigned b = w & 0xFFu;
+        if (!b)
+            continue;
+        __m128i bidx = _mm_loadl_epi64(
+                (const __m128i*)bm::bit_decode_table<true>::_idx[b]);
+        __m256i idx = _mm256_add_epi32(_mm256_cvtepu8_epi32(bidx), vbase);
+        _mm256_storeu_si256((__m256i*)pcurr, idx);
+        pcurr += _mm_popcnt_u32(b);
+    }
+    return unsigned(pcurr - arr);
+}
+
+/*!
+    @brief Bit transposition of 32-bit words array into bit-plain matrix
+    (AVX2 variant of vect_bit_transpose<unsigned, 32, set_block_plain_size>)
+    @sa sse2_bit_block_transpose32
+    @ingroup AVX2
+*/
+inline
+void avx2_bit_block_transpose32(const bm::word_t* BMRESTRICT arr,
+                                unsigned arr_size,
+                     bm::word_t tmatrix[bm::set_block_plain_cnt][bm::set_block_plain_size])
+{
+    BM_ASSERT(arr_size % 32 == 0);
+    for (unsigned col = 0; col < arr_size / 32; ++col, arr += 32)
+    {
+        __m256i v0 = _mm256_loadu_si256((const __m256i*)(arr + 0));
+        __m256i v1 = _mm256_loadu_si256((const __m256i*)(arr + 8));
+        __m256i v2 = _mm256_loadu_si256((const __m256i*)(arr + 16));
+        __m256i v3 = _mm256_loadu_si256((const __m256i*)(arr + 24));
+        for (int j = 31; j >= 0; --j)
+        {
+            unsigned w =
+                unsigned(_mm256_movemask_ps(_mm256_castsi256_ps(v0))) |
+               (unsigned(_mm256_movemask_ps(_mm256_castsi256_ps(v1))) << 8) |
+               (unsigned(_mm256_movemask_ps(_mm256_castsi256_ps(v2))) << 16) |
+               (unsigned(_mm256_movemask_ps(_mm256_castsi256_ps(v3))) << 24);
+            tmatrix[j][col] = w;
+            v0 = _mm256_slli_epi32(v0, 1);
+            v1 = _mm256_slli_epi32(v1, 1);
+            v2 = _mm256_slli_epi32(v2, 1);
+            v3 = _mm256_slli_epi32(v3, 1);
+        } // for j
+    } // for col
+}
+
+/*!
+    @brief Prefix XOR of bit block (bit i := XOR of bits [0..i])
+    @sa sse2_bit_block_xor_prefix
+    @ingroup AVX2
+*/
+inline
+void avx2_bit_block_xor_prefix(__m256i* BMRESTRICT block,
+                               __m256i* BMRESTRICT block_end,
+                               bm::word_t carry)
+{
+    const __m256i idx7 = _mm256_set1_epi32(7);
+    __m256i mc = _mm256_set1_epi32(int(carry));
+    do
+    {
+        __m256i x = _mm256_loadu_si256(block);
+        x = _mm256_xor_si256(x, _mm256_slli_epi32(x, 1));
+        x = _mm256_xor_si256(x, _mm256_slli_epi32(x, 2));
+        x = _mm256_xor_si256(x, _mm256_slli_epi32(x, 4));
+        x = _mm256_xor_si256(x, _mm256_slli_epi32(x, 8));
+        x = _mm256_xor_si256(x, _mm256_slli_epi32(x, 16));
+
+        // word parities: prefix in 128-bit halves, then low half total
+        // is carried to the high half
+        __m256i m = _mm256_srai_epi32(x, 31);
+        __m256i t = _mm256_xor_si256(m, _mm256_slli_si256(m, 4));
+        t = _mm256_xor_si256(t, _mm256_slli_si256(t, 8));
+        __m256i h = _mm256_permute2x128_si256(t, t, 0x08);
+        t = _mm256_xor_si256(t, _mm256_shuffle_epi32(h, 0xFF));
+        t = _mm256_xor_si256(t, m);
+
+        x = _mm256_xor_si256(x, t);
+
+        __m256i p = _mm256_permutevar8x32_epi32(_mm256_srai_epi32(x, 31), idx7);
+        _mm256_storeu_si256(block, _mm256_xor_si256(x, mc));
+        mc = _mm256_xor_si256(mc, p);
+    } while (++block < block_end);
+}
+
 #define VECT_XOR_ARR_2_MASK(dst, src, src_end, mask)\
     avx2_xor_arr_2_mask((__m256i*)(dst), (__m256i*)(src), (__m256i*)(src_end), (bm::word_t)mask)
 
@@ -848,6 +948,15 @@ bool avx2_is_all_one(const __m256i* BMRESTRICT block,
 #define VECT_IS_ONE_BLOCK(dst, dst_end) \
     avx2_is_all_one((__m256i*) dst, (__m256i*) (dst_end))
 
+#define VECT_BIT_DECODE32(w, arr, base) \
+    avx2_bit_decode32(w, arr, base)
+
+#define VECT_BIT_TRANSPOSE32(arr, arr_size, tmatrix) \
+    avx2_bit_block_transpose32(arr, arr_size, tmatrix)
+
+#define VECT_BIT_BLOCK_XOR_PREFIX(first, last, carry) \
+    avx2_bit_block_xor_prefix((__m256i*) (first), (__m256i*) (last), (carry))
+
 
 // TODO: write better pipelined AVX2 implementation
 /*!
@@ -0,0 +1,523 @@
+#ifndef BMAVX512__H__INCLUDED__
+#define BMAVX512__H__INCLUDED__
+/*
+Copyright(c) 2002-2017 Anatoliy Kuznetsov(anatoliy_kuznetsov at yahoo.com)
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+For more information please visit:  http://bitmagic.io
+*/
+
+/** @defgroup AVX512 AVX512 functions
+    Processor specific optimizations for AVX-512 instructions (internals)
+    @ingroup bvector
+    @internal
+ */
+
+
+// Header implements processor specific intrinsics declarations for AVX-512
+// (AVX512F + AVX512BW, VPOPCNTDQ when enabled by the compiler flags).
+// AVX-512 build mode is a superset of AVX2: this header is included after
+// bmavx2.h and replaces block level kernels (VECT_* macros) with 512-bit
+// variants, the rest of the AVX2 code stays in use.
+// Blocks are allocated 64-byte aligned (BM_ALLOC_ALIGN), kernels use
+// unaligned load/store forms which carry no penalty on aligned data and
+// keep 32-byte aligned external memory (views, user buffers) working.
+//
+#include<immintrin.h>
+
+#include "bmdef.h"
+
+
+namespace bm
+{
+
+/*!
+    @brief popcount of 64-bit lanes
+    Uses VPOPCNTDQ when available, nibble lookup (AVX512BW) otherwise.
+    @ingroup AVX512
+*/
+BMFORCEINLINE
+__m512i avx512_popcnt64(__m512i v)
+{
+#if defined(__AVX512VPOPCNTDQ__)
+    return _mm512_popcnt_epi64(v);
+#else
+    const __m512i lookup = _mm512_set4_epi32(0x04030302, 0x03020201,
+                                             0x03020201, 0x02010100);
+    const __m512i low_mask = _mm512_set1_epi8(0x0f);
+    __m512i lo = _mm512_and_si512(v, low_mask);
+    __m512i hi = _mm512_and_si512(_mm512_srli_epi16(v, 4), low_mask);
+    __m512i cnt = _mm512_add_epi8(_mm512_shuffle_epi8(lookup, lo),
+                                  _mm512_shuffle_epi8(lookup, hi));
+    return _mm512_sad_epu8(cnt, _mm512_setzero_si512());
+#endif
+}
+
+// GCC headers implement unmasked forms of some intrinsics (extract, cast to
+// 256-bit, andnot, shifts, alignr) as masked forms with an uninitialized
+// (_mm512_undefined) pass-through operand, which triggers
+// -W(maybe-)uninitialized,
+// zero-masked forms with a full mask compile to the same instructions.
+//
+#define BM_AVX512_FULL_MASK8 ((__mmask8)0xFF)
+
+/*!
+    @brief horizontal sum of 64-bit lanes
+    @ingroup AVX512
+*/
+BMFORCEINLINE
+bm::id64_t avx512_reduce_add64(__m512i v)
+{
+    __m256i s = _mm256_add_epi64(
+                    _mm512_maskz_extracti64x4_epi64(BM_AVX512_FULL_MASK8, v, 0),
+                    _mm512_maskz_extracti64x4_epi64(BM_AVX512_FULL_MASK8, v, 1));
+    __m128i s2 = _mm_add_epi64(_mm256_castsi256_si128(s),
+                               _mm256_extracti128_si256(s, 1));
+    return bm::id64_t(_mm_cvtsi128_si64(s2)) +
+           bm::id64_t(_mm_extract_epi64(s2, 1));
+}
+
+/*!
+    @brief AVX512 bit block popcount
+    @ingroup AVX512
+*/
+inline
+bm::id_t avx512_bit_count(const __m512i* BMRESTRICT block,
+                          const __m512i* BMRESTRICT block_end)
+{
+    __m512i cnt0 = _mm512_setzero_si512();
+    __m512i cnt1 = _mm512_setzero_si512();
+    for (; block + 2 <= block_end; block += 2)
+    {
+        cnt0 = _mm512_add_epi64(cnt0,
+                    bm::avx512_popcnt64(_mm512_loadu_si512(block)));
+        cnt1 = _mm512_add_epi64(cnt1,
+                    bm::avx512_popcnt64(_mm512_loadu_si512(block+1)));
+    }
+    if (block < block_end)
+        cnt0 = _mm512_add_epi64(cnt0,
+                    bm::avx512_popcnt64(_mm512_loadu_si512(block)));
+    return (bm::id_t)bm::avx512_reduce_add64(_mm512_add_epi64(cnt0, cnt1));
+}
+
+#define BM_AVX512_BIT_COUNT_OP(name, vop) \
+inline \
+bm::id_t name(const __m512i* BMRESTRICT block, \
+              const __m512i* BMRESTRICT block_end, \
+              const __m512i* BMRESTRICT mask_block) \
+{ \
+    __m512i cnt0 = _mm512_setzero_si512(); \
+    __m512i cnt1 = _mm512_setzero_si512(); \
+    for (; block + 2 <= block_end; block += 2, mask_block += 2) \
+    { \
+        __m512i v0 = vop(_mm512_loadu_si512(block), \
+                         _mm512_loadu_si512(mask_block)); \
+        __m512i v1 = vop(_mm512_loadu_si512(block+1), \
+                         _mm512_loadu_si512(mask_block+1)); \
+        cnt0 = _mm512_add_epi64(cnt0, bm::avx512_popcnt64(v0)); \
+        cnt1 = _mm512_add_epi64(cnt1, bm::avx512_popcnt64(v1)); \
+    } \
+    if (block < block_end) \
+    { \
+        __m512i v0 = vop(_mm512_loadu_si512(block), \
+                         _mm512_loadu_si512(mask_block)); \
+        cnt0 = _mm512_add_epi64(cnt0, bm::avx512_popcnt64(v0)); \
+    } \
+    return (bm::id_t)bm::avx512_reduce_add64(_mm512_add_epi64(cnt0, cnt1)); \
+}
+
+#define BM_AVX512_ANDNOT(a, b) \
+    _mm512_maskz_andnot_epi64(BM_AVX512_FULL_MASK8, b, a)
+
+/*!
+  @fn avx512_bit_count_and
+  @brief AND bit count for two bit-blocks
+  @ingroup AVX512
+*/
+BM_AVX512_BIT_COUNT_OP(avx512_bit_count_and, _mm512_and_si512)
+
+/*!
+  @fn avx512_bit_count_or
+  @brief OR bit count for two bit-blocks
+  @ingroup AVX512
+*/
+BM_AVX512_BIT_COUNT_OP(avx512_bit_count_or, _mm512_or_si512)
+
+/*!
+  @fn avx512_bit_count_xor
+  @brief XOR bit count for two bit-blocks
+  @ingroup AVX512
+*/
+BM_AVX512_BIT_COUNT_OP(avx512_bit_count_xor, _mm512_xor_si512)
+
+/*!
+  @fn avx512_bit_count_sub
+  @brief AND NOT bit count for two bit-blocks
+  @ingroup AVX512
+*/
+BM_AVX512_BIT_COUNT_OP(avx512_bit_count_sub, BM_AVX512_ANDNOT)
+
+#undef BM_AVX512_BIT_COUNT_OP
+
+
+/*!
+    @brief XOR array elements to specified mask
+    *dst = *src ^ mask
+
+    @ingroup AVX512
+*/
+inline
+void avx512_xor_arr_2_mask(__m512i* BMRESTRICT dst,
+                           const __m512i* BMRESTRICT src,
+                           const __m512i* BMRESTRICT src_end,
+                           bm::word_t mask)
+{
+    __m512i zmm2 = _mm512_set1_epi32(int(mask));
+    do
+    {
+        _mm512_storeu_si512(dst,
+                    _mm512_xor_si512(_mm512_loadu_si512(src), zmm2));
+        ++dst;
+    } while (++src < src_end);
+}
+
+/*!
+    @brief Inverts array elements and NOT them to specified mask
+    *dst = ~*src & mask
+
+    @ingroup AVX512
+*/
+inline
+void avx512_andnot_arr_2_mask(__m512i* BMRESTRICT dst,
+                              const __m512i* BMRESTRICT src,
+                              const __m512i* BMRESTRICT src_end,
+                              bm::word_t mask)
+{
+    __m512i zmm2 = _mm512_set1_epi32(int(mask));
+    do
+    {
+        _mm512_storeu_si512(dst,
+                    BM_AVX512_ANDNOT(zmm2, _mm512_loadu_si512(src)));
+        ++dst;
+    } while (++src < src_end);
+}
+
+#define BM_AVX512_ARR_OP(name, vop) \
+inline \
+void name(__m512i* BMRESTRICT dst, \
+          const __m512i* BMRESTRICT src, \
+          const __m512i* BMRESTRICT src_end) \
+{ \
+    do \
+    { \
+        __m512i zmm0 = vop(_mm512_loadu_si512(dst+0), _mm512_loadu_si512(src+0)); \
+        __m512i zmm1 = vop(_mm512_loadu_si512(dst+1), _mm512_loadu_si512(src+1)); \
+        _mm512_storeu_si512(dst+0, zmm0); \
+        _mm512_storeu_si512(dst+1, zmm1); \
+        dst += 2; src += 2; \
+    } while (src < src_end); \
+}
+
+/*!
+    @fn avx512_and_arr
+    @brief AND array elements against another array
+    *dst &= *src
+
+    @ingroup AVX512
+*/
+BM_AVX512_ARR_OP(avx512_and_arr, _mm512_and_si512)
+
+/*!
+    @fn avx512_or_arr
+    @brief OR array elements against another array
+    *dst |= *src
+
+    @ingroup AVX512
+*/
+BM_AVX512_ARR_OP(avx512_or_arr, _mm512_or_si512)
+
+/*!
+    @fn avx512_xor_arr
+    @brief XOR array elements against another array
+    *dst ^= *src
+
+    @ingroup AVX512
+*/
+BM_AVX512_ARR_OP(avx512_xor_arr, _mm512_xor_si512)
+
+/*!
+    @fn avx512_sub_arr
+    @brief AND-NOT (SUB) array elements against another array
+    *dst &= ~*src
+
+    @ingroup AVX512
+*/
+BM_AVX512_ARR_OP(avx512_sub_arr, BM_AVX512_ANDNOT)
+
+#undef BM_AVX512_ARR_OP
+#undef BM_AVX512_ANDNOT
+
+
+/*!
+    @brief AVX512 block memset
+    *dst = value
+
+    @ingroup AVX512
+*/
+BMFORCEINLINE
+void avx512_set_block(__m512i* BMRESTRICT dst,
+                      __m512i* BMRESTRICT dst_end,
+                      bm::word_t value)
+{
+    __m512i zmm0 = _mm512_set1_epi32(int(value));
+    do
+    {
+        _mm512_storeu_si512(dst, zmm0);
+    } while (++dst < dst_end);
+}
+
+/*!
+    @brief AVX512 block copy
+    *dst = *src
+
+    @ingroup AVX512
+*/
+inline
+void avx512_copy_block(__m512i* BMRESTRICT dst,
+                       const __m512i* BMRESTRICT src,
+                       const __m512i* BMRESTRICT src_end)
+{
+    do
+    {
+        __m512i zmm0 = _mm512_loadu_si512(src+0);
+        __m512i zmm1 = _mm512_loadu_si512(src+1);
+        __m512i zmm2 = _mm512_loadu_si512(src+2);
+        __m512i zmm3 = _mm512_loadu_si512(src+3);
+
+        _mm512_storeu_si512(dst+0, zmm0);
+        _mm512_storeu_si512(dst+1, zmm1);
+        _mm512_storeu_si512(dst+2, zmm2);
+        _mm512_storeu_si512(dst+3, zmm3);
+
+        src += 4;
+        dst += 4;
+    } while (src < src_end);
+}
+
+/*!
+    @brief Invert array elements
+    *dst = ~*dst
+
+    @ingroup AVX512
+*/
+inline
+void avx512_invert_arr(bm::word_t* BMRESTRICT first,
+                       bm::word_t* BMRESTRICT last)
+{
+    __m512i maskF = _mm512_set1_epi32(-1);
+    __m512i* wrd_ptr = (__m512i*)first;
+    do
+    {
+        __m512i zmm0 = _mm512_loadu_si512(wrd_ptr+0);
+        __m512i zmm1 = _mm512_loadu_si512(wrd_ptr+1);
+        _mm512_storeu_si512(wrd_ptr+0, _mm512_xor_si512(zmm0, maskF));
+        _mm512_storeu_si512(wrd_ptr+1, _mm512_xor_si512(zmm1, maskF));
+        wrd_ptr += 2;
+    } while (wrd_ptr < (__m512i*)last);
+}
+
+/*!
+    @brief check if block is all zero bits
+    @ingroup AVX512
+*/
+inline
+bool avx512_is_all_zero(const __m512i* BMRESTRICT block,
+                        const __m512i* BMRESTRICT block_end)
+{
+    do
+    {
+        __m512i w = _mm512_or_si512(_mm512_loadu_si512(block+0),
+                                    _mm512_loadu_si512(block+1));
+        if (_mm512_test_epi64_mask(w, w))
+            return false;
+        block += 2;
+    } while (block < block_end);
+    return true;
+}
+
+/*!
+    @brief check if block is all one bits
+    @ingroup AVX512
+*/
+inline
+bool avx512_is_all_one(const __m512i* BMRESTRICT block,
+                       const __m512i* BMRESTRICT block_end)
+{
+    const __m512i maskF = _mm512_set1_epi32(-1);
+    do
+    {
+        __m512i w = _mm512_and_si512(_mm512_loadu_si512(block+0),
+                                     _mm512_loadu_si512(block+1));
+        if (_mm512_cmpneq_epi64_mask(w, maskF))
+            return false;
+        block += 2;
+    } while (block < block_end);
+    return true;
+}
+
+/*!
+    @brief AVX512 bitcounting and number of GAPs
+
+    Bit block is treated as a continuous bit stream: every 64-bit lane is
+    XOR-ed with itself shifted right by one bit, with the lowest bit of the
+    next lane carried into the top position, the popcount gives the number
+    of 0-1 and 1-0 transitions.
+
+    @ingroup AVX512
+*/
+inline
+bm::id_t avx512_bit_block_calc_count_change(const __m512i* BMRESTRICT block,
+                                            const __m512i* BMRESTRICT block_end,
+                                            unsigned*      BMRESTRICT bit_count)
+{
+    BM_ASSERT(block < block_end);
+    __m512i bcnt = _mm512_setzero_si512();
+    __m512i gcnt = _mm512_setzero_si512();
+    const __m512i zero = _mm512_setzero_si512();
+
+    __m512i v = _mm512_loadu_si512(block);
+    for (++block; ; ++block)
+    {
+        __m512i vn = (block < block_end) ? _mm512_loadu_si512(block) : zero;
+        __m512i nx = _mm512_maskz_alignr_epi64(BM_AVX512_FULL_MASK8,
+                                               vn, v, 1); // [v1..v7, vn0]
+        __m512i t = _mm512_xor_si512(v,
+            _mm512_or_si512(_mm512_maskz_srli_epi64(BM_AVX512_FULL_MASK8, v, 1),
+                            _mm512_maskz_slli_epi64(BM_AVX512_FULL_MASK8, nx, 63)));
+        bcnt = _mm512_add_epi64(bcnt, bm::avx512_popcnt64(v));
+        gcnt = _mm512_add_epi64(gcnt, bm::avx512_popcnt64(t));
+        if (block >= block_end)
+            break;
+        v = vn;
+    } // for
+
+    *bit_count = (unsigned)bm::avx512_reduce_add64(bcnt);
+
+    // the last bit has no successor: zero carried in is not a transition
+    const bm::id64_t* w64 = (const bm::id64_t*)block_end;
+    unsigned count = 1 + (unsigned)bm::avx512_reduce_add64(gcnt);
+    count -= unsigned(w64[-1] >> 63);
+    return count;
+}
+
+/*!
+    @brief Find first GAP element >= pos (masked scan of up to 32 elements)
+    Masked load does not touch the memory past size elements.
+    @param pbuf - GAP buffer pointer
+    @param pos - value to search for
+    @param size - number of elements to search (1..32)
+    @return index of the first element >= pos or size
+
+    @ingroup AVX512
+*/
+inline
+unsigned avx512_gap_find(const bm::gap_word_t* BMRESTRICT pbuf,
+                         const bm::gap_word_t pos, const unsigned size)
+{
+    BM_ASSERT(size <= 32);
+    BM_ASSERT(size);
+
+    __mmask32 lmask = (__mmask32)(~0u >> (32 - size));
+    __m512i v = _mm512_maskz_loadu_epi16(lmask, pbuf);
+    __mmask32 ge = _mm512_mask_cmpge_epu16_mask(lmask, v,
+                                                _mm512_set1_epi16(short(pos)));
+    if (ge)
+        return (unsigned)_tzcnt_u32((unsigned)ge);
+    return size;
+}
+
+
+// AVX-512 kernels take over the block level operations of AVX2
+
+#undef VECT_XOR_ARR_2_MASK
+#undef VECT_ANDNOT_ARR_2_MASK
+#undef VECT_BITCOUNT
+#undef VECT_BITCOUNT_AND
+#undef VECT_BITCOUNT_OR
+#undef VECT_BITCOUNT_XOR
+#undef VECT_BITCOUNT_SUB
+#undef VECT_INVERT_ARR
+#undef VECT_AND_ARR
+#undef VECT_OR_ARR
+#undef VECT_SUB_ARR
+#undef VECT_XOR_ARR
+#undef VECT_COPY_BLOCK
+#undef VECT_SET_BLOCK
+#undef VECT_IS_ZERO_BLOCK
+#undef VECT_IS_ONE_BLOCK
+
+#define VECT_XOR_ARR_2_MASK(dst, src, src_end, mask)\
+    avx512_xor_arr_2_mask((__m512i*)(dst), (__m512i*)(src), (__m512i*)(src_end), (bm::word_t)mask)
+
+#define VECT_ANDNOT_ARR_2_MASK(dst, src, src_end, mask)\
+    avx512_andnot_arr_2_mask((__m512i*)(dst), (__m512i*)(src), (__m512i*)(src_end), (bm::word_t)mask)
+
+#define VECT_BITCOUNT(first, last) \
+    avx512_bit_count((__m512i*) (first), (__m512i*) (last))
+
+#define VECT_BITCOUNT_AND(first, last, mask) \
+    avx512_bit_count_and((__m512i*) (first), (__m512i*) (last), (__m512i*) (mask))
+
+#define VECT_BITCOUNT_OR(first, last, mask) \
+    avx512_bit_count_or((__m512i*) (first), (__m512i*) (last), (__m512i*) (mask))
+
+#define VECT_BITCOUNT_XOR(first, last, mask) \
+    avx512_bit_count_xor((__m512i*) (first), (__m512i*) (last), (__m512i*) (mask))
+
+#define VECT_BITCOUNT_SUB(first, last, mask) \
+    avx512_bit_count_sub((__m512i*) (first), (__m512i*) (last), (__m512i*) (mask))
+
+#define VECT_INVERT_ARR(first, last) \
+    avx512_invert_arr((bm::word_t*)first, (bm::word_t*)last);
+
+#define VECT_AND_ARR(dst, src, src_end) \
+    avx512_and_arr((__m512i*) dst, (__m512i*) (src), (__m512i*) (src_end))
+
+#define VECT_OR_ARR(dst, src, src_end) \
+    avx512_or_arr((__m512i*) dst, (__m512i*) (src), (__m512i*) (src_end))
+
+#define VECT_SUB_ARR(dst, src, src_end) \
+    avx512_sub_arr((__m512i*) dst, (__m512i*) (src), (__m512i*) (src_end))
+
+#define VECT_XOR_ARR(dst, src, src_end) \
+    avx512_xor_arr((__m512i*) dst, (__m512i*) (src), (__m512i*) (src_end))
+
+#define VECT_COPY_BLOCK(dst, src, src_end) \
+    avx512_copy_block((__m512i*) dst, (__m512i*) (src), (__m512i*) (src_end))
+
+#define VECT_SET_BLOCK(dst, dst_end, value) \
+    avx512_set_block((__m512i*) dst, (__m512i*) (dst_end), (value))
+
+#define VECT_IS_ZERO_BLOCK(dst, dst_end) \
+    avx512_is_all_zero((__m512i*) dst, (__m512i*) (dst_end))
+
+#define VECT_IS_ONE_BLOCK(dst, dst_end) \
+    avx512_is_all_one((__m512i*) dst, (__m512i*) (dst_end))
+
+
+#undef BM_AVX512_FULL_MASK8
+
+} // namespace
+
+#endif
@@ -668,7 +668,8 @@ public:
             word_t*** blk_root = bm->top_blocks_root();
 
             block_copy_func copy_func(*this, blockman);
-            for_each_nzblock(blk_root, top_block_size_, copy_func);
+            for_each_nzblock(blk_root, blockman.effective_top_block_size_, 
+                             copy_func);
         }
     }
     
@@ -750,7 +751,7 @@ public:
         unsigned top_block_sz = (unsigned)
             (bits_to_store / (bm::set_block_size * sizeof(bm::word_t) *
                                                 bm::set_array_size * 8));
-        if (top_block_sz < bm::set_array_size) ++top_block_sz;
+        if (top_block_sz < bm::set_top_array_size) ++top_block_sz;
         return top_block_sz;
     }
 
@@ -760,8 +761,8 @@ public:
     bm::id_t capacity() const
     {
         // arithmetic overflow protection...
-        return top_block_size_ == bm::set_array_size ? bm::id_max :
-            top_block_size_ * bm::set_array_size * bm::bits_in_block;
+        return top_block_size_ == bm::set_top_array_size ? bm::id_max :
+            bm::id_t(top_block_size_) * bm::set_array_size * bm::bits_in_block;
     }
 
     /**
@@ -1576,7 +1577,7 @@ public:
     bool is_subblock_null(unsigned nsub) const
     {
         BM_ASSERT(top_blocks_);
-        return top_blocks_[nsub] == NULL;
+        return (nsub >= top_block_size_) || (top_blocks_[nsub] == NULL);
     }
 
 
@@ -1616,10 +1617,22 @@ public:
         return effective_top_block_size_;
     }
 
+    /*! \brief Set effective size of the top block array (grow only)
+        Used to pre-size the tree before concurrent processing of
+        disjoint top blocks, so block assignments do not update it.
+        \internal
+    */
+    void set_effective_top_block_size(unsigned top_size)
+    {
+        BM_ASSERT(top_size <= top_block_size_);
+        if (top_size > effective_top_block_size_)
+            effective_top_block_size_ = top_size;
+    }
+
     /**
         \brief reserve capacity for specified number of bits
     */
-    void reserve(unsigned max_bits)
+    void reserve(bm::id_t max_bits)
     {
         if (max_bits) 
         {
@@ -1633,12 +1646,23 @@ public:
     */
     void reserve_top_blocks(unsigned top_blocks) 
     {
-        BM_ASSERT(top_blocks <= bm::set_array_size);
+        BM_ASSERT(top_blocks <= bm::set_top_array_size);
         
         if (!is_init())
             init_tree();
         
         if (top_blocks <= top_block_size_) return; // nothing to do
+#ifdef BM64ADDR
+        // 64-bit tree grows on demand: double the top level to keep
+        // the number of re-allocations logarithmic
+        {
+            unsigned top_blocks2 = top_block_size_ * 2;
+            if (top_blocks2 > bm::set_top_array_size)
+                top_blocks2 = bm::set_top_array_size;
+            if (top_blocks < top_blocks2)
+                top_blocks = top_blocks2;
+        }
+#endif
         bm::word_t*** new_blocks = 
             (bm::word_t***)alloc_.alloc_ptr(top_blocks);
 
@@ -0,0 +1,612 @@
+#ifndef BMBMATRIX__H__INCLUDED__
+#define BMBMATRIX__H__INCLUDED__
+/*
+Copyright(c) 2002-2017 Anatoliy Kuznetsov(anatoliy_kuznetsov at yahoo.com)
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+For more information please visit:  http://bitmagic.io
+*/
+
+#include <memory.h>
+
+#ifndef BM_NO_STL
+#include <stdexcept>
+#endif
+
+#include "bm.h"
+#include "bmdef.h"
+
+namespace bm
+{
+
+/*!
+    \brief Base class for bit-transposed sparse vectors
+
+    Keeps the matrix of bit-plains: value plains and an optional
+    "NOT NULL" plain, creates and frees plain bit-vectors, handles NULL
+    values, memory optimization and statistics. Containers implement
+    the transposition of their elements on top of it
+    (sparse_vector<> for integers, str_sparse_vector<> for strings).
+
+    \param Val - element type (type of a character for strings)
+    \param BV - bit-vector type for bit-plains
+    \param MAX_SIZE - number of Val elements in one container element
+
+    \ingroup svector
+*/
+template<typename Val, typename BV, unsigned MAX_SIZE>
+class base_sparse_vector
+{
+public:
+    typedef bm::id_t                                 size_type;
+    typedef BV                                       bvector_type;
+    typedef bvector_type*                            bvector_type_ptr;
+    typedef typename BV::allocator_type              allocator_type;
+    typedef typename bvector_type::allocation_policy allocation_policy_type;
+
+    /*! Statistical information about  memory allocation details. */
+    struct statistics : public bv_statistics
+    {};
+
+    enum bit_plains
+    {
+        sv_plains = (MAX_SIZE * sizeof(Val) * 8 + 1),
+        sv_value_plains = (MAX_SIZE * sizeof(Val) * 8)
+    };
+
+public:
+    base_sparse_vector(bm::null_support null_able = bm::no_null,
+                       allocation_policy_type ap = allocation_policy_type(),
+                       size_type bv_max_size = bm::id_max,
+                       const allocator_type&   alloc  = allocator_type());
+
+    base_sparse_vector(const base_sparse_vector& bsv);
+
+    ~base_sparse_vector() BMNOEXEPT { free_vectors(); }
+
+    /*! \brief return size of the vector
+        \return size of sparse vector
+    */
+    size_type size() const { return size_; }
+
+    /*! \brief return true if vector is empty
+        \return true if empty
+    */
+    bool empty() const { return (size_ == 0); }
+
+    /*! \brief resize vector
+        \param sz - new size
+    */
+    void resize(size_type sz);
+
+    /*! \brief resize to zero, free memory
+    */
+    void clear() BMNOEXEPT;
+
+    /**
+        \brief check if container supports NULL(unassigned) values
+    */
+    bool is_nullable() const { return (plains_[null_plain()] != 0); }
+
+    /**
+        \brief Get bit-vector of assigned values or NULL
+        (if not constructed that way)
+    */
+    const bvector_type* get_null_bvector() const
+        { return plains_[null_plain()]; }
+
+    /** \brief test if specified element is NULL
+        \param idx - element index
+        \return true if it is NULL false if it was assigned or container
+        is not configured to support assignment flags
+    */
+    bool is_null(size_type idx) const;
+
+    /*!
+        \brief get access to bit-plain, function checks and creates a plain
+    */
+    bvector_type_ptr get_plain(unsigned i);
+
+    /*!
+        \brief get total number of bit-plains in the vector
+    */
+    static unsigned plains() { return value_bits(); }
+
+    /** Number of stored bit-plains (value plains + extra */
+    static unsigned stored_plains() { return value_bits()+1; }
+
+    /*!
+        \brief get access to bit-plain as is (can return NULL)
+    */
+    bvector_type_ptr plain(unsigned i) { return plains_[i]; }
+    const bvector_type_ptr plain(unsigned i) const { return plains_[i]; }
+
+    /*!
+        \brief free memory in bit-plain
+    */
+    void free_plain(unsigned i);
+
+    /*!
+        \brief run memory optimization for all vector plains
+        \param temp_block - pre-allocated memory block to avoid unnecessary re-allocs
+        \param opt_mode - requested compression depth
+        \param stat - memory allocation statistics after optimization
+    */
+    void optimize(bm::word_t* temp_block = 0,
+                  typename bvector_type::optmode opt_mode = bvector_type::opt_compress,
+                  statistics* stat = 0);
+
+    /*!
+       \brief Optimize sizes of GAP blocks
+
+       This method runs an analysis to find optimal GAP levels for all bit plains
+       of the vector.
+    */
+    void optimize_gap_size();
+
+    /*!
+       @brief Calculates memory statistics.
+
+       Function fills statistics structure containing information about how
+       this vector uses memory and estimation of max. amount of memory
+       bvector needs to serialize itself.
+
+       @param st - pointer on statistics structure to be filled in.
+
+       @sa statistics
+    */
+    void calc_stat(statistics* st) const;
+
+protected:
+    /// copy plains and parameters of another vector (this must be empty)
+    void copy_from(const base_sparse_vector& bsv);
+
+    /// take over plains of another vector (this must be empty)
+    void move_from(base_sparse_vector& bsv) BMNOEXEPT;
+
+    /// content exchange
+    void swap(base_sparse_vector& bsv) BMNOEXEPT;
+
+    /// clear [left, right] range in the value plains (and NULL plain)
+    void clear_range(size_type left, size_type right, bool set_null);
+
+    /** Number of effective bit-plains in the value type*/
+    unsigned effective_plains() const { return effective_plains_ + 1; }
+
+    /** Number of total bit-plains in the value type*/
+    static unsigned value_bits() { return sv_value_plains; }
+
+    /** plain index for the "NOT NULL" flags plain */
+    static unsigned null_plain() { return value_bits(); }
+
+    const bm::word_t* get_block(unsigned p, unsigned i, unsigned j) const;
+    void throw_range_error(const char* err_msg) const;
+
+    bvector_type* construct_bvector(const bvector_type* bv) const;
+    void destruct_bvector(bvector_type* bv) const;
+    bvector_type* get_null_bvect() { return plains_[null_plain()]; }
+
+    /*! \brief free all internal vectors
+    */
+    void free_vectors() BMNOEXEPT;
+
+protected:
+    size_type                bv_size_;
+    allocator_type           alloc_;
+    allocation_policy_type   ap_;
+
+    bvector_type_ptr         plains_[sv_plains];
+    size_type                size_;
+    unsigned                 effective_plains_;
+};
+
+//---------------------------------------------------------------------
+//
+//---------------------------------------------------------------------
+
+template<typename Val, typename BV, unsigned MAX_SIZE>
+base_sparse_vector<Val, BV, MAX_SIZE>::base_sparse_vector(
+        bm::null_support        null_able,
+        allocation_policy_type  ap,
+        size_type               bv_max_size,
+        const allocator_type&   alloc)
+: bv_size_(bv_max_size),
+  alloc_(alloc),
+  ap_(ap),
+  size_(0),
+  effective_plains_(0)
+{
+    ::memset(plains_, 0, sizeof(plains_));
+    if (null_able == bm::use_null)
+    {
+        unsigned i = null_plain();
+        plains_[i] = construct_bvector(0);
+        plains_[i]->init();
+    }
+}
+
+//---------------------------------------------------------------------
+
+template<typename Val, typename BV, unsigned MAX_SIZE>
+base_sparse_vector<Val, BV, MAX_SIZE>::base_sparse_vector(
+                                        const base_sparse_vector& bsv)
+: bv_size_(bsv.bv_size_),
+  alloc_(bsv.alloc_),
+  ap_(bsv.ap_),
+  size_(bsv.size_),
+  effective_plains_(bsv.effective_plains_)
+{
+    for (unsigned i = 0; i < stored_plains(); ++i)
+    {
+        const bvector_type* bv = bsv.plains_[i];
+        plains_[i] = bv ? construct_bvector(bv) : 0;
+    }
+}
+
+//---------------------------------------------------------------------
+
+template<typename Val, typename BV, unsigned MAX_SIZE>
+void base_sparse_vector<Val, BV, MAX_SIZE>::copy_from(
+                                        const base_sparse_vector& bsv)
+{
+    BM_ASSERT(this != &bsv);
+    free_vectors();
+    bv_size_ = bsv.bv_size_;
+    alloc_ = bsv.alloc_;
+    ap_ = bsv.ap_;
+    size_ = bsv.size_;
+    effective_plains_ = bsv.effective_plains_;
+    for (unsigned i = 0; i < stored_plains(); ++i)
+    {
+        const bvector_type* bv = bsv.plains_[i];
+        plains_[i] = bv ? construct_bvector(bv) : 0;
+    }
+}
+
+//---------------------------------------------------------------------
+
+template<typename Val, typename BV, unsigned MAX_SIZE>
+void base_sparse_vector<Val, BV, MAX_SIZE>::move_from(
+                                        base_sparse_vector& bsv) BMNOEXEPT
+{
+    BM_ASSERT(this != &bsv);
+    free_vectors();
+    bv_size_ = bsv.bv_size_;
+    alloc_ = bsv.alloc_;
+    ap_ = bsv.ap_;
+    size_ = bsv.size_;
+    effective_plains_ = bsv.effective_plains_;
+    for (unsigned i = 0; i < stored_plains(); ++i)
+    {
+        plains_[i] = bsv.plains_[i];
+        bsv.plains_[i] = 0;
+    }
+    bsv.size_ = 0;
+}
+
+//---------------------------------------------------------------------
+
+template<typename Val, typename BV, unsigned MAX_SIZE>
+void base_sparse_vector<Val, BV, MAX_SIZE>::swap(
+                                        base_sparse_vector& bsv) BMNOEXEPT
+{
+    if (this != &bsv)
+    {
+        bm::xor_swap(bv_size_, bsv.bv_size_);
+
+        allocator_type alloc_tmp = alloc_;
+        alloc_ = bsv.alloc_;
+        bsv.alloc_ = alloc_tmp;
+
+        allocation_policy_type ap_tmp = ap_;
+        ap_ = bsv.ap_;
+        bsv.ap_ = ap_tmp;
+
+        for (unsigned i = 0; i < stored_plains(); ++i)
+        {
+            bvector_type* bv_tmp = plains_[i];
+            plains_[i] = bsv.plains_[i];
+            bsv.plains_[i] = bv_tmp;
+        } // for i
+
+        bm::xor_swap(size_, bsv.size_);
+        bm::xor_swap(effective_plains_, bsv.effective_plains_);
+    }
+}
+
+//---------------------------------------------------------------------
+
+template<typename Val, typename BV, unsigned MAX_SIZE>
+void base_sparse_vector<Val, BV, MAX_SIZE>::throw_range_error(
+                                                const char* err_msg) const
+{
+#ifndef BM_NO_STL
+    throw std::range_error(err_msg);
+#else
+    BM_ASSERT_THROW(false, BM_ERR_RANGE);
+#endif
+}
+
+//---------------------------------------------------------------------
+
+template<typename Val, typename BV, unsigned MAX_SIZE>
+typename base_sparse_vector<Val, BV, MAX_SIZE>::bvector_type*
+base_sparse_vector<Val, BV, MAX_SIZE>::construct_bvector(
+                                            const bvector_type* bv) const
+{
+    bvector_type* rbv = 0;
+#ifdef BM_NO_STL   // C compatibility mode
+    void* mem = ::malloc(sizeof(bvector_type));
+    if (mem == 0)
+    {
+        BM_ASSERT_THROW(false, BM_ERR_BADALLOC);
+    }
+    rbv = bv ? new(mem) bvector_type(*bv)
+             : new(mem) bvector_type(ap_.strat, ap_.glevel_len,
+                                     bv_size_,
+                                     alloc_);
+#else
+    rbv = bv ? new bvector_type(*bv)
+             : new bvector_type(ap_.strat, ap_.glevel_len,
+                                bv_size_,
+                                alloc_);
+#endif
+    return rbv;
+}
+
+//---------------------------------------------------------------------
+
+template<typename Val, typename BV, unsigned MAX_SIZE>
+void base_sparse_vector<Val, BV, MAX_SIZE>::destruct_bvector(
+                                                bvector_type* bv) const
+{
+#ifdef BM_NO_STL   // C compatibility mode
+    bv->~TBM_bvector();
+    ::free((void*)bv);
+#else
+    delete bv;
+#endif
+}
+
+//---------------------------------------------------------------------
+
+template<typename Val, typename BV, unsigned MAX_SIZE>
+void base_sparse_vector<Val, BV, MAX_SIZE>::free_vectors() BMNOEXEPT
+{
+    for (unsigned i = 0; i < stored_plains(); ++i)
+    {
+        bvector_type* bv = plains_[i];
+        if (bv)
+        {
+            destruct_bvector(bv);
+            plains_[i] = 0;
+        }
+    }
+}
+
+//---------------------------------------------------------------------
+
+template<typename Val, typename BV, unsigned MAX_SIZE>
+void base_sparse_vector<Val, BV, MAX_SIZE>::free_plain(unsigned i)
+{
+    BM_ASSERT(i < stored_plains());
+    bvector_type* bv = plains_[i];
+    if (bv)
+        destruct_bvector(bv);
+    plains_[i] = 0;
+}
+
+//---------------------------------------------------------------------
+
+template<typename Val, typename BV, unsigned MAX_SIZE>
+typename base_sparse_vector<Val, BV, MAX_SIZE>::bvector_type_ptr
+base_sparse_vector<Val, BV, MAX_SIZE>::get_plain(unsigned i)
+{
+    bvector_type_ptr bv = plains_[i];
+    if (!bv)
+    {
+        bv = construct_bvector(0);
+        bv->init();
+        plains_[i] = bv;
+        if (i > effective_plains_ && i < value_bits())
+            effective_plains_ = i;
+    }
+    return bv;
+}
+
+//---------------------------------------------------------------------
+
+template<typename Val, typename BV, unsigned MAX_SIZE>
+const bm::word_t* base_sparse_vector<Val, BV, MAX_SIZE>::get_block(
+                                    unsigned p, unsigned i, unsigned j) const
+{
+    const bvector_type* bv = this->plains_[p];
+    if (bv)
+    {
+        const typename bvector_type::blocks_manager_type& bman =
+                                                    bv->get_blocks_manager();
+        return bman.get_block(i, j);
+    }
+    return 0;
+}
+
+//---------------------------------------------------------------------
+
+template<typename Val, typename BV, unsigned MAX_SIZE>
+void base_sparse_vector<Val, BV, MAX_SIZE>::resize(size_type sz)
+{
+    if (sz == size_)  // nothing to do
+        return;
+    if (!sz) // resize to zero is an equivalent of non-destructive deallocation
+    {
+        clear();
+        return;
+    }
+    if (sz < size_) // vector shrink
+        clear_range(sz, size_-1, true);   // clear the tails and NULL vect
+    size_ = sz;
+}
+
+//---------------------------------------------------------------------
+
+template<typename Val, typename BV, unsigned MAX_SIZE>
+void base_sparse_vector<Val, BV, MAX_SIZE>::clear() BMNOEXEPT
+{
+    for (unsigned i = 0; i < value_bits(); ++i)
+    {
+        bvector_type* bv = plains_[i];
+        if (bv)
+        {
+            destruct_bvector(bv);
+            plains_[i] = 0;
+        }
+    }
+    size_ = 0;
+    bvector_type* bv_null = get_null_bvect();
+    if (bv_null)
+    {
+        bv_null->clear(true);
+        bv_null->init();
+    }
+}
+
+//---------------------------------------------------------------------
+
+template<typename Val, typename BV, unsigned MAX_SIZE>
+void base_sparse_vector<Val, BV, MAX_SIZE>::clear_range(size_type left,
+                                                        size_type right,
+                                                        bool      set_null)
+{
+    if (right < left)
+    {
+        size_type tmp = left; left = right; right = tmp;
+    }
+    unsigned eff_plains = effective_plains();
+    for (unsigned i = 0; i < eff_plains; ++i)
+    {
+        bvector_type* bv = plains_[i];
+        if (bv)
+            bv->set_range(left, right, false);
+    } // for i
+
+    if (set_null)
+    {
+        bvector_type* bv_null = get_null_bvect();
+        if (bv_null)
+            bv_null->set_range(left, right, false);
+    }
+}
+
+//---------------------------------------------------------------------
+
+template<typename Val, typename BV, unsigned MAX_SIZE>
+bool base_sparse_vector<Val, BV, MAX_SIZE>::is_null(size_type idx) const
+{
+    if (idx >= size_)
+        throw_range_error("sparse vector range error");
+    const bvector_type* bv_null = get_null_bvector();
+    return (bv_null) ? (!bv_null->test(idx)) : false;
+}
+
+//---------------------------------------------------------------------
+
+template<typename Val, typename BV, unsigned MAX_SIZE>
+void base_sparse_vector<Val, BV, MAX_SIZE>::calc_stat(statistics* st) const
+{
+    BM_ASSERT(st);
+    st->reset();
+
+    unsigned stored_plains = this->stored_plains();
+    for (unsigned j = 0; j < stored_plains; ++j)
+    {
+        const bvector_type* bv = this->plains_[j];
+        if (bv)
+        {
+            typename bvector_type::statistics stbv;
+            bv->calc_stat(&stbv);
+
+            st->bit_blocks += stbv.bit_blocks;
+            st->gap_blocks += stbv.gap_blocks;
+            st->max_serialize_mem += stbv.max_serialize_mem + 8;
+            st->memory_used += stbv.memory_used;
+        }
+    } // for j
+    // header accounting (wide vectors keep 32-bit plains count)
+    st->max_serialize_mem += 1 + 1 + 1 + 1 + 8 + (8 * stored_plains);
+    if (stored_plains > 255)
+        st->max_serialize_mem += 4;
+}
+
+//---------------------------------------------------------------------
+
+template<typename Val, typename BV, unsigned MAX_SIZE>
+void base_sparse_vector<Val, BV, MAX_SIZE>::optimize(
+                            bm::word_t*                    temp_block,
+                            typename bvector_type::optmode opt_mode,
+                            statistics*                    st)
+{
+    if (st)
+        st->reset();
+    bvector_type* bv_null = this->get_null_bvect();
+
+    unsigned stored_plains = this->stored_plains();
+    for (unsigned j = 0; j < stored_plains; ++j)
+    {
+        bvector_type* bv = this->plains_[j];
+        if (bv)
+        {
+            if (bv != bv_null) // protect the NULL vector from de-allocation
+            {
+                if (!bv->any())  // empty vector?
+                {
+                    destruct_bvector(this->plains_[j]);
+                    this->plains_[j] = 0;
+                    continue;
+                }
+            }
+
+            typename bvector_type::statistics stbv;
+            bv->optimize(temp_block, opt_mode, &stbv);
+
+            if (st)
+            {
+                st->bit_blocks += stbv.bit_blocks;
+                st->gap_blocks += stbv.gap_blocks;
+                st->max_serialize_mem += stbv.max_serialize_mem + 8;
+                st->memory_used += stbv.memory_used;
+            }
+        }
+    } // for j
+}
+
+//---------------------------------------------------------------------
+
+template<typename Val, typename BV, unsigned MAX_SIZE>
+void base_sparse_vector<Val, BV, MAX_SIZE>::optimize_gap_size()
+{
+    unsigned stored_plains = this->stored_plains();
+    for (unsigned j = 0; j < stored_plains; ++j)
+    {
+        bvector_type* bv = this->plains_[j];
+        if (bv)
+            bv->optimize_gap_size();
+    }
+}
+
+//---------------------------------------------------------------------
+
+
+} // namespace bm
+
+#endif
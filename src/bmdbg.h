@@ -405,7 +405,7 @@ void print_stat(const BV& bv, unsigned blocks = 0)
 
     if (!blocks)
     {
-        blocks = bm::set_total_blocks;
+        blocks = bman.top_block_size() * bm::set_array_size;
     }
 
     unsigned nb;
@@ -427,7 +427,7 @@ void print_stat(const BV& bv, unsigned blocks = 0)
            }
            
            unsigned start = nb; 
-           for(unsigned i = nb+1; i < bm::set_total_blocks; ++i, ++nb)
+           for(unsigned i = nb+1; i < blocks; ++i, ++nb)
            {
                blk = bman.get_block(nb);
                if (IS_FULL_BLOCK(blk))
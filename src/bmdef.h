@@ -197,6 +197,12 @@ For more information please visit:  http://bitmagic.io
 # undef BMSSE2OPT
 #endif
 
+#ifdef BMAVX512OPT
+# ifndef BMAVX2OPT
+#   define BMAVX2OPT
+# endif
+#endif
+
 #ifdef BMAVX2OPT
 # if defined(BM64OPT) || defined(__x86_64) || defined(_M_AMD64) || defined(_WIN64) || \
     defined(__LP64__) || defined(_LP64)
@@ -214,13 +220,16 @@ For more information please visit:  http://bitmagic.io
 # endif
 
 
-#if !(defined(BMSSE2OPT) || defined(BMSSE42OPT) || defined(BMAVX2OPT))
+#if !(defined(BMSSE2OPT) || defined(BMSSE42OPT) || defined(BMAVX2OPT) || \
+      defined(BM_SIMD_DISPATCH))
 
 
 #define BM_ALIGN16 
 #define BM_ALIGN16ATTR
 #define BM_ALIGN32
 #define BM_ALIGN32ATTR
+#define BM_ALIGN64
+#define BM_ALIGN64ATTR
 
 #else  
 
@@ -240,6 +249,11 @@ For more information please visit:  http://bitmagic.io
 #  define BM_ALIGN32ATTR
 #endif
 
+#ifndef BM_ALIGN64
+#  define BM_ALIGN64 __declspec(align(64))
+#  define BM_ALIGN64ATTR
+#endif
+
 
 # else // GCC
 
@@ -253,16 +267,27 @@ For more information please visit:  http://bitmagic.io
 #  define BM_ALIGN32ATTR __attribute__((aligned(32)))
 #endif
 
+#ifndef BM_ALIGN64
+#  define BM_ALIGN64
+#  define BM_ALIGN64ATTR __attribute__((aligned(64)))
+#endif
+
 
 #endif
 
 #endif
 
-#if (defined(BMSSE2OPT) || defined(BMSSE42OPT))
+#if defined(BM_SIMD_DISPATCH)
+#   define BM_VECT_ALIGN BM_ALIGN32
+#   define BM_VECT_ALIGN_ATTR BM_ALIGN32ATTR
+#elif (defined(BMSSE2OPT) || defined(BMSSE42OPT))
 #   define BM_VECT_ALIGN BM_ALIGN16
 #   define BM_VECT_ALIGN_ATTR BM_ALIGN16ATTR
 #else
-#   if defined(BMAVX2OPT)
+#   if defined(BMAVX512OPT)
+#       define BM_VECT_ALIGN BM_ALIGN64
+#       define BM_VECT_ALIGN_ATTR BM_ALIGN64ATTR
+#   elif defined(BMAVX2OPT)
 #       define BM_VECT_ALIGN BM_ALIGN32
 #       define BM_VECT_ALIGN_ATTR BM_ALIGN32ATTR
 #   else
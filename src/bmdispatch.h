@@ -0,0 +1,567 @@
+#ifndef BMDISPATCH__H__INCLUDED__
+#define BMDISPATCH__H__INCLUDED__
+/*
+Copyright(c) 2002-2017 Anatoliy Kuznetsov(anatoliy_kuznetsov at yahoo.com)
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+For more information please visit:  http://bitmagic.io
+*/
+
+/** @defgroup dispatch Runtime SIMD dispatch
+    Runtime selection of SIMD block kernels (internals)
+    @ingroup bvector
+    @internal
+ */
+
+// Runtime CPU dispatch (#define BM_SIMD_DISPATCH)
+//
+// Block kernels of all supported instruction sets (SSE2, SSE4.2, AVX2,
+// AVX-512) are compiled into the same binary (GCC/Clang target pragmas),
+// wrapped into per-ISA function tables (bm::simd_kernels).
+// CPU features are detected once, on the first call, VECT_* macros
+// call kernels of the selected table.
+// Build baseline: portable x86-64 (SSE2) or BMSSE42OPT.
+//
+
+#if defined(BMAVX2OPT) || defined(BMAVX512OPT)
+# error "BM_SIMD_DISPATCH: use portable (SSE2) or BMSSE42OPT build baseline"
+#endif
+#if !(defined(__x86_64) || defined(_M_AMD64) || defined(_M_X64))
+# error "BM_SIMD_DISPATCH: x86-64 target is required"
+#endif
+
+#include <emmintrin.h>
+#include <immintrin.h>
+#if defined(_MSC_VER)
+# include <intrin.h>
+#endif
+
+#include "bmdef.h"
+#include "bmutil.h"
+#include "bmsse_util.h"
+
+
+// Wrappers of a kernel set, expanded while VECT_* macros of the ISA header
+// are in effect.
+//
+#define BM_DISPATCH_KERNELS(pfx) \
+inline bm::id_t pfx##_k_bit_count(const bm::word_t* first, \
+                                  const bm::word_t* last) \
+    { return VECT_BITCOUNT(first, last); } \
+inline bm::id_t pfx##_k_bit_count_and(const bm::word_t* first, \
+                          const bm::word_t* last, const bm::word_t* mask) \
+    { return VECT_BITCOUNT_AND(first, last, mask); } \
+inline bm::id_t pfx##_k_bit_count_or(const bm::word_t* first, \
+                          const bm::word_t* last, const bm::word_t* mask) \
+    { return VECT_BITCOUNT_OR(first, last, mask); } \
+inline bm::id_t pfx##_k_bit_count_xor(const bm::word_t* first, \
+                          const bm::word_t* last, const bm::word_t* mask) \
+    { return VECT_BITCOUNT_XOR(first, last, mask); } \
+inline bm::id_t pfx##_k_bit_count_sub(const bm::word_t* first, \
+                          const bm::word_t* last, const bm::word_t* mask) \
+    { return VECT_BITCOUNT_SUB(first, last, mask); } \
+inline void pfx##_k_and_arr(bm::word_t* dst, const bm::word_t* src, \
+                            const bm::word_t* src_end) \
+    { VECT_AND_ARR(dst, src, src_end); } \
+inline void pfx##_k_or_arr(bm::word_t* dst, const bm::word_t* src, \
+                           const bm::word_t* src_end) \
+    { VECT_OR_ARR(dst, src, src_end); } \
+inline void pfx##_k_sub_arr(bm::word_t* dst, const bm::word_t* src, \
+                            const bm::word_t* src_end) \
+    { VECT_SUB_ARR(dst, src, src_end); } \
+inline void pfx##_k_xor_arr(bm::word_t* dst, const bm::word_t* src, \
+                            const bm::word_t* src_end) \
+    { VECT_XOR_ARR(dst, src, src_end); } \
+inline void pfx##_k_xor_arr_2_mask(bm::word_t* dst, const bm::word_t* src, \
+                           const bm::word_t* src_end, bm::word_t mask) \
+    { VECT_XOR_ARR_2_MASK(dst, src, src_end, mask); } \
+inline void pfx##_k_andnot_arr_2_mask(bm::word_t* dst, const bm::word_t* src, \
+                           const bm::word_t* src_end, bm::word_t mask) \
+    { VECT_ANDNOT_ARR_2_MASK(dst, src, src_end, mask); } \
+inline void pfx##_k_invert_arr(bm::word_t* first, bm::word_t* last) \
+    { VECT_INVERT_ARR(first, last); } \
+inline void pfx##_k_copy_block(bm::word_t* dst, const bm::word_t* src, \
+                               const bm::word_t* src_end) \
+    { VECT_COPY_BLOCK(dst, src, src_end); } \
+inline void pfx##_k_set_block(bm::word_t* dst, bm::word_t* dst_end, \
+                              bm::word_t value) \
+    { VECT_SET_BLOCK(dst, dst_end, value); } \
+inline void pfx##_k_bit_transpose32(const bm::word_t* arr, unsigned arr_size, \
+       bm::word_t tmatrix[bm::set_block_plain_cnt][bm::set_block_plain_size]) \
+    { VECT_BIT_TRANSPOSE32(arr, arr_size, tmatrix); } \
+inline void pfx##_k_bit_xor_prefix(bm::word_t* first, bm::word_t* last, \
+                                   bm::word_t carry) \
+    { VECT_BIT_BLOCK_XOR_PREFIX(first, last, carry); }
+
+
+
+// --------------------------------------------------------------------
+// SSE2 (x86-64 baseline)
+//
+#if !defined(BMSSE42OPT)
+# include "bmsse2.h"
+namespace bm
+{
+BM_DISPATCH_KERNELS(sse2)
+inline bool sse2_k_is_all_zero(const bm::word_t* first, const bm::word_t* last)
+{
+    const bm::wordop_t* w = (const bm::wordop_t*)first;
+    const bm::wordop_t* w_end = (const bm::wordop_t*)last;
+    do
+    {
+        if (w[0] | w[1] | w[2] | w[3])
+            return false;
+        w += 4;
+    } while (w < w_end);
+    return true;
+}
+inline bool sse2_k_is_all_one(const bm::word_t* first, const bm::word_t* last)
+{
+    const bm::wordop_t* w = (const bm::wordop_t*)first;
+    const bm::wordop_t* w_end = (const bm::wordop_t*)last;
+    do
+    {
+        if ((w[0] & w[1] & w[2] & w[3]) != bm::all_bits_mask)
+            return false;
+        w += 4;
+    } while (w < w_end);
+    return true;
+}
+inline bm::id_t sse2_k_count_change(const bm::word_t* first,
+                                    const bm::word_t* last, unsigned* bc)
+{
+    return bm::sse2_bit_block_calc_count_change(
+                    (const __m128i*)first, (const __m128i*)last, bc);
+}
+} // namespace bm
+# undef VECT_XOR_ARR_2_MASK
+# undef VECT_ANDNOT_ARR_2_MASK
+# undef VECT_BITCOUNT
+# undef VECT_BITCOUNT_AND
+# undef VECT_BITCOUNT_OR
+# undef VECT_BITCOUNT_XOR
+# undef VECT_BITCOUNT_SUB
+# undef VECT_INVERT_ARR
+# undef VECT_AND_ARR
+# undef VECT_OR_ARR
+# undef VECT_SUB_ARR
+# undef VECT_XOR_ARR
+# undef VECT_COPY_BLOCK
+# undef VECT_SET_BLOCK
+# undef VECT_BIT_TRANSPOSE32
+# undef VECT_BIT_BLOCK_XOR_PREFIX
+#endif
+
+
+// --------------------------------------------------------------------
+// SSE4.2
+//
+#if !defined(BMSSE42OPT)
+# if defined(__clang__)
+#  pragma clang attribute push (__attribute__((target("sse4.2,popcnt"))), apply_to=function)
+# elif defined(__GNUC__)
+#  pragma GCC push_options
+#  pragma GCC target("sse4.2,popcnt")
+# endif
+#endif
+
+#include "bmsse4.h"
+
+namespace bm
+{
+BM_DISPATCH_KERNELS(sse42)
+inline bool sse42_k_is_all_zero(const bm::word_t* first, const bm::word_t* last)
+    { return VECT_IS_ZERO_BLOCK(first, last); }
+inline bool sse42_k_is_all_one(const bm::word_t* first, const bm::word_t* last)
+    { return VECT_IS_ONE_BLOCK(first, last); }
+inline bm::id_t sse42_k_count_change(const bm::word_t* first,
+                                     const bm::word_t* last, unsigned* bc)
+{
+    return bm::sse4_bit_block_calc_count_change(
+                    (const __m128i*)first, (const __m128i*)last, bc);
+}
+} // namespace bm
+
+#if !defined(BMSSE42OPT)
+# if defined(__clang__)
+#  pragma clang attribute pop
+# elif defined(__GNUC__)
+#  pragma GCC pop_options
+# endif
+#endif
+
+#undef VECT_XOR_ARR_2_MASK
+#undef VECT_ANDNOT_ARR_2_MASK
+#undef VECT_BITCOUNT
+#undef VECT_BITCOUNT_AND
+#undef VECT_BITCOUNT_OR
+#undef VECT_BITCOUNT_XOR
+#undef VECT_BITCOUNT_SUB
+#undef VECT_INVERT_ARR
+#undef VECT_AND_ARR
+#undef VECT_OR_ARR
+#undef VECT_SUB_ARR
+#undef VECT_XOR_ARR
+#undef VECT_COPY_BLOCK
+#undef VECT_SET_BLOCK
+#undef VECT_IS_ZERO_BLOCK
+#undef VECT_IS_ONE_BLOCK
+#undef VECT_BIT_DECODE32
+#undef VECT_BIT_TRANSPOSE32
+#undef VECT_BIT_BLOCK_XOR_PREFIX
+
+
+// --------------------------------------------------------------------
+// AVX2
+//
+#if defined(__clang__)
+# pragma clang attribute push (__attribute__((target("avx2,popcnt"))), apply_to=function)
+#elif defined(__GNUC__)
+# pragma GCC push_options
+# pragma GCC target("avx2,popcnt")
+#endif
+
+#include "bmavx2.h"
+
+namespace bm
+{
+BM_DISPATCH_KERNELS(avx2)
+inline bool avx2_k_is_all_zero(const bm::word_t* first, const bm::word_t* last)
+    { return VECT_IS_ZERO_BLOCK(first, last); }
+inline bool avx2_k_is_all_one(const bm::word_t* first, const bm::word_t* last)
+    { return VECT_IS_ONE_BLOCK(first, last); }
+inline bm::id_t avx2_k_count_change(const bm::word_t* first,
+                                    const bm::word_t* last, unsigned* bc)
+{
+    // same kernel as the BMAVX2OPT build (see bit_block_calc_count_change)
+    return bm::sse42_bit_block_calc_count_change(
+                    (const __m128i*)first, (const __m128i*)last, bc);
+}
+} // namespace bm
+
+#if defined(__clang__)
+# pragma clang attribute pop
+#elif defined(__GNUC__)
+# pragma GCC pop_options
+#endif
+
+
+// --------------------------------------------------------------------
+// AVX-512 (AVX512F + AVX512BW, popcount via byte lookup: the dispatch
+// table does not require VPOPCNTDQ)
+//
+#if defined(__clang__)
+# pragma clang attribute push (__attribute__((target("avx512f,avx512bw,avx2,popcnt,bmi"))), apply_to=function)
+#elif defined(__GNUC__)
+# pragma GCC push_options
+# pragma GCC target("avx512f,avx512bw,avx2,popcnt,bmi")
+#endif
+
+#include "bmavx512.h"
+
+namespace bm
+{
+BM_DISPATCH_KERNELS(avx512)
+inline bool avx512_k_is_all_zero(const bm::word_t* first, const bm::word_t* last)
+    { return VECT_IS_ZERO_BLOCK(first, last); }
+inline bool avx512_k_is_all_one(const bm::word_t* first, const bm::word_t* last)
+    { return VECT_IS_ONE_BLOCK(first, last); }
+inline bm::id_t avx512_k_count_change(const bm::word_t* first,
+                                      const bm::word_t* last, unsigned* bc)
+{
+    return bm::avx512_bit_block_calc_count_change(
+                    (const __m512i*)first, (const __m512i*)last, bc);
+}
+} // namespace bm
+
+#if defined(__clang__)
+# pragma clang attribute pop
+#elif defined(__GNUC__)
+# pragma GCC pop_options
+#endif
+
+#undef VECT_XOR_ARR_2_MASK
+#undef VECT_ANDNOT_ARR_2_MASK
+#undef VECT_BITCOUNT
+#undef VECT_BITCOUNT_AND
+#undef VECT_BITCOUNT_OR
+#undef VECT_BITCOUNT_XOR
+#undef VECT_BITCOUNT_SUB
+#undef VECT_INVERT_ARR
+#undef VECT_AND_ARR
+#undef VECT_OR_ARR
+#undef VECT_SUB_ARR
+#undef VECT_XOR_ARR
+#undef VECT_COPY_BLOCK
+#undef VECT_SET_BLOCK
+#undef VECT_IS_ZERO_BLOCK
+#undef VECT_IS_ONE_BLOCK
+#undef VECT_BIT_DECODE32
+#undef VECT_BIT_TRANSPOSE32
+#undef VECT_BIT_BLOCK_XOR_PREFIX
+
+#undef BM_DISPATCH_KERNELS
+
+
+namespace bm
+{
+
+/*!
+    @brief Table of block kernels for one instruction set
+    @ingroup dispatch
+*/
+struct simd_kernels
+{
+    int simd_level; ///< bm::simd_codes
+
+    bm::id_t (*bit_count)(const bm::word_t* first, const bm::word_t* last);
+    bm::id_t (*bit_count_and)(const bm::word_t* first, const bm::word_t* last,
+                              const bm::word_t* mask);
+    bm::id_t (*bit_count_or)(const bm::word_t* first, const bm::word_t* last,
+                             const bm::word_t* mask);
+    bm::id_t (*bit_count_xor)(const bm::word_t* first, const bm::word_t* last,
+                              const bm::word_t* mask);
+    bm::id_t (*bit_count_sub)(const bm::word_t* first, const bm::word_t* last,
+                              const bm::word_t* mask);
+    void (*and_arr)(bm::word_t* dst, const bm::word_t* src,
+                    const bm::word_t* src_end);
+    void (*or_arr)(bm::word_t* dst, const bm::word_t* src,
+                   const bm::word_t* src_end);
+    void (*sub_arr)(bm::word_t* dst, const bm::word_t* src,
+                    const bm::word_t* src_end);
+    void (*xor_arr)(bm::word_t* dst, const bm::word_t* src,
+                    const bm::word_t* src_end);
+    void (*xor_arr_2_mask)(bm::word_t* dst, const bm::word_t* src,
+                           const bm::word_t* src_end, bm::word_t mask);
+    void (*andnot_arr_2_mask)(bm::word_t* dst, const bm::word_t* src,
+                              const bm::word_t* src_end, bm::word_t mask);
+    void (*invert_arr)(bm::word_t* first, bm::word_t* last);
+    void (*copy_block)(bm::word_t* dst, const bm::word_t* src,
+                       const bm::word_t* src_end);
+    void (*set_block)(bm::word_t* dst, bm::word_t* dst_end, bm::word_t value);
+    bool (*is_all_zero)(const bm::word_t* first, const bm::word_t* last);
+    bool (*is_all_one)(const bm::word_t* first, const bm::word_t* last);
+    bm::id_t (*count_change)(const bm::word_t* first, const bm::word_t* last,
+                             unsigned* bit_count);
+    unsigned (*gap_find)(const bm::gap_word_t* pbuf, const bm::gap_word_t pos,
+                         const unsigned size);
+    unsigned gap_find_lane;  ///< max number of elements for gap_find
+    void (*bit_transpose32)(const bm::word_t* arr, unsigned arr_size,
+         bm::word_t tmatrix[bm::set_block_plain_cnt][bm::set_block_plain_size]);
+    void (*bit_xor_prefix)(bm::word_t* first, bm::word_t* last,
+                           bm::word_t carry);
+};
+
+#define BM_DISPATCH_TABLE(level, pfx, gap_find_func, gap_lane) \
+    { level, \
+      pfx##_k_bit_count, pfx##_k_bit_count_and, pfx##_k_bit_count_or, \
+      pfx##_k_bit_count_xor, pfx##_k_bit_count_sub, \
+      pfx##_k_and_arr, pfx##_k_or_arr, pfx##_k_sub_arr, pfx##_k_xor_arr, \
+      pfx##_k_xor_arr_2_mask, pfx##_k_andnot_arr_2_mask, \
+      pfx##_k_invert_arr, pfx##_k_copy_block, pfx##_k_set_block, \
+      pfx##_k_is_all_zero, pfx##_k_is_all_one, pfx##_k_count_change, \
+      gap_find_func, gap_lane, pfx##_k_bit_transpose32, \
+      pfx##_k_bit_xor_prefix }
+
+
+/*!
+    @brief Runtime SIMD dispatcher
+
+    Kernel table is selected on the first call, based on CPU features
+    (CPUID and OS support of the extended register state).
+
+    @ingroup dispatch
+*/
+template<bool T> struct simd_dispatch
+{
+    /// Current kernel table
+    static const simd_kernels& kernels()
+    {
+        return *current();
+    }
+
+    /// SIMD code (bm::simd_codes) of the current kernel table
+    static int level()
+    {
+        return current()->simd_level;
+    }
+
+    /*!
+        @brief Limit SIMD level (for testing and benchmarking).
+        Level is capped by the CPU capabilities. Not thread safe,
+        must be called before parallel use of the library.
+        @return SIMD code of the selected kernel table
+    */
+    static int set_level(int simd_code)
+    {
+        int cpu_code = cpu_level();
+        current() = select(simd_code < cpu_code ? simd_code : cpu_code);
+        return level();
+    }
+
+    /// Best SIMD code supported by the CPU (and the build baseline)
+    static int cpu_level()
+    {
+        static const int cpu_code = detect_cpu();
+        return cpu_code;
+    }
+
+    /// Kernel table for SIMD code (falls back to the next lower level)
+    static const simd_kernels* select(int simd_code)
+    {
+#if !defined(BMSSE42OPT)
+        static const simd_kernels sse2_table =
+            BM_DISPATCH_TABLE(bm::simd_sse2, sse2, bm::sse2_gap_find, 16);
+#endif
+        static const simd_kernels sse42_table =
+            BM_DISPATCH_TABLE(bm::simd_sse42, sse42, bm::sse4_gap_find, 16);
+        static const simd_kernels avx2_table =
+            BM_DISPATCH_TABLE(bm::simd_avx2, avx2, bm::sse4_gap_find, 16);
+        static const simd_kernels avx512_table =
+            BM_DISPATCH_TABLE(bm::simd_avx512, avx512, bm::avx512_gap_find, 32);
+
+        if (simd_code >= bm::simd_avx512)
+            return &avx512_table;
+        if (simd_code >= bm::simd_avx2)
+            return &avx2_table;
+#if !defined(BMSSE42OPT)
+        if (simd_code < bm::simd_sse42)
+            return &sse2_table;
+#endif
+        return &sse42_table;
+    }
+
+private:
+    static const simd_kernels*& current()
+    {
+        static const simd_kernels* table = select(cpu_level());
+        return table;
+    }
+
+    static int detect_cpu()
+    {
+        int code = bm::simd_sse2;
+#if defined(__GNUC__)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt"))
+        {
+            code = bm::simd_sse42;
+            if (__builtin_cpu_supports("avx2"))
+            {
+                code = bm::simd_avx2;
+                if (__builtin_cpu_supports("avx512f") &&
+                    __builtin_cpu_supports("avx512bw") &&
+                    __builtin_cpu_supports("bmi"))
+                    code = bm::simd_avx512;
+            }
+        }
+#elif defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 0);
+        int max_leaf = info[0];
+        __cpuid(info, 1);
+        bool sse42 = (info[2] & (1 << 20)) && (info[2] & (1 << 23)); // +popcnt
+        bool osxsave = (info[2] & (1 << 27)) != 0;
+        if (sse42)
+        {
+            code = bm::simd_sse42;
+            unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+            if (max_leaf >= 7 && (xcr0 & 0x6) == 0x6) // XMM, YMM state
+            {
+                __cpuidex(info, 7, 0);
+                if (info[1] & (1 << 5))
+                {
+                    code = bm::simd_avx2;
+                    // opmask, ZMM state + AVX512F, AVX512BW, BMI1
+                    if ((xcr0 & 0xE6) == 0xE6 && (info[1] & (1 << 16)) &&
+                        (info[1] & (1 << 30)) && (info[1] & (1 << 3)))
+                        code = bm::simd_avx512;
+                }
+            }
+        }
+#endif
+#if defined(BMSSE42OPT)
+        if (code < bm::simd_sse42)
+            code = bm::simd_sse42; // build baseline
+#endif
+        return code;
+    }
+};
+
+#undef BM_DISPATCH_TABLE
+
+} // namespace bm
+
+
+// Block level operations call kernels of the selected table
+//
+#define VECT_XOR_ARR_2_MASK(dst, src, src_end, mask)\
+    bm::simd_dispatch<true>::kernels().xor_arr_2_mask((bm::word_t*)(dst), (const bm::word_t*)(src), (const bm::word_t*)(src_end), (bm::word_t)mask)
+
+#define VECT_ANDNOT_ARR_2_MASK(dst, src, src_end, mask)\
+    bm::simd_dispatch<true>::kernels().andnot_arr_2_mask((bm::word_t*)(dst), (const bm::word_t*)(src), (const bm::word_t*)(src_end), (bm::word_t)mask)
+
+#define VECT_BITCOUNT(first, last) \
+    bm::simd_dispatch<true>::kernels().bit_count((const bm::word_t*) (first), (const bm::word_t*) (last))
+
+#define VECT_BITCOUNT_AND(first, last, mask) \
+    bm::simd_dispatch<true>::kernels().bit_count_and((const bm::word_t*) (first), (const bm::word_t*) (last), (const bm::word_t*) (mask))
+
+#define VECT_BITCOUNT_OR(first, last, mask) \
+    bm::simd_dispatch<true>::kernels().bit_count_or((const bm::word_t*) (first), (const bm::word_t*) (last), (const bm::word_t*) (mask))
+
+#define VECT_BITCOUNT_XOR(first, last, mask) \
+    bm::simd_dispatch<true>::kernels().bit_count_xor((const bm::word_t*) (first), (const bm::word_t*) (last), (const bm::word_t*) (mask))
+
+#define VECT_BITCOUNT_SUB(first, last, mask) \
+    bm::simd_dispatch<true>::kernels().bit_count_sub((const bm::word_t*) (first), (const bm::word_t*) (last), (const bm::word_t*) (mask))
+
+#define VECT_INVERT_ARR(first, last) \
+    bm::simd_dispatch<true>::kernels().invert_arr((bm::word_t*)first, (bm::word_t*)last);
+
+#define VECT_AND_ARR(dst, src, src_end) \
+    bm::simd_dispatch<true>::kernels().and_arr((bm::word_t*) dst, (const bm::word_t*) (src), (const bm::word_t*) (src_end))
+
+#define VECT_OR_ARR(dst, src, src_end) \
+    bm::simd_dispatch<true>::kernels().or_arr((bm::word_t*) dst, (const bm::word_t*) (src), (const bm::word_t*) (src_end))
+
+#define VECT_SUB_ARR(dst, src, src_end) \
+    bm::simd_dispatch<true>::kernels().sub_arr((bm::word_t*) dst, (const bm::word_t*) (src), (const bm::word_t*) (src_end))
+
+#define VECT_XOR_ARR(dst, src, src_end) \
+    bm::simd_dispatch<true>::kernels().xor_arr((bm::word_t*) dst, (const bm::word_t*) (src), (const bm::word_t*) (src_end))
+
+#define VECT_COPY_BLOCK(dst, src, src_end) \
+    bm::simd_dispatch<true>::kernels().copy_block((bm::word_t*) dst, (const bm::word_t*) (src), (const bm::word_t*) (src_end))
+
+#define VECT_SET_BLOCK(dst, dst_end, value) \
+    bm::simd_dispatch<true>::kernels().set_block((bm::word_t*) dst, (bm::word_t*) (dst_end), (value))
+
+#define VECT_IS_ZERO_BLOCK(dst, dst_end) \
+    bm::simd_dispatch<true>::kernels().is_all_zero((const bm::word_t*) dst, (const bm::word_t*) (dst_end))
+
+#define VECT_IS_ONE_BLOCK(dst, dst_end) \
+    bm::simd_dispatch<true>::kernels().is_all_one((const bm::word_t*) dst, (const bm::word_t*) (dst_end))
+
+#define VECT_BIT_COUNT_CHANGE(first, last, bit_count) \
+    bm::simd_dispatch<true>::kernels().count_change((const bm::word_t*) (first), (const bm::word_t*) (last), (bit_count))
+
+#define VECT_BIT_TRANSPOSE32(arr, arr_size, tmatrix) \
+    bm::simd_dispatch<true>::kernels().bit_transpose32(arr, arr_size, tmatrix)
+
+#define VECT_BIT_BLOCK_XOR_PREFIX(first, last, carry) \
+    bm::simd_dispatch<true>::kernels().bit_xor_prefix((bm::word_t*) (first), (bm::word_t*) (last), (carry))
+
+
+#endif
@@ -58,7 +58,7 @@ struct bv_statistics
     /// Memory used by bitvector including temp and service blocks
     size_t  memory_used;
     /// Array of all GAP block lengths in the bvector.
-    gap_word_t   gap_length[bm::set_total_blocks];
+    gap_word_t   gap_length[bm::set_total_blocks32];
     /// GAP lengths used by bvector
     gap_word_t  gap_levels[bm::gap_levels];
 
@@ -75,7 +75,7 @@ struct bv_statistics
     /// count gap block
     void add_gap_block(unsigned capacity, unsigned length)
     {
-        (gap_blocks < bm::set_total_blocks) ? gap_length[gap_blocks] = (gap_word_t)length : 0;
+        (gap_blocks < bm::set_total_blocks32) ? gap_length[gap_blocks] = (gap_word_t)length : 0;
         ++gap_blocks;
         unsigned mem_used = (unsigned)(capacity * sizeof(gap_word_t));
         memory_used += mem_used;
@@ -129,7 +129,7 @@ template <> struct conditional<false>
     @ingroup bitfunc 
 */
 BMFORCEINLINE
-bm::id_t word_bitcount(bm::id_t w)
+unsigned word_bitcount(bm::word_t w)
 {
 #if defined(BMSSE42OPT) || defined(BMAVX2OPT)
     return _mm_popcnt_u32(w);
@@ -213,7 +213,7 @@ unsigned bitcount64_4way(bm::id64_t x, bm::id64_t y,
     @ingroup bitfunc 
 */
 BMFORCEINLINE
-bm::id_t word_trailing_zeros(bm::id_t w)
+unsigned word_trailing_zeros(bm::word_t w)
 {
     // TODO: find a better variant for MSVC 
 #if defined(BMSSE42OPT) && defined(__GNUC__)
@@ -515,6 +515,49 @@ template<typename T>
 unsigned gap_test_unr(const T* buf, const unsigned pos)
 {
     BM_ASSERT(pos < bm::gap_max_bits);
+#if defined(BM_SIMD_DISPATCH)
+    const bm::simd_kernels& k = bm::simd_dispatch<true>::kernels();
+    const unsigned lane = k.gap_find_lane;
+    unsigned start = 1;
+    unsigned end = 1 + ((*buf) >> 3);
+    unsigned dsize = end - start;
+
+    if (dsize <= lane)
+    {
+        start = k.gap_find(buf+1, (bm::gap_word_t)pos, dsize);
+        unsigned res = ((*buf) & 1) ^ ((start) & 1);
+        BM_ASSERT(buf[start+1] >= pos);
+        BM_ASSERT(buf[start] < pos || (start==0));
+        BM_ASSERT(res == bm::gap_test(buf, pos));
+        return res;
+    }
+    unsigned arr_end = end;
+    while (start != end)
+    {
+        unsigned curr = (start + end) >> 1;
+        if (buf[curr] < pos)
+            start = curr + 1;
+        else
+            end = curr;
+
+        unsigned size = end - start;
+        if (size < lane)
+        {
+            size += (end != arr_end);
+            unsigned idx = k.gap_find(buf + start, (bm::gap_word_t)pos, size);
+            start += idx;
+
+            BM_ASSERT(buf[start] >= pos);
+            BM_ASSERT(buf[start - 1] < pos || (start == 1));
+            break;
+        }
+    }
+
+    unsigned res = ((*buf) & 1) ^ ((--start) & 1);
+
+    BM_ASSERT(res == bm::gap_test(buf, pos));
+    return res;
+#else
 #if defined(BMSSE2OPT)
     unsigned start = 1;
     unsigned end = 1 + ((*buf) >> 3);
@@ -594,22 +637,64 @@ unsigned gap_test_unr(const T* buf, const unsigned pos)
     
     unsigned res = ((*buf) & 1) ^ ((--start) & 1);
 
+    BM_ASSERT(res == bm::gap_test(buf, pos));
+    return res;
+#elif defined(BMAVX512OPT)
+    unsigned start = 1;
+    unsigned end = 1 + ((*buf) >> 3);
+    unsigned dsize = end - start;
+
+    if (dsize < 33)
+    {
+        start = bm::avx512_gap_find(buf+1, (bm::gap_word_t)pos, dsize);
+        unsigned res = ((*buf) & 1) ^ ((start) & 1);
+        BM_ASSERT(buf[start+1] >= pos);
+        BM_ASSERT(buf[start] < pos || (start==0));
+        BM_ASSERT(res == bm::gap_test(buf, pos));
+        return res;
+    }
+    unsigned arr_end = end;
+    while (start != end)
+    {
+        unsigned curr = (start + end) >> 1;
+        if (buf[curr] < pos)
+            start = curr + 1;
+        else
+            end = curr;
+
+        unsigned size = end - start;
+        if (size < 32)
+        {
+            size += (end != arr_end);
+            unsigned idx = bm::avx512_gap_find(buf + start, (bm::gap_word_t)pos, size);
+            start += idx;
+
+            BM_ASSERT(buf[start] >= pos);
+            BM_ASSERT(buf[start - 1] < pos || (start == 1));
+            break;
+        }
+    }
+
+    unsigned res = ((*buf) & 1) ^ ((--start) & 1);
+
     BM_ASSERT(res == bm::gap_test(buf, pos));
     return res;
 #else
     return bm::gap_test(buf, pos);
 #endif
+#endif // BM_SIMD_DISPATCH
 }
 
 
-/*! For each non-zero block executes supplied function.
+/*! For each non-zero block in the range of top blocks [top_from, top_to)
+    executes supplied function.
     \internal
 */
 template<class T, class F> 
-void for_each_nzblock(T*** root, unsigned size1,
-                      F& f)
+void for_each_nzblock_range(T*** root, unsigned top_from, unsigned top_to,
+                            F& f)
 {
-    for (unsigned i = 0; i < size1; ++i)
+    for (unsigned i = top_from; i < top_to; ++i)
     {
         T** blk_blk = root[i];
         if (!blk_blk) 
@@ -726,6 +811,16 @@ void for_each_nzblock(T*** root, unsigned size1,
     }  // for i
 }
 
+/*! For each non-zero block executes supplied function.
+    \internal
+*/
+template<class T, class F> 
+void for_each_nzblock(T*** root, unsigned size1,
+                      F& f)
+{
+    bm::for_each_nzblock_range(root, 0u, size1, f);
+}
+
 /*! For each non-zero block executes supplied function.
 */
 template<class T, class F> 
@@ -1083,6 +1178,38 @@ unsigned gap_bit_count_to(const T* const buf, T right)
     return bits_counter;
 }
 
+/*!
+    \brief Finds position of the rank-th 1 bit in GAP buffer
+    \param buf - GAP buffer pointer.
+    \param rank - rank of the bit to find (1-based), must be present in the block
+    \return bit index in the block
+    @ingroup gapfunc
+*/
+template<typename T>
+unsigned gap_find_rank(const T* const buf, unsigned rank)
+{
+    BM_ASSERT(rank);
+
+    const T* pcurr = buf + 1;
+    const T* pend = buf + (*buf >> 3);
+    unsigned is_set = *buf & 1;
+    unsigned start = 0;
+
+    for (; pcurr <= pend; ++pcurr, is_set ^= 1)
+    {
+        if (is_set)
+        {
+            unsigned len = *pcurr - start + 1;
+            if (rank <= len)
+                return start + rank - 1;
+            rank -= len;
+        }
+        start = *pcurr + 1u;
+    }
+    BM_ASSERT(0); // rank is out of the block population
+    return bm::gap_max_bits;
+}
+
 
 /*! 
     D-GAP block for_each algorithm
@@ -2478,6 +2605,38 @@ void bit_block_set(bm::word_t* BMRESTRICT dst, bm::word_t value)
 }
 
 
+#ifdef VECT_BIT_BLOCK_XOR_PREFIX
+
+/*!
+   \brief GAP block to bitblock conversion (SIMD variant for long GAPs).
+
+   Every run boundary toggles one bit (start of the next run), 
+   then SIMD prefix XOR of the block fills the runs. 
+   Cost does not depend on the lengths of runs (no branches per run).
+
+   \param dest - bitblock buffer pointer.
+   \param buf  - GAP buffer pointer.
+
+   @ingroup gapfunc
+*/
+template<typename T> 
+void gap_convert_to_bitset_xp(unsigned* BMRESTRICT dest, 
+                              const T*  BMRESTRICT buf)
+{
+    bit_block_set(dest, 0);
+    const T* pcurr = buf + 1;
+    const T* pend = buf + (*buf >> 3); // last element is always 65535
+    for (; pcurr < pend; ++pcurr)
+    {
+        unsigned nbit = unsigned(*pcurr) + 1;
+        dest[nbit >> bm::set_word_shift] ^= (1u << (nbit & bm::set_word_mask));
+    }
+    VECT_BIT_BLOCK_XOR_PREFIX(dest, dest + bm::set_block_size, 
+                              (*buf & 1) ? ~0u : 0u);
+}
+
+#endif
+
 /*!
    \brief GAP block to bitblock conversion.
    \param dest - bitblock buffer pointer.
@@ -2488,6 +2647,13 @@ void bit_block_set(bm::word_t* BMRESTRICT dst, bm::word_t value)
 template<typename T> 
 void gap_convert_to_bitset(unsigned* dest, const T*  buf)
 {
+#ifdef VECT_BIT_BLOCK_XOR_PREFIX
+    if ((*buf >> 3) >= bm::gap_vect_convert_len)
+    {
+        gap_convert_to_bitset_xp(dest, buf);
+        return;
+    }
+#endif
     bit_block_set(dest, 0);
     gap_add_to_bitset(dest, buf);
 }
@@ -2936,6 +3102,64 @@ complete:
 }
 
 
+/*! 
+   \brief Converts full bit block to GAP. 
+
+   Run boundaries are found as bit changes (w ^ (w << 1)) of 64-bit words
+   and unpacked with popcount, two per word without branches. 
+   Faster than bit_convert_to_gap() on blocks with many runs.
+
+   \param dest - Destination GAP buffer.
+   \param src - Source bitblock buffer.
+   \param dest_len - length of the dest. buffer.
+   \return  New length of GAP block or 0 if conversion failed 
+   (insufficicent space).
+
+   @ingroup gapfunc
+*/
+template<typename T> 
+unsigned bit_convert_to_gap_pcnt(T* BMRESTRICT dest, 
+                                 const unsigned* BMRESTRICT src, 
+                                 unsigned dest_len)
+{
+    const bm::id64_t* BMRESTRICT src64 = (const bm::id64_t*) src;
+    T* BMRESTRICT pcurr = dest + 1;
+    T* BMRESTRICT end = dest + dest_len; 
+    bm::id64_t carry = src64[0] & 1u;
+    *dest = (T)carry;
+
+    for (unsigned i = 0; i < bm::set_block_size / 2; ++i)
+    {
+        bm::id64_t w = src64[i];
+        bm::id64_t t = w ^ ((w << 1) | carry);
+        carry = w >> 63;
+
+        unsigned cnt = (unsigned) bm::word_bitcount64(t);
+        if (pcurr + cnt + 2 >= end)
+        {
+            return 0; // OUT of memory
+        }
+        // change at bit N closes the run at N-1
+        unsigned base = (i << 6) - 1; 
+        T* BMRESTRICT p = pcurr;
+        pcurr += cnt;
+        p[0] = (T)(base + unsigned(bm::word_bitcount64((t & (0 - t)) - 1)));
+        t &= t - 1;
+        p[1] = (T)(base + unsigned(bm::word_bitcount64((t & (0 - t)) - 1)));
+        t &= t - 1;
+        for (p += 2; t; t &= t - 1)
+        {
+            *p++ = (T)(base + unsigned(bm::word_bitcount64((t & (0 - t)) - 1)));
+        }
+    } // for i
+
+    *pcurr = (T)(bm::gap_max_bits - 1);
+    unsigned len = (unsigned)(pcurr - dest);
+    *dest = (T)((*dest & 7) + (len << 3));
+    return len;
+}
+
+
 /*!
    \brief Iterate gap block as delta-bits with a functor 
    @ingroup gapfunc
@@ -3200,9 +3424,14 @@ bm::id_t bit_block_calc_count_change(const bm::word_t* block,
                                      const bm::word_t* block_end,
                                      unsigned*         bit_count)
 {
-#if defined(BMSSE2OPT) || defined(BMSSE42OPT) || defined (BMAVX2OPT)
+#if defined(BM_SIMD_DISPATCH)
+    return VECT_BIT_COUNT_CHANGE(block, block_end, bit_count);
+#elif defined(BMSSE2OPT) || defined(BMSSE42OPT) || defined (BMAVX2OPT)
 
-#ifdef BMAVX2OPT
+#if defined(BMAVX512OPT)
+    return avx512_bit_block_calc_count_change(
+        (const __m512i*)block, (const __m512i*)block_end, bit_count);
+#elif defined(BMAVX2OPT)
     // TODO: debug true avx2 function (stress test failure)
     // temp use SSE4.2 variant
     return sse42_bit_block_calc_count_change(
@@ -3414,6 +3643,77 @@ bm::id_t bit_block_calc_count_to(const bm::word_t*  block,
 }
 
 
+/*!
+    \brief Computes running counts of 512-bit sub-blocks (rank-select index)
+    \param block - bit block pointer
+    \param sub_cnt - [out] running counts, sub_cnt[k] is the number of bits
+                     in [0, (k+1)*bm::rs_sub_block_size) range
+                     (bm::rs_sub_block_count-1 values, the last one is the
+                     block population returned by the function)
+    \return population count of the block
+
+    @ingroup bitfunc
+*/
+inline
+unsigned bit_block_calc_subcount(const bm::word_t*  block,
+                                 bm::gap_word_t*    sub_cnt)
+{
+    BM_ASSERT(block && sub_cnt);
+    const bm::id64_t* b64 = (const bm::id64_t*) block;
+    unsigned count = 0;
+    for (unsigned k = 0; k < bm::rs_sub_block_count; ++k, b64 += 8)
+    {
+    #if defined(BMSSE42OPT) || defined(BMAVX2OPT)
+        count += unsigned(bm::word_bitcount64(b64[0]) + bm::word_bitcount64(b64[1]) +
+                          bm::word_bitcount64(b64[2]) + bm::word_bitcount64(b64[3]) +
+                          bm::word_bitcount64(b64[4]) + bm::word_bitcount64(b64[5]) +
+                          bm::word_bitcount64(b64[6]) + bm::word_bitcount64(b64[7]));
+    #else
+        count += bitcount64_4way(b64[0], b64[1], b64[2], b64[3]) +
+                 bitcount64_4way(b64[4], b64[5], b64[6], b64[7]);
+    #endif
+        if (k < bm::rs_sub_block_count - 1)
+            sub_cnt[k] = (bm::gap_word_t) count;
+    }
+    return count;
+}
+
+/*!
+    \brief Finds position of the rank-th 1 bit in a bit block
+    \param block - bit block pointer
+    \param rank - rank of the bit to find (1-based) counting from nbit_from,
+                  must be present in the block
+    \param nbit_from - search start position (word aligned)
+    \return bit index in the block
+
+    @ingroup bitfunc
+*/
+inline
+unsigned bit_find_rank(const bm::word_t*  block,
+                       unsigned           rank,
+                       unsigned           nbit_from)
+{
+    BM_ASSERT(block && rank);
+    BM_ASSERT((nbit_from & bm::set_word_mask) == 0);
+
+    for (unsigned nword = nbit_from >> bm::set_word_shift;
+         nword < bm::set_block_size; ++nword)
+    {
+        bm::word_t w = block[nword];
+        unsigned bc = bm::word_bitcount(w);
+        if (rank <= bc)
+        {
+            for (--rank; rank; --rank)
+                w &= w - 1; // reset lowest 1 bit
+            return (nword << bm::set_word_shift) + bm::word_trailing_zeros(w);
+        }
+        rank -= bc;
+    }
+    BM_ASSERT(0); // rank is out of the block population
+    return bm::bits_in_block;
+}
+
+
 
 /*!
     Cyclic rotation of bit-block left by 1 bit
@@ -3559,7 +3859,7 @@ template<typename T> void bit_invert(T* start, T* end)
 inline bool is_bits_one(const bm::wordop_t* start, 
                         const bm::wordop_t* end)
 {
-#if defined(BMSSE42OPT) || defined(BMAVX2OPT)
+#if defined(BMSSE42OPT) || defined(BMAVX2OPT) || defined(BM_SIMD_DISPATCH)
     return VECT_IS_ONE_BLOCK(start, end);
 #else
    do
@@ -3584,7 +3884,7 @@ inline
 bool bit_is_all_zero(const bm::wordop_t* start,
                      const bm::wordop_t* end)
 {
-#if defined(BMSSE42OPT) || defined(BMAVX2OPT)
+#if defined(BMSSE42OPT) || defined(BMAVX2OPT) || defined(BM_SIMD_DISPATCH)
     return VECT_IS_ZERO_BLOCK(start, end);
 #else
    do
@@ -3630,6 +3930,49 @@ BMFORCEINLINE unsigned sub_op(unsigned v1, unsigned v2)
 }
 
 
+#ifdef VECT_BIT_BLOCK_XOR_PREFIX
+
+/*!
+   \brief Checks if GAP count operation should run on bit-blocks
+   
+   GAP merge costs a branch miss per run, for long GAPs it is faster to 
+   convert both operands (gap_convert_to_bitset_xp) and use SIMD bit count.
+
+   @ingroup gapfunc
+*/
+BMFORCEINLINE 
+bool gap_count_vect_route(const gap_word_t* BMRESTRICT vect1,
+                          const gap_word_t* BMRESTRICT vect2)
+{
+    return (unsigned(*vect1 >> 3) >= bm::gap_vect_count_len) &&
+           (unsigned(*vect2 >> 3) >= bm::gap_vect_count_len);
+}
+
+
+#ifdef BMAVX2OPT
+
+/*!
+   \brief Checks if GAP logical operation should run on bit-blocks
+   
+   Long GAPs are converted (gap_convert_to_bitset_xp), combined with 
+   SIMD bit operation and converted back (bit_convert_to_gap_pcnt).
+   AVX2 only: with SSE4.2 conversions eat the gain of the merge.
+
+   @ingroup gapfunc
+*/
+BMFORCEINLINE 
+bool gap_merge_vect_route(const gap_word_t* BMRESTRICT vect1,
+                          const gap_word_t* BMRESTRICT vect2)
+{
+    return (unsigned(*vect1 >> 3) >= bm::gap_vect_merge_len) &&
+           (unsigned(*vect2 >> 3) >= bm::gap_vect_merge_len);
+}
+
+#endif
+
+#endif
+
+
 /*!
    \brief GAP AND operation.
    
@@ -3652,6 +3995,21 @@ gap_word_t* gap_operation_and(const gap_word_t* BMRESTRICT vect1,
                               gap_word_t*       BMRESTRICT tmp_buf,
                               unsigned&         dsize)
 {
+#if defined(VECT_BIT_BLOCK_XOR_PREFIX) && defined(BMAVX2OPT)
+    if (bm::gap_merge_vect_route(vect1, vect2))
+    {
+        BM_DECLARE_TEMP_BLOCK(tb1)
+        BM_DECLARE_TEMP_BLOCK(tb2)
+        bm::gap_convert_to_bitset_xp(tb1, vect1);
+        bm::gap_convert_to_bitset_xp(tb2, vect2);
+        VECT_AND_ARR(tb1, tb2, tb2 + bm::set_block_size);
+        // result has no more runs than both operands together
+        dsize = bm::bit_convert_to_gap_pcnt(tmp_buf, tb1, 
+                         unsigned(*vect1 >> 3) + unsigned(*vect2 >> 3) + 4);
+        if (dsize)
+            return tmp_buf;
+    }
+#endif
     gap_buff_op(tmp_buf, vect1, 0, vect2, 0, and_op, dsize);
     return tmp_buf;
 }
@@ -3678,6 +4036,7 @@ unsigned gap_operation_any_and(const gap_word_t* BMRESTRICT vect1,
 }
 
 
+
 /*!
    \brief GAP bitcount AND operation test.
    
@@ -3691,6 +4050,16 @@ BMFORCEINLINE
 unsigned gap_count_and(const gap_word_t* BMRESTRICT vect1,
                        const gap_word_t* BMRESTRICT vect2)
 {
+#ifdef VECT_BIT_BLOCK_XOR_PREFIX
+    if (bm::gap_count_vect_route(vect1, vect2))
+    {
+        BM_DECLARE_TEMP_BLOCK(tb1)
+        BM_DECLARE_TEMP_BLOCK(tb2)
+        bm::gap_convert_to_bitset_xp(tb1, vect1);
+        bm::gap_convert_to_bitset_xp(tb2, vect2);
+        return VECT_BITCOUNT_AND(tb1, tb1 + bm::set_block_size, tb2);
+    }
+#endif
     return gap_buff_count_op(vect1, vect2, and_op);
 }
 
@@ -3718,6 +4087,21 @@ gap_word_t* gap_operation_xor(const gap_word_t*  BMRESTRICT vect1,
                               gap_word_t*        BMRESTRICT tmp_buf,
                               unsigned&                     dsize)
 {
+#if defined(VECT_BIT_BLOCK_XOR_PREFIX) && defined(BMAVX2OPT)
+    if (bm::gap_merge_vect_route(vect1, vect2))
+    {
+        BM_DECLARE_TEMP_BLOCK(tb1)
+        BM_DECLARE_TEMP_BLOCK(tb2)
+        bm::gap_convert_to_bitset_xp(tb1, vect1);
+        bm::gap_convert_to_bitset_xp(tb2, vect2);
+        VECT_XOR_ARR(tb1, tb2, tb2 + bm::set_block_size);
+        // result has no more runs than both operands together
+        dsize = bm::bit_convert_to_gap_pcnt(tmp_buf, tb1, 
+                         unsigned(*vect1 >> 3) + unsigned(*vect2 >> 3) + 4);
+        if (dsize)
+            return tmp_buf;
+    }
+#endif
     gap_buff_op(tmp_buf, vect1, 0, vect2, 0, bm::xor_op, dsize);
     return tmp_buf;
 }
@@ -3757,6 +4141,16 @@ BMFORCEINLINE
 unsigned gap_count_xor(const gap_word_t* BMRESTRICT vect1,
                        const gap_word_t* BMRESTRICT vect2)
 {
+#ifdef VECT_BIT_BLOCK_XOR_PREFIX
+    if (bm::gap_count_vect_route(vect1, vect2))
+    {
+        BM_DECLARE_TEMP_BLOCK(tb1)
+        BM_DECLARE_TEMP_BLOCK(tb2)
+        bm::gap_convert_to_bitset_xp(tb1, vect1);
+        bm::gap_convert_to_bitset_xp(tb2, vect2);
+        return VECT_BITCOUNT_XOR(tb1, tb1 + bm::set_block_size, tb2);
+    }
+#endif
     return gap_buff_count_op(vect1, vect2, bm::xor_op);
 }
 
@@ -3784,6 +4178,21 @@ gap_word_t* gap_operation_or(const gap_word_t*  BMRESTRICT vect1,
                              gap_word_t*        BMRESTRICT tmp_buf,
                              unsigned&                     dsize)
 {
+#if defined(VECT_BIT_BLOCK_XOR_PREFIX) && defined(BMAVX2OPT)
+    if (bm::gap_merge_vect_route(vect1, vect2))
+    {
+        BM_DECLARE_TEMP_BLOCK(tb1)
+        BM_DECLARE_TEMP_BLOCK(tb2)
+        bm::gap_convert_to_bitset_xp(tb1, vect1);
+        bm::gap_convert_to_bitset_xp(tb2, vect2);
+        VECT_OR_ARR(tb1, tb2, tb2 + bm::set_block_size);
+        // result has no more runs than both operands together
+        dsize = bm::bit_convert_to_gap_pcnt(tmp_buf, tb1, 
+                         unsigned(*vect1 >> 3) + unsigned(*vect2 >> 3) + 4);
+        if (dsize)
+            return tmp_buf;
+    }
+#endif
     gap_buff_op(tmp_buf, vect1, 1, vect2, 1, bm::and_op, dsize);
     gap_invert(tmp_buf);
     return tmp_buf;
@@ -3802,6 +4211,16 @@ BMFORCEINLINE
 unsigned gap_count_or(const gap_word_t* BMRESTRICT vect1,
                       const gap_word_t* BMRESTRICT vect2)
 {
+#ifdef VECT_BIT_BLOCK_XOR_PREFIX
+    if (bm::gap_count_vect_route(vect1, vect2))
+    {
+        BM_DECLARE_TEMP_BLOCK(tb1)
+        BM_DECLARE_TEMP_BLOCK(tb2)
+        bm::gap_convert_to_bitset_xp(tb1, vect1);
+        bm::gap_convert_to_bitset_xp(tb2, vect2);
+        return VECT_BITCOUNT_OR(tb1, tb1 + bm::set_block_size, tb2);
+    }
+#endif
     return gap_buff_count_op(vect1, vect2, bm::or_op);
 }
 
@@ -3829,6 +4248,21 @@ inline gap_word_t* gap_operation_sub(const gap_word_t*  BMRESTRICT vect1,
                                      gap_word_t*        BMRESTRICT tmp_buf,
                                      unsigned&                     dsize)
 {
+#if defined(VECT_BIT_BLOCK_XOR_PREFIX) && defined(BMAVX2OPT)
+    if (bm::gap_merge_vect_route(vect1, vect2))
+    {
+        BM_DECLARE_TEMP_BLOCK(tb1)
+        BM_DECLARE_TEMP_BLOCK(tb2)
+        bm::gap_convert_to_bitset_xp(tb1, vect1);
+        bm::gap_convert_to_bitset_xp(tb2, vect2);
+        VECT_SUB_ARR(tb1, tb2, tb2 + bm::set_block_size);
+        // result has no more runs than both operands together
+        dsize = bm::bit_convert_to_gap_pcnt(tmp_buf, tb1, 
+                         unsigned(*vect1 >> 3) + unsigned(*vect2 >> 3) + 4);
+        if (dsize)
+            return tmp_buf;
+    }
+#endif
     gap_buff_op(tmp_buf, vect1, 0, vect2, 1, and_op, dsize);    
     return tmp_buf;
 }
@@ -3869,6 +4303,16 @@ BMFORCEINLINE
 unsigned gap_count_sub(const gap_word_t* BMRESTRICT vect1,
                        const gap_word_t* BMRESTRICT vect2)
 {
+#ifdef VECT_BIT_BLOCK_XOR_PREFIX
+    if (bm::gap_count_vect_route(vect1, vect2))
+    {
+        BM_DECLARE_TEMP_BLOCK(tb1)
+        BM_DECLARE_TEMP_BLOCK(tb2)
+        bm::gap_convert_to_bitset_xp(tb1, vect1);
+        bm::gap_convert_to_bitset_xp(tb2, vect2);
+        return VECT_BITCOUNT_SUB(tb1, tb1 + bm::set_block_size, tb2);
+    }
+#endif
     return gap_buff_count_op(vect1, vect2, bm::sub_op);
 }
 
@@ -5108,12 +5552,12 @@ template<typename T,typename B> unsigned bit_list_4(T w, B* bits)
     @ingroup bitfunc
 */
 template<typename B>
-unsigned short bitscan_popcnt(bm::id_t w, B* bits, unsigned  offs = 0)
+unsigned short bitscan_popcnt(bm::word_t w, B* bits, unsigned  offs = 0)
 {
     unsigned pos = 0;
     while (w)
     {
-        bm::id_t t = w & -w;
+        bm::word_t t = w & -w;
         bits[pos++] = (B)(bm::word_bitcount(t - 1) + offs);
         w &= w - 1;
     }
@@ -5244,6 +5688,115 @@ template<typename T> T bit_convert_to_arr(T* BMRESTRICT dest,
 
 
 
+/*!
+    @brief Decode bit block into array of ON bit indexes (+ offset)
+    
+    Decoding stops when the destination array is full,
+    decoding can be resumed from the bit after the last decoded index.
+    
+    @param block - bit block
+    @param nbit - bit to start from
+    @param arr - destination array
+    @param size - destination array capacity
+    @param offset - value to add to indexes (block base address)
+    @return number of decoded indexes
+    
+    @ingroup bitfunc 
+*/
+template<typename T>
+unsigned bit_block_decode(const bm::word_t* BMRESTRICT block,
+                          unsigned                     nbit,
+                          T* BMRESTRICT                arr,
+                          unsigned                     size,
+                          T                            offset)
+{
+    BM_ASSERT(nbit < bm::gap_max_bits);
+    T* BMRESTRICT pcurr = arr;
+    T* BMRESTRICT pend = arr + size;
+    unsigned nword = nbit >> bm::set_word_shift;
+    bm::word_t w = block[nword] & (~0u << (nbit & bm::set_word_mask));
+    for (;;)
+    {
+        if (w)
+        {
+            T base = offset + T(nword << bm::set_word_shift);
+            if (pend - pcurr >= 32 + 8) // room for SIMD decode overwrite
+            {
+#ifdef VECT_BIT_DECODE32
+                if (sizeof(T) == sizeof(unsigned))
+                {
+                    pcurr += VECT_BIT_DECODE32(w, (unsigned*)pcurr, 
+                                               unsigned(base));
+                }
+                else
+#endif
+                for (; w; w &= w - 1)
+                    *pcurr++ = base + T(bm::word_bitcount((w & (0u-w)) - 1));
+            }
+            else
+            {
+                for (; w && pcurr < pend; w &= w - 1)
+                    *pcurr++ = base + T(bm::word_bitcount((w & (0u-w)) - 1));
+                if (pcurr == pend)
+                    break;
+            }
+        }
+        if (++nword == bm::set_block_size)
+            break;
+        w = block[nword];
+    } // for
+    return unsigned(pcurr - arr);
+}
+
+/*!
+    @brief Decode GAP block into array of ON bit indexes (+ offset)
+    
+    Decoding stops when the destination array is full,
+    decoding can be resumed from the bit after the last decoded index.
+    
+    @param buf - GAP block
+    @param nbit - bit to start from
+    @param arr - destination array
+    @param size - destination array capacity
+    @param offset - value to add to indexes (block base address)
+    @return number of decoded indexes
+    
+    @ingroup gapfunc 
+*/
+template<typename T>
+unsigned gap_block_decode(const bm::gap_word_t* BMRESTRICT buf,
+                          unsigned                         nbit,
+                          T* BMRESTRICT                    arr,
+                          unsigned                         size,
+                          T                                offset)
+{
+    BM_ASSERT(nbit < bm::gap_max_bits);
+    unsigned is_set;
+    unsigned idx = bm::gap_bfind(buf, nbit, &is_set);
+    const bm::gap_word_t* BMRESTRICT pcurr = buf + idx;
+    const bm::gap_word_t* BMRESTRICT pend = buf + (*buf >> 3);
+    T* BMRESTRICT parr = arr;
+    unsigned rest = size;
+    for (unsigned start = nbit; pcurr <= pend && rest; ++pcurr, is_set ^= 1)
+    {
+        unsigned end = *pcurr;
+        if (is_set)
+        {
+            unsigned len = end - start + 1;
+            if (len > rest)
+                len = rest;
+            T v = offset + T(start);
+            for (unsigned i = 0; i < len; ++i)
+                parr[i] = v + T(i);
+            parr += len;
+            rest -= len;
+        }
+        start = end + 1;
+    } // for
+    return unsigned(parr - arr);
+}
+
+
 /*! @brief Calculates memory overhead for number of gap blocks sharing 
            the same memory allocation table (level lengths table).
     @ingroup gapfunc
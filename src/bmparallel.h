@@ -0,0 +1,549 @@
+#ifndef BMPARALLEL__H__INCLUDED__
+#define BMPARALLEL__H__INCLUDED__
+/*
+Copyright(c) 2002-2017 Anatoliy Kuznetsov(anatoliy_kuznetsov at yahoo.com)
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+For more information please visit:  http://bitmagic.io
+*/
+
+/*! \file bmparallel.h
+    \brief Block-parallel (multi-threaded) algorithms on bvector<>
+
+    Block tree of bvector<> is partitioned by top level block index,
+    disjoint ranges of top blocks are independent and processed by
+    different threads without locks.
+
+    Threads are provided by the caller via a thread pool adapter
+    with the following interface:
+
+    \code
+    class thread_pool
+    {
+    public:
+        // number of threads available for the algorithm
+        unsigned concurrency() const;
+        // call task(k) for every k in [0, task_count)
+        // (in any order, from any thread), return when all tasks are done
+        template<class Task> void run(Task& task, unsigned task_count);
+    };
+    \endcode
+
+    bm::std_thread_executor is a reference adapter based on std::thread.
+
+    Block allocator of the vectors must be thread safe
+    (default bm::block_allocator is).
+
+    Parallel serialization uses the chunked format with block-offset
+    directory (see bm::chunked_serializer).
+*/
+
+#include "bm.h"
+#include "bmfunc.h"
+#include "bmserial.h"
+
+#ifndef BM_NO_CXX11
+# include <thread>
+# include <atomic>
+#endif
+
+#include "bmdef.h"
+
+namespace bm
+{
+
+/// Parallel partitioning constants
+enum parallel_params
+{
+    /// number of tasks per thread (load balancing granularity)
+    parallel_tasks_per_thread = 16,
+    /// max number of tasks the top block array is split into
+    parallel_max_tasks = 256
+};
+
+/**
+    \brief Compute number of tasks and top blocks per task
+    \param top_size    - number of top blocks to split
+    \param concurrency - number of threads
+    \param step        - [out] number of top blocks per task
+    \return number of tasks
+    \internal
+*/
+inline
+unsigned parallel_split(unsigned top_size, unsigned concurrency,
+                        unsigned& step)
+{
+    if (!concurrency)
+        concurrency = 1;
+    unsigned task_count = concurrency * bm::parallel_tasks_per_thread;
+    if (task_count > bm::parallel_max_tasks)
+        task_count = bm::parallel_max_tasks;
+    if (task_count > top_size)
+        task_count = top_size;
+    if (!task_count)
+    {
+        step = 0;
+        return 0;
+    }
+    step = (top_size + task_count - 1) / task_count;
+    return (top_size + step - 1) / step;
+}
+
+
+/**
+    \brief Task of the parallel combine operation: combines a range of
+    top blocks of the target with the argument
+    \internal
+*/
+template<class BV>
+class combine_range_task
+{
+public:
+    combine_range_task(BV& bv, const BV& bv_arg, bm::operation opcode,
+                       unsigned top_size, unsigned step)
+    : bv_(bv), bv_arg_(bv_arg), opcode_(opcode),
+      top_size_(top_size), step_(step)
+    {}
+
+    void operator()(unsigned task_idx)
+    {
+        unsigned top_from = task_idx * step_;
+        unsigned top_to = top_from + step_;
+        if (top_to > top_size_)
+            top_to = top_size_;
+
+        typename BV::blocks_manager_type& bman = bv_.get_blocks_manager();
+        bm::word_t* temp_block = bman.get_allocator().alloc_bit_block();
+        bv_.combine_operation_range(bv_arg_, opcode_,
+                                    top_from, top_to, temp_block);
+        bman.get_allocator().free_bit_block(temp_block);
+    }
+private:
+    combine_range_task(const combine_range_task&);
+    combine_range_task& operator=(const combine_range_task&);
+private:
+    BV&            bv_;
+    const BV&      bv_arg_;
+    bm::operation  opcode_;
+    unsigned       top_size_;
+    unsigned       step_;
+};
+
+/**
+    \brief Task of the parallel count: counts bits in a range of
+    top blocks, result goes to the per-task slot
+    \internal
+*/
+template<class BV>
+class count_range_task
+{
+public:
+    count_range_task(const BV& bv, unsigned top_size, unsigned step,
+                     bm::id_t* counts)
+    : bv_(bv), top_size_(top_size), step_(step), counts_(counts)
+    {}
+
+    void operator()(unsigned task_idx)
+    {
+        unsigned top_from = task_idx * step_;
+        unsigned top_to = top_from + step_;
+        if (top_to > top_size_)
+            top_to = top_size_;
+
+        const typename BV::blocks_manager_type& bman =
+                                            bv_.get_blocks_manager();
+        bm::word_t*** blk_root = bman.top_blocks_root();
+        bm::id_t cnt = 0;
+        for (unsigned i = top_from; i < top_to; ++i)
+        {
+            bm::word_t** blk_blk = blk_root[i];
+            if (!blk_blk)
+                continue;
+            for (unsigned j = 0; j < bm::set_array_size; ++j)
+            {
+                const bm::word_t* blk = blk_blk[j];
+                if (blk)
+                    cnt += bman.block_bitcount(blk);
+            } // for j
+        } // for i
+        counts_[task_idx] = cnt;
+    }
+private:
+    count_range_task(const count_range_task&);
+    count_range_task& operator=(const count_range_task&);
+private:
+    const BV&  bv_;
+    unsigned   top_size_;
+    unsigned   step_;
+    bm::id_t*  counts_;
+};
+
+/**
+    \brief Task of the parallel optimization: optimizes blocks
+    in a range of top blocks
+    \internal
+*/
+template<class BV>
+class optimize_range_task
+{
+public:
+    optimize_range_task(BV& bv, typename BV::optmode opt_mode,
+                        unsigned top_size, unsigned step)
+    : bv_(bv), opt_mode_(opt_mode), top_size_(top_size), step_(step)
+    {}
+
+    void operator()(unsigned task_idx)
+    {
+        unsigned top_from = task_idx * step_;
+        unsigned top_to = top_from + step_;
+        if (top_to > top_size_)
+            top_to = top_size_;
+
+        typedef typename BV::blocks_manager_type bman_type;
+        bman_type& bman = bv_.get_blocks_manager();
+        bm::word_t* temp_block = bman.get_allocator().alloc_bit_block();
+        {
+            typename bman_type::block_opt_func opt_func(bman, temp_block,
+                                                        (int)opt_mode_);
+            bm::for_each_nzblock_range(bman.top_blocks_root(),
+                                       top_from, top_to, opt_func);
+        }
+        bman.get_allocator().free_bit_block(temp_block);
+    }
+private:
+    optimize_range_task(const optimize_range_task&);
+    optimize_range_task& operator=(const optimize_range_task&);
+private:
+    BV&                   bv_;
+    typename BV::optmode  opt_mode_;
+    unsigned              top_size_;
+    unsigned              step_;
+};
+
+
+/*!
+    \brief Block-parallel logical operation: bv = bv OP bv_arg
+    \param bv     - target vector
+    \param bv_arg - argument vector
+    \param opcode - operation code (BM_AND, BM_OR, BM_XOR, BM_SUB)
+    \param tpool  - thread pool adapter
+    \ingroup setalgo
+*/
+template<class BV, class TPool>
+void combine_operation_mt(BV& bv, const BV& bv_arg,
+                          bm::operation opcode, TPool& tpool)
+{
+    bv.forget_count();
+    unsigned top_size = bv.combine_operation_prepare(bv_arg, opcode);
+    unsigned step;
+    unsigned task_count =
+        bm::parallel_split(top_size, tpool.concurrency(), step);
+    if (!task_count)
+        return;
+    if (task_count == 1)
+    {
+        bv.combine_operation_range(bv_arg, opcode, 0, top_size);
+        return;
+    }
+    bm::combine_range_task<BV> task(bv, bv_arg, opcode, top_size, step);
+    tpool.run(task, task_count);
+}
+
+/*!
+    \brief Block-parallel logical OR: bv |= bv_arg
+    \ingroup setalgo
+*/
+template<class BV, class TPool>
+void bit_or_mt(BV& bv, const BV& bv_arg, TPool& tpool)
+{
+    bm::combine_operation_mt(bv, bv_arg, BM_OR, tpool);
+}
+
+/*!
+    \brief Block-parallel logical AND: bv &= bv_arg
+    \ingroup setalgo
+*/
+template<class BV, class TPool>
+void bit_and_mt(BV& bv, const BV& bv_arg, TPool& tpool)
+{
+    bm::combine_operation_mt(bv, bv_arg, BM_AND, tpool);
+}
+
+/*!
+    \brief Block-parallel logical XOR: bv ^= bv_arg
+    \ingroup setalgo
+*/
+template<class BV, class TPool>
+void bit_xor_mt(BV& bv, const BV& bv_arg, TPool& tpool)
+{
+    bm::combine_operation_mt(bv, bv_arg, BM_XOR, tpool);
+}
+
+/*!
+    \brief Block-parallel logical SUB (AND NOT): bv -= bv_arg
+    \ingroup setalgo
+*/
+template<class BV, class TPool>
+void bit_sub_mt(BV& bv, const BV& bv_arg, TPool& tpool)
+{
+    bm::combine_operation_mt(bv, bv_arg, BM_SUB, tpool);
+}
+
+/*!
+    \brief Block-parallel population count
+    \param bv    - source vector
+    \param tpool - thread pool adapter
+    \return number of 1 bits
+    \ingroup setalgo
+*/
+template<class BV, class TPool>
+bm::id_t count_mt(const BV& bv, TPool& tpool)
+{
+    const typename BV::blocks_manager_type& bman = bv.get_blocks_manager();
+    if (!bman.is_init())
+        return 0;
+    unsigned top_size = bman.effective_top_block_size();
+    unsigned step;
+    unsigned task_count =
+        bm::parallel_split(top_size, tpool.concurrency(), step);
+    if (task_count <= 1)
+        return bv.count();
+
+    bm::id_t counts[bm::parallel_max_tasks];
+    bm::count_range_task<BV> task(bv, top_size, step, counts);
+    tpool.run(task, task_count);
+
+    bm::id_t cnt = 0;
+    for (unsigned i = 0; i < task_count; ++i)
+        cnt += counts[i];
+    return cnt;
+}
+
+/*!
+    \brief Block-parallel optimization of the vector memory
+    (see bvector<>::optimize())
+    \param bv       - vector to optimize
+    \param tpool    - thread pool adapter
+    \param opt_mode - optimization level
+    \ingroup setalgo
+*/
+template<class BV, class TPool>
+void optimize_mt(BV& bv, TPool& tpool,
+                 typename BV::optmode opt_mode = BV::opt_compress)
+{
+    typename BV::blocks_manager_type& bman = bv.get_blocks_manager();
+    if (!bman.is_init())
+        return;
+    unsigned top_size = bman.effective_top_block_size();
+    unsigned step;
+    unsigned task_count =
+        bm::parallel_split(top_size, tpool.concurrency(), step);
+    if (task_count <= 1)
+    {
+        bv.optimize(0, opt_mode);
+        return;
+    }
+    bm::optimize_range_task<BV> task(bv, opt_mode, top_size, step);
+    tpool.run(task, task_count);
+}
+
+/**
+    \brief Task of the parallel serialization: encodes a chunk
+    \internal
+*/
+template<class BV>
+class serialize_chunk_task
+{
+public:
+    typedef typename bm::chunked_serializer<BV>::buffer buffer_type;
+
+    serialize_chunk_task(bm::chunked_serializer<BV>& bv_serial,
+                         const BV& bv, buffer_type& buf)
+    : bv_serial_(bv_serial), bv_(bv), buf_(buf)
+    {}
+
+    void operator()(unsigned task_idx)
+    {
+        bv_serial_.encode_chunk(bv_, buf_, task_idx);
+    }
+private:
+    serialize_chunk_task(const serialize_chunk_task&);
+    serialize_chunk_task& operator=(const serialize_chunk_task&);
+private:
+    bm::chunked_serializer<BV>&  bv_serial_;
+    const BV&                    bv_;
+    buffer_type&                 buf_;
+};
+
+/**
+    \brief Task of the parallel deserialization: decodes a chunk
+    \internal
+*/
+template<class BV>
+class deserialize_chunk_task
+{
+public:
+    deserialize_chunk_task(bm::chunked_deserializer<BV>& bv_deserial,
+                           BV& bv, const unsigned char* buf)
+    : bv_deserial_(bv_deserial), bv_(bv), buf_(buf)
+    {}
+
+    void operator()(unsigned task_idx)
+    {
+        typename BV::blocks_manager_type& bman = bv_.get_blocks_manager();
+        bm::word_t* temp_block = bman.get_allocator().alloc_bit_block();
+        bv_deserial_.decode_chunk(bv_, buf_, task_idx, temp_block);
+        bman.get_allocator().free_bit_block(temp_block);
+    }
+private:
+    deserialize_chunk_task(const deserialize_chunk_task&);
+    deserialize_chunk_task& operator=(const deserialize_chunk_task&);
+private:
+    bm::chunked_deserializer<BV>&  bv_deserial_;
+    BV&                            bv_;
+    const unsigned char*           buf_;
+};
+
+/*!
+    \brief Parallel serialization into the chunked format
+    (with block-offset directory).
+
+    Chunks are encoded into reserved areas of the output buffer
+    and packed in place.
+
+    \param bv           - source vector
+    \param buf          - output buffer (resized automatically)
+    \param tpool        - thread pool adapter
+    \param chunk_blocks - number of blocks in one chunk
+
+    \sa bm::chunked_serializer
+    \ingroup bvserial
+*/
+template<class BV, class TPool>
+void serialize_mt(const BV& bv,
+                  typename bm::serializer<BV>::buffer& buf,
+                  TPool& tpool,
+                  unsigned chunk_blocks = bm::set_array_size)
+{
+    bm::chunked_serializer<BV> bv_serial(chunk_blocks);
+    unsigned chunk_count = bv_serial.prepare(bv, buf);
+    if (chunk_count > 1)
+    {
+        bm::serialize_chunk_task<BV> task(bv_serial, bv, buf);
+        tpool.run(task, chunk_count);
+    }
+    else
+    if (chunk_count)
+    {
+        bv_serial.encode_chunk(bv, buf, 0);
+    }
+    bv_serial.finalize(bv, buf);
+}
+
+/*!
+    \brief Parallel deserialization (OR into the target vector).
+
+    Chunks of the chunked format are decoded directly into the target
+    vector, BLOBs of the regular format are decoded in one thread.
+
+    \param bv    - target vector
+    \param buf   - serialized BLOB
+    \param tpool - thread pool adapter
+    \return size of the BLOB
+    \ingroup bvserial
+*/
+template<class BV, class TPool>
+size_t deserialize_mt(BV& bv, const unsigned char* buf, TPool& tpool)
+{
+    if (!(buf[0] & bm::BM_HM_DIRECTORY))
+        return bm::deserialize(bv, buf);
+
+    bm::chunked_deserializer<BV> bv_deserial;
+    unsigned chunk_count = bv_deserial.read_directory(buf);
+    bv_deserial.prepare_target(bv);
+    if (chunk_count)
+    {
+        bm::deserialize_chunk_task<BV> task(bv_deserial, bv, buf);
+        tpool.run(task, chunk_count);
+    }
+    bv_deserial.finalize_target(bv);
+    return bv_deserial.size();
+}
+
+
+#ifndef BM_NO_CXX11
+
+/**
+    \brief Thread pool adapter on std::thread
+
+    Starts worker threads for each run() call, the calling thread
+    takes part in the processing. Tasks are distributed via an atomic
+    counter.
+
+    \ingroup setalgo
+*/
+class std_thread_executor
+{
+public:
+    /**
+        \param concurrency - number of threads (0 - hardware concurrency)
+    */
+    explicit std_thread_executor(unsigned concurrency = 0)
+    : concurrency_(concurrency)
+    {
+        if (!concurrency_)
+            concurrency_ = std::thread::hardware_concurrency();
+        if (!concurrency_)
+            concurrency_ = 1;
+    }
+
+    unsigned concurrency() const { return concurrency_; }
+
+    template<class Task>
+    void run(Task& task, unsigned task_count)
+    {
+        std::atomic<unsigned> next_task(0);
+        auto worker = [&task, &next_task, task_count]()
+        {
+            for (unsigned k = next_task.fetch_add(1); k < task_count;
+                 k = next_task.fetch_add(1))
+            {
+                task(k);
+            }
+        };
+        unsigned thread_count = concurrency_ - 1;
+        if (thread_count >= task_count)
+            thread_count = task_count - 1;
+
+        std::thread* threads =
+            thread_count ? new std::thread[thread_count] : 0;
+        for (unsigned i = 0; i < thread_count; ++i)
+            threads[i] = std::thread(worker);
+        worker();
+        for (unsigned i = 0; i < thread_count; ++i)
+            threads[i].join();
+        delete [] threads;
+    }
+private:
+    unsigned concurrency_;
+};
+
+#endif
+
+
+} // namespace bm
+
+#include "bmundef.h"
+
+#endif
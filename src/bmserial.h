@@ -92,7 +92,9 @@ enum serialization_header_mask {
     BM_HM_RESIZE  = (1 << 1), ///< resized vector
     BM_HM_ID_LIST = (1 << 2), ///< id list stored
     BM_HM_NO_BO   = (1 << 3), ///< no byte-order
-    BM_HM_NO_GAPL = (1 << 4)  ///< no GAP levels
+    BM_HM_NO_GAPL = (1 << 4), ///< no GAP levels
+    BM_HM_64      = (1 << 5), ///< 64-bit vector size
+    BM_HM_DIRECTORY = (1 << 6)  ///< chunked format with block-offset directory
 };
 
 
@@ -196,6 +198,31 @@ public:
     */
     unsigned serialize(const BV& bv, 
                        unsigned char* buf, size_t buf_size);
+
+    /**
+        Serialization of a range of blocks [nb_from, nb_to) into memory block.
+        Result is a regular serialization stream (bits outside of the
+        range are not stored).
+
+        @param bv       - input bitvector
+        @param buf      - out buffer (pre-allocated, see max_blocks_size())
+        @param buf_size - size of the output buffer
+        @param nb_from  - first block to serialize
+        @param nb_to    - block to stop at (not included)
+
+        @return Size of serialization block.
+        @sa max_blocks_size
+    */
+    unsigned serialize_blocks(const BV& bv,
+                              unsigned char* buf, size_t buf_size,
+                              unsigned nb_from, unsigned nb_to);
+
+    /**
+        Upper estimate of serialization size for a range of
+        blocks [nb_from, nb_to)
+    */
+    static
+    size_t max_blocks_size(const BV& bv, unsigned nb_from, unsigned nb_to);
     
     /**
         Bitvector serilization into buffer object (it gets resized automatically)
@@ -295,6 +322,10 @@ protected:
                           unsigned        block_type, 
                           bm::gap_word_t* dst_arr);
 
+    /// Read vector size from the header (32-bit or 64-bit field)
+    static bm::id_t read_bv_size(decoder_type& decoder, 
+                                 unsigned char header_flag);
+
 protected:
     bm::gap_word_t   id_array_[bm::gap_equiv_len * 2];
 };
@@ -400,7 +431,7 @@ public:
     serial_stream_iterator(const unsigned char* buf);
 
     /// serialized bitvector size
-    unsigned bv_size() const { return bv_size_; }
+    bm::id_t bv_size() const { return bv_size_; }
 
     /// Returns true if end of bit-stream reached 
     bool is_eof() const { return end_of_stream_; }
@@ -507,7 +538,7 @@ protected:
 
     decoder_type       decoder_;
     bool               end_of_stream_;
-    unsigned           bv_size_;
+    bm::id_t           bv_size_;
     iterator_state     state_;
     unsigned           id_cnt_;  ///< Id counter for id list
     bm::id_t           last_id_; ///< Last id from the id list
@@ -579,6 +610,219 @@ private:
 
 };
 
+/**
+    Chunk descriptor of the block-offset directory
+    (chunked serialization format)
+    @ingroup bvserial
+*/
+struct serial_chunk
+{
+    unsigned nb_from; ///< first block of the chunk
+    unsigned nb_to;   ///< block to stop at (not included)
+    size_t   offset;  ///< offset of the chunk stream in the BLOB
+    size_t   size;    ///< size of the chunk stream
+};
+
+/**
+    Chunked serialization with a block-offset directory.
+
+    Vector is split into chunks of top level blocks, every chunk is
+    serialized as an independent regular stream, the BLOB starts with
+    a directory of chunks, so chunks can be encoded and decoded
+    independently (in parallel).
+    Empty ranges of the vector produce no chunks.
+
+ <pre>
+ | DIRECTORY | CHUNK 0 | CHUNK 1 | ... |
+
+ Directory:
+   BYTE : Serialization header (BM_HM_DIRECTORY | BM_HM_*)
+   BYTE : Byte order ( 0 - Big Endian, 1 - Little Endian)
+   INT32/INT64: vector size (if BM_HM_RESIZE)
+   INT32: Number of chunks
+   Chunk descriptors:
+     INT32: first block of the chunk
+     INT32: block to stop at (not included)
+     INT32: size of the chunk stream
+ </pre>
+
+    Serialization steps prepare(), encode_chunk() and finalize() are
+    exposed to run encoding of chunks on multiple threads
+    (see bmparallel.h).
+
+    @ingroup bvserial
+*/
+template<class BV>
+class chunked_serializer
+{
+public:
+    typedef BV                                     bvector_type;
+    typedef typename bvector_type::allocator_type  allocator_type;
+    typedef typename serializer<BV>::buffer        buffer;
+public:
+    /**
+        \param chunk_blocks - number of blocks in one chunk
+                  (rounded up to the number of blocks in top level block)
+    */
+    chunked_serializer(unsigned chunk_blocks = bm::set_array_size);
+
+    /**
+        Set compression level of chunks (see serializer)
+    */
+    void set_compression_level(unsigned clevel) { compression_level_ = clevel; }
+
+    /**
+        Serialize vector into the buffer (single thread)
+    */
+    void serialize(const BV& bv, buffer& buf);
+
+    /**
+        Split vector into chunks, reserve the output buffer
+        \return number of chunks
+    */
+    unsigned prepare(const BV& bv, buffer& buf);
+
+    /**
+        Encode chunk into its reserved area of the output buffer.
+        Different chunks can be encoded concurrently.
+    */
+    void encode_chunk(const BV& bv, buffer& buf, unsigned k);
+
+    /**
+        Pack encoded chunks and write the directory
+    */
+    void finalize(const BV& bv, buffer& buf);
+
+    /// Number of chunks
+    unsigned chunk_count() const { return chunk_cnt_; }
+
+    /// Chunk descriptor
+    const serial_chunk& get_chunk(unsigned k) const;
+
+private:
+    chunked_serializer(const chunked_serializer&);
+    chunked_serializer& operator=(const chunked_serializer&);
+
+    serial_chunk* chunks()
+        { return (serial_chunk*) chunk_buf_.data(); }
+    
+private:
+    unsigned  chunk_blocks_;
+    unsigned  compression_level_;
+    unsigned  chunk_cnt_;
+    size_t    dir_size_;
+    buffer    chunk_buf_;
+};
+
+/**
+    Deserializer of the chunked (block-offset directory) format.
+
+    Steps read_directory(), prepare_target(), decode_chunk() and
+    finalize_target() are exposed to decode chunks on multiple
+    threads (see bmparallel.h).
+
+    @ingroup bvserial
+*/
+template<class BV>
+class chunked_deserializer
+{
+public:
+    typedef BV                                     bvector_type;
+    typedef typename bvector_type::allocator_type  allocator_type;
+    typedef typename serializer<BV>::buffer        buffer;
+public:
+    chunked_deserializer();
+
+    /**
+        Deserialize chunked BLOB (OR into the target vector)
+        \return size of the BLOB
+    */
+    size_t deserialize(BV& bv, const unsigned char* buf,
+                       bm::word_t* temp_block = 0);
+
+    /**
+        Deserialize range [from, to] of the chunked BLOB and combine it
+        with the target vector. Only chunks overlapping the range are
+        decoded, bits of the BLOB outside of the range are ignored
+        (set_AND clears all target bits outside of the range).
+        \param op - set_OR, set_AND, set_SUB or set_XOR
+        \return size of the BLOB
+    */
+    size_t deserialize_range(BV& bv, const unsigned char* buf,
+                             bm::id_t from, bm::id_t to,
+                             bm::set_operation op = bm::set_OR,
+                             bm::word_t* temp_block = 0);
+
+    /**
+        Read the block-offset directory
+        (reads only the directory, not the chunks)
+        \return number of chunks
+    */
+    unsigned read_directory(const unsigned char* buf);
+
+    /**
+        Find chunks overlapping the range [from, to]
+        (after read_directory()).
+        Chunk k is a regular serialization stream of get_chunk(k).size
+        bytes at get_chunk(k).offset in the BLOB, it can be read from
+        storage and restored with bm::deserialize() independently.
+
+        \param k_from - first overlapping chunk
+        \param k_to - chunk to stop at (not included)
+        \return number of overlapping chunks
+    */
+    unsigned find_chunks(bm::id_t from, bm::id_t to,
+                         unsigned& k_from, unsigned& k_to) const;
+
+    /**
+        Prepare target vector for independent decoding of chunks
+        (resize, top level blocks reservation)
+    */
+    void prepare_target(BV& bv);
+
+    /**
+        Decode chunk (OR into the target vector).
+        Different chunks can be decoded concurrently
+        (after prepare_target()).
+        \param temp_block - temp block (if concurrent: per thread)
+    */
+    void decode_chunk(BV& bv, const unsigned char* buf, unsigned k,
+                      bm::word_t* temp_block);
+
+    /**
+        Restore target vector parameters after decoding of chunks
+    */
+    void finalize_target(BV& bv);
+
+    /// Number of chunks
+    unsigned chunk_count() const { return chunk_cnt_; }
+
+    /// Chunk descriptor
+    const serial_chunk& get_chunk(unsigned k) const;
+
+    /// Size of the chunked BLOB (directory + all chunks)
+    size_t size() const { return blob_size_; }
+
+    /// Size of the directory (offset of the first chunk)
+    size_t directory_size() const { return dir_size_; }
+
+private:
+    chunked_deserializer(const chunked_deserializer&);
+    chunked_deserializer& operator=(const chunked_deserializer&);
+
+    template<class DEC>
+    void read_chunks(DEC& dec);
+
+private:
+    unsigned char  header_flag_;
+    bm::id_t       bv_size_;
+    unsigned       chunk_cnt_;
+    size_t         dir_size_;
+    size_t         blob_size_;
+    bm::strategy   strat_;
+    buffer         chunk_buf_;
+};
+
 
 
 
@@ -673,6 +917,10 @@ void serializer<BV>::encode_header(const BV& bv, bm::encoder& enc)
 
     if (!gap_serial_) 
         header_flag |= BM_HM_NO_GAPL;
+#ifdef BM64ADDR
+    if ((header_flag & BM_HM_RESIZE) && (bv.size() > 0xFFFFFFFFull))
+        header_flag |= BM_HM_64;
+#endif
 
     enc.put_8(header_flag);
 
@@ -691,7 +939,10 @@ void serializer<BV>::encode_header(const BV& bv, bm::encoder& enc)
     // save size (only if bvector has been down-sized)
     if (header_flag & BM_HM_RESIZE) 
     {
-        enc.put_32(bv.size());
+        if (header_flag & BM_HM_64)
+            enc.put_64(bv.size());
+        else
+            enc.put_32((bm::word_t)bv.size());
     }
     
 }
@@ -909,8 +1160,53 @@ void serializer<BV>::serialize(const BV& bv,
 template<class BV>
 unsigned serializer<BV>::serialize(const BV& bv, 
                                    unsigned char* buf, size_t buf_size)
+{
+    return serialize_blocks(bv, buf, buf_size, 0, bm::set_total_blocks);
+}
+
+template<class BV>
+size_t serializer<BV>::max_blocks_size(const BV& bv,
+                                       unsigned nb_from, unsigned nb_to)
+{
+    // header + leading zero run + trailing code
+    size_t max_size = 64;
+
+    const blocks_manager_type& bman = bv.get_blocks_manager();
+    if (!bman.is_init())
+        return max_size;
+    bm::word_t*** blk_root = bman.top_blocks_root();
+    unsigned top_size = bman.top_block_size();
+
+    unsigned i_from = nb_from >> bm::set_array_shift;
+    unsigned i_to = (nb_to + bm::set_array_size - 1) >> bm::set_array_shift;
+    if (i_to > top_size)
+        i_to = top_size;
+    for (unsigned i = i_from; i < i_to; ++i)
+    {
+        bm::word_t** blk_blk = blk_root[i];
+        if (!blk_blk)
+        {
+            max_size += 8; // zero run
+            continue;
+        }
+        for (unsigned j = 0; j < bm::set_array_size; ++j)
+        {
+            // plain bit-block is the worst case of block encoding
+            // 5 bytes is the worst case of a run of empty/full blocks
+            max_size += IS_VALID_ADDR(blk_blk[j]) ?
+                        bm::set_block_size * sizeof(bm::word_t) + 8 : 5;
+        } // for j
+    } // for i
+    return max_size;
+}
+
+template<class BV>
+unsigned serializer<BV>::serialize_blocks(const BV& bv, 
+                                          unsigned char* buf, size_t buf_size,
+                                          unsigned nb_from, unsigned nb_to)
 {
     BM_ASSERT(temp_block_);
+    BM_ASSERT(nb_from < nb_to && nb_to <= bm::set_total_blocks);
     
     const blocks_manager_type& bman = bv.get_blocks_manager();
 
@@ -921,9 +1217,23 @@ unsigned serializer<BV>::serialize(const BV& bv,
 
     unsigned i,j;
 
+    if (nb_from) // blocks before the range are stored as a zero run
+    {
+        if (nb_from > 1 && nb_from < 128)
+        {
+            enc.put_8((unsigned char)((1u << 7) | nb_from));
+        }
+        else
+        {
+            SER_NEXT_GRP(enc, nb_from, set_block_1zero, 
+                                       set_block_8zero, 
+                                       set_block_16zero, 
+                                       set_block_32zero) 
+        }
+    }
 
     // save blocks.
-    for (i = 0; i < bm::set_total_blocks; ++i)
+    for (i = nb_from; i < nb_to; ++i)
     {
         bm::word_t* blk = bman.get_block(i);
         // -----------------------------------------
@@ -935,7 +1245,7 @@ unsigned serializer<BV>::serialize(const BV& bv,
         {
         zero_block:
             unsigned next_nb = bman.find_next_nz_block(i+1, false);
-            if (next_nb == bm::set_total_blocks) // no more blocks
+            if (next_nb >= nb_to) // no more blocks
             {
                 enc.put_8(set_block_azero);
                 return enc.size();
@@ -964,7 +1274,7 @@ unsigned serializer<BV>::serialize(const BV& bv,
             if (flag)
             {
                 // Look ahead for similar blocks
-                for(j = i+1; j < bm::set_total_blocks; ++j)
+                for(j = i+1; j < nb_to; ++j)
                 {
                    bm::word_t* blk_next = bman.get_block(j);
                    if (flag != bman.is_block_one(j, blk_next, false))
@@ -1257,6 +1567,11 @@ unsigned deserialize(BV& bv,
 
     bm::decoder dec(buf);
     unsigned char header_flag = dec.get_8();
+    if (header_flag & BM_HM_DIRECTORY) // chunked format
+    {
+        chunked_deserializer<BV> deserial;
+        return (unsigned)deserial.deserialize(bv, buf, temp_block);
+    }
     ByteOrder bo = bo_current;
     if (!(header_flag & BM_HM_NO_BO))
     {
@@ -1286,6 +1601,25 @@ unsigned deserialize(BV& bv,
     return 0;
 }
 
+template<class DEC>
+bm::id_t deseriaizer_base<DEC>::read_bv_size(decoder_type& decoder, 
+                                             unsigned char header_flag)
+{
+    if (header_flag & BM_HM_64)
+    {
+        bm::id64_t bv_size = decoder.get_64();
+#ifndef BM64ADDR
+        // vector size does not fit 32-bit address space
+        BM_ASSERT(bv_size <= bm::id_max);
+        BM_ASSERT_THROW(bv_size <= bm::id_max, BM_ERR_RANGE);
+        if (bv_size > bm::id_max)
+            bv_size = bm::id_max;
+#endif
+        return (bm::id_t)bv_size;
+    }
+    return decoder.get_32();
+}
+
 template<class DEC>
 unsigned deseriaizer_base<DEC>::read_id_list(decoder_type&   decoder, 
 		    								 unsigned        block_type, 
@@ -1515,10 +1849,12 @@ deserializer<BV, DEC>::deserialize_gap(unsigned char btype, decoder_type& dec,
         BM_ASSERT(0);
     }
 
+    // temp block is free here, use it as a scratch for GAP conversions
     bv.combine_operation_with_block(i, 
                                    (bm::word_t*)gap_temp_block_, 
                                     1, 
-                                    BM_OR);
+                                    BM_OR,
+                                    temp_block_);
 
 }
 
@@ -1540,7 +1876,8 @@ unsigned deserializer<BV, DEC>::deserialize(bvector_type&        bv,
 
     temp_block_ = temp_block = (word_t*)tmp_buf;
     bm::strategy  strat = bv.get_new_blocks_strat();
-    bv.set_new_blocks_strat(BM_GAP);
+    if (strat != BM_GAP) // no write when set: chunks can be decoded concurrently
+        bv.set_new_blocks_strat(BM_GAP);
 
     decoder_type dec(buf);
 
@@ -1559,7 +1896,7 @@ unsigned deserializer<BV, DEC>::deserialize(bvector_type&        bv,
         // special case: the next comes plain list of integers
         if (header_flag & BM_HM_RESIZE)
         {
-            unsigned bv_size = dec.get_32();
+            bm::id_t bv_size = this->read_bv_size(dec, header_flag);
             if (bv_size > bv.size())
             {
                 bv.resize(bv_size);
@@ -1587,9 +1924,9 @@ unsigned deserializer<BV, DEC>::deserialize(bvector_type&        bv,
         }
     }
 
-    if (header_flag & (1 << 1))
+    if (header_flag & BM_HM_RESIZE)
     {
-        unsigned bv_size = dec.get_32();
+        bm::id_t bv_size = this->read_bv_size(dec, header_flag);
         if (bv_size > bv.size())
         {
             bv.resize(bv_size);
@@ -1602,7 +1939,8 @@ unsigned deserializer<BV, DEC>::deserialize(bvector_type&        bv,
     for (i = 0; i < bm::set_total_blocks; ++i)
     {
         btype = dec.get_8();
-        bm::word_t* blk = bman.get_block(i);
+        bm::word_t* blk; // target block is fetched only by data cases
+                         // (chunks of a vector can be decoded concurrently)
         // pre-check if we have short zero-run packaging here
         //
         if (btype & (1 << 7))
@@ -1652,6 +1990,7 @@ unsigned deserializer<BV, DEC>::deserialize(bvector_type&        bv,
             continue;
         case set_block_bit: 
         {
+            blk = bman.get_block(i);
             if (blk == 0)
             {
                 blk = bman.get_allocator().alloc_bit_block();
@@ -1669,8 +2008,8 @@ unsigned deserializer<BV, DEC>::deserialize(bvector_type&        bv,
         }
         case set_block_bit_1bit:
         {
-            unsigned bit_idx = dec.get_16();
-            bit_idx += i * bm::bits_in_block; 
+            bm::id_t bit_idx = dec.get_16();
+            bit_idx += bm::id_t(i) * bm::bits_in_block; 
             bv.set_bit(bit_idx);
             continue;
         }
@@ -1709,6 +2048,7 @@ unsigned deserializer<BV, DEC>::deserialize(bvector_type&        bv,
             head_idx = dec.get_16();
             tail_idx = dec.get_16();
 
+            blk = bman.get_block(i);
             if (blk == 0)
             {
                 blk = bman.get_allocator().alloc_bit_block();
@@ -1739,7 +2079,7 @@ unsigned deserializer<BV, DEC>::deserialize(bvector_type&        bv,
         case set_block_arrgap_egamma:
         case set_block_arrgap_egamma_inv:
         case set_block_arrgap_inv:    
-            deserialize_gap(btype, dec, bv, bman, i, blk);
+            deserialize_gap(btype, dec, bv, bman, i, bman.get_block(i));
             continue;
         case set_block_arrbit:
         {
@@ -1755,6 +2095,7 @@ unsigned deserializer<BV, DEC>::deserialize(bvector_type&        bv,
             }
             else
             {
+                blk = bman.get_block(i);
                 if (blk == 0)  // block does not exists yet
                 {
                     blk = bman.get_allocator().alloc_bit_block();
@@ -1777,7 +2118,8 @@ unsigned deserializer<BV, DEC>::deserialize(bvector_type&        bv,
     } // for i
 
     bv.forget_count();
-    bv.set_new_blocks_strat(strat);
+    if (strat != BM_GAP)
+        bv.set_new_blocks_strat(strat);
 
     return dec.size();
 }
@@ -1838,7 +2180,7 @@ serial_stream_iterator<DEC>::serial_stream_iterator(const unsigned char* buf)
         // special case: the next comes plain list of unsigned integers
         if (header_flag & BM_HM_RESIZE)
         {
-            bv_size_ = decoder_.get_32();
+            bv_size_ = this->read_bv_size(decoder_, header_flag);
         }
 
         state_ = e_list_ids;
@@ -1857,9 +2199,9 @@ serial_stream_iterator<DEC>::serial_stream_iterator(const unsigned char* buf)
             }
         }
 
-        if (header_flag & (1 << 1))
+        if (header_flag & BM_HM_RESIZE)
         {
-            bv_size_ = decoder_.get_32();
+            bv_size_ = this->read_bv_size(decoder_, header_flag);
         }
         state_ = e_blocks;
     }
@@ -3282,7 +3624,7 @@ void iterator_deserializer<BV, SerialIterator>::deserialize(
         bman_target.init_tree();
     }
 
-    unsigned bv_size = sit.bv_size();
+    bm::id_t bv_size = sit.bv_size();
     if (bv_mask.size() > bv_size) 
     {
         bv_size = bv_mask.size();    
@@ -3438,7 +3780,7 @@ void iterator_deserializer<BV, SerialIterator>::deserialize(
 					if (op == set_AND)
 					{
 						unsigned bit_idx = sit.get_bit();
-						unsigned bn = (bv_block_idx << bm::set_block_shift) | bit_idx;
+						bm::id_t bn = (bm::id_t(bv_block_idx) << bm::set_block_shift) | bit_idx;
 						bool bval_mask = bv_mask.test(bn);
 						bv_target.set_bit(bn, bval_mask);						
 						break;
@@ -3815,7 +4157,443 @@ iterator_deserializer<BV, SerialIterator>::deserialize(
     return count;
 }
 
+//----------------------------------------------------------------------
+
+template<class BV>
+chunked_serializer<BV>::chunked_serializer(unsigned chunk_blocks)
+: compression_level_(4),
+  chunk_cnt_(0),
+  dir_size_(0)
+{
+    if (!chunk_blocks)
+        chunk_blocks = bm::set_array_size;
+    chunk_blocks_ = (chunk_blocks + bm::set_array_size - 1) &
+                                                    ~bm::set_array_mask;
+}
+
+template<class BV>
+const serial_chunk& chunked_serializer<BV>::get_chunk(unsigned k) const
+{
+    BM_ASSERT(k < chunk_cnt_);
+    return ((const serial_chunk*) chunk_buf_.buf())[k];
+}
+
+template<class BV>
+void chunked_serializer<BV>::serialize(const BV& bv, buffer& buf)
+{
+    unsigned cnt = prepare(bv, buf);
+    for (unsigned k = 0; k < cnt; ++k)
+        encode_chunk(bv, buf, k);
+    finalize(bv, buf);
+}
+
+template<class BV>
+unsigned chunked_serializer<BV>::prepare(const BV& bv, buffer& buf)
+{
+    typedef typename bvector_type::blocks_manager_type blocks_manager_type;
+    const blocks_manager_type& bman = bv.get_blocks_manager();
+
+    unsigned top_size = 
+        bman.is_init() ? bman.effective_top_block_size() : 0;
+    unsigned top_step = chunk_blocks_ >> bm::set_array_shift;
+    unsigned max_chunks = (top_size + top_step - 1) / top_step;
+
+    chunk_buf_.resize(max_chunks * sizeof(serial_chunk));
+    serial_chunk* chunk = chunks();
+    chunk_cnt_ = 0;
+
+    bm::word_t*** blk_root = bman.top_blocks_root();
+    for (unsigned i = 0; i < top_size; i += top_step)
+    {
+        unsigned i_to = i + top_step;
+        if (i_to > top_size)
+            i_to = top_size;
+        unsigned k;
+        for (k = i; k < i_to; ++k) // skip empty ranges
+        {
+            if (blk_root[k])
+                break;
+        }
+        if (k == i_to)
+            continue;
+        chunk[chunk_cnt_].nb_from = i << bm::set_array_shift;
+        chunk[chunk_cnt_].nb_to = i_to << bm::set_array_shift;
+        ++chunk_cnt_;
+    } // for i
+
+    // directory size
+    dir_size_ = 1 + 1 + sizeof(bm::word_t) + 
+                chunk_cnt_ * 3 * sizeof(bm::word_t);
+    if (bv.size() != bm::id_max)
+        dir_size_ += sizeof(bm::id64_t);
+
+    // reserve the output buffer areas
+    size_t offset = dir_size_;
+    for (unsigned k = 0; k < chunk_cnt_; ++k)
+    {
+        chunk[k].offset = offset;
+        chunk[k].size = 
+            serializer<BV>::max_blocks_size(bv, chunk[k].nb_from,
+                                                chunk[k].nb_to);
+        offset += chunk[k].size;
+    }
+    buf.resize(offset);
+    return chunk_cnt_;
+}
+
+template<class BV>
+void chunked_serializer<BV>::encode_chunk(const BV& bv, buffer& buf,
+                                          unsigned k)
+{
+    BM_ASSERT(k < chunk_cnt_);
+    serial_chunk& chunk = chunks()[k];
+
+    bm::serializer<BV> bv_serial(bv.get_allocator());
+    bv_serial.set_compression_level(compression_level_);
+    size_t size = bv_serial.serialize_blocks(bv, buf.data() + chunk.offset,
+                                             chunk.size,
+                                             chunk.nb_from, chunk.nb_to);
+    BM_ASSERT(size <= chunk.size);
+    chunk.size = size;
+}
+
+template<class BV>
+void chunked_serializer<BV>::finalize(const BV& bv, buffer& buf)
+{
+    serial_chunk* chunk = chunks();
+    unsigned char* data = buf.data();
+
+    // pack chunks (in place)
+    size_t offset = dir_size_;
+    for (unsigned k = 0; k < chunk_cnt_; ++k)
+    {
+        if (chunk[k].offset != offset)
+        {
+            ::memmove(data + offset, data + chunk[k].offset, chunk[k].size);
+            chunk[k].offset = offset;
+        }
+        offset += chunk[k].size;
+    }
+
+    // write the directory
+    bm::encoder enc(data, dir_size_);
+    unsigned char header_flag = BM_HM_DIRECTORY;
+    if (bv.size() == bm::id_max)
+        header_flag |= BM_HM_DEFAULT;
+    else
+        header_flag |= BM_HM_RESIZE;
+    enc.put_8(header_flag);
+    enc.put_8((unsigned char)globals<true>::byte_order());
+    if (header_flag & BM_HM_RESIZE)
+        enc.put_64(bv.size());
+    enc.put_32(chunk_cnt_);
+    for (unsigned k = 0; k < chunk_cnt_; ++k)
+    {
+        BM_ASSERT(chunk[k].size <= 0xFFFFFFFFu);
+        enc.put_32(chunk[k].nb_from);
+        enc.put_32(chunk[k].nb_to);
+        enc.put_32((bm::word_t)chunk[k].size);
+    }
+    BM_ASSERT(enc.size() == dir_size_);
+
+    buf.resize(offset);
+}
+
+//----------------------------------------------------------------------
+
+template<class BV>
+chunked_deserializer<BV>::chunked_deserializer()
+: header_flag_(0),
+  bv_size_(0),
+  chunk_cnt_(0),
+  dir_size_(0),
+  blob_size_(0),
+  strat_(BM_BIT)
+{}
+
+template<class BV>
+const serial_chunk& chunked_deserializer<BV>::get_chunk(unsigned k) const
+{
+    BM_ASSERT(k < chunk_cnt_);
+    return ((const serial_chunk*) chunk_buf_.buf())[k];
+}
+
+template<class BV>
+size_t chunked_deserializer<BV>::deserialize(BV& bv,
+                                             const unsigned char* buf,
+                                             bm::word_t* temp_block)
+{
+    unsigned cnt = read_directory(buf);
+    prepare_target(bv);
+    for (unsigned k = 0; k < cnt; ++k)
+        decode_chunk(bv, buf, k, temp_block);
+    finalize_target(bv);
+    return blob_size_;
+}
+
+template<class BV>
+size_t chunked_deserializer<BV>::deserialize_range(BV& bv,
+                                                   const unsigned char* buf,
+                                                   bm::id_t from, bm::id_t to,
+                                                   bm::set_operation op,
+                                                   bm::word_t* temp_block)
+{
+    BM_ASSERT(from <= to);
+    read_directory(buf);
+    if ((header_flag_ & BM_HM_RESIZE) && bv_size_ > bv.size())
+        bv.resize(bv_size_);
+
+    unsigned k_from, k_to;
+    find_chunks(from, to, k_from, k_to);
+
+    bvector_type bv_range(BM_GAP, bm::gap_len_table<true>::_len,
+                          bv.size(), bv.get_allocator());
+    bool masked = false;
+    for (unsigned k = k_from; k < k_to; ++k)
+    {
+        const serial_chunk& chunk = get_chunk(k);
+        bm::id_t first = bm::id_t(chunk.nb_from) * bm::gap_max_bits;
+        bm::id_t last = 
+            bm::id_t(chunk.nb_to - 1) * bm::gap_max_bits + (bm::gap_max_bits-1);
+        if (op == bm::set_OR && from <= first && last <= to)
+        {
+            // chunk is inside the range: OR it directly into the target
+            bm::deserialize(bv, buf + chunk.offset, temp_block);
+            continue;
+        }
+        bm::deserialize(bv_range, buf + chunk.offset, temp_block);
+        masked |= (first < from || to < last);
+    }
+    if (masked)
+    {
+        bm::id_t last = bv_range.size() - 1;
+        if (from)
+            bv_range.set_range(0, from - 1, false);
+        if (to < last)
+            bv_range.set_range(to + 1, last, false);
+    }
+
+    switch (op)
+    {
+    case bm::set_OR:  bv.bit_or(bv_range);  break;
+    case bm::set_AND: bv.bit_and(bv_range); break;
+    case bm::set_SUB: bv.bit_sub(bv_range); break;
+    case bm::set_XOR: bv.bit_xor(bv_range); break;
+    default:
+        BM_ASSERT(0);
+    }
+    return blob_size_;
+}
+
+template<class BV>
+unsigned chunked_deserializer<BV>::find_chunks(bm::id_t from, bm::id_t to,
+                                               unsigned& k_from,
+                                               unsigned& k_to) const
+{
+    BM_ASSERT(from <= to);
+    unsigned nb_from = unsigned(from >> bm::set_block_shift);
+    unsigned nb_last = unsigned(to >> bm::set_block_shift);
+
+    // binary search for the first chunk ending after nb_from
+    unsigned lo = 0, hi = chunk_cnt_;
+    while (lo < hi)
+    {
+        unsigned mid = lo + ((hi - lo) >> 1);
+        if (get_chunk(mid).nb_to <= nb_from)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    k_from = k_to = lo;
+    for (; k_to < chunk_cnt_ && get_chunk(k_to).nb_from <= nb_last; ++k_to)
+    {}
+    return k_to - k_from;
+}
+
+template<class BV>
+unsigned chunked_deserializer<BV>::read_directory(const unsigned char* buf)
+{
+    ByteOrder bo_current = globals<true>::byte_order();
+
+    header_flag_ = buf[0];
+    BM_ASSERT(header_flag_ & BM_HM_DIRECTORY);
+    ByteOrder bo = (bm::ByteOrder) buf[1];
+    const unsigned char* dir_buf = buf + 2;
+    if (bo_current == bo)
+    {
+        bm::decoder dec(dir_buf);
+        read_chunks(dec);
+    }
+    else
+    {
+        switch (bo_current) 
+        {
+        case BigEndian:
+            {
+            bm::decoder_big_endian dec(dir_buf);
+            read_chunks(dec);
+            }
+            break;
+        case LittleEndian:
+            {
+            bm::decoder_little_endian dec(dir_buf);
+            read_chunks(dec);
+            }
+            break;
+        default:
+            BM_ASSERT(0);
+        };
+    }
+    return chunk_cnt_;
+}
+
+template<class BV> template<class DEC>
+void chunked_deserializer<BV>::read_chunks(DEC& dec)
+{
+    bv_size_ = bm::id_max;
+    if (header_flag_ & BM_HM_RESIZE)
+    {
+        bm::id64_t bv_size = dec.get_64();
+#ifndef BM64ADDR
+        BM_ASSERT(bv_size <= bm::id_max);
+        if (bv_size > bm::id_max)
+            bv_size = bm::id_max;
+#endif
+        bv_size_ = (bm::id_t)bv_size;
+    }
+    chunk_cnt_ = dec.get_32();
+    chunk_buf_.resize(chunk_cnt_ * sizeof(serial_chunk));
+    serial_chunk* chunk = (serial_chunk*) chunk_buf_.data();
+
+    // directory header size: header flag, byte order and the size above
+    size_t offset = 2 + dec.size() + chunk_cnt_ * 3 * sizeof(bm::word_t);
+    dir_size_ = offset;
+    for (unsigned k = 0; k < chunk_cnt_; ++k)
+    {
+        chunk[k].nb_from = dec.get_32();
+        chunk[k].nb_to = dec.get_32();
+        chunk[k].size = dec.get_32();
+        chunk[k].offset = offset;
+        offset += chunk[k].size;
+    }
+    blob_size_ = offset;
+}
+
+template<class BV>
+void chunked_deserializer<BV>::prepare_target(BV& bv)
+{
+    typedef typename bvector_type::blocks_manager_type blocks_manager_type;
+    blocks_manager_type& bman = bv.get_blocks_manager();
 
+    if ((header_flag_ & BM_HM_RESIZE) && bv_size_ > bv.size())
+        bv.resize(bv_size_);
+    if (!bman.is_init())
+        bman.init_tree();
+
+    // reserve top level blocks of all chunks, so decoding of chunks 
+    // never re-allocates shared tree structures
+    if (chunk_cnt_)
+    {
+        const serial_chunk& last = get_chunk(chunk_cnt_ - 1);
+        unsigned top_size = 
+            (last.nb_to + bm::set_array_size - 1) >> bm::set_array_shift;
+        bman.reserve_top_blocks(top_size);
+        bman.set_effective_top_block_size(top_size);
+    }
+    strat_ = bv.get_new_blocks_strat();
+    bv.set_new_blocks_strat(BM_GAP);
+}
+
+template<class BV>
+void chunked_deserializer<BV>::decode_chunk(BV& bv, const unsigned char* buf,
+                                            unsigned k, bm::word_t* temp_block)
+{
+    const serial_chunk& chunk = get_chunk(k);
+    unsigned size = bm::deserialize(bv, buf + chunk.offset, temp_block);
+    BM_ASSERT(size <= chunk.size);
+    (void)size;
+}
+
+template<class BV>
+void chunked_deserializer<BV>::finalize_target(BV& bv)
+{
+    bv.set_new_blocks_strat(strat_);
+    bv.forget_count();
+}
+
+//----------------------------------------------------------------------
+
+/*!
+   \brief Saves bitvector into memory buffer in the chunked format
+   (with block-offset directory).
+
+   \param bv - source bvector
+   \param buf - target buffer (resized automatically)
+   \param chunk_blocks - number of blocks in one chunk
+
+   \sa chunked_serializer
+   \ingroup bvserial
+*/
+template<class BV>
+void serialize_chunked(const BV& bv,
+                       typename serializer<BV>::buffer& buf,
+                       unsigned chunk_blocks = bm::set_array_size)
+{
+    bm::chunked_serializer<BV> bv_serial(chunk_blocks);
+    bv_serial.serialize(bv, buf);
+}
+
+/*!
+   \brief Deserialize range [from, to] of the BLOB and combine it with
+   the target vector.
+
+   Chunked BLOBs (serialize_chunked()) are decoded using the block-offset
+   directory: only chunks overlapping the range are read.
+   BLOBs of the regular format are decoded completely.
+   Bits of the BLOB outside of the range are ignored
+   (set_AND clears all target bits outside of the range).
+
+   \param bv - target bvector
+   \param buf - BLOB memory pointer
+   \param from - range start
+   \param to - range end (inclusive)
+   \param op - set_OR, set_AND, set_SUB or set_XOR
+   \param temp_block - temporary block to avoid re-allocations
+
+   \sa chunked_deserializer
+   \ingroup bvserial
+*/
+template<class BV>
+void deserialize_range(BV& bv,
+                       const unsigned char* buf,
+                       bm::id_t from, bm::id_t to,
+                       bm::set_operation op = bm::set_OR,
+                       bm::word_t* temp_block = 0)
+{
+    if (buf[0] & BM_HM_DIRECTORY)
+    {
+        bm::chunked_deserializer<BV> deserial;
+        deserial.deserialize_range(bv, buf, from, to, op, temp_block);
+        return;
+    }
+    BV bv_range(BM_GAP, bm::gap_len_table<true>::_len, 
+                bv.size(), bv.get_allocator());
+    bm::deserialize(bv_range, buf, temp_block);
+    bm::id_t last = bv_range.size() - 1;
+    if (from)
+        bv_range.set_range(0, from - 1, false);
+    if (to < last)
+        bv_range.set_range(to + 1, last, false);
+    switch (op)
+    {
+    case bm::set_OR:  bv.bit_or(bv_range);  break;
+    case bm::set_AND: bv.bit_and(bv_range); break;
+    case bm::set_SUB: bv.bit_sub(bv_range); break;
+    case bm::set_XOR: bv.bit_xor(bv_range); break;
+    default:
+        BM_ASSERT(0);
+    }
+}
 
 
 } // namespace bm
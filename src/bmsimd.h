@@ -19,6 +19,11 @@ For more information please visit:  http://bitmagic.io
 */
 
 
+#ifdef BM_SIMD_DISPATCH
+# define BMVECTOPT
+# include "bmdispatch.h"
+#else
+
 #ifdef BMAVX2OPT
 # undef BMSSE42OPT
 # undef BMSSE2OPT
@@ -26,6 +31,10 @@ For more information please visit:  http://bitmagic.io
 # include "bmavx2.h"
 #endif
 
+#ifdef BMAVX512OPT
+# include "bmavx512.h"
+#endif
+
 
 #ifdef BMSSE42OPT
 # define BMVECTOPT
@@ -38,6 +47,8 @@ For more information please visit:  http://bitmagic.io
 # include "bmsse2.h"
 #endif
 
+#endif // BM_SIMD_DISPATCH
+
 namespace bm
 {
 
@@ -47,6 +58,12 @@ namespace bm
 */
 inline int simd_version()
 {
+#ifdef BM_SIMD_DISPATCH
+    return bm::simd_dispatch<true>::level();
+#endif
+#ifdef BMAVX512OPT
+    return bm::simd_avx512;
+#endif
 #ifdef BMAVX2OPT
     return bm::simd_avx2;
 #endif
@@ -28,6 +28,7 @@ For more information please visit:  http://bitmagic.io
 #include "bmtrans.h"
 #include "bmalgo.h"
 #include "bmdef.h"
+#include "bmbmatrix.h"
 
 namespace bm
 {
@@ -38,6 +39,56 @@ namespace bm
  */
 
 
+/*!
+    \brief Value encoding traits of sparse_vector<>
+ 
+    Unsigned types are stored in the bit-plains as is.
+    Signed types are stored zig-zag encoded (0, -1, 1, -2, 2 ... map to
+    0, 1, 2, 3, 4 ...), so values of small magnitude of either sign use only
+    the low bit-plains, plain 0 is the sign (negative values) plain.
+ 
+    \ingroup svector
+*/
+template<typename T>
+struct sv_value_traits
+{
+    typedef T unsigned_type;
+    static const bool is_signed = false;
+    
+    static unsigned_type encode(T v) { return v; }
+    static T decode(unsigned_type u) { return u; }
+};
+
+/// \internal zig-zag encoding of signed type T (U - unsigned counterpart)
+template<typename T, typename U>
+struct sv_zigzag_traits
+{
+    typedef U unsigned_type;
+    static const bool is_signed = true;
+    
+    static unsigned_type encode(T v)
+    {
+        return unsigned_type(unsigned_type(unsigned_type(v) << 1) ^
+               unsigned_type(0u - (unsigned_type(v) >> (sizeof(T) * 8 - 1))));
+    }
+    static T decode(unsigned_type u)
+    {
+        return T(unsigned_type((u >> 1) ^ unsigned_type(0u - (u & 1u))));
+    }
+};
+
+template<> struct sv_value_traits<signed char>
+    : public sv_zigzag_traits<signed char, unsigned char> {};
+template<> struct sv_value_traits<short>
+    : public sv_zigzag_traits<short, unsigned short> {};
+template<> struct sv_value_traits<int>
+    : public sv_zigzag_traits<int, unsigned> {};
+template<> struct sv_value_traits<long>
+    : public sv_zigzag_traits<long, unsigned long> {};
+template<> struct sv_value_traits<long long>
+    : public sv_zigzag_traits<long long, unsigned long long> {};
+
+
 /*!
    \brief sparse vector with runtime compression using bit transposition method
  
@@ -54,23 +105,26 @@ namespace bm
    Overall it provides variable bit-depth compression, sparse compression in
    bit-plains.
  
+   Val can be any 8, 16, 32 or 64-bit integer type, signed types are
+   stored zig-zag encoded (see sv_value_traits<>).
+ 
    \ingroup svector
 */
 template<class Val, class BV>
-class sparse_vector
+class sparse_vector : public base_sparse_vector<Val, BV, 1>
 {
 public:
+    typedef base_sparse_vector<Val, BV, 1>           base_type;
     typedef Val                                      value_type;
+    typedef bm::sv_value_traits<Val>                 value_traits;
+    typedef typename value_traits::unsigned_type     unsigned_value_type;
     typedef bm::id_t                                 size_type;
     typedef BV                                       bvector_type;
     typedef bvector_type*                            bvector_type_ptr;
 	typedef const value_type&                        const_reference;
     typedef typename BV::allocator_type              allocator_type;
     typedef typename bvector_type::allocation_policy allocation_policy_type;
-    
-    /*! Statistical information about  memory allocation details. */
-    struct statistics : public bv_statistics
-    {};
+    typedef typename base_type::statistics           statistics;
 
     /**
          Reference class to access elements via common [] operator
@@ -100,13 +154,128 @@ public:
         size_type               idx_;
     };
 
-    enum bit_plains
+    /**
+        Back insert iterator implements buffered insertion of values
+        at the end of the vector. Values are accumulated in a block sized
+        buffer and on flush() get transposed into the bit-plains in one go,
+        which is much faster than push_back() of individual values.
+     
+        Buffer is flushed when it reaches the next block boundary,
+        by flush() or iterator destruction. Vector is not in a consistent
+        state until the last flush().
+    */
+    class back_insert_iterator
     {
-        sv_plains = (sizeof(value_type) * 8 + 1),
-        sv_value_plains = (sizeof(value_type) * 8)
+    public:
+#ifndef BM_NO_STL
+        typedef std::output_iterator_tag  iterator_category;
+#endif
+        typedef sparse_vector<Val, BV>    sparse_vector_type;
+        typedef sparse_vector_type*       sparse_vector_type_ptr;
+        typedef Val                       value_type;
+        typedef void difference_type;
+        typedef void pointer;
+        typedef void reference;
+        
+    public:
+        back_insert_iterator();
+        back_insert_iterator(sparse_vector_type* sv);
+        
+        /**
+            Copy flushes values buffered in the source, the copy starts 
+            with an empty buffer. Only one of the copies should be used
+            for insertion after that (values go to the vector in the 
+            order of buffer flushes).
+        */
+        back_insert_iterator(const back_insert_iterator& bi);
+        ~back_insert_iterator();
+        
+        /** flushes both iterators, see copy-ctor */
+        back_insert_iterator& operator=(const back_insert_iterator& bi)
+        {
+            if (this != &bi)
+            {
+                flush();
+                const_cast<back_insert_iterator&>(bi).flush();
+                sv_ = bi.sv_;
+            }
+            return *this;
+        }
+        
+#ifndef BM_NO_CXX11
+        /** move-ctor: takes over the buffered values */
+        back_insert_iterator(back_insert_iterator&& bi) BMNOEXEPT;
+        
+        /** move assignment: flushes this, takes over buffered values */
+        back_insert_iterator& operator=(back_insert_iterator&& bi)
+        {
+            if (this != &bi)
+            {
+                flush();
+                swap(bi);
+            }
+            return *this;
+        }
+#endif
+        
+        /** push value to the vector */
+        back_insert_iterator& operator=(value_type v)
+        {
+            this->add(v);
+            return *this;
+        }
+        /** noop */
+        back_insert_iterator& operator*() { return *this; }
+        /** noop */
+        back_insert_iterator& operator++() { return *this; }
+        /** noop */
+        back_insert_iterator& operator++(int) { return *this; }
+        
+        /** add value to the buffer (and flush at the block boundary) */
+        void add(value_type v);
+        
+        /** add NULL (no value) to the container */
+        void add_null();
+        
+        /** return true if insertion buffer is empty */
+        bool empty() const { return !buf_size_; }
+        
+        /** flush the accumulated buffer into the vector */
+        void flush();
+        
+    protected:
+        void swap(back_insert_iterator& bi) BMNOEXEPT;
+        
+    protected:
+        sparse_vector_type*  sv_;       ///< target vector
+        value_type*          buf_;      ///< values buffer (one block)
+        unsigned             buf_cap_;  ///< buffer capacity (to block end)
+        unsigned             buf_size_; ///< number of buffered values
+        bm::word_t*          tb_;       ///< transposition matrix (plains)
+        allocator_type       alloc_;    ///< buffers allocator
     };
+    
+    friend class back_insert_iterator;
 
 public:
+    // size, NULL support, bit-plains access and memory management
+    // are inherited from base_sparse_vector<>
+    using base_type::size;
+    using base_type::empty;
+    using base_type::resize;
+    using base_type::clear;
+    using base_type::is_nullable;
+    using base_type::get_null_bvector;
+    using base_type::is_null;
+    using base_type::get_plain;
+    using base_type::plains;
+    using base_type::stored_plains;
+    using base_type::plain;
+    using base_type::free_plain;
+    using base_type::optimize;
+    using base_type::optimize_gap_size;
+    using base_type::calc_stat;
+
     /*!
         \brief Sparse vector constructor
      
@@ -135,19 +304,7 @@ public:
     sparse_vector<Val,BV>& operator = (const sparse_vector<Val, BV>& sv)
     {
         if (this != &sv)
-        {
-            clear();
-            resize(sv.size());
-            bv_size_ = sv.bv_size_;
-            alloc_ = sv.alloc_;
-            effective_plains_ = sv.effective_plains_;
-
-            for (size_type i = 0; i < sv.stored_plains(); ++i)
-            {
-                const bvector_type* bv = sv.plains_[i];
-                plains_[i] = bv ? construct_bvector(bv) : 0;
-            } // for i
-        }
+            this->copy_from(sv);
         return *this;
     }
 
@@ -168,8 +325,6 @@ public:
     }
 #endif
 
-    ~sparse_vector() BMNOEXEPT;
-    
     /**
         \brief Operator to get write access to an element
     */
@@ -191,24 +346,6 @@ public:
     value_type operator[](size_type idx) const { return this->get(idx); }
     
     
-    /**
-        \brief check if container supports NULL(unassigned) values
-    */
-    bool is_nullable() const;
-    
-    /**
-        \brief Get bit-vector of assigned values or NULL
-        (if not constructed that way)
-    */
-    const bvector_type* get_null_bvector() const;
-    
-    /** \brief test if specified element is NULL
-        \param idx - element index
-        \return true if it is NULL false if it was assigned or container
-        is not configured to support assignment flags
-    */
-    bool is_null(size_type idx) const;
-    
     /** \brief set specified element to unassigned value (NULL)
         \param idx - element index
     */
@@ -247,29 +384,44 @@ public:
                      size_type   idx_from,
                      size_type   size,
                      bool        zero_mem = true) const;
-
-
-    
-    /*! \brief return size of the vector
-        \return size of sparse vector
-    */
-    size_type size() const;
-    
-    
-    /*! \brief return true if vector is empty
-        \return true if empty
-    */
-    bool empty() const;
-    
     
-    /*! \brief resize vector
-        \param sz - new size
+    /*!
+        \brief Gather elements to a C-style array (batch get())
+     
+        Indexes are processed block by block: block pointers of the bit
+        plains are resolved once per block, bits of up to 32 elements are
+        collected into one word per plain and values are assembled
+        by bit matrix transposition.
+     
+        \param arr  - dest array (size of the index array)
+        \param idx  - array of indexes, sorted in ascending order,
+                      all indexes must be less than size()
+        \param size - number of indexes
+     
+        \return number of gathered elements
+     
+        \sa get, decode
     */
-    void resize(size_type sz);
+    size_type gather(value_type*      arr,
+                     const size_type* idx,
+                     size_type        size) const;
     
-    /*! \brief resize to zero, free memory
+    /*!
+        \brief Gather elements for a set of indexes given as a bit-vector
+     
+        \param arr    - dest array
+        \param bv_idx - bit-vector of indexes (all less than size())
+        \param size   - dest array size, max number of elements to gather
+     
+        \return number of gathered elements
+     
+        \sa gather
     */
-    void clear() BMNOEXEPT;
+    size_type gather(value_type*         arr,
+                     const bvector_type& bv_idx,
+                     size_type           size) const;
+
+
     
     /*!
         \brief access specified element with bounds checking
@@ -302,9 +454,17 @@ public:
     /*!
         \brief push value back into vector
         \param v   - element value
+        \sa get_back_inserter
     */
     void push_back(value_type v);
     
+    /*!
+        \brief Provide back insert iterator (buffered bulk append)
+        \sa back_insert_iterator
+    */
+    back_insert_iterator get_back_inserter()
+        { return back_insert_iterator(this); }
+    
     /*!
         \brief check if another sparse vector has the same content and size
      
@@ -318,23 +478,6 @@ public:
                bm::null_support null_able = bm::use_null) const;
 
 
-    /*!
-        \brief run memory optimization for all vector plains
-        \param temp_block - pre-allocated memory block to avoid unnecessary re-allocs
-        \param opt_mode - requested compression depth
-        \param stat - memory allocation statistics after optimization
-    */
-    void optimize(bm::word_t* temp_block = 0,
-                  typename bvector_type::optmode opt_mode = bvector_type::opt_compress,
-                  typename sparse_vector<Val, BV>::statistics* stat = 0);
-    /*!
-       \brief Optimize sizes of GAP blocks
-
-       This method runs an analysis to find optimal GAP levels for all bit plains
-       of the vector.
-    */
-    void optimize_gap_size();
-    
     /*!
         \brief join all with another sparse vector using OR operation
         \param sv - argument vector to join with
@@ -343,44 +486,6 @@ public:
     sparse_vector<Val, BV>& join(const sparse_vector<Val, BV>& sv);
 
 
-    /*!
-       @brief Calculates memory statistics.
-
-       @param st - pointer on statistics structure to be filled in. 
-
-       Function fills statistics structure containing information about how 
-       this vector uses memory and estimation of max. amount of memory 
-       bvector needs to serialize itself.
-
-       @sa statistics
-    */
-    void calc_stat(struct sparse_vector<Val, BV>::statistics* st) const;
-    
-
-    /*!
-        \brief get access to bit-plain, function checks and creates a plain
-    */
-    bvector_type_ptr get_plain(unsigned i);
-    
-    /*!
-        \brief get total number of bit-plains in the vector
-    */
-    static unsigned plains() { return value_bits(); }
-
-    /** Number of stored bit-plains (value plains + extra */
-    static unsigned stored_plains() { return value_bits()+1; }
-
-    /*!
-        \brief get access to bit-plain as is (can return NULL)
-    */
-    bvector_type_ptr plain(unsigned i) { return plains_[i]; }
-    const bvector_type_ptr plain(unsigned i) const { return plains_[i]; }
-    
-    /*!
-        \brief free memory in bit-plain
-    */
-    void free_plain(unsigned i);
-    
     /*!
         \brief clear range (assign bit 0 for all plains)
         \param left  - interval start
@@ -443,39 +548,45 @@ public:
 
 private:
 
-    /*! \brief free all internal vectors
+    /*! \brief collect bits of a plain block into a word
+        (bit k of the result is the block bit nbits[k])
     */
-    void free_vectors() BMNOEXEPT;
-    
-    /** Number of effective bit-plains in the value type*/
-    unsigned effective_plains() const { return effective_plains_ + 1; }
+    static
+    unsigned gather_bits(const bm::word_t* blk,
+                         const unsigned*   nbits,
+                         unsigned          n);
 
-    /** Number of total bit-plains in the value type*/
-    static unsigned value_bits() { return sv_value_plains; }
+    /*! \brief decode array of plain assembled (zig-zag) values in place
+        (no-op for unsigned types)
+    */
+    static
+    void decode_values(value_type* arr, size_type size);
     
-    /** plain index for the "NOT NULL" flags plain */
-    static unsigned null_plain() { return value_bits(); }
-
 protected:
     /*! \brief set value without checking boundaries
     */
     void set_value(size_type idx, value_type v);
-    const bm::word_t* get_block(unsigned p, unsigned i, unsigned j) const;
-    void throw_range_error(const char* err_msg) const;
-
-    bvector_type* construct_bvector(const bvector_type* bv) const;
-    void destruct_bvector(bvector_type* bv) const;
-    bvector_type* get_null_bvect() { return plains_[this->null_plain()]; }
-
-private:
-    
-    size_type                bv_size_;
-    allocator_type           alloc_;
-    allocation_policy_type   ap_;
     
-    bvector_type_ptr         plains_[sv_plains];
-    size_type                size_;
-    unsigned                 effective_plains_;
+    /*! \brief append array of values at the end of the vector
+        (one block at most), a whole empty block of 32 or 64-bit values is
+        transposed into the plains directly
+        (tb - matrix buffer of sizeof(Val)*8 blocks)
+    */
+    void import_back(const value_type* arr, unsigned arr_size,
+                     bm::word_t* tb);
+
+    using base_type::effective_plains;
+    using base_type::value_bits;
+    using base_type::null_plain;
+    using base_type::get_block;
+    using base_type::throw_range_error;
+    using base_type::construct_bvector;
+    using base_type::destruct_bvector;
+    using base_type::get_null_bvect;
+
+    using base_type::bv_size_;
+    using base_type::plains_;
+    using base_type::size_;
 };
 
 //---------------------------------------------------------------------
@@ -487,40 +598,15 @@ sparse_vector<Val, BV>::sparse_vector(
         allocation_policy_type  ap,
         size_type               bv_max_size,
         const allocator_type&   alloc)
-: bv_size_(bv_max_size),
-  alloc_(alloc),
-  ap_(ap),
-  size_(0),
-  effective_plains_(0)
-{
-    ::memset(plains_, 0, sizeof(plains_));
-    if (null_able == bm::use_null)
-    {
-        unsigned i = null_plain();
-        plains_[i] = construct_bvector(0);
-        plains_[i]->init();
-    }
-}
+: base_type(null_able, ap, bv_max_size, alloc)
+{}
 
 //---------------------------------------------------------------------
 
 template<class Val, class BV>
 sparse_vector<Val, BV>::sparse_vector(const sparse_vector<Val, BV>& sv)
-: bv_size_ (sv.bv_size_),
-  alloc_(sv.alloc_),
-  ap_(sv.ap_),
-  size_(sv.size_),
-  effective_plains_(sv.effective_plains_)
-{
-    if (this != &sv)
-    {
-        for (size_type i = 0; i < stored_plains(); ++i)
-        {
-            const bvector_type* bv = sv.plains_[i];
-            plains_[i] = bv ? construct_bvector(bv) : 0;
-        }
-    }
-}
+: base_type(sv)
+{}
 
 //---------------------------------------------------------------------
 #ifndef BM_NO_CXX11
@@ -528,125 +614,17 @@ sparse_vector<Val, BV>::sparse_vector(const sparse_vector<Val, BV>& sv)
 template<class Val, class BV>
 sparse_vector<Val, BV>::sparse_vector(sparse_vector<Val, BV>&& sv) BMNOEXEPT
 {
-    bv_size_ = 0;
-    alloc_ = sv.alloc_;
-    ap_ = sv.ap_;
-    size_ = sv.size_;
-    effective_plains_ = sv.effective_plains_;
-        
-    for (size_type i = 0; i < stored_plains(); ++i)
-    {
-        plains_[i] = sv.plains_[i];
-        sv.plains_[i] = 0;
-    }
-    sv.size_ = 0;
+    this->move_from(sv);
 }
 
 #endif
 
-
-//---------------------------------------------------------------------
-
-template<class Val, class BV>
-sparse_vector<Val, BV>::~sparse_vector() BMNOEXEPT
-{
-    free_vectors();
-}
-
 //---------------------------------------------------------------------
 
 template<class Val, class BV>
 void sparse_vector<Val, BV>::swap(sparse_vector<Val, BV>& sv) BMNOEXEPT
 {
-    if (this != &sv)
-    {
-        bm::xor_swap(bv_size_, sv.bv_size_);
-        
-        allocator_type alloc_tmp = alloc_;
-        alloc_ = sv.alloc_;
-        sv.alloc_ = alloc_tmp;
-        
-        allocation_policy_type ap_tmp = ap_;
-        ap_ = sv.ap_;
-        sv.ap_ = ap_tmp;
-        
-        for (size_type i = 0; i < stored_plains(); ++i)
-        {
-            bvector_type* bv_tmp = plains_[i];
-            plains_[i] = sv.plains_[i];
-            sv.plains_[i] = bv_tmp;
-        } // for i
-        
-        bm::xor_swap(size_, sv.size_);        
-    }
-}
-
-//---------------------------------------------------------------------
-
-template<class Val, class BV>
-void sparse_vector<Val, BV>::throw_range_error(const char* err_msg) const
-{
-#ifndef BM_NO_STL
-    throw std::range_error(err_msg);
-#else
-    BM_ASSERT_THROW(false, BM_ERR_RANGE);
-#endif
-}
-
-
-//---------------------------------------------------------------------
-
-template<class Val, class BV>
-typename sparse_vector<Val, BV>::bvector_type*
-sparse_vector<Val, BV>::construct_bvector(const bvector_type* bv) const
-{
-    bvector_type* rbv = 0;
-#ifdef BM_NO_STL   // C compatibility mode
-    void* mem = ::malloc(sizeof(bvector_type));
-    if (mem == 0)
-    {
-        BM_ASSERT_THROW(false, BM_ERR_BADALLOC);
-    }
-    rbv = bv ? new(mem) bvector_type(*bv)
-             : new(mem) bvector_type(ap_.strat, ap_.glevel_len,
-                                     bv_size_,
-                                     alloc_);
-#else
-    rbv = bv ? new bvector_type(*bv)
-             : new bvector_type(ap_.strat, ap_.glevel_len,
-                                bv_size_,
-                                alloc_);
-#endif
-    return rbv;
-}
-
-//---------------------------------------------------------------------
-
-template<class Val, class BV>
-bool sparse_vector<Val, BV>::is_nullable() const
-{
-    return (plains_[this->null_plain()] != 0);
-}
-
-//---------------------------------------------------------------------
-
-template<class Val, class BV>
-const typename sparse_vector<Val, BV>::bvector_type*
-sparse_vector<Val, BV>::get_null_bvector() const
-{
-    return plains_[this->null_plain()];
-}
-
-//---------------------------------------------------------------------
-
-template<class Val, class BV>
-bool sparse_vector<Val, BV>::is_null(size_type idx) const
-{
-    if (idx >= size_)
-        throw_range_error("sparse vector range error");
-
-    const bvector_type* bv_null = get_null_bvector();
-    return (bv_null) ? (!bv_null->test(idx)) : false;
+    base_type::swap(sv);
 }
 
 //---------------------------------------------------------------------
@@ -687,7 +665,7 @@ void sparse_vector<Val, BV>::import(const value_type* arr,
     size_type i;
     for (i = 0; i < size; ++i)
     {
-        unsigned bcnt = bm::bitscan(arr[i], b_list);
+        unsigned bcnt = bm::bitscan(value_traits::encode(arr[i]), b_list);
         const unsigned bit_idx = i + offset;
         
         for (unsigned j = 0; j < bcnt; ++j)
@@ -783,8 +761,10 @@ sparse_vector<Val, BV>::extract_range(value_type* arr,
     unsigned mask0 = 1u << (nbit & bm::set_word_mask);
     const bm::word_t* blk = 0;
     unsigned is_set;
+    unsigned_value_type* uarr = (unsigned_value_type*) arr;
     
-    for (unsigned j = 0; j < sizeof(Val)*8; ++j)
+    unsigned eff_plains = effective_plains();
+    for (unsigned j = 0; j < eff_plains; ++j)
     {
         blk = get_block(j, i0, j0);
         bool is_gap = BM_IS_GAP(blk);
@@ -815,13 +795,15 @@ sparse_vector<Val, BV>::extract_range(value_type* arr,
                 is_set = (blk[nword] & mask0);
             }
             size_type idx = k - offset;
-            value_type vm = (bool) is_set;
+            unsigned_value_type vm = (bool) is_set;
             vm <<= j;
-            arr[idx] |= vm;
+            uarr[idx] |= vm;
             
         } // for k
 
     } // for j
+    if (end > start)
+        decode_values(arr, end - start);
     return 0;
 }
 
@@ -847,13 +829,14 @@ sparse_vector<Val, BV>::extract_plains(value_type* arr,
         end = size_;
     }
     
+    unsigned_value_type* uarr = (unsigned_value_type*) arr;
     for (size_type i = 0; i < value_bits(); ++i)
     {
         const bvector_type* bv = plains_[i];
         if (!bv)
             continue;
        
-        value_type mask = 1;
+        unsigned_value_type mask = 1;
         mask <<= i;
         typename BV::enumerator en(bv, offset);
         for (;en.valid(); ++en)
@@ -861,10 +844,12 @@ sparse_vector<Val, BV>::extract_plains(value_type* arr,
             size_type idx = *en - offset;
             if (idx >= size)
                 break;
-            arr[idx] |= mask;
+            uarr[idx] |= mask;
         } // for
         
     } // for i
+    if (end > start)
+        decode_values(arr, end - start);
 
     return 0;
 }
@@ -884,9 +869,9 @@ sparse_vector<Val, BV>::extract(value_type* arr,
     ///
     struct sv_decode_visitor_func
     {
-        sv_decode_visitor_func(value_type* varr,
-                               value_type  mask,
-                               size_type   off)
+        sv_decode_visitor_func(unsigned_value_type* varr,
+                               unsigned_value_type  mask,
+                               size_type            off)
         : arr_(varr), mask_(mask), off_(off)
         {}
         
@@ -908,9 +893,9 @@ sparse_vector<Val, BV>::extract(value_type* arr,
                 arr_[i + idx_base] |= mask_;
             }
         }
-        value_type*  arr_;
-        value_type   mask_;
-        size_type    off_;
+        unsigned_value_type*  arr_;
+        unsigned_value_type   mask_;
+        size_type             off_;
     };
 
 
@@ -928,6 +913,7 @@ sparse_vector<Val, BV>::extract(value_type* arr,
     }
     
 	bool masked_scan = !(offset == 0 && size == this->size());
+    unsigned_value_type* uarr = (unsigned_value_type*) arr;
 
     if (masked_scan) // use temp vector to decompress the area
     {
@@ -942,7 +928,8 @@ sparse_vector<Val, BV>::extract(value_type* arr,
                 bv_mask.set_range(offset, end - 1);
                 bv_mask.bit_and(*bv);
 
-                sv_decode_visitor_func func(arr, (value_type(1) << i), offset);
+                sv_decode_visitor_func func(uarr,
+                                (unsigned_value_type(1) << i), offset);
                 bm::for_each_bit(bv_mask, func);
                 bv_mask.clear();
             }
@@ -955,11 +942,14 @@ sparse_vector<Val, BV>::extract(value_type* arr,
             const bvector_type* bv = plains_[i];
             if (bv)
             {
-                sv_decode_visitor_func func(arr, (value_type(1) << i), 0);
+                sv_decode_visitor_func func(uarr,
+                                (unsigned_value_type(1) << i), 0);
                 bm::for_each_bit(*bv, func);
             }
         } // for i
     }
+    if (end > start)
+        decode_values(arr, end - start);
 
     return 0;
 }
@@ -967,60 +957,148 @@ sparse_vector<Val, BV>::extract(value_type* arr,
 //---------------------------------------------------------------------
 
 template<class Val, class BV>
-typename sparse_vector<Val, BV>::size_type
-sparse_vector<Val, BV>::size() const
+void sparse_vector<Val, BV>::decode_values(value_type* arr, size_type size)
 {
-    return size_;
+    if (!value_traits::is_signed)
+        return;
+    const unsigned_value_type* uarr = (const unsigned_value_type*) arr;
+    for (size_type i = 0; i < size; ++i)
+        arr[i] = value_traits::decode(uarr[i]);
 }
 
 //---------------------------------------------------------------------
 
 template<class Val, class BV>
-bool sparse_vector<Val, BV>::empty() const
+unsigned sparse_vector<Val, BV>::gather_bits(const bm::word_t* blk,
+                                             const unsigned*   nbits,
+                                             unsigned          n)
 {
-    return (size_ == 0);
+    BM_ASSERT(n && n <= 32);
+    if (!blk)
+        return 0;
+    if (IS_FULL_BLOCK(blk))
+        return (n == 32) ? ~0u : ((1u << n) - 1);
+    unsigned w = 0;
+    if (BM_IS_GAP(blk))
+    {
+        const bm::gap_word_t* gap_blk = BMGAP_PTR(blk);
+        for (unsigned k = 0; k < n; ++k)
+            w |= unsigned(bm::gap_test_unr(gap_blk, nbits[k]) != 0) << k;
+    }
+    else
+    {
+        for (unsigned k = 0; k < n; ++k)
+        {
+            unsigned nbit = nbits[k];
+            w |= ((blk[nbit >> bm::set_word_shift] >>
+                  (nbit & bm::set_word_mask)) & 1u) << k;
+        }
+    }
+    return w;
 }
 
-
 //---------------------------------------------------------------------
 
 template<class Val, class BV>
-void sparse_vector<Val, BV>::resize(typename sparse_vector<Val, BV>::size_type sz)
+typename sparse_vector<Val, BV>::size_type
+sparse_vector<Val, BV>::gather(value_type*      arr,
+                               const size_type* idx,
+                               size_type        size) const
 {
-    if (sz == size_)  // nothing to do
-        return;
+    BM_ASSERT(arr && (idx || !size));
     
-    if (!sz) // resize to zero is an equivalent of non-destructive deallocation
-    {
-        clear();
-        return;
-    }
+    const bm::word_t* blka[sizeof(Val)*8];
+    unsigned nbits[32];  // bit positions in the block
+    unsigned tm[32];     // bit-plain words (32x32 transposition matrix)
+    unsigned eff_plains = effective_plains();
+    unsigned_value_type* uarr = (unsigned_value_type*) arr;
     
-    if (sz < size_) // vector shrink
+    size_type i = 0;
+    while (i < size)
     {
-        this->clear_range(sz, size_-1, true);   // clear the tails and NULL vect
-    }
-    
-    size_ = sz;
+        BM_ASSERT(idx[i] < size_);
+        unsigned nb = unsigned(idx[i] >> bm::set_block_shift);
+        unsigned i0 = nb >> bm::set_array_shift; // top block address
+        unsigned j0 = nb &  bm::set_array_mask;  // address in sub-block
+        for (unsigned p = 0; p < eff_plains; ++p)
+            blka[p] = get_block(p, i0, j0);
+        
+        // sorted indexes: the block is a continuous run
+        size_type run_end = i + 1;
+        while (run_end < size &&
+               unsigned(idx[run_end] >> bm::set_block_shift) == nb)
+        {
+            BM_ASSERT(idx[run_end-1] <= idx[run_end]);
+            ++run_end;
+        }
+        
+        while (i < run_end)
+        {
+            unsigned n = unsigned(run_end - i);
+            if (n > 32)
+                n = 32;
+            unsigned k;
+            for (k = 0; k < n; ++k)
+                nbits[k] = unsigned(idx[i + k] & bm::set_block_mask);
+            
+            for (unsigned base = 0; base < eff_plains; base += 32)
+            {
+                unsigned rows = eff_plains - base;
+                if (rows > 32)
+                    rows = 32;
+                unsigned any = 0;
+                for (k = 0; k < rows; ++k)
+                    any |= (tm[k] = gather_bits(blka[base + k], nbits, n));
+                if (!any)
+                {
+                    if (!base)
+                        ::memset(arr + i, 0, n * sizeof(value_type));
+                    continue;
+                }
+                for (; k < 32; ++k)
+                    tm[k] = 0;
+                bm::bit_matrix_transpose32(tm);
+                if (!base)
+                {
+                    for (k = 0; k < n; ++k)
+                        uarr[i + k] = unsigned_value_type(tm[k]);
+                }
+                else
+                {
+                    for (k = 0; k < n; ++k)
+                        uarr[i + k] |=
+                            unsigned_value_type(unsigned_value_type(tm[k]) << base);
+                }
+            } // for base
+            decode_values(arr + i, n);
+            i += n;
+        } // while
+    } // while
+    return size;
 }
 
 //---------------------------------------------------------------------
 
-
 template<class Val, class BV>
-typename sparse_vector<Val, BV>::bvector_type_ptr
-   sparse_vector<Val, BV>::get_plain(unsigned i)
+typename sparse_vector<Val, BV>::size_type
+sparse_vector<Val, BV>::gather(value_type*         arr,
+                               const bvector_type& bv_idx,
+                               size_type           size) const
 {
-    bvector_type_ptr bv = plains_[i];
-    if (!bv)
+    const unsigned buf_size = 1024;
+    size_type idx_buf[buf_size];
+    
+    size_type cnt = 0;
+    typename bvector_type::enumerator en = bv_idx.first();
+    while (cnt < size && en.valid())
     {
-        bv = construct_bvector(0);
-        bv->init();
-        plains_[i] = bv;
-        if (i > effective_plains_ && i < value_bits())
-            effective_plains_ = i;
+        unsigned n = 0;
+        for (; n < buf_size && cnt + n < size && en.valid(); ++en, ++n)
+            idx_buf[n] = *en;
+        gather(arr + cnt, idx_buf, n);
+        cnt += n;
     }
-    return bv;
+    return cnt;
 }
 
 //---------------------------------------------------------------------
@@ -1036,27 +1114,13 @@ sparse_vector<Val, BV>::at(typename sparse_vector<Val, BV>::size_type idx) const
 
 //---------------------------------------------------------------------
 
-template<class Val, class BV>
-const bm::word_t* sparse_vector<Val, BV>::get_block(unsigned p, unsigned i, unsigned j) const
-{
-    const bvector_type* bv = this->plains_[p];
-    if (bv)
-    {
-        const typename bvector_type::blocks_manager_type& bman = bv->get_blocks_manager();
-        return bman.get_block(i, j);
-    }
-    return 0;
-}
-
-//---------------------------------------------------------------------
-
 template<class Val, class BV>
 typename sparse_vector<Val, BV>::value_type
 sparse_vector<Val, BV>::get(bm::id_t i) const
 {
     BM_ASSERT(i < size_);
     
-    value_type v = 0;
+    unsigned_value_type v = 0;
     
     // calculate logical block coordinates and masks
     //
@@ -1101,35 +1165,35 @@ sparse_vector<Val, BV>::get(bm::id_t i) const
         if ((blk = blka[0+0])!=0)
         {
             unsigned is_set = (BM_IS_GAP(blk)) ? bm::gap_test_unr(BMGAP_PTR(blk), nbit) : (blk[nword] & mask0);
-            value_type vm = (bool) is_set;
+            unsigned_value_type vm = (bool) is_set;
             vm <<= (j+0);
             v |= vm;
         }
         if ((blk = blka[0+1])!=0)
         {
             unsigned is_set = (BM_IS_GAP(blk)) ? bm::gap_test_unr(BMGAP_PTR(blk), nbit) : (blk[nword] & mask0);
-            value_type vm = (bool) is_set;
+            unsigned_value_type vm = (bool) is_set;
             vm <<= (j+1);
             v |= vm;
         }
         if ((blk = blka[0+2])!=0)
         {
             unsigned is_set = (BM_IS_GAP(blk)) ? bm::gap_test_unr(BMGAP_PTR(blk), nbit) : (blk[nword] & mask0);
-            value_type vm = (bool) is_set;
+            unsigned_value_type vm = (bool) is_set;
             vm <<= (j+2);
             v |= vm;
         }
         if ((blk = blka[0+3])!=0)
         {
             unsigned is_set = (BM_IS_GAP(blk)) ? bm::gap_test_unr(BMGAP_PTR(blk), nbit) : (blk[nword] & mask0);
-            value_type vm = (bool) is_set;
+            unsigned_value_type vm = (bool) is_set;
             vm <<= (j+3);
             v |= vm;
         }
 
     } // for j
     
-    return v;
+    return value_traits::decode(v);
 }
 
 
@@ -1165,237 +1229,275 @@ void sparse_vector<Val, BV>::clear(size_type idx, bool set_null)
 //---------------------------------------------------------------------
 
 template<class Val, class BV>
-void sparse_vector<Val, BV>::push_back(value_type v)
-{
-    set_value(size_, v);
-    ++size_;
-}
-
-//---------------------------------------------------------------------
-
-template<class Val, class BV>
-void sparse_vector<Val, BV>::set_value(size_type idx, value_type v)
+void sparse_vector<Val, BV>::import_back(const value_type* arr,
+                                         unsigned          arr_size,
+                                         bm::word_t*       tb)
 {
-    // calculate logical block coordinates and masks
-    //
-    unsigned nb = unsigned(idx >>  bm::set_block_shift);
+    BM_ASSERT(arr_size && arr_size <= bm::gap_max_bits);
+    size_type offset = size_;
+    unsigned nb = unsigned(offset >> bm::set_block_shift);
     unsigned i0 = nb >> bm::set_array_shift; // top block address
     unsigned j0 = nb &  bm::set_array_mask;  // address in sub-block
-
-    // clear the plains where needed
-    unsigned eff_plains = effective_plains();
-    for (unsigned i = 0; i < eff_plains; ++i)
+    
+    bool whole_block = tb &&
+                       (sizeof(Val) == sizeof(unsigned) ||
+                        sizeof(Val) == sizeof(bm::id64_t)) &&
+                       (arr_size == bm::gap_max_bits) &&
+                       !(offset & bm::set_block_mask);
+    for (unsigned p = 0; whole_block && p < value_bits(); ++p)
+        whole_block = !get_block(p, i0, j0);
+    if (!whole_block)
     {
-        const bm::word_t* blk = get_block(i, i0, j0);
-        if (blk)
+        import(arr, arr_size, offset);
+        return;
+    }
+    
+    if (sizeof(Val) == sizeof(unsigned) && !value_traits::is_signed)
+    {
+        bm::vect_bit_transpose<unsigned, bm::set_block_plain_cnt, bm::set_block_size>
+            ((const unsigned*)arr, arr_size, (unsigned(*)[bm::set_block_size])tb);
+    }
+    else
+    {
+        // 32x32 transpositions of (encoded) values, 64-bit values are
+        // transposed as low and high halves (high plains are often all 0)
+        const unsigned halves = unsigned(sizeof(Val) / sizeof(unsigned));
+        unsigned m[2][32];
+        for (unsigned i = 0, col = 0; i < arr_size; i += 32, ++col)
         {
-            BM_ASSERT(plains_[i]);
-            bvector_type* bv = plains_[i];
-            bv->clear_bit(idx);
-        }
+            unsigned any_hi = 0;
+            for (unsigned k = 0; k < 32; ++k)
+            {
+                unsigned_value_type uv = value_traits::encode(arr[i + k]);
+                m[0][k] = unsigned(uv);
+                if (halves > 1)
+                    any_hi |= m[1][k] = unsigned((uv >> 16) >> 16);
+            }
+            bm::bit_matrix_transpose32(m[0]);
+            if (any_hi)
+                bm::bit_matrix_transpose32(m[1]);
+            for (unsigned h = 0; h < halves; ++h)
+            {
+                bm::word_t* row = tb + (h * 32) * bm::set_block_size + col;
+                for (unsigned j = 0; j < 32; ++j, row += bm::set_block_size)
+                    *row = m[h][j];
+            }
+        } // for i
     }
-
-    // set bits in plains
-    unsigned b_list[sizeof(Val) * 8];
-    unsigned bcnt = bm::bitscan(v, b_list);
-
-    for (unsigned j = 0; j < bcnt; ++j)
+    
+    for (unsigned p = 0; p < value_bits(); ++p)
     {
-        unsigned p = b_list[j];
+        const bm::word_t* row = tb + p * bm::set_block_size;
+        if (bm::bit_is_all_zero((bm::wordop_t*)row,
+                                (bm::wordop_t*)(row + bm::set_block_size)))
+            continue;
         bvector_type* bv = get_plain(p);
-        bv->set_bit_no_check(idx);
-    } // for j
+        typename bvector_type::blocks_manager_type& bman =
+                                                    bv->get_blocks_manager();
+        if (bm::is_bits_one((bm::wordop_t*)row,
+                            (bm::wordop_t*)(row + bm::set_block_size)))
+        {
+            bman.set_block_all_set(nb);
+        }
+        else
+        {
+            bm::word_t* blk = bman.get_allocator().alloc_bit_block();
+            bm::bit_block_copy(blk, row);
+            bm::word_t* old_blk = bman.set_block(nb, blk);
+            BM_ASSERT(!old_blk); (void) old_blk;
+        }
+        bv->forget_count();
+    } // for p
     
     bvector_type* bv_null = get_null_bvect();
     if (bv_null)
-        bv_null->set_bit_no_check(idx);
-
+        bv_null->set_range(offset, offset + arr_size - 1);
+    size_ = offset + arr_size;
 }
 
+//---------------------------------------------------------------------
+//
+//---------------------------------------------------------------------
+
+template<class Val, class BV>
+sparse_vector<Val, BV>::back_insert_iterator::back_insert_iterator()
+: sv_(0), buf_(0), buf_cap_(0), buf_size_(0), tb_(0)
+{}
+
 //---------------------------------------------------------------------
 
 template<class Val, class BV>
-void sparse_vector<Val, BV>::clear() BMNOEXEPT
+sparse_vector<Val, BV>::back_insert_iterator::back_insert_iterator(
+                                                    sparse_vector_type* sv)
+: sv_(sv), buf_(0), buf_cap_(0), buf_size_(0), tb_(0)
+{}
+
+//---------------------------------------------------------------------
+
+template<class Val, class BV>
+sparse_vector<Val, BV>::back_insert_iterator::back_insert_iterator(
+                                        const back_insert_iterator& bi)
+: sv_(bi.sv_), buf_(0), buf_cap_(0), buf_size_(0), tb_(0)
 {
-    for (size_type i = 0; i < value_bits(); ++i)
-    {
-        bvector_type* bv = plains_[i];
-        if (bv)
-        {
-            destruct_bvector(bv);
-            plains_[i] = 0;
-        }
-    }
-    size_ = 0;
-    bvector_type* bv_null = get_null_bvect();
-    if (bv_null)
-    {
-        bv_null->clear(true);
-        bv_null->init();
-    }
+    // values of the source go first, the copy continues after them
+    const_cast<back_insert_iterator&>(bi).flush();
 }
 
 //---------------------------------------------------------------------
 
+#ifndef BM_NO_CXX11
+
 template<class Val, class BV>
-void sparse_vector<Val, BV>::destruct_bvector(bvector_type* bv) const
+sparse_vector<Val, BV>::back_insert_iterator::back_insert_iterator(
+                                        back_insert_iterator&& bi) BMNOEXEPT
+: sv_(bi.sv_), buf_(0), buf_cap_(0), buf_size_(0), tb_(0)
 {
-#ifdef BM_NO_STL   // C compatibility mode
-    bv->~TBM_bvector();
-    ::free((void*)bv);
-#else
-    delete bv;
-#endif
+    swap(bi);
 }
 
+#endif
+
 //---------------------------------------------------------------------
 
 template<class Val, class BV>
-void sparse_vector<Val, BV>::free_vectors() BMNOEXEPT
+void sparse_vector<Val, BV>::back_insert_iterator::swap(
+                                        back_insert_iterator& bi) BMNOEXEPT
 {
-    for (size_type i = 0; i < stored_plains(); ++i)
-    {
-        bvector_type* bv = plains_[i];
-        destruct_bvector(bv);
-    }
+    BM_ASSERT(this != &bi);
+    sparse_vector_type* sv_tmp = sv_;
+    sv_ = bi.sv_;
+    bi.sv_ = sv_tmp;
+    
+    value_type* buf_tmp = buf_;
+    buf_ = bi.buf_;
+    bi.buf_ = buf_tmp;
+    
+    bm::word_t* tb_tmp = tb_;
+    tb_ = bi.tb_;
+    bi.tb_ = tb_tmp;
+    
+    allocator_type alloc_tmp = alloc_;
+    alloc_ = bi.alloc_;
+    bi.alloc_ = alloc_tmp;
+    
+    bm::xor_swap(buf_cap_, bi.buf_cap_);
+    bm::xor_swap(buf_size_, bi.buf_size_);
 }
 
 //---------------------------------------------------------------------
 
-
 template<class Val, class BV>
-void sparse_vector<Val, BV>::free_plain(unsigned i)
+sparse_vector<Val, BV>::back_insert_iterator::~back_insert_iterator()
 {
-    BM_ASSERT(i < stored_plains());
-    bvector_type* bv = plains_[i];
-    destruct_bvector(bv);
-    plains_[i] = 0;
+    flush();
+    if (buf_)
+        alloc_.free_bit_block((bm::word_t*)buf_, sizeof(Val) * 8);
+    if (tb_)
+        alloc_.free_bit_block(tb_, sizeof(Val) * 8);
 }
 
 //---------------------------------------------------------------------
 
 template<class Val, class BV>
-sparse_vector<Val, BV>&
-sparse_vector<Val, BV>::clear_range(
-    typename sparse_vector<Val, BV>::size_type left,
-    typename sparse_vector<Val, BV>::size_type right,
-    bool set_null)
+void sparse_vector<Val, BV>::back_insert_iterator::add(value_type v)
 {
-    if (right < left)
+    BM_ASSERT(sv_);
+    if (!buf_size_)
     {
-        return clear_range(right, left);
+        if (!buf_) // block of values: gap_max_bits * sizeof(Val) bytes
+            buf_ = (value_type*)alloc_.alloc_bit_block(sizeof(Val) * 8);
+        buf_cap_ = bm::gap_max_bits - unsigned(sv_->size() & bm::set_block_mask);
     }
-    unsigned eff_plains = effective_plains();
-    for (unsigned i = 0; i < eff_plains; ++i)
-    {
-        bvector_type* bv = plains_[i];
-        if (bv)
-        {
-            bv->set_range(left, right, false);
-        }
-    } // for i
-    
-    if (set_null)
-    {
-        bvector_type* bv_null = get_null_bvect();
-        if (bv_null)
-            bv_null->set_range(left, right, false);
-    }
-    
-    return *this;
+    buf_[buf_size_++] = v;
+    if (buf_size_ == buf_cap_)
+        flush();
 }
 
 //---------------------------------------------------------------------
 
 template<class Val, class BV>
-void sparse_vector<Val, BV>::calc_stat(
-     struct sparse_vector<Val, BV>::statistics* st) const
+void sparse_vector<Val, BV>::back_insert_iterator::add_null()
 {
-    BM_ASSERT(st);
-    
-    st->reset();
+    BM_ASSERT(sv_);
+    flush();
+    sv_->resize(sv_->size() + 1);
+}
 
-    unsigned stored_plains = this->stored_plains();
-    for (unsigned j = 0; j < stored_plains; ++j)
-    {
-        const bvector_type* bv = this->plains_[j];
-        if (bv)
-        {
-            typename bvector_type::statistics stbv;
-            bv->calc_stat(&stbv);
-            
-            st->bit_blocks += stbv.bit_blocks;
-            st->gap_blocks += stbv.gap_blocks;
-            st->max_serialize_mem += stbv.max_serialize_mem + 8;
-            st->memory_used += stbv.memory_used;
-        }
-    } // for j
-    // header accounting
-    st->max_serialize_mem += 1 + 1 + 1 + 1 + 8 + (8 * this->stored_plains());
+//---------------------------------------------------------------------
 
+template<class Val, class BV>
+void sparse_vector<Val, BV>::back_insert_iterator::flush()
+{
+    if (!buf_size_)
+        return;
+    if (!tb_ && buf_size_ == bm::gap_max_bits &&
+        (sizeof(Val) == sizeof(unsigned) || sizeof(Val) == sizeof(bm::id64_t)))
+        tb_ = alloc_.alloc_bit_block(sizeof(Val) * 8);
+    sv_->import_back(buf_, buf_size_, tb_);
+    buf_size_ = 0;
 }
 
 //---------------------------------------------------------------------
 
 template<class Val, class BV>
-void sparse_vector<Val, BV>::optimize(
-    bm::word_t*                                  temp_block, 
-    typename bvector_type::optmode               opt_mode,
-    typename sparse_vector<Val, BV>::statistics* st)
+void sparse_vector<Val, BV>::push_back(value_type v)
 {
-    if (st)
-    {
-        st->bit_blocks = st->gap_blocks = 0;
-        st->max_serialize_mem = st->memory_used = 0;
-    }
-    bvector_type* bv_null = this->get_null_bvect();
-    
-    unsigned stored_plains = this->stored_plains();
-    for (unsigned j = 0; j < stored_plains; ++j)
+    set_value(size_, v);
+    ++size_;
+}
+
+//---------------------------------------------------------------------
+
+template<class Val, class BV>
+void sparse_vector<Val, BV>::set_value(size_type idx, value_type v)
+{
+    // calculate logical block coordinates and masks
+    //
+    unsigned nb = unsigned(idx >>  bm::set_block_shift);
+    unsigned i0 = nb >> bm::set_array_shift; // top block address
+    unsigned j0 = nb &  bm::set_array_mask;  // address in sub-block
+
+    // clear the plains where needed
+    unsigned eff_plains = effective_plains();
+    for (unsigned i = 0; i < eff_plains; ++i)
     {
-        bvector_type* bv = this->plains_[j];
-        if (bv)
+        const bm::word_t* blk = get_block(i, i0, j0);
+        if (blk)
         {
-            if (bv != bv_null) // protect the NULL vector from de-allocation
-            {
-                if (!bv->any())  // empty vector?
-                {
-                    destruct_bvector(this->plains_[j]);
-                    this->plains_[j] = 0;
-                    continue;
-                }
-            }
-            
-            typename bvector_type::statistics stbv;
-            bv->optimize(temp_block, opt_mode, &stbv);
-            
-            if (st)
-            {
-                st->bit_blocks += stbv.bit_blocks;
-                st->gap_blocks += stbv.gap_blocks;
-                st->max_serialize_mem += stbv.max_serialize_mem + 8;
-                st->memory_used += stbv.memory_used;
-            }
+            BM_ASSERT(plains_[i]);
+            bvector_type* bv = plains_[i];
+            bv->clear_bit(idx);
         }
+    }
+
+    // set bits in plains
+    unsigned b_list[sizeof(Val) * 8];
+    unsigned bcnt = bm::bitscan(value_traits::encode(v), b_list);
+
+    for (unsigned j = 0; j < bcnt; ++j)
+    {
+        unsigned p = b_list[j];
+        bvector_type* bv = get_plain(p);
+        bv->set_bit_no_check(idx);
     } // for j
+    
+    bvector_type* bv_null = get_null_bvect();
+    if (bv_null)
+        bv_null->set_bit_no_check(idx);
 
 }
 
 //---------------------------------------------------------------------
 
-
 template<class Val, class BV>
-void sparse_vector<Val, BV>::optimize_gap_size()
+sparse_vector<Val, BV>&
+sparse_vector<Val, BV>::clear_range(
+    typename sparse_vector<Val, BV>::size_type left,
+    typename sparse_vector<Val, BV>::size_type right,
+    bool set_null)
 {
-    unsigned stored_plains = this->stored_plains();
-    for (unsigned j = 0; j < stored_plains; ++j)
-    {
-        bvector_type* bv = this->plains_[j];
-        if (bv)
-        {
-            bv->optimize_gap_size();
-        }
-    }
+    base_type::clear_range(left, right, set_null);
+    return *this;
 }
 
 //---------------------------------------------------------------------
@@ -18,8 +18,11 @@ limitations under the License.
 For more information please visit:  http://bitmagic.io
 */
 
-#include "bmdef.h"
+#include <vector>
+
 #include "bmsparsevec.h"
+#include "bmaggregator.h"
+#include "bmdef.h"
 
 /** \defgroup svalgo Sparse vector algorithms
     Sparse vector algorithms
@@ -30,6 +33,9 @@ For more information please visit:  http://bitmagic.io
 namespace bm
 {
 
+template<class Val, class SV> class remap_sparse_vector;
+template<class Val, class SV> class for_sparse_vector;
+
 /*!
     \brief Clip dynamic range for signal higher than specified
     
@@ -161,6 +167,211 @@ void compute_nonzero_bvector(const SV& svect, typename SV::bvector_type& bvect)
     }
 }
 
+/*!
+    \brief Count of NOT NULL sparse vector elements selected by the mask
+ 
+    \param  svect - input sparse vector
+    \param  bv_mask - set of element indexes (filter)
+    \return number of NOT NULL elements in the mask
+ 
+    \ingroup svalgo
+*/
+template<class SV>
+bm::id_t sparse_vector_count(const SV& svect,
+                             const typename SV::bvector_type& bv_mask)
+{
+    if (svect.empty())
+        return 0;
+    const typename SV::bvector_type* bv_null = svect.get_null_bvector();
+    if (bv_null)
+        return bm::count_and(*bv_null, bv_mask);
+    return bv_mask.count_range(0, svect.size()-1);
+}
+
+/// \internal SUM(count_and(plain[i], mask) << (i - first)) for plains >= first
+template<class SV>
+bm::id64_t sparse_vector_sum_plains(const SV& svect,
+                                    const typename SV::bvector_type& bv_mask,
+                                    unsigned first)
+{
+    bm::id64_t sum = 0;
+    for (unsigned i = first; i < svect.plains(); ++i)
+    {
+        const typename SV::bvector_type* bv_plain = svect.plain(i);
+        if (bv_plain)
+            sum += bm::id64_t(bm::count_and(*bv_plain, bv_mask)) << (i - first);
+    } // for i
+    return sum;
+}
+
+/*!
+    \brief SUM of sparse vector elements selected by the mask
+ 
+    Sum is computed from bit plains as SUM(count_and(plain[i], mask) << i),
+    elements are never decoded. NULL elements do not contribute.
+    For signed (zig-zag encoded) vectors negative elements (plain 0) are
+    counted separately and the sum is two's complement.
+ 
+    \param  svect - input sparse vector
+    \param  bv_mask - set of element indexes (filter)
+    \return sum (modulo 2^64)
+ 
+    \ingroup svalgo
+*/
+template<class SV>
+bm::id64_t sparse_vector_sum(const SV& svect,
+                             const typename SV::bvector_type& bv_mask)
+{
+    if (!bm::sv_value_traits<typename SV::value_type>::is_signed)
+        return bm::sparse_vector_sum_plains(svect, bv_mask, 0);
+    
+    // x = (zz >> 1) for even zz, x = -(zz >> 1) - 1 for odd (negative) zz
+    bm::id64_t sum_all = bm::sparse_vector_sum_plains(svect, bv_mask, 1);
+    const typename SV::bvector_type* bv_sign = svect.plain(0);
+    if (!bv_sign) // no negative values
+        return sum_all;
+    typename SV::bvector_type bv_neg(bv_mask);
+    bv_neg &= *bv_sign;
+    bm::id64_t neg_cnt = bv_neg.count();
+    bm::id64_t sum_neg = bm::sparse_vector_sum_plains(svect, bv_neg, 1);
+    return (sum_all - sum_neg) - sum_neg - neg_cnt;
+}
+
+/// \internal candidates for MIN/MAX search: mask AND NOT NULL
+template<class SV>
+bool sparse_vector_mask_candidates(const SV& svect,
+                                   const typename SV::bvector_type& bv_mask,
+                                   typename SV::bvector_type& bv_cand)
+{
+    if (svect.empty())
+        return false;
+    bv_cand = bv_mask;
+    const typename SV::bvector_type* bv_null = svect.get_null_bvector();
+    if (bv_null)
+        bv_cand &= *bv_null;
+    else
+    if (svect.size() < bv_cand.size())
+        bv_cand.set_range(svect.size(), bv_cand.size() - 1, false);
+    return bv_cand.any();
+}
+
+/// \internal MIN of the (encoded) plains value of candidates
+template<class SV>
+typename bm::sv_value_traits<typename SV::value_type>::unsigned_type
+sparse_vector_min_plains(const SV& svect, typename SV::bvector_type& bv_cand)
+{
+    typedef typename
+        bm::sv_value_traits<typename SV::value_type>::unsigned_type uvalue_type;
+    uvalue_type v = 0;
+    for (unsigned i = svect.plains(); i-- > 0; )
+    {
+        const typename SV::bvector_type* bv_plain = svect.plain(i);
+        if (!bv_plain)
+            continue;
+        if (bm::any_sub(bv_cand, *bv_plain))
+            bv_cand.bit_sub(*bv_plain);
+        else // all candidates have 1 in this plain
+            v |= uvalue_type(uvalue_type(1) << i);
+    } // for i
+    return v;
+}
+
+/// \internal MAX of the (encoded) plains value of candidates
+template<class SV>
+typename bm::sv_value_traits<typename SV::value_type>::unsigned_type
+sparse_vector_max_plains(const SV& svect, typename SV::bvector_type& bv_cand)
+{
+    typedef typename
+        bm::sv_value_traits<typename SV::value_type>::unsigned_type uvalue_type;
+    uvalue_type v = 0;
+    for (unsigned i = svect.plains(); i-- > 0; )
+    {
+        const typename SV::bvector_type* bv_plain = svect.plain(i);
+        if (bv_plain && bm::any_and(bv_cand, *bv_plain))
+        {
+            bv_cand.bit_and(*bv_plain);
+            v |= uvalue_type(uvalue_type(1) << i);
+        }
+    } // for i
+    return v;
+}
+
+/*!
+    \brief MIN of sparse vector elements selected by the mask
+ 
+    Bit plains are scanned from the highest to the lowest, at every
+    step candidates with 0 in the plain (if any) are kept.
+ 
+    \param  svect - input sparse vector
+    \param  bv_mask - set of element indexes (filter)
+    \param  min_val - [out] minimal value
+    \return false if mask selects no NOT NULL elements
+ 
+    \ingroup svalgo
+    \sa sparse_vector_max
+*/
+template<class SV>
+bool sparse_vector_min(const SV& svect,
+                       const typename SV::bvector_type& bv_mask,
+                       typename SV::value_type& min_val)
+{
+    typedef bm::sv_value_traits<typename SV::value_type> value_traits;
+    typename SV::bvector_type bv_cand;
+    if (!bm::sparse_vector_mask_candidates(svect, bv_mask, bv_cand))
+        return false;
+    
+    if (value_traits::is_signed) // MIN is MAX (zig-zag) of negative values
+    {
+        const typename SV::bvector_type* bv_sign = svect.plain(0);
+        if (bv_sign && bm::any_and(bv_cand, *bv_sign))
+        {
+            bv_cand.bit_and(*bv_sign);
+            min_val = value_traits::decode(
+                        bm::sparse_vector_max_plains(svect, bv_cand));
+            return true;
+        }
+    }
+    min_val = value_traits::decode(bm::sparse_vector_min_plains(svect, bv_cand));
+    return true;
+}
+
+/*!
+    \brief MAX of sparse vector elements selected by the mask
+ 
+    \param  svect - input sparse vector
+    \param  bv_mask - set of element indexes (filter)
+    \param  max_val - [out] maximal value
+    \return false if mask selects no NOT NULL elements
+ 
+    \ingroup svalgo
+    \sa sparse_vector_min
+*/
+template<class SV>
+bool sparse_vector_max(const SV& svect,
+                       const typename SV::bvector_type& bv_mask,
+                       typename SV::value_type& max_val)
+{
+    typedef bm::sv_value_traits<typename SV::value_type> value_traits;
+    typename SV::bvector_type bv_cand;
+    if (!bm::sparse_vector_mask_candidates(svect, bv_mask, bv_cand))
+        return false;
+    
+    if (value_traits::is_signed) // MAX is MIN (zig-zag) of negative values
+    {                            // if all candidates are negative
+        const typename SV::bvector_type* bv_sign = svect.plain(0);
+        if (bv_sign && !bm::any_sub(bv_cand, *bv_sign))
+        {
+            max_val = value_traits::decode(
+                        bm::sparse_vector_min_plains(svect, bv_cand));
+            return true;
+        }
+        if (bv_sign)
+            bv_cand.bit_sub(*bv_sign);
+    }
+    max_val = value_traits::decode(bm::sparse_vector_max_plains(svect, bv_cand));
+    return true;
+}
+
 /*!
     \brief Integer set to set transformation (functional image in groups theory)
     https://en.wikipedia.org/wiki/Image_(mathematics)
@@ -206,14 +417,21 @@ public:
             bv_product_ &= bvect_in;
         }
         
+        // batch gather: sparse vector blocks are resolved once per block
+        const unsigned buf_size = 1024;
+        typename SV::size_type  idx_buf[buf_size];
+        typename SV::value_type val_buf[buf_size];
+        
         typename SV::bvector_type::enumerator en(bv_product_.first());
-        for (; en.valid(); ++en)
+        while (en.valid())
         {
-            auto idx = *en;
-            idx = sv_brel.translate_address(idx);
-            typename SV::value_type translated_id = sv_brel.get(idx);
-            bvect_out.set_bit_no_check(translated_id);
-        } // for en
+            unsigned n = 0;
+            for (; n < buf_size && en.valid(); ++en, ++n)
+                idx_buf[n] = sv_brel.translate_address(*en);
+            sv_brel.gather(val_buf, idx_buf, n);
+            for (unsigned i = 0; i < n; ++i)
+                bvect_out.set_bit_no_check(val_buf[i]);
+        } // while
     }
     
 protected:
@@ -222,6 +440,1595 @@ protected:
 
 
 
+/*!
+    \brief get block of a bit-vector as a bit-block
+    (GAP block is converted into the temp block)
+    \param bv - bit-vector (can be NULL)
+    \param nb - block number
+    \param tb - temp block for GAP conversion
+    \return 0 if block is empty, FULL_BLOCK_REAL_ADDR if it is full
+    \internal
+*/
+template<class BV>
+const bm::word_t* get_bit_block_as_bitset(const BV* bv, unsigned nb,
+                                          bm::word_t* tb)
+{
+    if (!bv)
+        return 0;
+    const bm::word_t* block = bv->get_blocks_manager().get_block_ptr(nb);
+    if (!block)
+        return 0;
+    if (BM_IS_GAP(block))
+    {
+        bm::gap_convert_to_bitset(tb, BMGAP_PTR(block));
+        return tb;
+    }
+    if (IS_FULL_BLOCK(block))
+        return FULL_BLOCK_REAL_ADDR;
+    return block;
+}
+
+
+/*!
+    \brief algorithms for sparse_vector scan/search
+ 
+    Scanner uses properties of bit-vector plains to answer the request.
+    Search for a value is a fused AND-SUB of the bit plains (plains of
+    1 bits of the value are AND-ed, plains of 0 bits are subtracted),
+    evaluated block by block by bm::aggregator<>, blocks which become
+    empty are dropped from further processing.
+    NULL-able vectors are AND-ed with the NOT NULL plain, so NULL values
+    never match.
+ 
+    \ingroup svalgo
+    \ingroup setalgo
+*/
+template<typename SV>
+class sparse_vector_scanner
+{
+public:
+    typedef typename SV::bvector_type       bvector_type;
+    typedef const bvector_type*             bvector_type_const_ptr;
+    typedef typename SV::value_type         value_type;
+    typedef bm::sv_value_traits<value_type> value_traits;
+    typedef typename value_traits::unsigned_type unsigned_value_type;
+    typedef typename SV::size_type          size_type;
+    typedef bm::aggregator<bvector_type>    aggregator_type;
+    typedef typename bvector_type::blocks_manager_type blocks_manager_type;
+    
+public:
+    sparse_vector_scanner() {}
+    
+    /**
+        \brief find all sparse vector elements EQ to search value
+
+        \param sv - input sparse vector
+        \param value - value to search for
+        \param bv_out - search result bit-vector (search result is a set of indexes)
+    */
+    void find_eq(const SV& sv, value_type value, bvector_type& bv_out);
+    
+    /**
+        \brief find first sparse vector element EQ to search value
+
+        \param sv - input sparse vector
+        \param value - value to search for
+        \param idx - [out] index of the first element
+        \return true if found
+    */
+    bool find_eq(const SV& sv, value_type value, size_type& idx);
+    
+    /**
+        \brief find all sparse vector elements equal to any value
+        of the search list (IN-list query)
+
+        \param sv - input sparse vector
+        \param values - array of values to search for
+        \param values_size - size of the values array
+        \param bv_out - search result bit-vector
+    */
+    void find_in(const SV& sv,
+                 const value_type* values, size_type values_size,
+                 bvector_type& bv_out);
+    
+    /**
+        \brief find all sparse vector elements EQ to 0
+        \param sv - input sparse vector
+        \param bv_out - output bit-vector (search result)
+    */
+    void find_zero(const SV& sv, bvector_type& bv_out)
+        { find_eq(sv, value_type(0), bv_out); }
+    
+    /**
+        \brief find all sparse vector elements LT (less than) value
+        \param sv - input sparse vector
+        \param value - value to compare with
+        \param bv_out - search result bit-vector
+    */
+    void find_lt(const SV& sv, value_type value, bvector_type& bv_out)
+        { find_cmp(sv, value, value, cmp_lt, bv_out); }
+    
+    /**
+        \brief find all sparse vector elements LE (less or equal) value
+        \sa find_lt
+    */
+    void find_le(const SV& sv, value_type value, bvector_type& bv_out)
+        { find_cmp(sv, value, value, cmp_le, bv_out); }
+    
+    /**
+        \brief find all sparse vector elements GT (greater than) value
+        \sa find_lt
+    */
+    void find_gt(const SV& sv, value_type value, bvector_type& bv_out)
+        { find_cmp(sv, value, value, cmp_gt, bv_out); }
+    
+    /**
+        \brief find all sparse vector elements GE (greater or equal) value
+        \sa find_lt
+    */
+    void find_ge(const SV& sv, value_type value, bvector_type& bv_out)
+        { find_cmp(sv, value, value, cmp_ge, bv_out); }
+    
+    /**
+        \brief find all sparse vector elements in the closed range
+        [from..to] (BETWEEN from AND to)
+
+        \param sv - input sparse vector
+        \param from - range start (inclusive)
+        \param to - range end (inclusive)
+        \param bv_out - search result bit-vector
+    */
+    void find_range(const SV& sv, value_type from, value_type to,
+                    bvector_type& bv_out)
+        { find_cmp(sv, from, to, cmp_range, bv_out); }
+    
+    /**
+        \brief find all string sparse vector elements EQ to search string
+        (str_sparse_vector<>)
+
+        \param sv - input string sparse vector
+        \param str - zero terminated string to search for
+        \param bv_out - search result bit-vector (search result is a set of indexes)
+    */
+    void find_eq_str(const SV& sv, const value_type* str, bvector_type& bv_out);
+    
+    /**
+        \brief find first string sparse vector element EQ to search string
+
+        \param sv - input string sparse vector
+        \param str - zero terminated string to search for
+        \param idx - [out] index of the first element
+        \return true if found
+    */
+    bool find_eq_str(const SV& sv, const value_type* str, size_type& idx);
+    
+    /**
+        \brief find all string sparse vector elements starting with prefix
+        (LIKE 'prefix%')
+
+        \param sv - input string sparse vector
+        \param str - zero terminated prefix to search for
+        \param bv_out - search result bit-vector
+    */
+    void find_eq_str_prefix(const SV& sv, const value_type* str,
+                            bvector_type& bv_out);
+    
+    /**
+        \brief find all remapped sparse vector elements EQ to search value
+        (value is translated into its dictionary code)
+
+        \param rsv - input remapped sparse vector (bmsparsevec_compr.h)
+        \param value - value to search for
+        \param bv_out - search result bit-vector
+        \sa remap_sparse_vector
+    */
+    template<class Val>
+    void find_eq(const remap_sparse_vector<Val, SV>& rsv,
+                 typename remap_sparse_vector<Val, SV>::value_type value,
+                 bvector_type& bv_out);
+    
+    /**
+        \brief find first remapped sparse vector element EQ to search value
+        \return true if found
+    */
+    template<class Val>
+    bool find_eq(const remap_sparse_vector<Val, SV>& rsv,
+                 typename remap_sparse_vector<Val, SV>::value_type value,
+                 size_type& idx);
+    
+    /**
+        \brief IN-list query over a remapped sparse vector
+        (values missing in the dictionary are skipped)
+    */
+    template<class Val>
+    void find_in(const remap_sparse_vector<Val, SV>& rsv,
+                 const typename remap_sparse_vector<Val, SV>::value_type* values,
+                 size_type values_size,
+                 bvector_type& bv_out);
+    
+    /**
+        \brief find all remapped sparse vector elements LT value
+        (dictionary is ordered, comparison runs on codes)
+    */
+    template<class Val>
+    void find_lt(const remap_sparse_vector<Val, SV>& rsv,
+                 typename remap_sparse_vector<Val, SV>::value_type value,
+                 bvector_type& bv_out)
+        { find_cmp_remap(rsv, value, value, cmp_lt, bv_out); }
+    
+    /** \brief find all remapped sparse vector elements LE value */
+    template<class Val>
+    void find_le(const remap_sparse_vector<Val, SV>& rsv,
+                 typename remap_sparse_vector<Val, SV>::value_type value,
+                 bvector_type& bv_out)
+        { find_cmp_remap(rsv, value, value, cmp_le, bv_out); }
+    
+    /** \brief find all remapped sparse vector elements GT value */
+    template<class Val>
+    void find_gt(const remap_sparse_vector<Val, SV>& rsv,
+                 typename remap_sparse_vector<Val, SV>::value_type value,
+                 bvector_type& bv_out)
+        { find_cmp_remap(rsv, value, value, cmp_gt, bv_out); }
+    
+    /** \brief find all remapped sparse vector elements GE value */
+    template<class Val>
+    void find_ge(const remap_sparse_vector<Val, SV>& rsv,
+                 typename remap_sparse_vector<Val, SV>::value_type value,
+                 bvector_type& bv_out)
+        { find_cmp_remap(rsv, value, value, cmp_ge, bv_out); }
+    
+    /** \brief find all remapped sparse vector elements in [from..to] */
+    template<class Val>
+    void find_range(const remap_sparse_vector<Val, SV>& rsv,
+                    typename remap_sparse_vector<Val, SV>::value_type from,
+                    typename remap_sparse_vector<Val, SV>::value_type to,
+                    bvector_type& bv_out)
+        { find_cmp_remap(rsv, from, to, cmp_range, bv_out); }
+    
+    /**
+        \brief find all frame-of-reference sparse vector elements EQ to
+        search value (value is rebased for every block)
+
+        \param fsv - input FOR sparse vector (bmsparsevec_compr.h)
+        \param value - value to search for
+        \param bv_out - search result bit-vector
+        \sa for_sparse_vector
+    */
+    template<class Val>
+    void find_eq(const for_sparse_vector<Val, SV>& fsv,
+                 typename for_sparse_vector<Val, SV>::value_type value,
+                 bvector_type& bv_out);
+    
+    /**
+        \brief find first frame-of-reference sparse vector element EQ to
+        search value
+        \return true if found
+    */
+    template<class Val>
+    bool find_eq(const for_sparse_vector<Val, SV>& fsv,
+                 typename for_sparse_vector<Val, SV>::value_type value,
+                 size_type& idx);
+    
+    /** \brief find all FOR sparse vector elements LT value */
+    template<class Val>
+    void find_lt(const for_sparse_vector<Val, SV>& fsv,
+                 typename for_sparse_vector<Val, SV>::value_type value,
+                 bvector_type& bv_out)
+        { find_cmp_for(fsv, value, value, cmp_lt, bv_out); }
+    
+    /** \brief find all FOR sparse vector elements LE value */
+    template<class Val>
+    void find_le(const for_sparse_vector<Val, SV>& fsv,
+                 typename for_sparse_vector<Val, SV>::value_type value,
+                 bvector_type& bv_out)
+        { find_cmp_for(fsv, value, value, cmp_le, bv_out); }
+    
+    /** \brief find all FOR sparse vector elements GT value */
+    template<class Val>
+    void find_gt(const for_sparse_vector<Val, SV>& fsv,
+                 typename for_sparse_vector<Val, SV>::value_type value,
+                 bvector_type& bv_out)
+        { find_cmp_for(fsv, value, value, cmp_gt, bv_out); }
+    
+    /** \brief find all FOR sparse vector elements GE value */
+    template<class Val>
+    void find_ge(const for_sparse_vector<Val, SV>& fsv,
+                 typename for_sparse_vector<Val, SV>::value_type value,
+                 bvector_type& bv_out)
+        { find_cmp_for(fsv, value, value, cmp_ge, bv_out); }
+    
+    /** \brief find all FOR sparse vector elements in [from..to] */
+    template<class Val>
+    void find_range(const for_sparse_vector<Val, SV>& fsv,
+                    typename for_sparse_vector<Val, SV>::value_type from,
+                    typename for_sparse_vector<Val, SV>::value_type to,
+                    bvector_type& bv_out)
+        { find_cmp_for(fsv, from, to, cmp_range, bv_out); }
+    
+protected:
+    /// comparison operation codes (find_cmp)
+    enum cmp_op
+    {
+        cmp_lt = 0,
+        cmp_le,
+        cmp_gt,
+        cmp_ge,
+        cmp_range
+    };
+    
+    /// Bit-sliced comparison of sparse vector with value(s),
+    /// evaluated block by block
+    ///
+    /// \param block_base - values of blocks are stored as (value - base)
+    ///        (frame-of-reference), comparison arguments are rebased for
+    ///        every block; 0 if values are stored as is
+    /// \param base_size - size of block_base (1 - same base for all blocks)
+    template<class SVC>
+    void find_cmp(const SVC& sv,
+                  typename SVC::value_type from,
+                  typename SVC::value_type to,
+                  int cmp, bvector_type& bv_out,
+                  const typename SVC::value_type* block_base = 0,
+                  unsigned base_size = 0);
+    
+    /// Comparison of frame-of-reference sparse vector (per block bases),
+    /// values and bases are compared as unsigned ordered codes
+    template<class Val>
+    void find_cmp_for(const for_sparse_vector<Val, SV>& fsv,
+                      typename for_sparse_vector<Val, SV>::value_type from,
+                      typename for_sparse_vector<Val, SV>::value_type to,
+                      int cmp, bvector_type& bv_out);
+    
+    /// Translate comparison into the frame of reference of a block
+    /// (unsigned code arithmetics: stored codes are (value - base))
+    /// \return 0 - compare, -1 - no matches, 1 - all NOT NULL elements match
+    template<typename CT>
+    static
+    int rebase_cmp(CT base, int cmp, CT& from, CT& to);
+    
+    /// Comparison of remapped sparse vector: value bounds are translated
+    /// into the range of codes
+    template<class Val>
+    void find_cmp_remap(const remap_sparse_vector<Val, SV>& rsv,
+                        typename remap_sparse_vector<Val, SV>::value_type from,
+                        typename remap_sparse_vector<Val, SV>::value_type to,
+                        int cmp, bvector_type& bv_out);
+    
+    /// Bit-sliced comparison of one block (from the highest plain down),
+    /// stops when there are no more EQ candidates
+    ///
+    /// \param eq - [in] NOT NULL mask, [out] elements EQ to value
+    /// \param lt - [out] elements LT value
+    /// \param tb - temp block (GAP plain conversion)
+    template<class SVC>
+    void compare_block(const SVC& sv, unsigned nb,
+                       typename SVC::value_type value,
+                       bm::word_t* BMRESTRICT lt,
+                       bm::word_t* BMRESTRICT eq,
+                       bm::word_t* BMRESTRICT tb);
+    
+    /// compare_block() of the plains (encoded) value (unsigned order)
+    template<class SVC>
+    void compare_plains(const SVC& sv, unsigned nb,
+                        typename SVC::unsigned_value_type value,
+                        bm::word_t* BMRESTRICT lt,
+                        bm::word_t* BMRESTRICT eq,
+                        bm::word_t* BMRESTRICT tb);
+    
+    /// put result bit-block into the target (empty or full blocks are
+    /// not allocated)
+    static
+    void store_result_block(blocks_manager_type& bman, unsigned nb,
+                            const bm::word_t* tb);
+    
+    /// get block of a plain as a bit-block (GAP block is converted into tb)
+    /// \return 0 if block is empty, FULL_BLOCK_REAL_ADDR if it is full
+    static
+    const bm::word_t* get_bit_block(const bvector_type* bv, unsigned nb,
+                                    bm::word_t* tb);
+    
+protected:
+    /// attach plains of the sparse vector to the AND-SUB aggregator
+    /// \return false if the search result is known to be empty
+    template<class SVC>
+    bool prepare_and_sub_aggregator(const SVC& sv,
+                                    typename SVC::value_type value);
+    
+    /// attach character plains of the string vector to the AND-SUB
+    /// aggregator (prefix search skips the string terminator check)
+    /// \return false if the search result is known to be empty
+    bool prepare_and_sub_aggregator(const SV& sv, const value_type* str,
+                                    bool prefix);
+    
+    /// attach plains of characters [from, to) to the AND-SUB aggregator
+    /// \return false if a character bit is not present in the vector
+    bool add_str_plains(const SV& sv, const value_type* str,
+                        unsigned from, unsigned to);
+    
+private:
+    sparse_vector_scanner(const sparse_vector_scanner&);
+    sparse_vector_scanner& operator=(const sparse_vector_scanner&);
+    
+protected:
+    aggregator_type   agg_;       ///< AND-SUB evaluation engine
+    bvector_type      bv_range_;  ///< [0, size) range (NOT NULL-able vectors)
+    bvector_type      bv_tmp_;    ///< temp result (IN-list)
+    bvector_type      bv_chunk_;  ///< partial result (long string search)
+};
+
+
+//----------------------------------------------------------------------------
+//
+//----------------------------------------------------------------------------
+
+template<typename SV> template<class SVC>
+bool sparse_vector_scanner<SV>::prepare_and_sub_aggregator(
+                                            const SVC&               sv,
+                                            typename SVC::value_type v)
+{
+    typename SVC::unsigned_value_type value = SVC::value_traits::encode(v);
+    agg_.reset();
+    if (sv.empty())
+        return false;
+    
+    const bvector_type* bv_null = sv.get_null_bvector();
+    bool and_empty = true;
+    if (bv_null) // NULL values never match
+    {
+        agg_.add(bv_null, 0);
+        and_empty = false;
+    }
+    
+    // high plains go first: they are usually sparse and cut more blocks
+    for (unsigned i = sv.plains(); i-- > 0; )
+    {
+        const bvector_type* bv_plain = sv.plain(i);
+        if ((value >> i) & 1)
+        {
+            if (!bv_plain) // value bit is not present in the vector
+                return false;
+            agg_.add(bv_plain, 0);
+            and_empty = false;
+        }
+        else
+        {
+            if (bv_plain)
+                agg_.add(bv_plain, 1);
+        }
+    } // for i
+    
+    if (and_empty) // search for 0 in NOT NULL-able vector
+    {
+        bv_range_.clear(true);
+        bv_range_.set_range(0, sv.size()-1);
+        agg_.add(&bv_range_, 0);
+    }
+    return true;
+}
+
+//----------------------------------------------------------------------------
+
+template<typename SV>
+void sparse_vector_scanner<SV>::find_eq(const SV&     sv,
+                                        value_type    value,
+                                        bvector_type& bv_out)
+{
+    if (!prepare_and_sub_aggregator(sv, value))
+    {
+        bv_out.clear(true);
+        return;
+    }
+    agg_.combine_and_sub(bv_out);
+    agg_.reset();
+}
+
+//----------------------------------------------------------------------------
+
+template<typename SV>
+bool sparse_vector_scanner<SV>::find_eq(const SV&  sv,
+                                        value_type value,
+                                        size_type& idx)
+{
+    if (!prepare_and_sub_aggregator(sv, value))
+        return false;
+    bm::id_t nbit;
+    bool found = agg_.find_first_and_sub(nbit);
+    agg_.reset();
+    if (found)
+        idx = size_type(nbit);
+    return found;
+}
+
+//----------------------------------------------------------------------------
+
+template<typename SV>
+bool sparse_vector_scanner<SV>::add_str_plains(const SV&         sv,
+                                               const value_type* str,
+                                               unsigned          from,
+                                               unsigned          to)
+{
+    const unsigned char_bits = unsigned(sizeof(value_type) * 8);
+    for (unsigned i = from; i < to; ++i)
+    {
+        unsigned ch = unsigned(str[i]);
+        unsigned p0 = i * char_bits;
+        for (unsigned k = 0; k < char_bits; ++k)
+        {
+            const bvector_type* bv_plain = sv.plain(p0 + k);
+            if ((ch >> k) & 1)
+            {
+                if (!bv_plain)
+                    return false;
+                agg_.add(bv_plain, 0);
+            }
+            else
+            {
+                if (bv_plain)
+                    agg_.add(bv_plain, 1);
+            }
+        } // for k
+    } // for i
+    return true;
+}
+
+//----------------------------------------------------------------------------
+
+template<typename SV>
+bool sparse_vector_scanner<SV>::prepare_and_sub_aggregator(
+                                                const SV&         sv,
+                                                const value_type* str,
+                                                bool              prefix)
+{
+    BM_ASSERT(str);
+    agg_.reset();
+    if (sv.empty())
+        return false;
+    
+    const unsigned char_bits = unsigned(sizeof(value_type) * 8);
+    const unsigned max_str_size = sv.plains() / char_bits;
+    // characters per AND-SUB run: their plains, terminator plains, NULL 
+    // and the result of the previous run fit into an aggregator group
+    const unsigned chunk_size = 
+        unsigned(aggregator_type::max_aggregator_cap) / char_bits - 2;
+    
+    unsigned len = 0;
+    for (; str[len]; ++len)
+    {
+        if (len == max_str_size) // longer than any stored string
+            return false;
+    }
+    
+    const bvector_type* bv_null = sv.get_null_bvector();
+    if (bv_null) // NULL values never match
+        agg_.add(bv_null, 0);
+    
+    // long strings: leading characters are searched in chunks, result of
+    // each chunk is an AND argument of the next one
+    unsigned i = 0;
+    for (; len - i > chunk_size; i += chunk_size)
+    {
+        if (!add_str_plains(sv, str, i, i + chunk_size))
+            return false;
+        agg_.combine_and_sub(bv_tmp_);
+        agg_.reset();
+        if (!bv_tmp_.any())
+            return false;
+        bv_chunk_.swap(bv_tmp_);
+        agg_.add(&bv_chunk_, 0);
+    } // for i
+    
+    if (!add_str_plains(sv, str, i, len))
+        return false;
+    
+    // EQ: the next character must be the terminator (characters after it
+    // are always 0)
+    if (!prefix && len < max_str_size)
+    {
+        unsigned p0 = len * char_bits;
+        for (unsigned k = 0; k < char_bits; ++k)
+        {
+            const bvector_type* bv_plain = sv.plain(p0 + k);
+            if (bv_plain)
+                agg_.add(bv_plain, 1);
+        } // for k
+    }
+    
+    if (!bv_null && !len) // empty string (prefix) in NOT NULL-able vector
+    {
+        bv_range_.clear(true);
+        bv_range_.set_range(0, sv.size()-1);
+        agg_.add(&bv_range_, 0);
+    }
+    return true;
+}
+
+//----------------------------------------------------------------------------
+
+template<typename SV>
+void sparse_vector_scanner<SV>::find_eq_str(const SV&         sv,
+                                            const value_type* str,
+                                            bvector_type&     bv_out)
+{
+    if (!prepare_and_sub_aggregator(sv, str, false))
+    {
+        bv_out.clear(true);
+        return;
+    }
+    agg_.combine_and_sub(bv_out);
+    agg_.reset();
+}
+
+//----------------------------------------------------------------------------
+
+template<typename SV>
+bool sparse_vector_scanner<SV>::find_eq_str(const SV&         sv,
+                                            const value_type* str,
+                                            size_type&        idx)
+{
+    if (!prepare_and_sub_aggregator(sv, str, false))
+        return false;
+    bm::id_t nbit;
+    bool found = agg_.find_first_and_sub(nbit);
+    agg_.reset();
+    if (found)
+        idx = size_type(nbit);
+    return found;
+}
+
+//----------------------------------------------------------------------------
+
+template<typename SV>
+void sparse_vector_scanner<SV>::find_eq_str_prefix(const SV&         sv,
+                                                   const value_type* str,
+                                                   bvector_type&     bv_out)
+{
+    if (!prepare_and_sub_aggregator(sv, str, true))
+    {
+        bv_out.clear(true);
+        return;
+    }
+    agg_.combine_and_sub(bv_out);
+    agg_.reset();
+}
+
+//----------------------------------------------------------------------------
+
+template<typename SV> template<class Val>
+void sparse_vector_scanner<SV>::find_eq(
+                const remap_sparse_vector<Val, SV>&               rsv,
+                typename remap_sparse_vector<Val, SV>::value_type value,
+                bvector_type&                                     bv_out)
+{
+    value_type code;
+    if (!rsv.remap(value, &code))
+    {
+        bv_out.clear(true);
+        return;
+    }
+    find_eq(rsv.get_sv(), code, bv_out);
+}
+
+//----------------------------------------------------------------------------
+
+template<typename SV> template<class Val>
+bool sparse_vector_scanner<SV>::find_eq(
+                const remap_sparse_vector<Val, SV>&               rsv,
+                typename remap_sparse_vector<Val, SV>::value_type value,
+                size_type&                                        idx)
+{
+    value_type code;
+    if (!rsv.remap(value, &code))
+        return false;
+    return find_eq(rsv.get_sv(), code, idx);
+}
+
+//----------------------------------------------------------------------------
+
+template<typename SV> template<class Val>
+void sparse_vector_scanner<SV>::find_in(
+            const remap_sparse_vector<Val, SV>&                      rsv,
+            const typename remap_sparse_vector<Val, SV>::value_type* values,
+            size_type                                                values_size,
+            bvector_type&                                            bv_out)
+{
+    BM_ASSERT(values || !values_size);
+    std::vector<value_type> codes;
+    for (size_type i = 0; i < values_size; ++i)
+    {
+        value_type code;
+        if (rsv.remap(values[i], &code))
+            codes.push_back(code);
+    } // for i
+    if (codes.empty())
+    {
+        bv_out.clear(true);
+        return;
+    }
+    find_in(rsv.get_sv(), &codes[0], size_type(codes.size()), bv_out);
+}
+
+//----------------------------------------------------------------------------
+
+template<typename SV> template<class Val>
+void sparse_vector_scanner<SV>::find_cmp_remap(
+                const remap_sparse_vector<Val, SV>&               rsv,
+                typename remap_sparse_vector<Val, SV>::value_type from,
+                typename remap_sparse_vector<Val, SV>::value_type to,
+                int                                               cmp,
+                bvector_type&                                     bv_out)
+{
+    const value_type dict_size = value_type(rsv.dictionary_size());
+    value_type c_from, c_to;
+    switch (cmp)
+    {
+    case cmp_lt: // codes below the first value >= from
+    case cmp_le:
+        c_to = (cmp == cmp_lt) ? rsv.lower_code(from) : rsv.upper_code(from);
+        if (!c_to)
+            break;
+        find_cmp(rsv.get_sv(), value_type(c_to - 1), value_type(c_to - 1),
+                 cmp_le, bv_out);
+        return;
+    case cmp_gt:
+    case cmp_ge:
+        c_from = (cmp == cmp_gt) ? rsv.upper_code(from) : rsv.lower_code(from);
+        if (c_from == dict_size)
+            break;
+        find_cmp(rsv.get_sv(), c_from, c_from, cmp_ge, bv_out);
+        return;
+    case cmp_range:
+        c_from = rsv.lower_code(from);
+        c_to = rsv.upper_code(to);
+        if (c_from >= c_to)
+            break;
+        find_cmp(rsv.get_sv(), c_from, value_type(c_to - 1), cmp_range, bv_out);
+        return;
+    default:
+        BM_ASSERT(0);
+    } // switch
+    bv_out.clear(true); // no codes in the range
+}
+
+//----------------------------------------------------------------------------
+
+template<typename SV> template<class Val>
+void sparse_vector_scanner<SV>::find_eq(
+                const for_sparse_vector<Val, SV>&               fsv,
+                typename for_sparse_vector<Val, SV>::value_type value,
+                bvector_type&                                   bv_out)
+{
+    if (fsv.empty())
+    {
+        bv_out.clear(true);
+        return;
+    }
+    if (fsv.get_bases().size() == 1) // one base: AND-SUB search
+    {
+        typedef for_sparse_vector<Val, SV> fsv_type;
+        value_type base = fsv.get_bases()[0];
+        if (value < base ||
+            !prepare_and_sub_aggregator(fsv.get_sv(),
+                typename fsv_type::code_type(fsv_type::ordered_code(value) -
+                                             fsv_type::ordered_code(base))))
+        {
+            bv_out.clear(true);
+            return;
+        }
+        agg_.combine_and_sub(bv_out);
+        agg_.reset();
+        return;
+    }
+    find_cmp_for(fsv, value, value, cmp_range, bv_out);
+}
+
+//----------------------------------------------------------------------------
+
+template<typename SV> template<class Val>
+bool sparse_vector_scanner<SV>::find_eq(
+                const for_sparse_vector<Val, SV>&               fsv,
+                typename for_sparse_vector<Val, SV>::value_type value,
+                size_type&                                      idx)
+{
+    if (fsv.empty())
+        return false;
+    if (fsv.get_bases().size() == 1)
+    {
+        typedef for_sparse_vector<Val, SV> fsv_type;
+        value_type base = fsv.get_bases()[0];
+        if (value < base ||
+            !prepare_and_sub_aggregator(fsv.get_sv(),
+                typename fsv_type::code_type(fsv_type::ordered_code(value) -
+                                             fsv_type::ordered_code(base))))
+            return false;
+        bm::id_t nbit;
+        bool found = agg_.find_first_and_sub(nbit);
+        agg_.reset();
+        if (found)
+            idx = size_type(nbit);
+        return found;
+    }
+    find_cmp_for(fsv, value, value, cmp_range, bv_tmp_);
+    bm::id_t nbit;
+    bool found = bv_tmp_.find(0, nbit);
+    if (found)
+        idx = size_type(nbit);
+    return found;
+}
+
+//----------------------------------------------------------------------------
+
+template<typename SV> template<class Val>
+void sparse_vector_scanner<SV>::find_cmp_for(
+                const for_sparse_vector<Val, SV>&               fsv,
+                typename for_sparse_vector<Val, SV>::value_type from,
+                typename for_sparse_vector<Val, SV>::value_type to,
+                int                                             cmp,
+                bvector_type&                                   bv_out)
+{
+    if (fsv.empty())
+    {
+        bv_out.clear(true);
+        return;
+    }
+    typedef for_sparse_vector<Val, SV> fsv_type;
+    typedef typename fsv_type::code_type code_type;
+    const typename fsv_type::base_vector_type& bases = fsv.get_bases();
+    
+    // codes are (value - base) in unsigned math: the scan compares
+    // ordered codes, so signed values never overflow
+    std::vector<code_type> code_bases(bases.size());
+    for (size_t i = 0; i < bases.size(); ++i)
+        code_bases[i] = fsv_type::ordered_code(bases[i]);
+    find_cmp(fsv.get_sv(),
+             fsv_type::ordered_code(from), fsv_type::ordered_code(to),
+             cmp, bv_out, &code_bases[0], unsigned(code_bases.size()));
+}
+
+//----------------------------------------------------------------------------
+
+template<typename SV>
+void sparse_vector_scanner<SV>::find_in(const SV&         sv,
+                                        const value_type* values,
+                                        size_type         values_size,
+                                        bvector_type&     bv_out)
+{
+    BM_ASSERT(values || !values_size);
+    bv_out.clear(true);
+    for (size_type i = 0; i < values_size; ++i)
+    {
+        find_eq(sv, values[i], bv_tmp_);
+        bv_out.bit_or(bv_tmp_);
+    } // for i
+}
+
+
+//----------------------------------------------------------------------------
+
+template<typename SV>
+const bm::word_t* 
+sparse_vector_scanner<SV>::get_bit_block(const bvector_type* bv, unsigned nb,
+                                         bm::word_t* tb)
+{
+    return bm::get_bit_block_as_bitset(bv, nb, tb);
+}
+
+//----------------------------------------------------------------------------
+
+template<typename SV> template<class SVC>
+void sparse_vector_scanner<SV>::compare_block(const SVC& sv, unsigned nb,
+                                              typename SVC::value_type value,
+                                              bm::word_t* BMRESTRICT lt,
+                                              bm::word_t* BMRESTRICT eq,
+                                              bm::word_t* BMRESTRICT tb)
+{
+    typedef typename SVC::value_traits svc_value_traits;
+    compare_plains(sv, nb, svc_value_traits::encode(value), lt, eq, tb);
+    if (!svc_value_traits::is_signed)
+        return;
+    
+    // zig-zag order: negative values (plain 0) are LT any value >= 0,
+    // among negative values greater encoded value is LT
+    const bm::word_t* sign_blk = get_bit_block(sv.plain(0), nb, tb);
+    if (!sign_blk)
+        return;
+    const bm::wordop_t* s_w = (const bm::wordop_t*) sign_blk;
+    bm::wordop_t* lt_w = (bm::wordop_t*) lt;
+    const bm::wordop_t* eq_w = (const bm::wordop_t*) eq;
+    unsigned k;
+    if (svc_value_traits::encode(value) & 1u) // negative value
+    {
+        for (k = 0; k < bm::set_block_size_op; ++k)
+            lt_w[k] = s_w[k] & ~(lt_w[k] | eq_w[k]);
+    }
+    else
+    {
+        for (k = 0; k < bm::set_block_size_op; ++k)
+            lt_w[k] |= s_w[k];
+    }
+}
+
+//----------------------------------------------------------------------------
+
+template<typename SV> template<class SVC>
+void sparse_vector_scanner<SV>::compare_plains(const SVC& sv, unsigned nb,
+                                        typename SVC::unsigned_value_type value,
+                                               bm::word_t* BMRESTRICT lt,
+                                               bm::word_t* BMRESTRICT eq,
+                                               bm::word_t* BMRESTRICT tb)
+{
+    bm::bit_block_set(lt, 0);
+    
+    bm::wordop_t* lt_w = (bm::wordop_t*) lt;
+    bm::wordop_t* eq_w = (bm::wordop_t*) eq;
+    for (unsigned i = sv.plains(); i-- > 0; )
+    {
+        const bm::word_t* blk = get_bit_block(sv.plain(i), nb, tb);
+        const bm::wordop_t* b_w = (const bm::wordop_t*) blk;
+        bm::wordop_t acc = 0;
+        if ((value >> i) & 1)
+        {
+            if (!blk) // all EQ candidates have 0 here: they are all LT
+            {
+                bm::bit_block_or(lt, eq);
+                bm::bit_block_set(eq, 0);
+                return;
+            }
+            if (IS_FULL_BLOCK(blk))
+                continue;
+            for (unsigned k = 0; k < bm::set_block_size_op; ++k)
+            {
+                lt_w[k] |= eq_w[k] & ~b_w[k];
+                eq_w[k] &= b_w[k];
+                acc |= eq_w[k];
+            }
+        }
+        else
+        {
+            if (!blk)
+                continue;
+            if (IS_FULL_BLOCK(blk)) // all EQ candidates are GT
+            {
+                bm::bit_block_set(eq, 0);
+                return;
+            }
+            for (unsigned k = 0; k < bm::set_block_size_op; ++k)
+            {
+                eq_w[k] &= ~b_w[k];
+                acc |= eq_w[k];
+            }
+        }
+        if (!acc) // no more EQ candidates, LT is final
+            return;
+    } // for i
+}
+
+//----------------------------------------------------------------------------
+
+template<typename SV> template<typename CT>
+int sparse_vector_scanner<SV>::rebase_cmp(CT base, int cmp, CT& from, CT& to)
+{
+    // all stored values of the block are >= base
+    switch (cmp)
+    {
+    case cmp_lt:
+        if (from <= base)
+            return -1;
+        break;
+    case cmp_le:
+        if (from < base)
+            return -1;
+        break;
+    case cmp_gt:
+        if (from < base)
+            return 1;
+        break;
+    case cmp_ge:
+        if (from <= base)
+            return 1;
+        break;
+    case cmp_range:
+        if (to < base)
+            return -1;
+        to = CT(to - base);
+        from = (from < base) ? CT(0) : CT(from - base);
+        return 0;
+    default:
+        BM_ASSERT(0);
+    } // switch
+    from = CT(from - base);
+    return 0;
+}
+
+//----------------------------------------------------------------------------
+
+template<typename SV> template<class SVC>
+void sparse_vector_scanner<SV>::find_cmp(
+                                const SVC&                      sv,
+                                typename SVC::value_type        from,
+                                typename SVC::value_type        to,
+                                int                             cmp,
+                                bvector_type&                   bv_out,
+                                const typename SVC::value_type* block_base,
+                                unsigned                        base_size)
+{
+    typedef typename SVC::value_type svc_value_type;
+    bv_out.clear(true);
+    if (sv.empty())
+        return;
+    
+    const bvector_type* bv_nn = sv.get_null_bvector();
+    if (!bv_nn) // NOT NULL-able vector: all elements in [0, size)
+    {
+        bv_range_.clear(true);
+        bv_range_.set_range(0, sv.size()-1);
+        bv_nn = &bv_range_;
+    }
+    const blocks_manager_type& bman_nn = bv_nn->get_blocks_manager();
+    if (!bman_nn.is_init())
+        return;
+    
+    if (bv_nn->size() > bv_out.size())
+        bv_out.resize(bv_nn->size());
+    blocks_manager_type& bman_target = bv_out.get_blocks_manager();
+    unsigned top_size = bman_nn.top_block_size();
+    bman_target.reserve_top_blocks(top_size);
+    
+    // block sized working set: stays in CPU cache
+    BM_DECLARE_TEMP_BLOCK(tb_nn)
+    BM_DECLARE_TEMP_BLOCK(tb_lt)
+    BM_DECLARE_TEMP_BLOCK(tb_eq)
+    BM_DECLARE_TEMP_BLOCK(tb_lt2)
+    BM_DECLARE_TEMP_BLOCK(tb_eq2)
+    BM_DECLARE_TEMP_BLOCK(tb_plain)
+    
+    bm::wordop_t* nn_w  = (bm::wordop_t*) tb_nn;
+    bm::wordop_t* lt_w  = (bm::wordop_t*) tb_lt;
+    bm::wordop_t* eq_w  = (bm::wordop_t*) tb_eq;
+    bm::wordop_t* lt2_w = (bm::wordop_t*) tb_lt2;
+    bm::wordop_t* eq2_w = (bm::wordop_t*) tb_eq2;
+    
+    for (unsigned i = 0; i < top_size; ++i)
+    {
+        if (!bman_nn.top_blocks_root()[i])
+            continue;
+        unsigned nb = i << bm::set_array_shift;
+        for (unsigned j = 0; j < bm::set_array_size; ++j, ++nb)
+        {
+            const bm::word_t* nn_blk = get_bit_block(bv_nn, nb, tb_nn);
+            if (!nn_blk) // no values in the block
+                continue;
+            if (nn_blk != tb_nn)
+                bm::bit_block_copy(tb_nn, nn_blk);
+            
+            svc_value_type b_from = from, b_to = to;
+            if (block_base)
+            {
+                BM_ASSERT(base_size == 1 || nb < base_size);
+                svc_value_type base = block_base[(base_size == 1) ? 0 : nb];
+                int r = rebase_cmp(base, cmp, b_from, b_to);
+                if (r < 0)
+                    continue;
+                if (r > 0) // whole NOT NULL block matches
+                {
+                    bm::bit_block_copy(tb_lt, tb_nn);
+                    store_result_block(bman_target, nb, tb_lt);
+                    continue;
+                }
+            }
+            
+            bm::bit_block_copy(tb_eq, tb_nn);
+            compare_block(sv, nb, b_from, tb_lt, tb_eq, tb_plain);
+            
+            // result goes to tb_lt
+            unsigned k;
+            switch (cmp)
+            {
+            case cmp_lt:
+                break;
+            case cmp_le:
+                bm::bit_block_or(tb_lt, tb_eq);
+                break;
+            case cmp_gt:
+                for (k = 0; k < bm::set_block_size_op; ++k)
+                    lt_w[k] = nn_w[k] & ~(lt_w[k] | eq_w[k]);
+                break;
+            case cmp_ge:
+                for (k = 0; k < bm::set_block_size_op; ++k)
+                    lt_w[k] = nn_w[k] & ~lt_w[k];
+                break;
+            case cmp_range: // GE(from) AND LE(to)
+                bm::bit_block_copy(tb_eq2, tb_nn);
+                compare_block(sv, nb, b_to, tb_lt2, tb_eq2, tb_plain);
+                for (k = 0; k < bm::set_block_size_op; ++k)
+                    lt_w[k] = nn_w[k] & ~lt_w[k] & (lt2_w[k] | eq2_w[k]);
+                break;
+            default:
+                BM_ASSERT(0);
+            } // switch
+            store_result_block(bman_target, nb, tb_lt);
+        } // for j
+    } // for i
+    bv_out.forget_count();
+}
+
+//----------------------------------------------------------------------------
+
+template<typename SV>
+void sparse_vector_scanner<SV>::store_result_block(blocks_manager_type& bman,
+                                                   unsigned nb,
+                                                   const bm::word_t* tb)
+{
+    if (bm::bit_is_all_zero((bm::wordop_t*)tb,
+                            (bm::wordop_t*)(tb + bm::set_block_size)))
+        return;
+    if (bm::is_bits_one((bm::wordop_t*)tb,
+                        (bm::wordop_t*)(tb + bm::set_block_size)))
+    {
+        bman.set_block_all_set(nb);
+        return;
+    }
+    bm::word_t* blk = bman.get_allocator().alloc_bit_block();
+    bm::bit_block_copy(blk, tb);
+    bm::word_t* old_blk = bman.set_block(nb, blk);
+    BM_ASSERT(!old_blk); (void) old_blk;
+}
+
+
+/*!
+    \brief GROUP BY aggregation (COUNT, SUM) over a sparse_vector value column
+ 
+    Rows selected by a filter bit-vector are split into groups by a key
+    column and the values column is aggregated per group.
+    Key column is either a sparse_vector<> (group per distinct key value)
+    or an id-map of per-key bit-vectors (std::map<key, bvector<> > or alike).
+ 
+    Evaluation goes block at a time: for every block of the filter
+    group blocks are produced by bitwise intersection (id-map) or by
+    splitting the filter block over the bit plains of the key vector,
+    group SUM is assembled from population counts of
+    (group block AND value plain block) weighted by the plain bit.
+    Blocks of the value plains are reused by all groups while they are
+    still in CPU cache.
+ 
+    Rows with NULL keys are not grouped, NULL values add nothing to the
+    group SUM but counted as group rows.
+    For signed (zig-zag encoded) value columns group SUM is two's complement.
+ 
+    \ingroup svalgo
+*/
+template<typename SV>
+class sparse_vector_group_by
+{
+public:
+    typedef typename SV::bvector_type             bvector_type;
+    typedef typename SV::value_type               value_type;
+    typedef bm::sv_value_traits<value_type>       value_traits;
+    typedef typename value_traits::unsigned_type  unsigned_value_type;
+    typedef typename bvector_type::allocator_type allocator_type;
+    typedef typename bvector_type::blocks_manager_type blocks_manager_type;
+    
+    /// Aggregates of one group
+    struct group_stat
+    {
+        bm::id_t    count; ///< number of rows in the group
+        bm::id64_t  sum;   ///< SUM of values in the group
+        
+        group_stat() : count(0), sum(0) {}
+    };
+    
+    enum plains_size
+    {
+        value_bits = sizeof(value_type) * 8
+    };
+    
+public:
+    sparse_vector_group_by();
+    ~sparse_vector_group_by();
+    
+    /**
+        \brief GROUP BY over an id-map of per-key bit-vectors
+ 
+        \param key_map - key to bit-vector (rows of the key) map,
+                         iterated as a std::map (first - key, second - bvector)
+        \param bv_filter - rows to aggregate (WHERE clause)
+        \param sv_values - values column
+        \param res - [out] key to group_stat map, aggregates are added to the
+                     existing map entries, empty groups are not reported
+    */
+    template<class KM, class RM>
+    void group_by_map(const KM&           key_map,
+                      const bvector_type& bv_filter,
+                      const SV&           sv_values,
+                      RM&                 res);
+    
+    /**
+        \brief GROUP BY distinct values of a key sparse vector
+ 
+        \param sv_keys - key column
+        \param bv_filter - rows to aggregate (WHERE clause)
+        \param sv_values - values column
+        \param res - [out] key value to group_stat map, aggregates are added
+                     to the existing map entries
+    */
+    template<class RM>
+    void group_by(const SV&           sv_keys,
+                  const bvector_type& bv_filter,
+                  const SV&           sv_values,
+                  RM&                 res);
+    
+protected:
+    /// fetch blocks of the value plains for block nb
+    void load_value_blocks(const SV& sv_values, unsigned nb);
+    
+    /// add block of group rows to the group aggregates
+    void add_block(const bm::word_t* BMRESTRICT blk, group_stat& st);
+    
+    /// SUM of (encoded) values of block rows over value plains >= first
+    /// (cnt - number of rows in the block)
+    bm::id64_t sum_block(const bm::word_t* BMRESTRICT blk, bm::id_t cnt,
+                         unsigned first) const;
+    
+    /// split block of rows over the key plains [0..i) into groups
+    template<class RM>
+    void split_block(const bm::word_t* BMRESTRICT blk,
+                     unsigned i, unsigned_value_type key, RM& res);
+    
+    /// get temp block (allocated on first use)
+    bm::word_t* get_temp_block(bm::word_t** tb_ptr);
+    
+private:
+    sparse_vector_group_by(const sparse_vector_group_by&);
+    sparse_vector_group_by& operator=(const sparse_vector_group_by&);
+    
+protected:
+    allocator_type     alloc_;                ///< temp blocks allocator
+    bm::word_t*        tb_filter_;            ///< filter block (converted)
+    bm::word_t*        tb_group_;             ///< group (filter) block
+    bm::word_t*        tb_neg_;               ///< negative values rows
+    bm::word_t*        tb_key_[value_bits];   ///< key plains (GAP converted)
+    bm::word_t*        tb_split_[value_bits]; ///< split buffer per key plain
+    const bm::word_t*  key_blk_[value_bits];  ///< key plain blocks
+    const bm::word_t*  value_blk_[value_bits];///< value plain blocks
+    bvector_type       bv_range_;             ///< [0, size) range
+};
+
+
+//----------------------------------------------------------------------------
+//
+//----------------------------------------------------------------------------
+
+template<typename SV>
+sparse_vector_group_by<SV>::sparse_vector_group_by()
+{
+    tb_filter_ = alloc_.alloc_bit_block();
+    tb_group_ = alloc_.alloc_bit_block();
+    tb_neg_ = 0;
+    for (unsigned i = 0; i < value_bits; ++i)
+        tb_key_[i] = tb_split_[i] = 0;
+}
+
+//----------------------------------------------------------------------------
+
+template<typename SV>
+sparse_vector_group_by<SV>::~sparse_vector_group_by()
+{
+    alloc_.free_bit_block(tb_filter_);
+    alloc_.free_bit_block(tb_group_);
+    if (tb_neg_)
+        alloc_.free_bit_block(tb_neg_);
+    for (unsigned i = 0; i < value_bits; ++i)
+    {
+        if (tb_key_[i])
+            alloc_.free_bit_block(tb_key_[i]);
+        if (tb_split_[i])
+            alloc_.free_bit_block(tb_split_[i]);
+    }
+}
+
+//----------------------------------------------------------------------------
+
+template<typename SV>
+bm::word_t* sparse_vector_group_by<SV>::get_temp_block(bm::word_t** tb_ptr)
+{
+    if (!*tb_ptr)
+        *tb_ptr = alloc_.alloc_bit_block();
+    return *tb_ptr;
+}
+
+//----------------------------------------------------------------------------
+
+template<typename SV>
+void sparse_vector_group_by<SV>::load_value_blocks(const SV& sv_values,
+                                                   unsigned  nb)
+{
+    unsigned plains = sv_values.plains();
+    for (unsigned i = 0; i < value_bits; ++i)
+    {
+        const bvector_type* bv_plain = (i < plains) ? sv_values.plain(i) : 0;
+        value_blk_[i] = bv_plain ?
+                    bv_plain->get_blocks_manager().get_block_ptr(nb) : 0;
+    }
+}
+
+//----------------------------------------------------------------------------
+
+template<typename SV>
+void sparse_vector_group_by<SV>::add_block(const bm::word_t* BMRESTRICT blk,
+                                           group_stat& st)
+{
+    bm::id_t cnt = bm::bit_block_calc_count(blk, blk + bm::set_block_size);
+    if (!cnt)
+        return;
+    st.count += cnt;
+    if (!value_traits::is_signed)
+    {
+        st.sum += sum_block(blk, cnt, 0);
+        return;
+    }
+    
+    // x = (zz >> 1) for even zz, x = -(zz >> 1) - 1 for odd (negative) zz
+    bm::id64_t sum_all = sum_block(blk, cnt, 1);
+    const bm::word_t* s_blk = value_blk_[0];
+    const bm::word_t* neg = blk;
+    bm::id_t neg_cnt = cnt;
+    if (!s_blk)
+        neg_cnt = 0;
+    else
+    if (!IS_FULL_BLOCK(s_blk))
+    {
+        bm::word_t* tb = get_temp_block(&tb_neg_);
+        if (BM_IS_GAP(s_blk))
+        {
+            bm::bit_block_copy(tb, blk);
+            bm::gap_and_to_bitset(tb, BMGAP_PTR(s_blk));
+        }
+        else
+        {
+            const bm::wordop_t* b_w = (const bm::wordop_t*) blk;
+            const bm::wordop_t* s_w = (const bm::wordop_t*) s_blk;
+            bm::wordop_t* t_w = (bm::wordop_t*) tb;
+            for (unsigned k = 0; k < bm::set_block_size_op; ++k)
+                t_w[k] = b_w[k] & s_w[k];
+        }
+        neg = tb;
+        neg_cnt = bm::bit_block_calc_count(tb, tb + bm::set_block_size);
+    }
+    if (!neg_cnt)
+    {
+        st.sum += sum_all;
+        return;
+    }
+    bm::id64_t sum_neg = sum_block(neg, neg_cnt, 1);
+    st.sum += (sum_all - sum_neg) - sum_neg - neg_cnt;
+}
+
+//----------------------------------------------------------------------------
+
+template<typename SV>
+bm::id64_t
+sparse_vector_group_by<SV>::sum_block(const bm::word_t* BMRESTRICT blk,
+                                      bm::id_t cnt, unsigned first) const
+{
+    bm::id64_t sum = 0;
+    for (unsigned i = first; i < value_bits; ++i)
+    {
+        const bm::word_t* v_blk = value_blk_[i];
+        if (!v_blk)
+            continue;
+        bm::id_t c;
+        if (BM_IS_GAP(v_blk))
+            c = bm::gap_bitset_and_count(blk, BMGAP_PTR(v_blk));
+        else
+        if (IS_FULL_BLOCK(v_blk))
+            c = cnt;
+        else
+            c = bm::bit_block_and_count(blk, blk + bm::set_block_size, v_blk);
+        sum += bm::id64_t(c) << (i - first);
+    } // for i
+    return sum;
+}
+
+//----------------------------------------------------------------------------
+
+template<typename SV> template<class RM>
+void sparse_vector_group_by<SV>::split_block(const bm::word_t* BMRESTRICT blk,
+                                             unsigned            i,
+                                             unsigned_value_type key,
+                                             RM&                 res)
+{
+    while (i)
+    {
+        --i;
+        const bm::word_t* k_blk = key_blk_[i];
+        if (!k_blk) // all rows have 0 in this plain
+            continue;
+        if (IS_FULL_BLOCK(k_blk))
+        {
+            key |= unsigned_value_type(unsigned_value_type(1) << i);
+            continue;
+        }
+        const bm::wordop_t* k_w = (const bm::wordop_t*) k_blk;
+        const bm::wordop_t* b_w = (const bm::wordop_t*) blk;
+        bm::word_t* out = get_temp_block(&tb_split_[i]);
+        bm::wordop_t* o_w = (bm::wordop_t*) out;
+        bm::wordop_t acc = 0;
+        unsigned k;
+        for (k = 0; k < bm::set_block_size_op; ++k)
+        {
+            o_w[k] = b_w[k] & ~k_w[k];
+            acc |= o_w[k];
+        }
+        unsigned_value_type key1 =
+                unsigned_value_type(key | (unsigned_value_type(1) << i));
+        if (!acc) // all rows have 1 in this plain
+        {
+            key = key1;
+            continue;
+        }
+        split_block(out, i, key, res); // 0 branch
+        
+        // 1 branch (split buffer of this plain is free again)
+        acc = 0;
+        for (k = 0; k < bm::set_block_size_op; ++k)
+        {
+            o_w[k] = b_w[k] & k_w[k];
+            acc |= o_w[k];
+        }
+        if (acc)
+            split_block(out, i, key1, res);
+        return;
+    } // while
+    add_block(blk, res[value_traits::decode(key)]);
+}
+
+//----------------------------------------------------------------------------
+
+template<typename SV> template<class KM, class RM>
+void sparse_vector_group_by<SV>::group_by_map(const KM&           key_map,
+                                              const bvector_type& bv_filter,
+                                              const SV&           sv_values,
+                                              RM&                 res)
+{
+    const blocks_manager_type& bman_f = bv_filter.get_blocks_manager();
+    if (!bman_f.is_init() || key_map.empty())
+        return;
+    
+    // group bit-vectors and aggregates in the id-map order
+    std::vector<const bvector_type*> grp_bv;
+    std::vector<group_stat>          grp_stat(key_map.size());
+    grp_bv.reserve(key_map.size());
+    typename KM::const_iterator it;
+    for (it = key_map.begin(); it != key_map.end(); ++it)
+        grp_bv.push_back(&(it->second));
+    
+    size_t grp_size = grp_bv.size();
+    unsigned top_size = bman_f.top_block_size();
+    for (unsigned i = 0; i < top_size; ++i)
+    {
+        if (!bman_f.top_blocks_root()[i])
+            continue;
+        unsigned nb = i << bm::set_array_shift;
+        for (unsigned j = 0; j < bm::set_array_size; ++j, ++nb)
+        {
+            const bm::word_t* f_blk =
+                        bm::get_bit_block_as_bitset(&bv_filter, nb, tb_filter_);
+            if (!f_blk)
+                continue;
+            load_value_blocks(sv_values, nb);
+            
+            const bm::wordop_t* f_w = (const bm::wordop_t*) f_blk;
+            for (size_t g = 0; g < grp_size; ++g)
+            {
+                const bm::word_t* g_blk =
+                    grp_bv[g]->get_blocks_manager().get_block_ptr(nb);
+                if (!g_blk)
+                    continue;
+                if (IS_FULL_BLOCK(g_blk))
+                {
+                    add_block(f_blk, grp_stat[g]);
+                    continue;
+                }
+                if (BM_IS_GAP(g_blk))
+                {
+                    bm::bit_block_copy(tb_group_, f_blk);
+                    bm::gap_and_to_bitset(tb_group_, BMGAP_PTR(g_blk));
+                }
+                else
+                {
+                    const bm::wordop_t* g_w = (const bm::wordop_t*) g_blk;
+                    bm::wordop_t* t_w = (bm::wordop_t*) tb_group_;
+                    for (unsigned k = 0; k < bm::set_block_size_op; ++k)
+                        t_w[k] = f_w[k] & g_w[k];
+                }
+                add_block(tb_group_, grp_stat[g]);
+            } // for g
+        } // for j
+    } // for i
+    
+    size_t g = 0;
+    for (it = key_map.begin(); it != key_map.end(); ++it, ++g)
+    {
+        const group_stat& st = grp_stat[g];
+        if (!st.count)
+            continue;
+        group_stat& st_res = res[it->first];
+        st_res.count += st.count;
+        st_res.sum += st.sum;
+    } // for it
+}
+
+//----------------------------------------------------------------------------
+
+template<typename SV> template<class RM>
+void sparse_vector_group_by<SV>::group_by(const SV&           sv_keys,
+                                          const bvector_type& bv_filter,
+                                          const SV&           sv_values,
+                                          RM&                 res)
+{
+    const blocks_manager_type& bman_f = bv_filter.get_blocks_manager();
+    if (!bman_f.is_init() || sv_keys.empty())
+        return;
+    
+    const bvector_type* bv_nn = sv_keys.get_null_bvector();
+    if (!bv_nn) // NOT NULL-able keys: all rows in [0, size)
+    {
+        bv_range_.clear(true);
+        bv_range_.set_range(0, sv_keys.size()-1);
+        bv_nn = &bv_range_;
+    }
+    unsigned key_plains = sv_keys.plains();
+    if (key_plains > value_bits)
+        key_plains = value_bits;
+    
+    unsigned top_size = bman_f.top_block_size();
+    for (unsigned i = 0; i < top_size; ++i)
+    {
+        if (!bman_f.top_blocks_root()[i])
+            continue;
+        unsigned nb = i << bm::set_array_shift;
+        for (unsigned j = 0; j < bm::set_array_size; ++j, ++nb)
+        {
+            const bm::word_t* f_blk =
+                        bm::get_bit_block_as_bitset(&bv_filter, nb, tb_filter_);
+            if (!f_blk)
+                continue;
+            const bm::word_t* nn_blk =
+                        bm::get_bit_block_as_bitset(bv_nn, nb, tb_group_);
+            if (!nn_blk)
+                continue;
+            
+            // group rows = filter AND NOT NULL keys
+            const bm::wordop_t* f_w = (const bm::wordop_t*) f_blk;
+            const bm::wordop_t* nn_w = (const bm::wordop_t*) nn_blk;
+            bm::wordop_t* t_w = (bm::wordop_t*) tb_group_;
+            bm::wordop_t acc = 0;
+            for (unsigned k = 0; k < bm::set_block_size_op; ++k)
+            {
+                t_w[k] = f_w[k] & nn_w[k];
+                acc |= t_w[k];
+            }
+            if (!acc)
+                continue;
+            
+            for (unsigned p = 0; p < key_plains; ++p)
+            {
+                const bvector_type* bv_plain = sv_keys.plain(p);
+                const bm::word_t* k_blk = bv_plain ?
+                    bv_plain->get_blocks_manager().get_block_ptr(nb) : 0;
+                if (k_blk && BM_IS_GAP(k_blk))
+                {
+                    bm::word_t* tb = get_temp_block(&tb_key_[p]);
+                    bm::gap_convert_to_bitset(tb, BMGAP_PTR(k_blk));
+                    k_blk = tb;
+                }
+                key_blk_[p] = k_blk;
+            } // for p
+            load_value_blocks(sv_values, nb);
+            
+            split_block(tb_group_, key_plains, unsigned_value_type(0), res);
+        } // for j
+    } // for i
+}
 
 
 } // namespace bm
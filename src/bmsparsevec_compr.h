@@ -0,0 +1,2237 @@
+#ifndef BMSPARSEVEC_COMPR_H__INCLUDED__
+#define BMSPARSEVEC_COMPR_H__INCLUDED__
+/*
+Copyright(c) 2002-2017 Anatoliy Kuznetsov(anatoliy_kuznetsov at yahoo.com)
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+For more information please visit:  http://bitmagic.io
+*/
+
+#include <memory.h>
+#include <stdexcept>
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <limits>
+
+#include "bmsparsevec.h"
+#include "bmsparsevec_serial.h"
+#include "bmdef.h"
+
+namespace bm
+{
+
+
+/*!
+   \brief Rank-Select compressed sparse vector
+
+   Container uses Rank-Select method of compression, where
+   all NULL columns gets dropped, effective address of columns is computed
+   using address bit-vector (NOT NULL plain) and its rank-select index.
+
+   Values of NOT NULL rows are stored densely in the underlying
+   sparse_vector<> (value plains are addressed by the rank of the row),
+   NOT NULL plain of the underlying vector keeps the row ids, so vectors
+   with a lot of NULLs do not spend space and scan time on them.
+
+   Container is append-only: rows are added by push_back() in the
+   ascending order of row ids, or loaded from sparse_vector<> in one go.
+   Modification invalidates the rank-select index, sync() must be called
+   before the read access.
+
+   \ingroup svector
+*/
+template<class Val, class SV>
+class rsc_sparse_vector
+{
+public:
+    typedef Val                                      value_type;
+    typedef bm::id_t                                 size_type;
+    typedef SV                                       sparse_vector_type;
+    typedef typename SV::const_reference             const_reference;
+    typedef typename SV::value_traits                value_traits;
+    typedef typename SV::bvector_type                bvector_type;
+    typedef bvector_type*                            bvector_type_ptr;
+    typedef const bvector_type*                      bvector_type_const_ptr;
+    typedef typename bvector_type::allocator_type    allocator_type;
+    typedef typename bvector_type::allocation_policy allocation_policy_type;
+    typedef typename bvector_type::rs_index_type     rs_index_type;
+    typedef typename SV::statistics                  statistics;
+
+    enum bit_plains
+    {
+        sv_plains = SV::sv_plains,
+        sv_value_plains = SV::sv_value_plains
+    };
+
+public:
+    /*!
+        \brief Sparse vector constructor
+        \param ap - allocation strategy for underlying bit-vectors
+        \param bv_max_size - maximum possible size of underlying bit-vectors
+        \param alloc - allocator for bit-vectors
+
+        \sa sparse_vector
+    */
+    rsc_sparse_vector(allocation_policy_type ap = allocation_policy_type(),
+                      size_type bv_max_size = bm::id_max,
+                      const allocator_type&   alloc  = allocator_type());
+
+    /*! copy-ctor */
+    rsc_sparse_vector(const rsc_sparse_vector<Val, SV>& csv);
+
+    /*! copy assignmment operator */
+    rsc_sparse_vector<Val,SV>& operator = (const rsc_sparse_vector<Val, SV>& csv)
+    {
+        if (this != &csv)
+        {
+            sv_ = csv.sv_;
+            nn_count_ = csv.nn_count_;
+            in_sync_ = csv.in_sync_;
+            if (in_sync_)
+                rs_idx_.copy_from(csv.rs_idx_);
+        }
+        return *this;
+    }
+
+    /*! \brief content exchange */
+    void swap(rsc_sparse_vector<Val, SV>& csv) BMNOEXEPT;
+
+    /*! \brief return size of the vector (number of rows, NULLs included)
+    */
+    size_type size() const { return sv_.size(); }
+
+    /*! \brief return true if vector is empty
+    */
+    bool empty() const { return sv_.empty(); }
+
+    /*! \brief return number of NOT NULL rows (stored values)
+    */
+    size_type count_not_null() const { return nn_count_; }
+
+    /*!
+        \brief set specified element at the end of the vector
+
+        \param idx - element index (row id), must be greater than
+                     the index of the last element
+        \param v   - element value
+    */
+    void push_back(size_type idx, value_type v);
+
+    /*!
+        \brief add NULL (no value) rows at the end of the vector
+        \param count - number of NULLs to add
+    */
+    void push_back_null(size_type count = 1) { sv_.resize(sv_.size() + count); }
+
+    /*!
+        \brief get specified element without bounds checking
+        (rank-select index must be in sync)
+        \param idx - element index
+        \return value of the element (0 for NULL)
+    */
+    value_type get(size_type idx) const;
+
+    /*!
+        \brief access specified element with bounds checking
+        \param idx - element index
+        \return value of the element
+    */
+    value_type at(size_type idx) const;
+
+    /*!
+        \brief get specified element without bounds checking
+    */
+    value_type operator[](size_type idx) const { return this->get(idx); }
+
+    /** \brief test if specified element is NULL
+        \param idx - element index
+        \return true if it is NULL
+    */
+    bool is_null(size_type idx) const;
+
+    /*!
+        \brief Get bit-vector of assigned (NOT NULL) rows
+    */
+    const bvector_type* get_null_bvector() const
+        { return sv_.get_null_bvector(); }
+
+    /*!
+        \brief Resolve logical row id to the address in the dense vector
+        \param idx - row id
+        \param idx_to - [out] address of the value in the dense vector
+        \return true if row is NOT NULL
+    */
+    bool resolve(size_type idx, size_type* idx_to) const;
+
+    /*!
+        \brief Bulk export of elements to a C-style array
+
+        Values of NOT NULL rows of the range are decoded from the
+        dense vector in one go and then get spread to the row positions.
+
+        \param arr  - dest array (NULLs are exported as 0)
+        \param idx_from - index in the vector to export from
+        \param size - decoding size (array allocation should match)
+
+        \return number of exported elements
+    */
+    size_type decode(value_type* arr,
+                     size_type   idx_from,
+                     size_type   size) const;
+
+    /*!
+        \brief check if another vector has the same content
+        \return true, if it is the same
+    */
+    bool equal(const rsc_sparse_vector<Val, SV>& csv) const;
+
+    /*!
+        \brief Load compressed vector from a sparse vector
+        (NULL rows of NULL-able source are dropped)
+        \param sv_src - source sparse vector
+    */
+    void load_from(const sparse_vector_type& sv_src);
+
+    /*!
+        \brief Export compressed vector to a NULL-able sparse vector
+        \param sv - target sparse vector
+    */
+    void load_to(sparse_vector_type& sv) const;
+
+    /*! \brief resize to zero, free memory
+    */
+    void clear() BMNOEXEPT;
+
+    /*!
+        \brief run memory optimization for all vector plains
+        \param temp_block - pre-allocated memory block to avoid unnecessary re-allocs
+        \param opt_mode - requested compression depth
+        \param stat - memory allocation statistics after optimization
+    */
+    void optimize(bm::word_t* temp_block = 0,
+                  typename bvector_type::optmode opt_mode = bvector_type::opt_compress,
+                  statistics* stat = 0);
+
+    /*!
+       @brief Calculates memory statistics.
+       @param st - pointer on statistics structure to be filled in.
+    */
+    void calc_stat(statistics* st) const;
+
+    /*!
+        \brief Re-calculate rank-select index of the NOT NULL vector
+        \param force - force recalculation even if it is already in sync
+    */
+    void sync(bool force = false);
+
+    /*!
+        \brief returns true if rank-select index is in sync with the vector
+    */
+    bool in_sync() const { return in_sync_; }
+
+    /*!
+        \brief Get const reference to the underlying (dense) sparse vector
+    */
+    const sparse_vector_type& get_sv() const { return sv_; }
+
+    /*!
+        \brief Get writable reference to the underlying sparse vector
+
+        Access to underlying vector assumes modification and
+        loss of rank-select index.
+        Need to call sync() at the end of transaction.
+        \internal
+    */
+    sparse_vector_type& get_sv() { in_sync_ = false; return sv_; }
+
+protected:
+    void throw_range_error(const char* err_msg) const;
+
+private:
+    sparse_vector_type   sv_;        ///< dense vector + NOT NULL plain
+    size_type            nn_count_;  ///< number of NOT NULL rows
+    rs_index_type        rs_idx_;    ///< rank-select index of NOT NULL plain
+    bool                 in_sync_;   ///< flag if rs index is in-sync
+};
+
+
+/*!
+    \brief Serialize RSC compressed sparse vector into a memory buffer
+    (same format as sparse_vector<>, NOT NULL plain keeps row ids)
+
+    \ingroup svserial
+    \sa sparse_vector_serialize
+*/
+template<class Val, class SV>
+void sparse_vector_serialize(
+                const rsc_sparse_vector<Val, SV>& csv,
+                sparse_vector_serial_layout<SV>&  sv_layout,
+                bm::word_t*                       temp_block = 0)
+{
+    bm::sparse_vector_serialize(csv.get_sv(), sv_layout, temp_block);
+}
+
+/*!
+    \brief Deserialize RSC compressed sparse vector
+    (rank-select index is rebuilt)
+
+    \return error non-zero codes means failure
+    \ingroup svserial
+    \sa sparse_vector_deserialize
+*/
+template<class Val, class SV>
+int sparse_vector_deserialize(rsc_sparse_vector<Val, SV>& csv,
+                              const unsigned char*        buf,
+                              bm::word_t*                 temp_block = 0)
+{
+    int res = bm::sparse_vector_deserialize(csv.get_sv(), buf, temp_block);
+    if (res == 0 && !csv.get_null_bvector())
+        res = -3; // not a NULL-able vector
+    csv.sync(true);
+    return res;
+}
+
+
+/*!
+    \brief Serialize sparse vector leaving room for a header in front
+    (compressed containers put their dictionary or bases there)
+
+    \param sv - sparse vector to serialize
+    \param sv_layout - buffer structure to keep the result
+    \param h_size - size of the header
+    \param temp_block - temporary buffer
+    \return pointer on the header
+    \internal
+*/
+template<class SV>
+unsigned char* sparse_vector_serialize_prefixed(
+                const SV&                        sv,
+                sparse_vector_serial_layout<SV>& sv_layout,
+                size_t                           h_size,
+                bm::word_t*                      temp_block)
+{
+    sparse_vector_serial_layout<SV> sv_lay;
+    bm::sparse_vector_serialize(sv, sv_lay, temp_block);
+
+    unsigned char* buf = sv_layout.reserve(h_size + sv_lay.size());
+    ::memcpy(buf + h_size, sv_lay.buf(), sv_lay.size());
+    sv_layout.resize(h_size + sv_lay.size());
+
+    // plain pointers follow the copy
+    for (unsigned i = 0; i < sv.stored_plains(); ++i)
+    {
+        const unsigned char* p = sv_lay.get_plain(i);
+        if (p)
+            sv_layout.set_plain(i, buf + h_size + (p - sv_lay.buf()),
+                                sv_lay.get_plain_size(i));
+        else
+            sv_layout.set_plain(i, 0, 0);
+    } // for i
+    return buf;
+}
+
+/// Encode value of an integer type (1, 2, 4 or 8 bytes)
+/// \internal
+template<class Val>
+void sv_encode_value(bm::encoder& enc, Val v)
+{
+    switch (sizeof(Val))
+    {
+    case 1: enc.put_8((unsigned char)v); break;
+    case 2: enc.put_16((bm::short_t)v); break;
+    case 4: enc.put_32((bm::word_t)v); break;
+    default: enc.put_64((bm::id64_t)v);
+    }
+}
+
+/// Decode value of an integer type (1, 2, 4 or 8 bytes)
+/// \internal
+template<class Val>
+void sv_decode_value(bm::decoder& dec, Val& v)
+{
+    switch (sizeof(Val))
+    {
+    case 1: v = Val(dec.get_8()); break;
+    case 2: v = Val(dec.get_16()); break;
+    case 4: v = Val(dec.get_32()); break;
+    default: v = Val(dec.get_64());
+    }
+}
+
+
+/*!
+   \brief Sparse vector with order-preserving remapping of values
+   (dictionary compression)
+
+   Container keeps a sorted dictionary of the distinct values and stores
+   value codes (positions in the dictionary) in the bit-plains of
+   the underlying sparse_vector<>. Number of materialized plains depends
+   on the number of distinct values, not on the magnitude of values:
+   300 distinct ids in the 0x7F000000 range take 9 plains instead of 31.
+
+   Codes follow the order of values, so comparison and range searches
+   translate to code ranges (see sparse_vector_scanner<> overloads).
+   New values extend the dictionary, codes of existing rows get
+   renumbered (slow path), so bulk load via import() or load_from()
+   is preferred.
+
+   \ingroup svector
+*/
+template<class Val, class SV>
+class remap_sparse_vector
+{
+public:
+    typedef Val                                      value_type;
+    typedef bm::id_t                                 size_type;
+    typedef SV                                       sparse_vector_type;
+    typedef typename SV::value_type                  code_type;
+    typedef typename SV::bvector_type                bvector_type;
+    typedef bvector_type*                            bvector_type_ptr;
+    typedef const bvector_type*                      bvector_type_const_ptr;
+    typedef typename bvector_type::allocator_type    allocator_type;
+    typedef typename bvector_type::allocation_policy allocation_policy_type;
+    typedef typename SV::statistics                  statistics;
+    typedef std::vector<value_type>                  dictionary_type;
+
+    enum bit_plains
+    {
+        sv_plains = SV::sv_plains,
+        sv_value_plains = SV::sv_value_plains
+    };
+
+public:
+    /*!
+        \brief Sparse vector constructor
+        \param null_able - defines if vector supports NULL values flag
+        \param ap - allocation strategy for underlying bit-vectors
+        \param bv_max_size - maximum possible size of underlying bit-vectors
+        \param alloc - allocator for bit-vectors
+
+        \sa sparse_vector
+    */
+    remap_sparse_vector(bm::null_support null_able = bm::no_null,
+                        allocation_policy_type ap = allocation_policy_type(),
+                        size_type bv_max_size = bm::id_max,
+                        const allocator_type&   alloc  = allocator_type());
+
+    /*! \brief content exchange */
+    void swap(remap_sparse_vector<Val, SV>& rsv) BMNOEXEPT;
+
+    /*! \brief return size of the vector
+    */
+    size_type size() const { return sv_.size(); }
+
+    /*! \brief return true if vector is empty
+    */
+    bool empty() const { return sv_.empty(); }
+
+    /*! \brief check if container supports NULL(unassigned) values
+    */
+    bool is_nullable() const { return sv_.is_nullable(); }
+
+    /*!
+        \brief Get bit-vector of assigned values or NULL
+    */
+    const bvector_type* get_null_bvector() const
+        { return sv_.get_null_bvector(); }
+
+    /** \brief test if specified element is NULL
+        \param idx - element index
+    */
+    bool is_null(size_type idx) const { return sv_.is_null(idx); }
+
+    /*!
+        \brief get specified element without bounds checking
+        \param idx - element index
+        \return value of the element (0 for NULL)
+    */
+    value_type get(size_type idx) const;
+
+    /*!
+        \brief access specified element with bounds checking
+        \param idx - element index
+        \return value of the element
+    */
+    value_type at(size_type idx) const;
+
+    /*!
+        \brief get specified element without bounds checking
+    */
+    value_type operator[](size_type idx) const { return this->get(idx); }
+
+    /*!
+        \brief set value of an existing element
+        \param idx - element index (must be less than size())
+        \param v   - element value
+    */
+    void set(size_type idx, value_type v);
+
+    /*!
+        \brief push value back into vector
+        \param v   - element value
+    */
+    void push_back(value_type v);
+
+    /*!
+        \brief Import list of elements from a C-style array
+
+        All new values of the array are added to the dictionary first
+        (one renumbering of existing codes at most), then codes are
+        imported into the plains.
+
+        \param arr  - source array
+        \param size - source size
+        \param offset - target index (must not be greater than size())
+    */
+    void import(const value_type* arr, size_type size, size_type offset = 0);
+
+    /*!
+        \brief Bulk export of elements to a C-style array
+        \param arr  - dest array (NULLs are exported as 0)
+        \param idx_from - index in the vector to export from
+        \param size - decoding size (array allocation should match)
+        \return number of exported elements
+    */
+    size_type decode(value_type* arr,
+                     size_type   idx_from,
+                     size_type   size) const;
+
+    /*!
+        \brief Load remapped vector from a sparse vector
+        \param sv_src - source sparse vector
+    */
+    void load_from(const sparse_vector_type& sv_src);
+
+    /*!
+        \brief Export values to a sparse vector
+        \param sv - target sparse vector
+    */
+    void load_to(sparse_vector_type& sv) const;
+
+    /*!
+        \brief check if another vector has the same content
+        \return true, if it is the same
+    */
+    bool equal(const remap_sparse_vector<Val, SV>& rsv) const;
+
+    /*! \brief resize to zero, free memory
+    */
+    void clear() BMNOEXEPT;
+
+    /*!
+        \brief run memory optimization for all vector plains
+        \param temp_block - pre-allocated memory block to avoid unnecessary re-allocs
+        \param opt_mode - requested compression depth
+        \param stat - memory allocation statistics after optimization
+    */
+    void optimize(bm::word_t* temp_block = 0,
+                  typename bvector_type::optmode opt_mode = bvector_type::opt_compress,
+                  statistics* stat = 0);
+
+    /*!
+       @brief Calculates memory statistics (dictionary included).
+       @param st - pointer on statistics structure to be filled in.
+    */
+    void calc_stat(statistics* st) const;
+
+    /*! \brief number of distinct values (dictionary size)
+    */
+    size_type dictionary_size() const { return size_type(dict_.size()); }
+
+    /*! \brief get sorted dictionary of values (code is the position)
+    */
+    const dictionary_type& get_dictionary() const { return dict_; }
+
+    /*!
+        \brief find code of a value
+        \param v - value to look up
+        \param code - [out] code of the value
+        \return true if value is in the dictionary
+    */
+    bool remap(value_type v, code_type* code) const;
+
+    /*!
+        \brief first code with value >= v (dictionary_size() if none)
+    */
+    code_type lower_code(value_type v) const
+    {
+        return code_type(std::lower_bound(dict_.begin(), dict_.end(), v) -
+                         dict_.begin());
+    }
+
+    /*!
+        \brief first code with value > v (dictionary_size() if none)
+    */
+    code_type upper_code(value_type v) const
+    {
+        return code_type(std::upper_bound(dict_.begin(), dict_.end(), v) -
+                         dict_.begin());
+    }
+
+    /*!
+        \brief Get const reference to the underlying sparse vector of codes
+    */
+    const sparse_vector_type& get_sv() const { return sv_; }
+
+    /*!
+        \brief Restore vector from a dictionary and a vector of codes
+        (used by deserialization)
+        \internal
+    */
+    sparse_vector_type& get_sv() { return sv_; }
+
+    /*!
+        \brief Writable access to the dictionary
+        \internal
+    */
+    dictionary_type& get_dictionary() { return dict_; }
+
+protected:
+    /// add value to the dictionary (if new)
+    /// \return code of the value
+    code_type add_value(value_type v);
+
+    /// add values to the dictionary, renumber codes of existing rows
+    void add_values(const value_type* arr, size_type size);
+
+    /// translate codes of all rows using old-to-new code table
+    void recode(const code_type* code_map);
+
+    /// clear value plains of NULL rows
+    void clear_null_rows();
+
+    void throw_range_error(const char* err_msg) const;
+
+private:
+    sparse_vector_type   sv_;    ///< vector of value codes
+    dictionary_type      dict_;  ///< sorted distinct values
+};
+
+
+/*!
+    \brief Serialize remapped sparse vector into a memory buffer
+
+ Serialization format:
+ <pre>
+   BYTE+BYTE: Magic-signature 'R','M'
+   BYTE : Size of the value type in bytes
+   INT32: Dictionary size (N)
+   N values (1, 2, 4 or 8 bytes each)
+   sparse_vector<> of codes (see sparse_vector_serialize())
+ </pre>
+
+    \ingroup svserial
+    \sa sparse_vector_serialize
+*/
+template<class Val, class SV>
+void sparse_vector_serialize(
+                const remap_sparse_vector<Val, SV>& rsv,
+                sparse_vector_serial_layout<SV>&    sv_layout,
+                bm::word_t*                         temp_block = 0)
+{
+    typedef typename remap_sparse_vector<Val, SV>::dictionary_type dict_type;
+    const dict_type& dict = rsv.get_dictionary();
+
+    size_t h_size = 1 + 1 + 1 + 4 + dict.size() * sizeof(Val);
+    unsigned char* buf = bm::sparse_vector_serialize_prefixed(
+                            rsv.get_sv(), sv_layout, h_size, temp_block);
+    bm::encoder enc(buf, unsigned(h_size));
+    enc.put_8('R');
+    enc.put_8('M');
+    enc.put_8((unsigned char)sizeof(Val));
+    enc.put_32((bm::word_t)dict.size());
+    for (size_t i = 0; i < dict.size(); ++i)
+        bm::sv_encode_value(enc, dict[i]);
+    BM_ASSERT(enc.size() == h_size);
+}
+
+/*!
+    \brief Deserialize remapped sparse vector
+
+    \return error non-zero codes means failure
+    \ingroup svserial
+    \sa sparse_vector_deserialize
+*/
+template<class Val, class SV>
+int sparse_vector_deserialize(remap_sparse_vector<Val, SV>& rsv,
+                              const unsigned char*          buf,
+                              bm::word_t*                   temp_block = 0)
+{
+    typedef typename remap_sparse_vector<Val, SV>::dictionary_type dict_type;
+
+    rsv.clear();
+    bm::decoder dec(buf);
+    unsigned char h1 = dec.get_8();
+    unsigned char h2 = dec.get_8();
+    if (h1 != 'R' || h2 != 'M')
+        return -1;
+    if (dec.get_8() != sizeof(Val))
+        return -4; // value type mismatch
+
+    dict_type& dict = rsv.get_dictionary();
+    unsigned dict_size = dec.get_32();
+    dict.resize(dict_size);
+    for (unsigned i = 0; i < dict_size; ++i)
+        bm::sv_decode_value(dec, dict[i]);
+    int res = bm::sparse_vector_deserialize(rsv.get_sv(), dec.get_pos(),
+                                            temp_block);
+    if (res != 0)
+        rsv.clear();
+    return res;
+}
+
+
+/*!
+   \brief Frame-of-reference (FOR) compressed sparse vector
+
+   Values are stored as (value - base) in the bit-plains of the underlying
+   sparse_vector<>, base is the minimum of every 64K block (base_per_block)
+   or of the whole vector (base_per_vector). Columns with large values in
+   a narrow band (timestamps, counters) materialize only the low plains
+   of the varying part.
+
+   Codes are kept in the unsigned counterpart of SV (code_vector_type),
+   so signed values do not pay for the zig-zag encoding and codes compare
+   in unsigned order.
+   sparse_vector_scanner<> comparisons rebase search arguments block by
+   block, serialization keeps the bases in front of the plains.
+   A value below the base of its block rebases the block (or the whole
+   vector), bulk load via import() or load_from() computes bases first.
+
+   \ingroup svector
+*/
+template<class Val, class SV>
+class for_sparse_vector
+{
+public:
+    typedef Val                                      value_type;
+    typedef bm::id_t                                 size_type;
+    typedef SV                                       sparse_vector_type;
+    typedef typename SV::unsigned_value_type         code_type;
+    typedef typename SV::bvector_type                bvector_type;
+    typedef bm::sparse_vector<code_type, bvector_type> code_vector_type;
+    typedef typename bm::sv_value_traits<Val>::unsigned_type unsigned_value_type;
+    typedef bvector_type*                            bvector_type_ptr;
+    typedef const bvector_type*                      bvector_type_const_ptr;
+    typedef typename bvector_type::allocator_type    allocator_type;
+    typedef typename bvector_type::allocation_policy allocation_policy_type;
+    typedef typename code_vector_type::statistics    statistics;
+    typedef std::vector<value_type>                  base_vector_type;
+
+    enum bit_plains
+    {
+        sv_plains = SV::sv_plains,
+        sv_value_plains = SV::sv_value_plains
+    };
+
+    /// base of the frame of reference
+    enum base_mode
+    {
+        base_per_block = 0,  ///< minimum of every 64K block
+        base_per_vector      ///< minimum of the vector
+    };
+
+public:
+    /*!
+        \brief Sparse vector constructor
+        \param null_able - defines if vector supports NULL values flag
+        \param mode - per block or per vector base
+        \param ap - allocation strategy for underlying bit-vectors
+        \param bv_max_size - maximum possible size of underlying bit-vectors
+        \param alloc - allocator for bit-vectors
+
+        \sa sparse_vector
+    */
+    for_sparse_vector(bm::null_support null_able = bm::no_null,
+                      base_mode mode = base_per_block,
+                      allocation_policy_type ap = allocation_policy_type(),
+                      size_type bv_max_size = bm::id_max,
+                      const allocator_type&   alloc  = allocator_type());
+
+    /*! \brief content exchange */
+    void swap(for_sparse_vector<Val, SV>& fsv) BMNOEXEPT;
+
+    /*! \brief return size of the vector
+    */
+    size_type size() const { return sv_.size(); }
+
+    /*! \brief return true if vector is empty
+    */
+    bool empty() const { return sv_.empty(); }
+
+    /*! \brief base mode of the vector
+    */
+    base_mode get_base_mode() const { return mode_; }
+
+    /*! \brief check if container supports NULL(unassigned) values
+    */
+    bool is_nullable() const { return sv_.is_nullable(); }
+
+    /*!
+        \brief Get bit-vector of assigned values or NULL
+    */
+    const bvector_type* get_null_bvector() const
+        { return sv_.get_null_bvector(); }
+
+    /** \brief test if specified element is NULL
+        \param idx - element index
+    */
+    bool is_null(size_type idx) const { return sv_.is_null(idx); }
+
+    /*!
+        \brief get specified element without bounds checking
+        \param idx - element index
+        \return value of the element (0 for NULL)
+    */
+    value_type get(size_type idx) const;
+
+    /*!
+        \brief access specified element with bounds checking
+        \param idx - element index
+        \return value of the element
+    */
+    value_type at(size_type idx) const;
+
+    /*!
+        \brief get specified element without bounds checking
+    */
+    value_type operator[](size_type idx) const { return this->get(idx); }
+
+    /*!
+        \brief set value of an existing element
+        \param idx - element index (must be less than size())
+        \param v   - element value
+    */
+    void set(size_type idx, value_type v);
+
+    /*!
+        \brief push value back into vector
+        \param v   - element value
+    */
+    void push_back(value_type v);
+
+    /*!
+        \brief Append elements from a C-style array
+        (bases of the blocks are computed before import)
+
+        \param arr  - source array
+        \param size - source size
+    */
+    void import_back(const value_type* arr, size_type size);
+
+    /*!
+        \brief Bulk export of a range of elements to a C-style array
+        (codes are decoded by block-aligned chunks and rebased)
+
+        \param arr  - dest array (NULLs are exported as 0)
+        \param idx_from - index in the vector to export from
+        \param size - decoding size (array allocation should match)
+        \return number of exported elements
+    */
+    size_type decode(value_type* arr,
+                     size_type   idx_from,
+                     size_type   size) const;
+
+    /*!
+        \brief Bulk export of a range of elements
+        \sa decode
+    */
+    size_type extract_range(value_type* arr,
+                            size_type   size,
+                            size_type   idx_from) const
+        { return decode(arr, idx_from, size); }
+
+    /*!
+        \brief Load FOR vector from a sparse vector
+        \param sv_src - source sparse vector
+    */
+    void load_from(const sparse_vector_type& sv_src);
+
+    /*!
+        \brief Export values to a sparse vector
+        \param sv - target sparse vector
+    */
+    void load_to(sparse_vector_type& sv) const;
+
+    /*!
+        \brief check if another vector has the same content
+        \return true, if it is the same
+    */
+    bool equal(const for_sparse_vector<Val, SV>& fsv) const;
+
+    /*! \brief resize to zero, free memory
+    */
+    void clear() BMNOEXEPT;
+
+    /*!
+        \brief run memory optimization for all vector plains
+        \param temp_block - pre-allocated memory block to avoid unnecessary re-allocs
+        \param opt_mode - requested compression depth
+        \param stat - memory allocation statistics after optimization
+    */
+    void optimize(bm::word_t* temp_block = 0,
+                  typename bvector_type::optmode opt_mode = bvector_type::opt_compress,
+                  statistics* stat = 0);
+
+    /*!
+       @brief Calculates memory statistics (bases included).
+       @param st - pointer on statistics structure to be filled in.
+    */
+    void calc_stat(statistics* st) const;
+
+    /*!
+        \brief get base of the block
+        \param nb - block number (idx >> bm::set_block_shift)
+    */
+    value_type block_base(unsigned nb) const
+        { return (mode_ == base_per_vector) ? bases_[0] : bases_[nb]; }
+
+    /*! \brief get vector of bases (one base for base_per_vector mode)
+    */
+    const base_vector_type& get_bases() const { return bases_; }
+
+    /*!
+        \brief Get const reference to the underlying sparse vector of
+        rebased values
+    */
+    const code_vector_type& get_sv() const { return sv_; }
+
+    /*!
+        \brief Writable access to the underlying sparse vector
+        (used by deserialization)
+        \internal
+    */
+    code_vector_type& get_sv() { return sv_; }
+
+    /*!
+        \brief Writable access to the bases
+        \internal
+    */
+    base_vector_type& get_bases() { return bases_; }
+
+    /*!
+        \brief Set base mode (used by deserialization)
+        \internal
+    */
+    void set_base_mode(base_mode mode) { mode_ = mode; }
+
+    /*!
+        \brief Value in the unsigned order of codes (signed values get the
+        sign bit flipped): a < b is ordered_code(a) < ordered_code(b) and
+        (ordered_code(v) - ordered_code(base)) is the code of v
+    */
+    static code_type ordered_code(value_type v)
+    {
+        const unsigned_value_type sign_bit = bm::sv_value_traits<Val>::is_signed ?
+            unsigned_value_type(unsigned_value_type(1) << (sizeof(Val) * 8 - 1)) : 0;
+        return code_type(unsigned_value_type(unsigned_value_type(v) ^ sign_bit));
+    }
+
+protected:
+    /// initial base of a block (any first value rebases it),
+    /// a block has its real base once it has rows (see rebase())
+    static value_type no_base() { return std::numeric_limits<Val>::max(); }
+
+    /// code of v: (v - base) in the unsigned type (no signed overflow)
+    static code_type to_code(value_type v, value_type base)
+    {
+        return code_type(unsigned_value_type(unsigned_value_type(v) -
+                                             unsigned_value_type(base)));
+    }
+    /// value of the code (inverse of to_code())
+    static value_type from_code(code_type code, value_type base)
+    {
+        return value_type(unsigned_value_type(unsigned_value_type(base) +
+                                              unsigned_value_type(code)));
+    }
+
+    /// make sure block has a base, lower the base to v if needed
+    /// \return base of the block
+    value_type check_base(unsigned nb, value_type v);
+
+    /// move block(s) to the new (lower) base
+    void rebase(unsigned nb, value_type new_base);
+
+    /// add value to stored codes of a range of rows
+    void shift_rows(size_type from, size_type to, code_type add);
+
+    /// clear value plains of NULL rows
+    void clear_null_rows();
+
+    void throw_range_error(const char* err_msg) const;
+
+private:
+    code_vector_type     sv_;     ///< vector of (value - base)
+    base_vector_type     bases_;  ///< bases of blocks
+    base_mode            mode_;   ///< per block or per vector base
+};
+
+
+/*!
+    \brief Serialize FOR sparse vector into a memory buffer
+
+ Serialization format:
+ <pre>
+   BYTE+BYTE: Magic-signature 'F','R'
+   BYTE : Size of the value type in bytes
+   BYTE : Base mode (0 - per block, 1 - per vector)
+   INT32: Number of bases (N)
+   N bases (1, 2, 4 or 8 bytes each)
+   sparse_vector<> of rebased values (see sparse_vector_serialize())
+ </pre>
+
+    \ingroup svserial
+    \sa sparse_vector_serialize
+*/
+template<class Val, class SV>
+void sparse_vector_serialize(
+        const for_sparse_vector<Val, SV>& fsv,
+        sparse_vector_serial_layout<
+            typename for_sparse_vector<Val, SV>::code_vector_type>& sv_layout,
+        bm::word_t*                       temp_block = 0)
+{
+    typedef typename for_sparse_vector<Val, SV>::base_vector_type bases_type;
+    const bases_type& bases = fsv.get_bases();
+
+    size_t h_size = 1 + 1 + 1 + 1 + 4 + bases.size() * sizeof(Val);
+    unsigned char* buf = bm::sparse_vector_serialize_prefixed(
+                            fsv.get_sv(), sv_layout, h_size, temp_block);
+    bm::encoder enc(buf, unsigned(h_size));
+    enc.put_8('F');
+    enc.put_8('R');
+    enc.put_8((unsigned char)sizeof(Val));
+    enc.put_8((unsigned char)fsv.get_base_mode());
+    enc.put_32((bm::word_t)bases.size());
+    for (size_t i = 0; i < bases.size(); ++i)
+        bm::sv_encode_value(enc, bases[i]);
+    BM_ASSERT(enc.size() == h_size);
+}
+
+/*!
+    \brief Deserialize FOR sparse vector
+
+    \return error non-zero codes means failure
+    \ingroup svserial
+    \sa sparse_vector_deserialize
+*/
+template<class Val, class SV>
+int sparse_vector_deserialize(for_sparse_vector<Val, SV>& fsv,
+                              const unsigned char*        buf,
+                              bm::word_t*                 temp_block = 0)
+{
+    typedef typename for_sparse_vector<Val, SV>::base_vector_type bases_type;
+    typedef typename for_sparse_vector<Val, SV>::base_mode base_mode_type;
+
+    fsv.clear();
+    bm::decoder dec(buf);
+    unsigned char h1 = dec.get_8();
+    unsigned char h2 = dec.get_8();
+    if (h1 != 'F' || h2 != 'R')
+        return -1;
+    if (dec.get_8() != sizeof(Val))
+        return -4; // value type mismatch
+    fsv.set_base_mode(base_mode_type(dec.get_8()));
+
+    bases_type& bases = fsv.get_bases();
+    unsigned bases_size = dec.get_32();
+    bases.resize(bases_size);
+    for (unsigned i = 0; i < bases_size; ++i)
+        bm::sv_decode_value(dec, bases[i]);
+    int res = bm::sparse_vector_deserialize(fsv.get_sv(), dec.get_pos(),
+                                            temp_block);
+    if (res != 0)
+        fsv.clear();
+    return res;
+}
+
+
+//---------------------------------------------------------------------
+//
+//---------------------------------------------------------------------
+
+template<class Val, class SV>
+rsc_sparse_vector<Val, SV>::rsc_sparse_vector(allocation_policy_type ap,
+                                              size_type bv_max_size,
+                                              const allocator_type&   alloc)
+: sv_(bm::use_null, ap, bv_max_size, alloc),
+  nn_count_(0),
+  in_sync_(false)
+{}
+
+//---------------------------------------------------------------------
+
+template<class Val, class SV>
+rsc_sparse_vector<Val, SV>::rsc_sparse_vector(
+                          const rsc_sparse_vector<Val, SV>& csv)
+: sv_(csv.sv_),
+  nn_count_(csv.nn_count_),
+  in_sync_(csv.in_sync_)
+{
+    if (in_sync_)
+        rs_idx_.copy_from(csv.rs_idx_);
+}
+
+//---------------------------------------------------------------------
+
+template<class Val, class SV>
+void rsc_sparse_vector<Val, SV>::swap(rsc_sparse_vector<Val, SV>& csv) BMNOEXEPT
+{
+    if (this != &csv)
+    {
+        sv_.swap(csv.sv_);
+        bm::xor_swap(nn_count_, csv.nn_count_);
+        rs_idx_.swap(csv.rs_idx_);
+        bool b = in_sync_; in_sync_ = csv.in_sync_; csv.in_sync_ = b;
+    }
+}
+
+//---------------------------------------------------------------------
+
+template<class Val, class SV>
+void rsc_sparse_vector<Val, SV>::throw_range_error(const char* err_msg) const
+{
+#ifndef BM_NO_STL
+    throw std::range_error(err_msg);
+#else
+    BM_ASSERT_THROW(false, BM_ERR_RANGE);
+#endif
+}
+
+//---------------------------------------------------------------------
+
+template<class Val, class SV>
+void rsc_sparse_vector<Val, SV>::push_back(size_type idx, value_type v)
+{
+    if (sv_.size() && idx < sv_.size())
+        throw_range_error("rsc_sparse_vector push_back is not at the end");
+
+    bvector_type* bv_null = sv_.plain(sv_value_plains);
+    BM_ASSERT(bv_null);
+    bv_null->set_bit_no_check(idx);
+
+    // value goes to the next dense position (plains keep encoded values)
+    unsigned char b_list[sizeof(Val) * 8];
+    unsigned bcnt = bm::bitscan(value_traits::encode(v), b_list);
+    for (unsigned j = 0; j < bcnt; ++j)
+        sv_.get_plain(b_list[j])->set_bit_no_check(nn_count_);
+    ++nn_count_;
+
+    sv_.resize(idx + 1);
+    in_sync_ = false;
+}
+
+//---------------------------------------------------------------------
+
+template<class Val, class SV>
+bool rsc_sparse_vector<Val, SV>::resolve(size_type idx, size_type* idx_to) const
+{
+    BM_ASSERT(idx_to);
+    const bvector_type* bv_null = sv_.get_null_bvector();
+    if (in_sync_)
+    {
+        *idx_to = bv_null->count_to_test(idx, rs_idx_);
+    }
+    else  // slow access
+    {
+        *idx_to = bv_null->test(idx) ? bv_null->count_range(0, idx) : 0;
+    }
+    if (!*idx_to)
+        return false;
+    --(*idx_to); // rank to address
+    return true;
+}
+
+//---------------------------------------------------------------------
+
+template<class Val, class SV>
+typename rsc_sparse_vector<Val, SV>::value_type
+rsc_sparse_vector<Val, SV>::get(size_type idx) const
+{
+    BM_ASSERT(idx < sv_.size());
+    size_type sv_idx;
+    if (!resolve(idx, &sv_idx))
+        return value_type(0);
+    return sv_.get(sv_idx);
+}
+
+//---------------------------------------------------------------------
+
+template<class Val, class SV>
+typename rsc_sparse_vector<Val, SV>::value_type
+rsc_sparse_vector<Val, SV>::at(size_type idx) const
+{
+    if (idx >= sv_.size())
+        throw_range_error("rsc_sparse_vector range error");
+    return this->get(idx);
+}
+
+//---------------------------------------------------------------------
+
+template<class Val, class SV>
+bool rsc_sparse_vector<Val, SV>::is_null(size_type idx) const
+{
+    const bvector_type* bv_null = sv_.get_null_bvector();
+    BM_ASSERT(bv_null);
+    return !bv_null->test(idx);
+}
+
+//---------------------------------------------------------------------
+
+template<class Val, class SV>
+typename rsc_sparse_vector<Val, SV>::size_type
+rsc_sparse_vector<Val, SV>::decode(value_type* arr,
+                                   size_type   idx_from,
+                                   size_type   size) const
+{
+    if (!size || idx_from >= sv_.size())
+        return 0;
+    if (idx_from + size > sv_.size())
+        size = sv_.size() - idx_from;
+
+    const bvector_type* bv_null = sv_.get_null_bvector();
+    BM_ASSERT(bv_null);
+
+    // dense range of the NOT NULL values
+    size_type rank_from, rank_to;
+    size_type idx_to = idx_from + size - 1;
+    if (in_sync_)
+    {
+        rank_from = idx_from ? bv_null->rank(idx_from - 1, rs_idx_) : 0;
+        rank_to = bv_null->rank(idx_to, rs_idx_);
+    }
+    else
+    {
+        rank_from = idx_from ? bv_null->count_range(0, idx_from - 1) : 0;
+        rank_to = rank_from + bv_null->count_range(idx_from, idx_to);
+    }
+    size_type nn_cnt = rank_to - rank_from;
+    if (!nn_cnt)
+    {
+        ::memset(arr, 0, sizeof(value_type) * size);
+        return size;
+    }
+
+    // decode values to the tail of the target array and spread them
+    // forward: target position is never after the source position
+    value_type* arr_nn = arr + (size - nn_cnt);
+    sv_.decode(arr_nn, rank_from, nn_cnt);
+
+    size_type pos = 0;
+    typename bvector_type::enumerator en(bv_null, idx_from);
+    for (size_type k = 0; k < nn_cnt; ++k, ++en)
+    {
+        BM_ASSERT(en.valid());
+        size_type target = *en - idx_from;
+        BM_ASSERT(target <= size - nn_cnt + k);
+        value_type v = arr_nn[k];
+        for (; pos < target; ++pos)
+            arr[pos] = 0;
+        arr[pos++] = v;
+    } // for k
+    for (; pos < size; ++pos)
+        arr[pos] = 0;
+    return size;
+}
+
+//---------------------------------------------------------------------
+
+template<class Val, class SV>
+bool rsc_sparse_vector<Val, SV>::equal(const rsc_sparse_vector<Val, SV>& csv) const
+{
+    if (this == &csv)
+        return true;
+    if (nn_count_ != csv.nn_count_)
+        return false;
+    return sv_.equal(csv.sv_, bm::use_null);
+}
+
+//---------------------------------------------------------------------
+
+template<class Val, class SV>
+void rsc_sparse_vector<Val, SV>::load_from(const sparse_vector_type& sv_src)
+{
+    clear();
+    if (sv_src.empty())
+        return;
+
+    sv_.resize(sv_src.size());
+    bvector_type* bv_null = sv_.plain(sv_value_plains);
+    BM_ASSERT(bv_null);
+    const bvector_type* bv_null_src = sv_src.get_null_bvector();
+    if (bv_null_src)
+        *bv_null = *bv_null_src;
+    else
+        bv_null->set_range(0, sv_src.size()-1);
+
+    // gather NOT NULL values and append them to a dense vector
+    sparse_vector_type sv_dense(bm::no_null);
+    {
+        const unsigned buf_size = 1024;
+        size_type  idx_buf[buf_size];
+        value_type val_buf[buf_size];
+        typename sparse_vector_type::back_insert_iterator
+                                        bi(sv_dense.get_back_inserter());
+        typename bvector_type::enumerator en = bv_null->first();
+        while (en.valid())
+        {
+            unsigned n = 0;
+            for (; n < buf_size && en.valid(); ++en, ++n)
+                idx_buf[n] = *en;
+            sv_src.gather(val_buf, idx_buf, n);
+            for (unsigned k = 0; k < n; ++k)
+                bi = val_buf[k];
+        } // while
+        bi.flush();
+        nn_count_ = sv_dense.size();
+    }
+
+    for (unsigned i = 0; i < sv_value_plains; ++i)
+    {
+        bvector_type* bv = sv_dense.plain(i);
+        if (bv)
+            sv_.get_plain(i)->swap(*bv);
+    } // for i
+    sync(true);
+}
+
+//---------------------------------------------------------------------
+
+template<class Val, class SV>
+void rsc_sparse_vector<Val, SV>::load_to(sparse_vector_type& sv) const
+{
+    sv.clear();
+    if (sv_.empty())
+        return;
+    sv.resize(sv_.size());
+
+    const bvector_type* bv_null = sv_.get_null_bvector();
+    BM_ASSERT(bv_null);
+    bvector_type* bv_null_dst = sv.plain(sv_value_plains);
+    if (bv_null_dst)
+        *bv_null_dst = *bv_null;
+
+    // decode dense values by chunks and transpose them into the
+    // target plains as lists of row ids (same as sparse_vector::import)
+    const unsigned buf_size = 1024;
+    const unsigned transpose_window = 256;
+    value_type val_buf[buf_size];
+    unsigned char b_list[sizeof(Val)*8];
+    unsigned row_len[sizeof(Val)*8] = {0, };
+    bm::tmatrix<bm::id_t, sizeof(Val)*8, transpose_window> tm;
+
+    typename bvector_type::enumerator en = bv_null->first();
+    for (size_type rank = 0; rank < nn_count_; )
+    {
+        unsigned n = buf_size;
+        if (n > nn_count_ - rank)
+            n = unsigned(nn_count_ - rank);
+        sv_.decode(val_buf, rank, n);
+        for (unsigned k = 0; k < n; ++k, ++en)
+        {
+            BM_ASSERT(en.valid());
+            const bm::id_t row_idx = *en;
+            unsigned bcnt = bm::bitscan(value_traits::encode(val_buf[k]),
+                                        b_list);
+            for (unsigned j = 0; j < bcnt; ++j)
+            {
+                unsigned p = b_list[j];
+                unsigned rl = row_len[p];
+                tm.row(p)[rl] = row_idx;
+                row_len[p] = ++rl;
+                if (rl == transpose_window)
+                {
+                    const bm::id_t* r = tm.row(p);
+                    bm::combine_or(*sv.get_plain(p), r, r + rl);
+                    row_len[p] = 0;
+                }
+            } // for j
+        } // for k
+        rank += n;
+    } // for rank
+
+    for (unsigned p = 0; p < tm.rows(); ++p)
+    {
+        unsigned rl = row_len[p];
+        if (rl)
+        {
+            const bm::id_t* r = tm.row(p);
+            bm::combine_or(*sv.get_plain(p), r, r + rl);
+        }
+    } // for p
+}
+
+//---------------------------------------------------------------------
+
+template<class Val, class SV>
+void rsc_sparse_vector<Val, SV>::clear() BMNOEXEPT
+{
+    sv_.clear();
+    nn_count_ = 0;
+    rs_idx_.clear();
+    in_sync_ = false;
+}
+
+//---------------------------------------------------------------------
+
+template<class Val, class SV>
+void rsc_sparse_vector<Val, SV>::optimize(bm::word_t* temp_block,
+                                    typename bvector_type::optmode opt_mode,
+                                    statistics* stat)
+{
+    bool was_in_sync = in_sync_;
+    sv_.optimize(temp_block, opt_mode, stat);
+    in_sync_ = false; // block types changed, index has to be rebuilt
+    if (was_in_sync)
+        sync(true);
+}
+
+//---------------------------------------------------------------------
+
+template<class Val, class SV>
+void rsc_sparse_vector<Val, SV>::calc_stat(statistics* st) const
+{
+    BM_ASSERT(st);
+    sv_.calc_stat(st);
+}
+
+//---------------------------------------------------------------------
+
+template<class Val, class SV>
+void rsc_sparse_vector<Val, SV>::sync(bool force)
+{
+    if (in_sync_ && !force)
+        return;
+    const bvector_type* bv_null = sv_.get_null_bvector();
+    BM_ASSERT(bv_null);
+    bv_null->build_rs_index(&rs_idx_);
+    nn_count_ = rs_idx_.count();
+    in_sync_ = true;
+}
+
+//---------------------------------------------------------------------
+//
+//---------------------------------------------------------------------
+
+template<class Val, class SV>
+remap_sparse_vector<Val, SV>::remap_sparse_vector(
+                                        bm::null_support        null_able,
+                                        allocation_policy_type  ap,
+                                        size_type               bv_max_size,
+                                        const allocator_type&   alloc)
+: sv_(null_able, ap, bv_max_size, alloc)
+{}
+
+//---------------------------------------------------------------------
+
+template<class Val, class SV>
+void remap_sparse_vector<Val, SV>::swap(
+                            remap_sparse_vector<Val, SV>& rsv) BMNOEXEPT
+{
+    if (this != &rsv)
+    {
+        sv_.swap(rsv.sv_);
+        dict_.swap(rsv.dict_);
+    }
+}
+
+//---------------------------------------------------------------------
+
+template<class Val, class SV>
+void remap_sparse_vector<Val, SV>::throw_range_error(const char* err_msg) const
+{
+#ifndef BM_NO_STL
+    throw std::range_error(err_msg);
+#else
+    BM_ASSERT_THROW(false, BM_ERR_RANGE);
+#endif
+}
+
+//---------------------------------------------------------------------
+
+template<class Val, class SV>
+bool remap_sparse_vector<Val, SV>::remap(value_type v, code_type* code) const
+{
+    BM_ASSERT(code);
+    typename dictionary_type::const_iterator it =
+                            std::lower_bound(dict_.begin(), dict_.end(), v);
+    if (it == dict_.end() || *it != v)
+        return false;
+    *code = code_type(it - dict_.begin());
+    return true;
+}
+
+//---------------------------------------------------------------------
+
+template<class Val, class SV>
+typename remap_sparse_vector<Val, SV>::value_type
+remap_sparse_vector<Val, SV>::get(size_type idx) const
+{
+    BM_ASSERT(idx < sv_.size());
+    const bvector_type* bv_null = sv_.get_null_bvector();
+    if (bv_null && !bv_null->test(idx))
+        return value_type(0);
+    code_type code = sv_.get(idx);
+    BM_ASSERT(code < dict_.size());
+    return dict_[code];
+}
+
+//---------------------------------------------------------------------
+
+template<class Val, class SV>
+typename remap_sparse_vector<Val, SV>::value_type
+remap_sparse_vector<Val, SV>::at(size_type idx) const
+{
+    if (idx >= sv_.size())
+        throw_range_error("remap_sparse_vector range error");
+    return this->get(idx);
+}
+
+//---------------------------------------------------------------------
+
+template<class Val, class SV>
+void remap_sparse_vector<Val, SV>::set(size_type idx, value_type v)
+{
+    if (idx >= sv_.size())
+        throw_range_error("remap_sparse_vector range error");
+    sv_.set(idx, add_value(v));
+}
+
+//---------------------------------------------------------------------
+
+template<class Val, class SV>
+void remap_sparse_vector<Val, SV>::push_back(value_type v)
+{
+    sv_.push_back(add_value(v));
+}
+
+//---------------------------------------------------------------------
+
+template<class Val, class SV>
+typename remap_sparse_vector<Val, SV>::code_type
+remap_sparse_vector<Val, SV>::add_value(value_type v)
+{
+    code_type code = 0;
+    if (remap(v, &code))
+        return code;
+    add_values(&v, 1);
+    return lower_code(v);
+}
+
+//---------------------------------------------------------------------
+
+template<class Val, class SV>
+void remap_sparse_vector<Val, SV>::add_values(const value_type* arr,
+                                              size_type         size)
+{
+    dictionary_type vals(arr, arr + size);
+    std::sort(vals.begin(), vals.end());
+    vals.erase(std::unique(vals.begin(), vals.end()), vals.end());
+
+    dictionary_type new_dict;
+    new_dict.reserve(dict_.size() + vals.size());
+    std::set_union(dict_.begin(), dict_.end(), vals.begin(), vals.end(),
+                   std::back_inserter(new_dict));
+    if (new_dict.size() == dict_.size()) // no new values
+        return;
+    // codes are non-negative: signed code types hold half of the range
+    if (new_dict.size() - 1 > size_t(std::numeric_limits<code_type>::max()))
+        throw_range_error("remap_sparse_vector: too many distinct values");
+
+    if (!sv_.empty() && !dict_.empty()) // existing codes shift up
+    {
+        std::vector<code_type> code_map(dict_.size());
+        for (size_t i = 0; i < dict_.size(); ++i)
+        {
+            code_map[i] = code_type(
+                std::lower_bound(new_dict.begin(), new_dict.end(), dict_[i]) -
+                new_dict.begin());
+        }
+        recode(&code_map[0]);
+    }
+    dict_.swap(new_dict);
+}
+
+//---------------------------------------------------------------------
+
+template<class Val, class SV>
+void remap_sparse_vector<Val, SV>::recode(const code_type* code_map)
+{
+    const bvector_type* bv_null = sv_.get_null_bvector();
+    bvector_type bv_nn;
+    if (bv_null)
+        bv_nn = *bv_null;
+
+    const unsigned buf_size = 1024;
+    code_type cbuf[buf_size];
+    size_type sz = sv_.size();
+    for (size_type from = 0; from < sz; from += buf_size)
+    {
+        unsigned n = buf_size;
+        if (n > sz - from)
+            n = unsigned(sz - from);
+        sv_.decode(cbuf, from, n);
+        for (unsigned k = 0; k < n; ++k)
+            cbuf[k] = code_map[cbuf[k]];
+        sv_.import(cbuf, n, from);
+    } // for from
+
+    if (bv_null) // import() marked all rows as assigned
+    {
+        sv_.plain(sv_value_plains)->swap(bv_nn);
+        clear_null_rows();
+    }
+}
+
+//---------------------------------------------------------------------
+
+template<class Val, class SV>
+void remap_sparse_vector<Val, SV>::clear_null_rows()
+{
+    const bvector_type* bv_null = sv_.get_null_bvector();
+    BM_ASSERT(bv_null);
+    for (unsigned i = 0; i < sv_value_plains; ++i)
+    {
+        bvector_type* bv = sv_.plain(i);
+        if (bv)
+            bv->bit_and(*bv_null);
+    } // for i
+}
+
+//---------------------------------------------------------------------
+
+template<class Val, class SV>
+void remap_sparse_vector<Val, SV>::import(const value_type* arr,
+                                          size_type         size,
+                                          size_type         offset)
+{
+    if (size == 0)
+        throw_range_error("remap_sparse_vector range error (import size 0)");
+    if (offset > sv_.size())
+        throw_range_error("remap_sparse_vector range error (import offset)");
+    BM_ASSERT(arr);
+
+    add_values(arr, size);
+
+    const unsigned buf_size = 1024;
+    code_type cbuf[buf_size];
+    for (size_type i = 0; i < size; i += buf_size)
+    {
+        unsigned n = buf_size;
+        if (n > size - i)
+            n = unsigned(size - i);
+        for (unsigned k = 0; k < n; ++k)
+            cbuf[k] = lower_code(arr[i + k]);
+        sv_.import(cbuf, n, offset + i);
+    } // for i
+}
+
+//---------------------------------------------------------------------
+
+template<class Val, class SV>
+typename remap_sparse_vector<Val, SV>::size_type
+remap_sparse_vector<Val, SV>::decode(value_type* arr,
+                                     size_type   idx_from,
+                                     size_type   size) const
+{
+    if (!size || idx_from >= sv_.size())
+        return 0;
+    if (idx_from + size > sv_.size())
+        size = sv_.size() - idx_from;
+    if (dict_.empty()) // all NULL
+    {
+        for (size_type k = 0; k < size; ++k)
+            arr[k] = value_type(0);
+        return size;
+    }
+
+    // codes are decoded in place and translated
+    sv_.decode(arr, idx_from, size);
+    const value_type* dict = &dict_[0];
+    for (size_type k = 0; k < size; ++k)
+        arr[k] = dict[arr[k]];
+
+    const bvector_type* bv_null = sv_.get_null_bvector();
+    if (bv_null) // NULL rows have code 0, export them as 0
+    {
+        size_type pos = 0;
+        typename bvector_type::enumerator en(bv_null, idx_from);
+        for (; en.valid(); ++en)
+        {
+            size_type target = *en - idx_from;
+            if (target >= size)
+                break;
+            for (; pos < target; ++pos)
+                arr[pos] = value_type(0);
+            ++pos;
+        } // for en
+        for (; pos < size; ++pos)
+            arr[pos] = value_type(0);
+    }
+    return size;
+}
+
+//---------------------------------------------------------------------
+
+template<class Val, class SV>
+void remap_sparse_vector<Val, SV>::load_from(const sparse_vector_type& sv_src)
+{
+    clear();
+    if (sv_src.empty())
+        return;
+
+    const bvector_type* bv_null_src = sv_src.get_null_bvector();
+    // NULL rows are values of 0 for NOT NULL-able target
+    bool skip_null = bv_null_src && sv_.is_nullable();
+
+    const unsigned buf_size = 1024;
+    value_type vbuf[buf_size];
+    code_type cbuf[buf_size];
+    size_type sz = sv_src.size();
+
+    // pass 1: dictionary of distinct values (merged in large batches)
+    const size_t batch_size = 65536;
+    dictionary_type vals;
+    for (size_type from = 0; from < sz; from += buf_size)
+    {
+        unsigned n = buf_size;
+        if (n > sz - from)
+            n = unsigned(sz - from);
+        sv_src.decode(vbuf, from, n);
+        if (skip_null)
+        {
+            typename bvector_type::enumerator en(bv_null_src, from);
+            for (; en.valid() && *en < from + n; ++en)
+                vals.push_back(vbuf[*en - from]);
+        }
+        else
+        {
+            vals.insert(vals.end(), vbuf, vbuf + n);
+        }
+        if (vals.size() >= batch_size)
+        {
+            add_values(&vals[0], size_type(vals.size()));
+            vals.resize(0);
+        }
+    } // for from
+    if (!vals.empty())
+        add_values(&vals[0], size_type(vals.size()));
+
+    // pass 2: codes
+    for (size_type from = 0; from < sz; from += buf_size)
+    {
+        unsigned n = buf_size;
+        if (n > sz - from)
+            n = unsigned(sz - from);
+        sv_src.decode(vbuf, from, n);
+        for (unsigned k = 0; k < n; ++k)
+        {
+            code_type code;
+            cbuf[k] = remap(vbuf[k], &code) ? code : code_type(0);
+        }
+        sv_.import(cbuf, n, from);
+    } // for from
+
+    if (skip_null)
+    {
+        *sv_.plain(sv_value_plains) = *bv_null_src;
+        clear_null_rows();
+    }
+}
+
+//---------------------------------------------------------------------
+
+template<class Val, class SV>
+void remap_sparse_vector<Val, SV>::load_to(sparse_vector_type& sv) const
+{
+    sv.clear();
+    if (sv_.empty())
+        return;
+
+    const unsigned buf_size = 1024;
+    value_type vbuf[buf_size];
+    size_type sz = sv_.size();
+    for (size_type from = 0; from < sz; from += buf_size)
+    {
+        unsigned n = buf_size;
+        if (n > sz - from)
+            n = unsigned(sz - from);
+        decode(vbuf, from, n);
+        sv.import(vbuf, n, from);
+    } // for from
+
+    const bvector_type* bv_null = sv_.get_null_bvector();
+    bvector_type* bv_null_dst = sv.plain(sv_value_plains);
+    if (bv_null && bv_null_dst)
+        *bv_null_dst = *bv_null;
+}
+
+//---------------------------------------------------------------------
+
+template<class Val, class SV>
+bool remap_sparse_vector<Val, SV>::equal(
+                            const remap_sparse_vector<Val, SV>& rsv) const
+{
+    if (this == &rsv)
+        return true;
+    if (dict_ != rsv.dict_)
+        return false;
+    return sv_.equal(rsv.sv_, bm::use_null);
+}
+
+//---------------------------------------------------------------------
+
+template<class Val, class SV>
+void remap_sparse_vector<Val, SV>::clear() BMNOEXEPT
+{
+    sv_.clear();
+    dict_.resize(0);
+}
+
+//---------------------------------------------------------------------
+
+template<class Val, class SV>
+void remap_sparse_vector<Val, SV>::optimize(bm::word_t* temp_block,
+                                    typename bvector_type::optmode opt_mode,
+                                    statistics* stat)
+{
+    sv_.optimize(temp_block, opt_mode, stat);
+    if (stat)
+    {
+        stat->memory_used += dict_.capacity() * sizeof(value_type);
+        stat->max_serialize_mem += 1 + 1 + 1 + 4 + dict_.size() * sizeof(value_type);
+    }
+}
+
+//---------------------------------------------------------------------
+
+template<class Val, class SV>
+void remap_sparse_vector<Val, SV>::calc_stat(statistics* st) const
+{
+    BM_ASSERT(st);
+    sv_.calc_stat(st);
+    st->memory_used += dict_.capacity() * sizeof(value_type);
+    st->max_serialize_mem += 1 + 1 + 1 + 4 + dict_.size() * sizeof(value_type);
+}
+
+//---------------------------------------------------------------------
+//
+//---------------------------------------------------------------------
+
+template<class Val, class SV>
+for_sparse_vector<Val, SV>::for_sparse_vector(
+                                        bm::null_support        null_able,
+                                        base_mode               mode,
+                                        allocation_policy_type  ap,
+                                        size_type               bv_max_size,
+                                        const allocator_type&   alloc)
+: sv_(null_able, ap, bv_max_size, alloc),
+  mode_(mode)
+{}
+
+//---------------------------------------------------------------------
+
+template<class Val, class SV>
+void for_sparse_vector<Val, SV>::swap(for_sparse_vector<Val, SV>& fsv) BMNOEXEPT
+{
+    if (this != &fsv)
+    {
+        sv_.swap(fsv.sv_);
+        bases_.swap(fsv.bases_);
+        base_mode m = mode_; mode_ = fsv.mode_; fsv.mode_ = m;
+    }
+}
+
+//---------------------------------------------------------------------
+
+template<class Val, class SV>
+void for_sparse_vector<Val, SV>::throw_range_error(const char* err_msg) const
+{
+#ifndef BM_NO_STL
+    throw std::range_error(err_msg);
+#else
+    BM_ASSERT_THROW(false, BM_ERR_RANGE);
+#endif
+}
+
+//---------------------------------------------------------------------
+
+template<class Val, class SV>
+typename for_sparse_vector<Val, SV>::value_type
+for_sparse_vector<Val, SV>::get(size_type idx) const
+{
+    BM_ASSERT(idx < sv_.size());
+    const bvector_type* bv_null = sv_.get_null_bvector();
+    if (bv_null && !bv_null->test(idx))
+        return value_type(0);
+    unsigned nb = unsigned(idx >> bm::set_block_shift);
+    return from_code(sv_.get(idx), block_base(nb));
+}
+
+//---------------------------------------------------------------------
+
+template<class Val, class SV>
+typename for_sparse_vector<Val, SV>::value_type
+for_sparse_vector<Val, SV>::at(size_type idx) const
+{
+    if (idx >= sv_.size())
+        throw_range_error("for_sparse_vector range error");
+    return this->get(idx);
+}
+
+//---------------------------------------------------------------------
+
+template<class Val, class SV>
+typename for_sparse_vector<Val, SV>::value_type
+for_sparse_vector<Val, SV>::check_base(unsigned nb, value_type v)
+{
+    if (mode_ == base_per_vector)
+        nb = 0;
+    if (nb >= bases_.size())
+        bases_.resize(nb + 1, no_base());
+    if (v < bases_[nb])
+        rebase(nb, v);
+    return bases_[nb];
+}
+
+//---------------------------------------------------------------------
+
+template<class Val, class SV>
+void for_sparse_vector<Val, SV>::rebase(unsigned nb, value_type new_base)
+{
+    value_type old_base = bases_[nb];
+    BM_ASSERT(new_base < old_base);
+    bases_[nb] = new_base;
+    // rows of the block (if any) are coded against the old base,
+    // no_base() is a legal base value, so rows decide and not the base
+    if (sv_.empty())
+        return;
+
+    size_type from, to;
+    if (mode_ == base_per_vector)
+    {
+        from = 0; to = sv_.size() - 1;
+    }
+    else
+    {
+        from = size_type(nb) << bm::set_block_shift;
+        if (from >= sv_.size())
+            return;
+        to = from + bm::gap_max_bits - 1;
+        if (to >= sv_.size())
+            to = sv_.size() - 1;
+    }
+    shift_rows(from, to, to_code(old_base, new_base));
+}
+
+//---------------------------------------------------------------------
+
+template<class Val, class SV>
+void for_sparse_vector<Val, SV>::shift_rows(size_type from, size_type to,
+                                            code_type add)
+{
+    const bvector_type* bv_null = sv_.get_null_bvector();
+    bvector_type bv_nn;
+    if (bv_null)
+        bv_nn = *bv_null;
+
+    const unsigned buf_size = 1024;
+    code_type cbuf[buf_size];
+    for (size_type i = from; i <= to; i += buf_size)
+    {
+        unsigned n = buf_size;
+        if (n > to - i + 1)
+            n = unsigned(to - i + 1);
+        sv_.decode(cbuf, i, n);
+        for (unsigned k = 0; k < n; ++k)
+            cbuf[k] = code_type(cbuf[k] + add);
+        sv_.import(cbuf, n, i);
+    } // for i
+
+    if (bv_null) // import() marked all rows as assigned
+    {
+        sv_.plain(sv_value_plains)->swap(bv_nn);
+        clear_null_rows();
+    }
+}
+
+//---------------------------------------------------------------------
+
+template<class Val, class SV>
+void for_sparse_vector<Val, SV>::clear_null_rows()
+{
+    const bvector_type* bv_null = sv_.get_null_bvector();
+    BM_ASSERT(bv_null);
+    for (unsigned i = 0; i < sv_value_plains; ++i)
+    {
+        bvector_type* bv = sv_.plain(i);
+        if (bv)
+            bv->bit_and(*bv_null);
+    } // for i
+}
+
+//---------------------------------------------------------------------
+
+template<class Val, class SV>
+void for_sparse_vector<Val, SV>::set(size_type idx, value_type v)
+{
+    if (idx >= sv_.size())
+        throw_range_error("for_sparse_vector range error");
+    value_type base = check_base(unsigned(idx >> bm::set_block_shift), v);
+    sv_.set(idx, to_code(v, base));
+}
+
+//---------------------------------------------------------------------
+
+template<class Val, class SV>
+void for_sparse_vector<Val, SV>::push_back(value_type v)
+{
+    size_type idx = sv_.size();
+    value_type base = check_base(unsigned(idx >> bm::set_block_shift), v);
+    sv_.push_back(to_code(v, base));
+}
+
+//---------------------------------------------------------------------
+
+template<class Val, class SV>
+void for_sparse_vector<Val, SV>::import_back(const value_type* arr,
+                                             size_type         size)
+{
+    if (size == 0)
+        return;
+    BM_ASSERT(arr);
+
+    // bases first: one rebase per block (or vector) at most
+    size_type offset = sv_.size();
+    for (size_type i = 0; i < size; )
+    {
+        size_type idx = offset + i;
+        unsigned nb = unsigned(idx >> bm::set_block_shift);
+        unsigned n = bm::gap_max_bits - unsigned(idx & bm::set_block_mask);
+        if (n > size - i)
+            n = unsigned(size - i);
+        value_type min_v = *std::min_element(arr + i, arr + i + n);
+        check_base(nb, min_v);
+        i += n;
+    } // for i
+
+    const unsigned buf_size = 1024;
+    code_type cbuf[buf_size];
+    for (size_type i = 0; i < size; )
+    {
+        size_type idx = offset + i;
+        unsigned n = buf_size - unsigned(idx % buf_size); // block aligned
+        if (n > size - i)
+            n = unsigned(size - i);
+        value_type base = block_base(unsigned(idx >> bm::set_block_shift));
+        const value_type* a = arr + i;
+        for (unsigned k = 0; k < n; ++k)
+            cbuf[k] = to_code(a[k], base);
+        sv_.import(cbuf, n, idx);
+        i += n;
+    } // for i
+}
+
+//---------------------------------------------------------------------
+
+template<class Val, class SV>
+typename for_sparse_vector<Val, SV>::size_type
+for_sparse_vector<Val, SV>::decode(value_type* arr,
+                                   size_type   idx_from,
+                                   size_type   size) const
+{
+    if (!size || idx_from >= sv_.size())
+        return 0;
+    if (idx_from + size > sv_.size())
+        size = sv_.size() - idx_from;
+
+    // rebased values are decoded in place, block by block
+    for (size_type i = 0; i < size; )
+    {
+        size_type idx = idx_from + i;
+        unsigned n = bm::gap_max_bits - unsigned(idx & bm::set_block_mask);
+        if (n > size - i)
+            n = unsigned(size - i);
+        value_type* a = arr + i;
+        sv_.decode((code_type*)a, idx, n); // codes have the size of values
+        value_type base = block_base(unsigned(idx >> bm::set_block_shift));
+        if (base)
+        {
+            for (unsigned k = 0; k < n; ++k)
+                a[k] = from_code(code_type(a[k]), base);
+        }
+        i += n;
+    } // for i
+
+    const bvector_type* bv_null = sv_.get_null_bvector();
+    if (bv_null) // NULL rows have code 0, export them as 0
+    {
+        size_type pos = 0;
+        typename bvector_type::enumerator en(bv_null, idx_from);
+        for (; en.valid(); ++en)
+        {
+            size_type target = *en - idx_from;
+            if (target >= size)
+                break;
+            for (; pos < target; ++pos)
+                arr[pos] = value_type(0);
+            ++pos;
+        } // for en
+        for (; pos < size; ++pos)
+            arr[pos] = value_type(0);
+    }
+    return size;
+}
+
+//---------------------------------------------------------------------
+
+template<class Val, class SV>
+void for_sparse_vector<Val, SV>::load_from(const sparse_vector_type& sv_src)
+{
+    clear();
+    if (sv_src.empty())
+        return;
+
+    const bvector_type* bv_null_src = sv_src.get_null_bvector();
+    // NULL rows are values of 0 for NOT NULL-able target
+    bool skip_null = bv_null_src && sv_.is_nullable();
+
+    const unsigned buf_size = 1024;
+    value_type vbuf[buf_size];
+    code_type cbuf[buf_size];
+    size_type sz = sv_src.size();
+
+    // pass 1: bases (chunks are block aligned)
+    for (size_type from = 0; from < sz; from += buf_size)
+    {
+        unsigned n = buf_size;
+        if (n > sz - from)
+            n = unsigned(sz - from);
+        unsigned nb = unsigned(from >> bm::set_block_shift);
+        sv_src.decode(vbuf, from, n);
+        if (skip_null)
+        {
+            typename bvector_type::enumerator en(bv_null_src, from);
+            for (; en.valid() && *en < from + n; ++en)
+                check_base(nb, vbuf[*en - from]);
+        }
+        else
+        {
+            check_base(nb, *std::min_element(vbuf, vbuf + n));
+        }
+    } // for from
+    if (mode_ == base_per_block) // blocks of NULLs
+        bases_.resize((sz - 1) / bm::gap_max_bits + 1, no_base());
+
+    // pass 2: rebased values
+    for (size_type from = 0; from < sz; from += buf_size)
+    {
+        unsigned n = buf_size;
+        if (n > sz - from)
+            n = unsigned(sz - from);
+        sv_src.decode(vbuf, from, n);
+        value_type base = block_base(unsigned(from >> bm::set_block_shift));
+        for (unsigned k = 0; k < n; ++k)
+            cbuf[k] = to_code(vbuf[k], base);
+        sv_.import(cbuf, n, from);
+    } // for from
+
+    if (skip_null) // values of NULL rows were rebased too
+    {
+        *sv_.plain(sv_value_plains) = *bv_null_src;
+        clear_null_rows();
+    }
+}
+
+//---------------------------------------------------------------------
+
+template<class Val, class SV>
+void for_sparse_vector<Val, SV>::load_to(sparse_vector_type& sv) const
+{
+    sv.clear();
+    if (sv_.empty())
+        return;
+
+    const unsigned buf_size = 1024;
+    value_type vbuf[buf_size];
+    size_type sz = sv_.size();
+    for (size_type from = 0; from < sz; from += buf_size)
+    {
+        unsigned n = buf_size;
+        if (n > sz - from)
+            n = unsigned(sz - from);
+        decode(vbuf, from, n);
+        sv.import(vbuf, n, from);
+    } // for from
+
+    const bvector_type* bv_null = sv_.get_null_bvector();
+    bvector_type* bv_null_dst = sv.plain(sv_value_plains);
+    if (bv_null && bv_null_dst)
+        *bv_null_dst = *bv_null;
+}
+
+//---------------------------------------------------------------------
+
+template<class Val, class SV>
+bool for_sparse_vector<Val, SV>::equal(const for_sparse_vector<Val, SV>& fsv) const
+{
+    if (this == &fsv)
+        return true;
+    if (mode_ != fsv.mode_ || bases_ != fsv.bases_)
+        return false;
+    return sv_.equal(fsv.sv_, bm::use_null);
+}
+
+//---------------------------------------------------------------------
+
+template<class Val, class SV>
+void for_sparse_vector<Val, SV>::clear() BMNOEXEPT
+{
+    sv_.clear();
+    bases_.resize(0);
+}
+
+//---------------------------------------------------------------------
+
+template<class Val, class SV>
+void for_sparse_vector<Val, SV>::optimize(bm::word_t* temp_block,
+                                    typename bvector_type::optmode opt_mode,
+                                    statistics* stat)
+{
+    sv_.optimize(temp_block, opt_mode, stat);
+    if (stat)
+    {
+        stat->memory_used += bases_.capacity() * sizeof(value_type);
+        stat->max_serialize_mem += 1 + 1 + 1 + 1 + 4 + bases_.size() * sizeof(value_type);
+    }
+}
+
+//---------------------------------------------------------------------
+
+template<class Val, class SV>
+void for_sparse_vector<Val, SV>::calc_stat(statistics* st) const
+{
+    BM_ASSERT(st);
+    sv_.calc_stat(st);
+    st->memory_used += bases_.capacity() * sizeof(value_type);
+    st->max_serialize_mem += 1 + 1 + 1 + 1 + 4 + bases_.size() * sizeof(value_type);
+}
+
+
+} // namespace bm
+
+#include "bmundef.h"
+
+
+#endif
@@ -102,7 +102,13 @@ struct sparse_vector_serial_layout
     {
         return plain_ptrs_[i];
     }
-    
+
+    /// Get serialized plain size
+    unsigned get_plain_size(unsigned i) const
+    {
+        return plane_size_[i];
+    }
+
     /// Return serialization buffer pointer
     const unsigned char* buf() const { return buf_.buf(); /*return buffer_;*/ }
     
@@ -200,7 +206,15 @@ void sparse_vector_serialize(
     enc.put_8('B');
     enc.put_8('M');
     enc.put_8((unsigned char)bo);
-    enc.put_8((unsigned char)plains);
+    if (plains < 256)
+    {
+        enc.put_8((unsigned char)plains);
+    }
+    else // wide vectors (strings): 0 marker and 32-bit plains count
+    {
+        enc.put_8(0);
+        enc.put_32(plains);
+    }
     enc.put_64(sv.size());
     
     for (i = 0; i < plains; ++i)
@@ -251,6 +265,8 @@ int sparse_vector_deserialize(SV& sv,
     //unsigned char bv_bo =
         dec.get_8();
     unsigned plains = dec.get_8();
+    if (!plains) // wide vector: 32-bit plains count
+        plains = dec.get_32();
     
     if (!plains || plains > sv.stored_plains())
     {
@@ -39,7 +39,7 @@ class bvps_addr_resolver
 public:
     typedef bm::id_t                                 size_type;
     typedef BV                                       bvector_type;
-    typedef typename bvector_type::blocks_count      bvector_blocks_psum_type;
+    typedef typename bvector_type::rs_index_type     bvector_blocks_psum_type;
 public:
     bvps_addr_resolver();
     bvps_addr_resolver(const bvps_addr_resolver& addr_res);
@@ -396,7 +396,7 @@ void bvps_addr_resolver<BV>::move_from(bvps_addr_resolver& addr_res) BMNOEXEPT
         in_sync_ = addr_res.in_sync_;
         if (in_sync_)
         {
-            bv_blocks_.copy_from(addr_res.bv_blocks_);
+            bv_blocks_.swap(addr_res.bv_blocks_);
         }
     }
 }
@@ -460,7 +460,7 @@ void bvps_addr_resolver<BV>::calc_prefix_sum(bool force)
     if (in_sync_ && force == false)
         return;  // nothing to do
     
-    addr_bv_.running_count_blocks(&bv_blocks_); // compute popcount prefix list
+    addr_bv_.build_rs_index(&bv_blocks_); // compute rank-select index
     in_sync_ = true;
 }
 
@@ -222,6 +222,12 @@ bm::id_t sse2_bit_count_op(const __m128i* BMRESTRICT block,
 #define VECT_SET_BLOCK(dst, dst_end, value) \
     sse2_set_block((__m128i*) dst, (__m128i*) (dst_end), (value))
 
+#define VECT_BIT_TRANSPOSE32(arr, arr_size, tmatrix) \
+    sse2_bit_block_transpose32(arr, arr_size, tmatrix)
+
+#define VECT_BIT_BLOCK_XOR_PREFIX(first, last, carry) \
+    sse2_bit_block_xor_prefix((__m128i*) (first), (__m128i*) (last), (carry))
+
 
 
 
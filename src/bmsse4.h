@@ -189,6 +189,37 @@ bool sse4_is_all_one(const __m128i* BMRESTRICT block,
 
 
 
+/*!
+    @brief Decode 32-bit word into array of ON bit indexes (+ base)
+    Byte-wise table driven decoding, every byte is expanded into 8 
+    indexes, so up to 8 elements after the result get overwritten.
+    @return number of indexes
+    @ingroup SSE4
+*/
+inline
+unsigned sse4_bit_decode32(bm::word_t w, unsigned* BMRESTRICT arr, 
+                           unsigned base)
+{
+    unsigned* BMRESTRICT pcurr = arr;
+    const __m128i v8 = _mm_set1_epi32(8);
+    __m128i vbase = _mm_set1_epi32(int(base));
+    for (; w; w >>= 8, vbase = _mm_add_epi32(vbase, v8))
+    {
+        unsigned b = w & 0xFFu;
+        if (!b)
+            continue;
+        __m128i bidx = _mm_loadl_epi64(
+                (const __m128i*)bm::bit_decode_table<true>::_idx[b]);
+        __m128i idx0 = _mm_add_epi32(_mm_cvtepu8_epi32(bidx), vbase);
+        __m128i idx1 = _mm_add_epi32(
+                    _mm_cvtepu8_epi32(_mm_srli_si128(bidx, 4)), vbase);
+        _mm_storeu_si128((__m128i*)pcurr, idx0);
+        _mm_storeu_si128((__m128i*)(pcurr + 4), idx1);
+        pcurr += _mm_popcnt_u32(b);
+    }
+    return unsigned(pcurr - arr);
+}
+
 #define VECT_XOR_ARR_2_MASK(dst, src, src_end, mask)\
     sse2_xor_arr_2_mask((__m128i*)(dst), (__m128i*)(src), (__m128i*)(src_end), (bm::word_t)mask)
 
@@ -237,6 +268,15 @@ bool sse4_is_all_one(const __m128i* BMRESTRICT block,
 #define VECT_IS_ONE_BLOCK(dst, dst_end) \
     sse4_is_all_one((__m128i*) dst, (__m128i*) (dst_end))
 
+#define VECT_BIT_DECODE32(w, arr, base) \
+    sse4_bit_decode32(w, arr, base)
+
+#define VECT_BIT_TRANSPOSE32(arr, arr_size, tmatrix) \
+    sse2_bit_block_transpose32(arr, arr_size, tmatrix)
+
+#define VECT_BIT_BLOCK_XOR_PREFIX(first, last, carry) \
+    sse2_bit_block_xor_prefix((__m128i*) (first), (__m128i*) (last), (carry))
+
 
 
 /*!
@@ -437,6 +437,89 @@ const bm::gap_word_t* sse2_gap_sum_arr(
     return pbuf;
 }
 
+/*!
+    @brief Bit transposition of 32-bit words array into bit-plain matrix
+    (SSE2 variant of vect_bit_transpose<unsigned, 32, set_block_plain_size>)
+    
+    Every 32 words of the source form one matrix column, sign bits of the 
+    words are collected by movemask and words are shifted left to bring 
+    the next bit plain into the sign position.
+    
+    @param arr - source array (size must be multiple of 32)
+    @param arr_size - source array size
+    @param tmatrix - destination bit matrix
+    
+    @ingroup SSE2
+*/
+inline
+void sse2_bit_block_transpose32(const bm::word_t* BMRESTRICT arr,
+                                unsigned arr_size,
+                     bm::word_t tmatrix[bm::set_block_plain_cnt][bm::set_block_plain_size])
+{
+    BM_ASSERT(arr_size % 32 == 0);
+    for (unsigned col = 0; col < arr_size / 32; ++col, arr += 32)
+    {
+        __m128i v[8];
+        for (unsigned k = 0; k < 8; ++k)
+            v[k] = _mm_loadu_si128((const __m128i*)(arr + k * 4));
+        for (int j = 31; j >= 0; --j)
+        {
+            unsigned w = 0;
+            for (unsigned k = 0; k < 8; ++k)
+            {
+                w |= unsigned(_mm_movemask_ps(_mm_castsi128_ps(v[k]))) << (k * 4);
+                v[k] = _mm_slli_epi32(v[k], 1);
+            }
+            tmatrix[j][col] = w;
+        } // for j
+    } // for col
+}
+
+/*!
+    @brief Prefix XOR of bit block (bit i := XOR of bits [0..i])
+
+    Turns a block of run boundary toggles into runs of 1s (used for
+    GAP to bit block conversion). Words are scanned with shift-xor steps,
+    word parities are propagated across the vector lanes and carried
+    to the next vector.
+
+    @param block - bit block start (does not need to be aligned)
+    @param block_end - bit block end
+    @param carry - initial carry (0 or ~0u, the value of bit -1)
+
+    @ingroup SSE2
+*/
+inline
+void sse2_bit_block_xor_prefix(__m128i* BMRESTRICT block,
+                               __m128i* BMRESTRICT block_end,
+                               bm::word_t carry)
+{
+    __m128i mc = _mm_set1_epi32(int(carry));
+    do
+    {
+        __m128i x = _mm_loadu_si128(block);
+        x = _mm_xor_si128(x, _mm_slli_epi32(x, 1));
+        x = _mm_xor_si128(x, _mm_slli_epi32(x, 2));
+        x = _mm_xor_si128(x, _mm_slli_epi32(x, 4));
+        x = _mm_xor_si128(x, _mm_slli_epi32(x, 8));
+        x = _mm_xor_si128(x, _mm_slli_epi32(x, 16));
+
+        // word parities (sign bits) -> exclusive prefix across lanes
+        __m128i m = _mm_srai_epi32(x, 31);
+        __m128i t = _mm_xor_si128(m, _mm_slli_si128(m, 4));
+        t = _mm_xor_si128(t, _mm_slli_si128(t, 8));
+        t = _mm_xor_si128(t, m);
+
+        x = _mm_xor_si128(x, t);
+
+        // parity of the vector is taken before the carry is applied
+        // to keep the loop carried dependency to one XOR
+        __m128i p = _mm_shuffle_epi32(_mm_srai_epi32(x, 31), 0xFF);
+        _mm_storeu_si128(block, _mm_xor_si128(x, mc));
+        mc = _mm_xor_si128(mc, p);
+    } while (++block < block_end);
+}
+
 
 } // namespace
 
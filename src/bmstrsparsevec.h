@@ -0,0 +1,592 @@
+#ifndef BMSTRSPARSEVEC__H__INCLUDED__
+#define BMSTRSPARSEVEC__H__INCLUDED__
+/*
+Copyright(c) 2002-2017 Anatoliy Kuznetsov(anatoliy_kuznetsov at yahoo.com)
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+For more information please visit:  http://bitmagic.io
+*/
+
+#include <memory.h>
+
+#ifndef BM_NO_STL
+#include <stdexcept>
+#endif
+
+#include "bm.h"
+#include "bmtrans.h"
+#include "bmalgo.h"
+#include "bmdef.h"
+#include "bmbmatrix.h"
+
+
+namespace bm
+{
+
+/*!
+   \brief sparse vector for strings with compression using bit transposition
+   method
+
+   Strings are stored character by character in bit-plains: character
+   position i of all strings (column of the string matrix) is kept in
+   sizeof(CharType)*8 bit-plains, (i * sizeof(CharType)*8 + bit) is the
+   plain index. Characters after the string terminator are 0 and take no
+   space, so short strings in a wide container are cheap, sorted or
+   repetitive columns compress well with GAP blocks.
+
+   Bit-plains storage, NULL support and memory management are shared
+   with sparse_vector<> (see base_sparse_vector<>), so the container can be
+   serialized with sparse_vector_serialize() and searched with
+   sparse_vector_scanner<>::find_eq_str().
+
+   \param CharType - character type (char, unsigned char, wchar_t)
+   \param BV - bit-vector type for bit-plains
+   \param MAX_STR_SIZE - maximum string length (no terminator)
+
+   \ingroup svector
+*/
+template<typename CharType, typename BV, unsigned MAX_STR_SIZE>
+class str_sparse_vector : public base_sparse_vector<CharType, BV, MAX_STR_SIZE>
+{
+public:
+    typedef base_sparse_vector<CharType, BV, MAX_STR_SIZE> base_type;
+    typedef CharType                                 value_type;
+    typedef bm::id_t                                 size_type;
+    typedef BV                                       bvector_type;
+    typedef bvector_type*                            bvector_type_ptr;
+    typedef const value_type*                        const_reference;
+    typedef typename BV::allocator_type              allocator_type;
+    typedef typename bvector_type::allocation_policy allocation_policy_type;
+    typedef typename base_type::statistics           statistics;
+
+    enum str_params
+    {
+        max_str_size = MAX_STR_SIZE,
+        char_bits = sizeof(CharType) * 8
+    };
+
+public:
+    // size, NULL support, bit-plains access and memory management
+    // are inherited from base_sparse_vector<>
+    using base_type::size;
+    using base_type::empty;
+    using base_type::resize;
+    using base_type::clear;
+    using base_type::is_nullable;
+    using base_type::get_null_bvector;
+    using base_type::is_null;
+    using base_type::get_plain;
+    using base_type::plains;
+    using base_type::stored_plains;
+    using base_type::plain;
+    using base_type::free_plain;
+    using base_type::optimize;
+    using base_type::optimize_gap_size;
+    using base_type::calc_stat;
+
+public:
+    /*!
+        \brief Sparse vector constructor
+
+        \param null_able - defines if vector supports NULL values flag
+            by default it is OFF, use bm::use_null to enable it
+        \param ap - allocation strategy for underlying bit-vectors
+        Default allocation policy uses BM_BIT setting (fastest access)
+        \param bv_max_size - maximum possible size of underlying bit-vectors
+        Please note, this is NOT size of svector itself, it is dynamic upper limit
+        which should be used very carefully if we surely know the ultimate size
+        \param alloc  - allocator for bit-vectors
+
+        \sa bvector<>
+        \sa sparse_vector
+    */
+    str_sparse_vector(bm::null_support null_able = bm::no_null,
+                      allocation_policy_type ap = allocation_policy_type(),
+                      size_type bv_max_size = bm::id_max,
+                      const allocator_type&   alloc  = allocator_type());
+
+    /*! copy-ctor */
+    str_sparse_vector(const str_sparse_vector& str_sv);
+
+    /*! copy assignmment operator */
+    str_sparse_vector& operator = (const str_sparse_vector& str_sv)
+    {
+        if (this != &str_sv)
+            this->copy_from(str_sv);
+        return *this;
+    }
+
+    /*! \brief content exchange
+    */
+    void swap(str_sparse_vector& str_sv) BMNOEXEPT;
+
+    /** \brief set specified element to unassigned value (NULL)
+        \param idx - element index
+    */
+    void set_null(size_type idx);
+
+    /*!
+        \brief set specified element with bounds checking and automatic resize
+        \param idx  - element index
+        \param str  - zero terminated string (up to MAX_STR_SIZE characters)
+    */
+    void set(size_type idx, const value_type* str);
+
+    /*!
+        \brief push value back into vector
+        \param str  - zero terminated string (up to MAX_STR_SIZE characters)
+    */
+    void push_back(const value_type* str) { set_value(size_, str); ++size_; }
+
+    /*!
+        \brief get specified element
+
+        \param idx  - element index
+        \param str  - string buffer
+        \param buf_size - string buffer size (including the terminator)
+
+        \return string length
+    */
+    size_type get(size_type idx, value_type* str, size_type buf_size) const;
+
+    /*!
+        \brief Compare vector element with argument lexicographically
+
+        \param idx - vactor element index
+        \param str - argument to compare with
+
+        \return 0 - equal, < 0 - vect[idx] < str, >0 otherwise
+    */
+    int compare(size_type idx, const value_type* str) const;
+
+    /*!
+        \brief Import strings from an array of zero terminated strings
+
+        Blocks of the vector which are not yet populated are imported
+        by bit-matrix transposition of 32-bit columns (4 chars for char)
+        of the string matrix, other rows are set one by one.
+
+        \param strs - array of string pointers
+        \param size - number of strings to import
+        \param offset - target index in the sparse vector to import into
+    */
+    void import(const value_type* const* strs,
+                size_type size,
+                size_type offset = 0);
+
+    /*!
+        \brief check if another vector has the same content
+        \param str_sv - vector to compare with
+        \param null_able - flag to consider NULL vector in comparison (default)
+        or compare only value content plains
+
+        \return true, if it is the same
+    */
+    bool equal(const str_sparse_vector& str_sv,
+               bm::null_support null_able = bm::use_null) const;
+
+protected:
+    /// set string value of the element (no size check)
+    void set_value(size_type idx, const value_type* str);
+
+    /// import of a block aligned chunk into unpopulated block of the vector
+    void import_block(const value_type* const* strs, unsigned size,
+                      unsigned nb, unsigned* arr, bm::word_t* tb);
+
+    /// check if block is not populated in any of the value plains
+    bool is_block_empty(unsigned i, unsigned j) const;
+
+    /// code of a character (unsigned representation)
+    static unsigned char_code(value_type ch)
+        { return unsigned(ch) & (~0u >> (32 - char_bits)); }
+
+    /// length of a string, throws range error if it is longer than maximum
+    unsigned str_length(const value_type* str) const;
+
+    using base_type::effective_plains;
+    using base_type::value_bits;
+    using base_type::null_plain;
+    using base_type::get_block;
+    using base_type::throw_range_error;
+    using base_type::get_null_bvect;
+
+    using base_type::alloc_;
+    using base_type::plains_;
+    using base_type::size_;
+};
+
+
+//---------------------------------------------------------------------
+//
+//---------------------------------------------------------------------
+
+template<class CharType, class BV, unsigned MAX_STR_SIZE>
+str_sparse_vector<CharType, BV, MAX_STR_SIZE>::str_sparse_vector(
+        bm::null_support null_able,
+        allocation_policy_type  ap,
+        size_type               bv_max_size,
+        const allocator_type&   alloc)
+: base_type(null_able, ap, bv_max_size, alloc)
+{
+    BM_ASSERT(sizeof(CharType) <= sizeof(unsigned));
+}
+
+//---------------------------------------------------------------------
+
+template<class CharType, class BV, unsigned MAX_STR_SIZE>
+str_sparse_vector<CharType, BV, MAX_STR_SIZE>::str_sparse_vector(
+                                        const str_sparse_vector& str_sv)
+: base_type(str_sv)
+{}
+
+//---------------------------------------------------------------------
+
+template<class CharType, class BV, unsigned MAX_STR_SIZE>
+void str_sparse_vector<CharType, BV, MAX_STR_SIZE>::swap(
+                                    str_sparse_vector& str_sv) BMNOEXEPT
+{
+    base_type::swap(str_sv);
+}
+
+//---------------------------------------------------------------------
+
+template<class CharType, class BV, unsigned MAX_STR_SIZE>
+bool str_sparse_vector<CharType, BV, MAX_STR_SIZE>::is_block_empty(
+                                                unsigned i, unsigned j) const
+{
+    unsigned eff_plains = effective_plains();
+    for (unsigned p = 0; p < eff_plains; ++p)
+    {
+        if (get_block(p, i, j))
+            return false;
+    }
+    return true;
+}
+
+//---------------------------------------------------------------------
+
+template<class CharType, class BV, unsigned MAX_STR_SIZE>
+void str_sparse_vector<CharType, BV, MAX_STR_SIZE>::set_null(size_type idx)
+{
+    if (idx >= size_)
+        size_ = idx+1;
+    this->clear_range(idx, idx, true);
+}
+
+//---------------------------------------------------------------------
+
+template<class CharType, class BV, unsigned MAX_STR_SIZE>
+unsigned str_sparse_vector<CharType, BV, MAX_STR_SIZE>::str_length(
+                                            const value_type* str) const
+{
+    BM_ASSERT(str);
+    unsigned len = 0;
+    for (; str[len]; ++len)
+    {
+        if (len == MAX_STR_SIZE)
+            throw_range_error("string sparse vector: string is too long");
+    }
+    return len;
+}
+
+//---------------------------------------------------------------------
+
+template<class CharType, class BV, unsigned MAX_STR_SIZE>
+void str_sparse_vector<CharType, BV, MAX_STR_SIZE>::set(
+                                    size_type idx, const value_type* str)
+{
+    if (idx >= size_)
+        size_ = idx+1;
+    set_value(idx, str);
+}
+
+//---------------------------------------------------------------------
+
+template<class CharType, class BV, unsigned MAX_STR_SIZE>
+void str_sparse_vector<CharType, BV, MAX_STR_SIZE>::set_value(
+                                    size_type idx, const value_type* str)
+{
+    unsigned len = str_length(str);
+
+    unsigned nb = unsigned(idx >>  bm::set_block_shift);
+    unsigned i0 = nb >> bm::set_array_shift; // top block address
+    unsigned j0 = nb &  bm::set_array_mask;  // address in sub-block
+
+    // clear the old value
+    unsigned eff_plains = effective_plains();
+    for (unsigned p = 0; p < eff_plains; ++p)
+    {
+        if (get_block(p, i0, j0))
+            plains_[p]->clear_bit(idx);
+    }
+
+    unsigned char b_list[char_bits];
+    for (unsigned i = 0; i < len; ++i)
+    {
+        unsigned bcnt = bm::bitscan(char_code(str[i]), b_list);
+        unsigned p0 = i * char_bits;
+        for (unsigned j = 0; j < bcnt; ++j)
+            get_plain(p0 + b_list[j])->set_bit_no_check(idx);
+    } // for i
+
+    bvector_type* bv_null = get_null_bvect();
+    if (bv_null)
+        bv_null->set_bit_no_check(idx);
+}
+
+//---------------------------------------------------------------------
+
+template<class CharType, class BV, unsigned MAX_STR_SIZE>
+typename str_sparse_vector<CharType, BV, MAX_STR_SIZE>::size_type
+str_sparse_vector<CharType, BV, MAX_STR_SIZE>::get(
+            size_type idx, value_type* str, size_type buf_size) const
+{
+    BM_ASSERT(idx < size_);
+    BM_ASSERT(str && buf_size);
+
+    // calculate logical block coordinates and masks
+    //
+    unsigned nb = unsigned(idx >>  bm::set_block_shift);
+    unsigned i0 = nb >> bm::set_array_shift; // top block address
+    unsigned j0 = nb &  bm::set_array_mask;  // address in sub-block
+    unsigned nbit = unsigned(idx & bm::set_block_mask);
+    unsigned nword  = unsigned(nbit >> bm::set_word_shift);
+    unsigned mask0 = 1u << (nbit & bm::set_word_mask);
+
+    size_type i = 0;
+    for (; i < MAX_STR_SIZE && i < buf_size - 1; ++i)
+    {
+        unsigned ch = 0;
+        unsigned p0 = unsigned(i) * char_bits;
+        for (unsigned k = 0; k < char_bits; ++k)
+        {
+            const bm::word_t* blk = get_block(p0 + k, i0, j0);
+            if (!blk)
+                continue;
+            unsigned is_set = (BM_IS_GAP(blk)) ?
+                        bm::gap_test_unr(BMGAP_PTR(blk), nbit) :
+                        (blk[nword] & mask0);
+            ch |= unsigned(bool(is_set)) << k;
+        } // for k
+        if (!ch)
+            break;
+        str[i] = value_type(ch);
+    } // for i
+    str[i] = 0;
+    return i;
+}
+
+//---------------------------------------------------------------------
+
+template<class CharType, class BV, unsigned MAX_STR_SIZE>
+int str_sparse_vector<CharType, BV, MAX_STR_SIZE>::compare(
+                            size_type idx, const value_type* str) const
+{
+    BM_ASSERT(idx < size_);
+    BM_ASSERT(str);
+
+    unsigned nb = unsigned(idx >>  bm::set_block_shift);
+    unsigned i0 = nb >> bm::set_array_shift; // top block address
+    unsigned j0 = nb &  bm::set_array_mask;  // address in sub-block
+    unsigned nbit = unsigned(idx & bm::set_block_mask);
+    unsigned nword  = unsigned(nbit >> bm::set_word_shift);
+    unsigned mask0 = 1u << (nbit & bm::set_word_mask);
+
+    for (unsigned i = 0; i < MAX_STR_SIZE; ++i)
+    {
+        unsigned ch = 0;
+        unsigned p0 = i * char_bits;
+        for (unsigned k = 0; k < char_bits; ++k)
+        {
+            const bm::word_t* blk = get_block(p0 + k, i0, j0);
+            if (!blk)
+                continue;
+            unsigned is_set = (BM_IS_GAP(blk)) ?
+                        bm::gap_test_unr(BMGAP_PTR(blk), nbit) :
+                        (blk[nword] & mask0);
+            ch |= unsigned(bool(is_set)) << k;
+        } // for k
+        unsigned arg_ch = char_code(str[i]);
+        if (ch != arg_ch)
+            return (ch < arg_ch) ? -1 : 1;
+        if (!ch)
+            return 0;
+    } // for i
+    return str[MAX_STR_SIZE] ? -1 : 0;
+}
+
+//---------------------------------------------------------------------
+
+template<class CharType, class BV, unsigned MAX_STR_SIZE>
+void str_sparse_vector<CharType, BV, MAX_STR_SIZE>::import(
+                                    const value_type* const* strs,
+                                    size_type size,
+                                    size_type offset)
+{
+    if (size == 0)
+        throw_range_error("sparse_vector range error (import size 0)");
+    BM_ASSERT(strs);
+
+    if (offset + size > size_)
+        size_ = offset + size;
+
+    unsigned*   arr = 0; // 32-bit column of the string matrix block
+    bm::word_t* tb = 0;  // transposition matrix: 32 bit-blocks
+
+    for (size_type i = 0; i < size; )
+    {
+        size_type idx = offset + i;
+        unsigned nbit = unsigned(idx & bm::set_block_mask);
+        unsigned nb = unsigned(idx >> bm::set_block_shift);
+        unsigned chunk = bm::gap_max_bits - nbit;
+        if (chunk > size - i)
+            chunk = unsigned(size - i);
+
+        if (!nbit && is_block_empty(nb >> bm::set_array_shift,
+                                    nb &  bm::set_array_mask))
+        {
+            if (!arr) // 32-bit columns and string lengths
+            {
+                arr = (unsigned*)alloc_.alloc_bit_block(bm::set_block_plain_cnt * 2);
+                tb = alloc_.alloc_bit_block(bm::set_block_plain_cnt);
+            }
+            import_block(strs + i, chunk, nb, arr, tb);
+        }
+        else
+        {
+            for (unsigned k = 0; k < chunk; ++k)
+                set_value(idx + k, strs[i + k]);
+        }
+        i += chunk;
+    } // for i
+
+    if (arr)
+    {
+        alloc_.free_bit_block((bm::word_t*)arr, bm::set_block_plain_cnt * 2);
+        alloc_.free_bit_block(tb, bm::set_block_plain_cnt);
+    }
+}
+
+//---------------------------------------------------------------------
+
+template<class CharType, class BV, unsigned MAX_STR_SIZE>
+void str_sparse_vector<CharType, BV, MAX_STR_SIZE>::import_block(
+                                    const value_type* const* strs,
+                                    unsigned     size,
+                                    unsigned     nb,
+                                    unsigned*    arr,
+                                    bm::word_t*  tb)
+{
+    BM_ASSERT(size && size <= bm::gap_max_bits);
+    const unsigned chars_per_word = 32 / char_bits;
+
+    unsigned* lens = arr + bm::gap_max_bits; // string lengths
+    unsigned max_len = 0;
+    for (unsigned k = 0; k < size; ++k)
+    {
+        unsigned len = lens[k] = str_length(strs[k]);
+        if (len > max_len)
+            max_len = len;
+    }
+    if (size < bm::gap_max_bits) // tail rows of the block stay empty
+        ::memset(arr + size, 0, (bm::gap_max_bits - size) * sizeof(unsigned));
+
+    // each 32-bit column of the string matrix is transposed into 32 plains
+    for (unsigned pos = 0; pos < max_len; pos += chars_per_word)
+    {
+        for (unsigned k = 0; k < size; ++k)
+        {
+            const value_type* str = strs[k];
+            unsigned len = lens[k];
+            unsigned w = 0;
+            for (unsigned c = 0; c < chars_per_word && pos + c < len; ++c)
+                w |= char_code(str[pos + c]) << (c * char_bits);
+            arr[k] = w;
+        } // for k
+
+        bm::vect_bit_transpose<unsigned, bm::set_block_plain_cnt, bm::set_block_size>
+            (arr, bm::gap_max_bits, (unsigned(*)[bm::set_block_size])tb);
+
+        unsigned p0 = pos * char_bits;
+        for (unsigned p = 0; p < 32 && p0 + p < value_bits(); ++p)
+        {
+            const bm::word_t* row = tb + p * bm::set_block_size;
+            if (bm::bit_is_all_zero((bm::wordop_t*)row,
+                                    (bm::wordop_t*)(row + bm::set_block_size)))
+                continue;
+            bvector_type* bv = get_plain(p0 + p);
+            typename bvector_type::blocks_manager_type& bman =
+                                                    bv->get_blocks_manager();
+            if (bm::is_bits_one((bm::wordop_t*)row,
+                                (bm::wordop_t*)(row + bm::set_block_size)))
+            {
+                bman.set_block_all_set(nb);
+            }
+            else
+            {
+                bm::word_t* blk = bman.get_allocator().alloc_bit_block();
+                bm::bit_block_copy(blk, row);
+                bm::word_t* old_blk = bman.set_block(nb, blk);
+                BM_ASSERT(!old_blk); (void) old_blk;
+            }
+            bv->forget_count();
+        } // for p
+    } // for pos
+
+    bvector_type* bv_null = get_null_bvect();
+    if (bv_null)
+    {
+        bm::id_t base = bm::id_t(nb) << bm::set_block_shift;
+        bv_null->set_range(base, base + size - 1);
+    }
+}
+
+//---------------------------------------------------------------------
+
+template<class CharType, class BV, unsigned MAX_STR_SIZE>
+bool str_sparse_vector<CharType, BV, MAX_STR_SIZE>::equal(
+                                const str_sparse_vector& str_sv,
+                                bm::null_support null_able) const
+{
+    if (size_ != str_sv.size_)
+        return false;
+    unsigned plains = (null_able == bm::use_null) ? stored_plains() : this->plains();
+    for (unsigned j = 0; j < plains; ++j)
+    {
+        const bvector_type* bv = plains_[j];
+        const bvector_type* arg_bv = str_sv.plains_[j];
+        if (bv == arg_bv) // same NULL
+            continue;
+        if (!bv || !arg_bv)
+        {
+            if (j == null_plain()) // NULL-able vs not NULL-able
+                return false;
+            if ((bv && bv->any()) || (arg_bv && arg_bv->any()))
+                return false;
+            continue;
+        }
+        if (bv->compare(*arg_bv) != 0)
+            return false;
+    } // for j
+    return true;
+}
+
+//---------------------------------------------------------------------
+
+
+} // namespace bm
+
+#include "bmundef.h"
+
+#endif
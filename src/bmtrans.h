@@ -314,6 +314,22 @@ void vect_bit_transpose(const T* arr,
 }
 
 
+#ifdef VECT_BIT_TRANSPOSE32
+/**
+    32-bit words transposition (full bit-block), SIMD version
+*/
+template<>
+inline
+void vect_bit_transpose<unsigned, bm::set_block_plain_cnt, 
+                        bm::set_block_plain_size>(const unsigned* arr, 
+                        unsigned arr_size,
+                        unsigned tmatrix[bm::set_block_plain_cnt]
+                                        [bm::set_block_plain_size])
+{
+    VECT_BIT_TRANSPOSE32(arr, arr_size, tmatrix);
+}
+#endif
+
 /**
     Restore bit array from the transposition matrix
     T - array type (any int)
@@ -341,6 +357,71 @@ void vect_bit_trestore(const T  tmatrix[BPC][BPS],
 
 
 
+/**
+    In-place transposition of 32x32 bit matrix
+    (bit c of row r becomes bit r of row c)
+    
+    Off-diagonal sub-matrices are swapped with halving size (16, 8, 4, 2, 1),
+    5 rounds of branch-free shift/xor over all rows
+    
+    \param m - bit matrix (32 rows)
+*/
+inline
+void bit_matrix_transpose32(unsigned* m)
+{
+    static const unsigned masks[5] = 
+        { 0x0000FFFFu, 0x00FF00FFu, 0x0F0F0F0Fu, 0x33333333u, 0x55555555u };
+    for (unsigned s = 16, k = 0; s; s >>= 1, ++k)
+    {
+        unsigned mask = masks[k];
+        for (unsigned r = 0; r < 32; r = (r + s + 1) & ~s)
+        {
+            unsigned t = ((m[r] >> s) ^ m[r + s]) & mask;
+            m[r + s] ^= t;
+            m[r] ^= t << s;
+        } // for r
+    } // for s
+}
+
+
+/**
+    32-bit words transposition into 32 bit-blocks (one plain per bit),
+    done by 32x32 bit matrix transpositions
+    
+    \param arr      - source array start (up to bm::set_block_size*32 values)
+    \param arr_size - source array size
+    \param tmatrix  - destination bit matrix (32 bit-blocks)
+*/
+template<>
+inline
+void vect_bit_transpose<unsigned, bm::set_block_plain_cnt, bm::set_block_size>(
+                        const unsigned* arr, 
+                        unsigned arr_size,
+                        unsigned tmatrix[bm::set_block_plain_cnt]
+                                        [bm::set_block_size])
+{
+    BM_ASSERT(arr_size <= bm::set_block_plain_cnt * bm::set_block_size);
+    unsigned m[32];
+    unsigned col = 0;
+    for (unsigned i = 0; i < arr_size; i += 32, arr += 32, ++col)
+    {
+        unsigned n = arr_size - i;
+        if (n >= 32)
+        {
+            ::memcpy(m, arr, sizeof(m));
+        }
+        else
+        {
+            ::memcpy(m, arr, n * sizeof(unsigned));
+            ::memset(m + n, 0, (32 - n) * sizeof(unsigned));
+        }
+        bm::bit_matrix_transpose32(m);
+        for (unsigned j = 0; j < bm::set_block_plain_cnt; ++j)
+            tmatrix[j][col] = m[j];
+    } // for i
+}
+
+
 /*!
     \brief Compute pairwise Row x Row Humming distances on plains(rows) of 
            the transposed bit block
@@ -0,0 +1,593 @@
+#ifndef BMVIEW__H__INCLUDED__
+#define BMVIEW__H__INCLUDED__
+/*
+Copyright(c) 2002-2017 Anatoliy Kuznetsov(anatoliy_kuznetsov at yahoo.com)
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+For more information please visit:  http://bitmagic.io
+*/
+
+/*! \file bmview.h
+    \brief Read-only zero-copy view of bvector<> over a block-aligned
+    memory image (memory mapped file, etc.)
+
+    Unlike serialization BLOBs, the view image keeps blocks in place:
+    bit blocks and GAP blocks are stored as is, aligned for SIMD access,
+    and addressed through a two level table of block offsets.
+    bm::bvector_view attaches to the image without decoding or memory
+    allocation, algorithms use the blocks directly from the image.
+
+    The image is native: it can only be attached on a system with the
+    same byte order and the same bm::id_t size (BM64ADDR setting).
+*/
+
+#include <string.h>
+
+#include "bm.h"
+#include "bmfunc.h"
+
+#include "bmdef.h"
+
+namespace bm
+{
+
+/// View image constants
+enum view_params
+{
+    view_magic = 0x57564D42,      ///< "BMVW"
+    view_version = 1,             ///< image format version
+    view_block_align = 64,        ///< alignment of bit blocks in the image
+    view_gap_align = 16,          ///< alignment of GAP blocks in the image
+#if defined(BMAVX512OPT)
+    view_buf_align = 64,          ///< min alignment of the attached memory
+#elif defined(BMAVX2OPT) || defined(BM_SIMD_DISPATCH)
+    view_buf_align = 32,          ///< min alignment of the attached memory
+#else
+    view_buf_align = 16,          ///< min alignment of the attached memory
+#endif
+    view_null_table = 0xFFFFFFFFu ///< top directory entry of an empty top block
+};
+
+/**
+    Header of the view image.
+
+ <pre>
+ | HEADER | TOP DIRECTORY | BLOCK TABLES | BIT BLOCKS | GAP BLOCKS |
+
+ TOP DIRECTORY:  INT32 per top block: block table index or view_null_table
+ BLOCK TABLES:   bm::set_array_size INT64 descriptors per table:
+                 0 - empty block, 1 - full block,
+                 even - offset of a bit block,
+                 odd - (offset | 1) of a GAP block
+ </pre>
+
+    All offsets are from the beginning of the image.
+    @ingroup bvserial
+*/
+struct view_header
+{
+    bm::word_t    magic;        ///< view_magic
+    unsigned char version;      ///< view_version
+    unsigned char byte_order;   ///< bm::ByteOrder of the image
+    unsigned char id_size;      ///< sizeof(bm::id_t)
+    unsigned char reserved0;
+    bm::word_t    top_size;     ///< number of top blocks
+    bm::word_t    table_count;  ///< number of block tables
+    bm::id64_t    bv_size;      ///< size of the vector
+    bm::id64_t    dir_offset;   ///< offset of the top directory
+    bm::id64_t    table_offset; ///< offset of the block tables
+    bm::id64_t    image_size;   ///< size of the image
+    bm::id64_t    reserved1[2];
+};
+
+
+/**
+    \brief Read-only view of bvector<> over a memory image
+
+    View does not own the memory, the image must stay available
+    (mapped) while the view is in use.
+    All methods are const and thread safe.
+
+    @ingroup bvector
+*/
+template<class BV>
+class bvector_view
+{
+public:
+    typedef BV                 bvector_type;
+    typedef bm::id_t           size_type;
+
+public:
+    bvector_view();
+
+    /**
+        \brief Attach view to the image
+        \param buf  - image memory (aligned at least as bit blocks
+                      for SIMD, memory mapped files are)
+        \param size - size of the available memory
+        \return false if the image is damaged or not compatible
+    */
+    bool attach(const unsigned char* buf, size_t size);
+
+    /// Detach from the image
+    void detach();
+
+    /// true if the view is attached to an image
+    bool is_attached() const { return buf_ != 0; }
+
+    /// Size of the vector
+    size_type size() const { return size_; }
+
+    /// Size of the attached image
+    size_t image_size() const { return image_size_; }
+
+    /// Number of top level blocks
+    unsigned top_block_size() const { return top_size_; }
+
+    /// Number of bits ON
+    bm::id_t count() const;
+
+    /// true if any bits are ON
+    bool any() const;
+
+    /// Test the bit
+    bool test(bm::id_t n) const;
+
+    /// Index of the first bit ON (0 if none)
+    bm::id_t get_first() const { return check_or_next(0); }
+
+    /// Index of the next bit ON after prev (0 if none)
+    bm::id_t get_next(bm::id_t prev) const
+    {
+        return (++prev == bm::id_max) ? 0 : check_or_next(prev);
+    }
+
+    /**
+        \brief Combine the view with the target vector
+        \param bv - target vector
+        \param op - set_OR, set_AND, set_SUB or set_XOR
+    */
+    void combine_into(BV& bv, bm::set_operation op) const;
+
+    /**
+        \brief Block of the view
+        \return block pointer (GAP pointers tagged as in bvector<>),
+                FULL_BLOCK_REAL_ADDR for full blocks or NULL
+    */
+    const bm::word_t* get_block(unsigned nb) const;
+
+private:
+    bm::id_t check_or_next(bm::id_t prev) const;
+
+    /// block table of the top block (NULL if the top block is empty)
+    const bm::id64_t* get_table(unsigned i) const
+    {
+        if (i >= top_size_ || top_dir_[i] == bm::view_null_table)
+            return 0;
+        return tables_ + (size_t(top_dir_[i]) << bm::set_array_shift);
+    }
+
+    const bm::word_t* decode_block(bm::id64_t d) const
+    {
+        if (d == 0)
+            return 0;
+        if (d == 1)
+            return FULL_BLOCK_REAL_ADDR;
+        const bm::word_t* p = (const bm::word_t*)(buf_ + size_t(d & ~1ull));
+        if (d & 1)
+            return (const bm::word_t*)BMPTR_SETBIT0(p);
+        return p;
+    }
+
+private:
+    const unsigned char*  buf_;
+    size_t                image_size_;
+    size_type             size_;
+    unsigned              top_size_;
+    const bm::word_t*     top_dir_;
+    const bm::id64_t*     tables_;
+};
+
+
+/**
+    \brief Compute size of the view image of the vector
+    \ingroup bvserial
+*/
+template<class BV>
+size_t view_image_size(const BV& bv);
+
+/**
+    \brief Save vector as a view image (see bm::bvector_view)
+    \param bv  - source vector
+    \param buf - target memory of view_image_size(bv) bytes
+    \return size of the image
+    \ingroup bvserial
+*/
+template<class BV>
+size_t save_view(const BV& bv, unsigned char* buf);
+
+
+//---------------------------------------------------------------------
+
+/// Layout of the view image (offsets of sections)
+struct view_layout
+{
+    unsigned   top_size;
+    unsigned   table_count;
+    size_t     dir_offset;
+    size_t     table_offset;
+    size_t     bit_offset;
+    size_t     gap_offset;
+    size_t     image_size;
+};
+
+/// Align offset (power of 2 alignment)
+inline size_t view_align(size_t offset, size_t align)
+{
+    return (offset + align - 1) & ~(align - 1);
+}
+
+/// Plan the view image of the vector
+template<class BV>
+void view_plan_layout(const BV& bv, view_layout& layout)
+{
+    const typename BV::blocks_manager_type& bman = bv.get_blocks_manager();
+
+    unsigned top_size = bman.is_init() ? bman.effective_top_block_size() : 0;
+    unsigned table_count = 0;
+    size_t bit_blocks = 0;
+    size_t gap_size = 0;
+    for (unsigned i = 0; i < top_size; ++i)
+    {
+        const bm::word_t* const* blk_blk = bman.get_topblock(i);
+        if (!blk_blk)
+            continue;
+        bool any_block = false;
+        for (unsigned j = 0; j < bm::set_array_size; ++j)
+        {
+            const bm::word_t* blk = blk_blk[j];
+            if (!blk)
+                continue;
+            any_block = true;
+            if (BM_IS_GAP(blk))
+            {
+                unsigned len = bm::gap_length(BMGAP_PTR(blk));
+                gap_size += bm::view_align(len * sizeof(bm::gap_word_t),
+                                           bm::view_gap_align);
+            }
+            else
+            if (!IS_FULL_BLOCK(blk))
+                ++bit_blocks;
+        } // for j
+        table_count += any_block;
+    } // for i
+
+    layout.top_size = top_size;
+    layout.table_count = table_count;
+    layout.dir_offset = sizeof(bm::view_header);
+    layout.table_offset = bm::view_align(
+                layout.dir_offset + top_size * sizeof(bm::word_t), 8);
+    layout.bit_offset = bm::view_align(layout.table_offset +
+        size_t(table_count) * bm::set_array_size * sizeof(bm::id64_t),
+        bm::view_block_align);
+    layout.gap_offset = layout.bit_offset +
+                        bit_blocks * bm::set_block_size * sizeof(bm::word_t);
+    layout.image_size = layout.gap_offset + gap_size;
+}
+
+template<class BV>
+size_t view_image_size(const BV& bv)
+{
+    bm::view_layout layout;
+    bm::view_plan_layout(bv, layout);
+    return layout.image_size;
+}
+
+template<class BV>
+size_t save_view(const BV& bv, unsigned char* buf)
+{
+    const typename BV::blocks_manager_type& bman = bv.get_blocks_manager();
+    bm::view_layout layout;
+    bm::view_plan_layout(bv, layout);
+    ::memset(buf, 0, layout.bit_offset);
+
+    bm::view_header* hdr = (bm::view_header*) buf;
+    hdr->magic = bm::view_magic;
+    hdr->version = bm::view_version;
+    hdr->byte_order = (unsigned char) globals<true>::byte_order();
+    hdr->id_size = (unsigned char) sizeof(bm::id_t);
+    hdr->top_size = layout.top_size;
+    hdr->table_count = layout.table_count;
+    hdr->bv_size = bv.size();
+    hdr->dir_offset = layout.dir_offset;
+    hdr->table_offset = layout.table_offset;
+    hdr->image_size = layout.image_size;
+
+    bm::word_t* top_dir = (bm::word_t*)(buf + layout.dir_offset);
+    bm::id64_t* table = (bm::id64_t*)(buf + layout.table_offset);
+    size_t bit_offset = layout.bit_offset;
+    size_t gap_offset = layout.gap_offset;
+    unsigned table_idx = 0;
+    for (unsigned i = 0; i < layout.top_size; ++i)
+    {
+        top_dir[i] = bm::view_null_table;
+        const bm::word_t* const* blk_blk = bman.get_topblock(i);
+        if (!blk_blk)
+            continue;
+        for (unsigned j = 0; j < bm::set_array_size; ++j)
+        {
+            const bm::word_t* blk = blk_blk[j];
+            if (!blk)
+                continue;
+            if (top_dir[i] == bm::view_null_table)
+                top_dir[i] = table_idx++;
+            bm::id64_t& d = table[(size_t(top_dir[i]) << bm::set_array_shift) + j];
+            if (BM_IS_GAP(blk))
+            {
+                const bm::gap_word_t* gap_blk = BMGAP_PTR(blk);
+                size_t len = bm::gap_length(gap_blk) * sizeof(bm::gap_word_t);
+                size_t len_aligned = bm::view_align(len, bm::view_gap_align);
+                ::memcpy(buf + gap_offset, gap_blk, len);
+                ::memset(buf + gap_offset + len, 0, len_aligned - len);
+                d = bm::id64_t(gap_offset) | 1;
+                gap_offset += len_aligned;
+            }
+            else
+            if (IS_FULL_BLOCK(blk))
+            {
+                d = 1;
+            }
+            else
+            {
+                ::memcpy(buf + bit_offset, blk,
+                         bm::set_block_size * sizeof(bm::word_t));
+                d = bit_offset;
+                bit_offset += bm::set_block_size * sizeof(bm::word_t);
+            }
+        } // for j
+    } // for i
+    BM_ASSERT(table_idx == layout.table_count);
+    BM_ASSERT(bit_offset == layout.gap_offset);
+    BM_ASSERT(gap_offset == layout.image_size);
+    return layout.image_size;
+}
+
+//---------------------------------------------------------------------
+
+template<class BV>
+bvector_view<BV>::bvector_view()
+: buf_(0),
+  image_size_(0),
+  size_(0),
+  top_size_(0),
+  top_dir_(0),
+  tables_(0)
+{}
+
+template<class BV>
+bool bvector_view<BV>::attach(const unsigned char* buf, size_t size)
+{
+    detach();
+    if (!buf || size < sizeof(bm::view_header))
+        return false;
+    if (size_t(buf) & (bm::view_buf_align - 1)) // SIMD alignment
+        return false;
+    const bm::view_header* hdr = (const bm::view_header*) buf;
+    if (hdr->magic != bm::view_magic || hdr->version != bm::view_version)
+        return false;
+    if (hdr->byte_order != (unsigned char) globals<true>::byte_order() ||
+        hdr->id_size != sizeof(bm::id_t))
+        return false;
+    if (hdr->image_size > size ||
+        hdr->bv_size > bm::id64_t(bm::id_max) ||
+        hdr->table_offset + bm::id64_t(hdr->table_count) *
+            bm::set_array_size * sizeof(bm::id64_t) > hdr->image_size ||
+        hdr->dir_offset +
+            bm::id64_t(hdr->top_size) * sizeof(bm::word_t) > hdr->image_size)
+        return false;
+
+    buf_ = buf;
+    image_size_ = size_t(hdr->image_size);
+    size_ = size_type(hdr->bv_size);
+    top_size_ = hdr->top_size;
+    top_dir_ = (const bm::word_t*)(buf + hdr->dir_offset);
+    tables_ = (const bm::id64_t*)(buf + hdr->table_offset);
+    return true;
+}
+
+template<class BV>
+void bvector_view<BV>::detach()
+{
+    buf_ = 0;
+    image_size_ = 0;
+    size_ = 0;
+    top_size_ = 0;
+    top_dir_ = 0;
+    tables_ = 0;
+}
+
+template<class BV>
+const bm::word_t* bvector_view<BV>::get_block(unsigned nb) const
+{
+    const bm::id64_t* table = get_table(nb >> bm::set_array_shift);
+    return table ? decode_block(table[nb & bm::set_array_mask]) : 0;
+}
+
+template<class BV>
+bm::id_t bvector_view<BV>::count() const
+{
+    bm::id_t cnt = 0;
+    for (unsigned i = 0; i < top_size_; ++i)
+    {
+        const bm::id64_t* table = get_table(i);
+        if (!table)
+            continue;
+        for (unsigned j = 0; j < bm::set_array_size; ++j)
+        {
+            const bm::word_t* blk = decode_block(table[j]);
+            if (!blk)
+                continue;
+            if (BM_IS_GAP(blk))
+                cnt += bm::gap_bit_count_unr(BMGAP_PTR(blk));
+            else
+                cnt += IS_FULL_BLOCK(blk) ? bm::bits_in_block :
+                        bm::bit_block_calc_count(blk, blk + bm::set_block_size);
+        } // for j
+    } // for i
+    return cnt;
+}
+
+template<class BV>
+bool bvector_view<BV>::any() const
+{
+    for (unsigned i = 0; i < top_size_; ++i)
+    {
+        const bm::id64_t* table = get_table(i);
+        if (!table)
+            continue;
+        for (unsigned j = 0; j < bm::set_array_size; ++j)
+        {
+            const bm::word_t* blk = decode_block(table[j]);
+            if (!blk)
+                continue;
+            if (BM_IS_GAP(blk))
+            {
+                if (!bm::gap_is_all_zero(BMGAP_PTR(blk), bm::gap_max_bits))
+                    return true;
+            }
+            else
+            if (IS_FULL_BLOCK(blk) ||
+                !bm::bit_is_all_zero((const bm::wordop_t*)blk,
+                          (const bm::wordop_t*)(blk + bm::set_block_size)))
+                return true;
+        } // for j
+    } // for i
+    return false;
+}
+
+template<class BV>
+bool bvector_view<BV>::test(bm::id_t n) const
+{
+    BM_ASSERT(n < size_);
+    const bm::word_t* blk = get_block(unsigned(n >> bm::set_block_shift));
+    if (!blk)
+        return false;
+    unsigned nbit = unsigned(n & bm::set_block_mask);
+    if (BM_IS_GAP(blk))
+        return bm::gap_test_unr(BMGAP_PTR(blk), nbit);
+    if (IS_FULL_BLOCK(blk))
+        return true;
+    return bm::test_bit(blk, nbit);
+}
+
+template<class BV>
+bm::id_t bvector_view<BV>::check_or_next(bm::id_t prev) const
+{
+    for (;;)
+    {
+        unsigned nblock = unsigned(prev >> bm::set_block_shift);
+        unsigned i = nblock >> bm::set_array_shift;
+        if (i >= top_size_)
+            break;
+        const bm::id64_t* table = get_table(i);
+        if (!table)
+        {
+            prev += (bm::set_blkblk_mask + 1) - (prev & bm::set_blkblk_mask);
+        }
+        else
+        {
+            unsigned nbit = unsigned(prev & bm::set_block_mask);
+            const bm::word_t* blk =
+                decode_block(table[nblock & bm::set_array_mask]);
+            if (blk)
+            {
+                if (BM_IS_GAP(blk))
+                {
+                    if (bm::gap_find_in_block(BMGAP_PTR(blk), nbit, &prev))
+                        return prev;
+                }
+                else
+                {
+                    if (IS_FULL_BLOCK(blk))
+                        return prev;
+                    if (bm::bit_find_in_block(blk, nbit, &prev))
+                        return prev;
+                }
+            }
+            else
+            {
+                prev += (bm::set_block_mask + 1) - (prev & bm::set_block_mask);
+            }
+        }
+        if (!prev)
+            break;
+    } // for
+    return 0;
+}
+
+template<class BV>
+void bvector_view<BV>::combine_into(BV& bv, bm::set_operation op) const
+{
+    bm::operation opcode = bm::setop2op(op);
+    typename BV::blocks_manager_type& bman = bv.get_blocks_manager();
+
+    if (!bman.is_init())
+    {
+        if (opcode == BM_AND || opcode == BM_SUB)
+            return;
+        bman.init_tree();
+    }
+    if (bv.size() < size_)
+        bv.resize(size_);
+
+    unsigned top_size = top_size_;
+    if (opcode == BM_AND && bman.top_block_size() > top_size)
+        top_size = bman.top_block_size();
+
+    for (unsigned i = 0; i < top_size; ++i)
+    {
+        const bm::word_t* const* blk_blk = bman.get_topblock(i);
+        const bm::id64_t* table = get_table(i);
+        if (!table)
+        {
+            if (opcode == BM_AND && blk_blk) // X AND 0 == 0
+            {
+                for (unsigned j = 0; j < bm::set_array_size; ++j)
+                    if (blk_blk[j])
+                        bman.zero_block(i, j);
+            }
+            continue;
+        }
+        if (!blk_blk && (opcode == BM_AND || opcode == BM_SUB))
+            continue;
+        unsigned r = i * bm::set_array_size;
+        for (unsigned j = 0; j < bm::set_array_size; ++j)
+        {
+            const bm::word_t* arg_blk = decode_block(table[j]);
+            // target tree may be re-allocated by the previous operation
+            blk_blk = bman.get_topblock(i);
+            if (!arg_blk && !(blk_blk && blk_blk[j]))
+                continue;
+            bv.combine_operation_with_block(r + j, arg_blk,
+                                            BM_IS_GAP(arg_blk), opcode);
+        } // for j
+    } // for i
+    bv.forget_count();
+}
+
+} // namespace bm
+
+#include "bmundef.h"
+
+#endif
@@ -18,6 +18,8 @@ limitations under the License.
 For more information please visit:  http://bitmagic.io
 */
 
+#include "bmdef.h"
+
 #ifdef _MSC_VER
 #pragma warning( push )
 #pragma warning( disable : 4100)
@@ -488,6 +490,8 @@ private:
 
 } // namespace bm
 
+#include "bmundef.h"
+
 #ifdef _MSC_VER
 #pragma warning( pop )
 #endif
@@ -133,6 +133,7 @@ public:
     decoder_little_endian(const unsigned char* buf);
     bm::short_t get_16();
     bm::word_t get_32();
+    bm::id64_t get_64();
     void get_32(bm::word_t* w, unsigned count);
     void get_16(bm::short_t* s, unsigned count);
 };
@@ -787,7 +788,7 @@ inline bm::id64_t decoder::get_64()
 #if (BM_UNALIGNED_ACCESS_OK == 1)
 	bm::id64_t a = *((bm::id64_t*)buf_);
 #else
-	bm::word_t a = buf_[0]+
+	bm::id64_t a = buf_[0]+
                    ((bm::id64_t)buf_[1] << 8)  +
                    ((bm::id64_t)buf_[2] << 16) +
                    ((bm::id64_t)buf_[3] << 24) +
@@ -889,6 +890,16 @@ BMFORCEINLINE bm::word_t decoder_little_endian::get_32()
     return a;
 }
 
+BMFORCEINLINE bm::id64_t decoder_little_endian::get_64() 
+{
+    bm::id64_t a = ((bm::id64_t)buf_[0] << 56) + ((bm::id64_t)buf_[1] << 48) +
+                   ((bm::id64_t)buf_[2] << 40) + ((bm::id64_t)buf_[3] << 32) +
+                   ((bm::id64_t)buf_[4] << 24) + ((bm::id64_t)buf_[5] << 16) +
+                   ((bm::id64_t)buf_[6] << 8)  + ((bm::id64_t)buf_[7]);
+    buf_+=sizeof(a);
+    return a;
+}
+
 inline void decoder_little_endian::get_32(bm::word_t* w, unsigned count)
 {
     if (!w) 
@@ -40,6 +40,7 @@ For more information please visit:  http://bitmagic.io
 #include "bmserial.h"
 #include "bmrandom.h"
 #include "bmsparsevec.h"
+#include "bmsparsevec_algo.h"
 
 
 //#include "bmdbg.h"
@@ -50,6 +51,7 @@ void show_help()
 {
     std::cerr
       << "BitMagic benchmark (analytical) (c) 2017."  << std::endl
+      << "-t    -- print timings"  << std::endl
       << std::endl
       ;
 }
@@ -78,6 +80,11 @@ int parse_args(int argc, char *argv[])
             show_help();
             return 0;
         }
+        if ((arg == "-t") || (arg == "--timing"))
+        {
+            is_timing = true;
+            continue;
+        }
     } // for i
     return 0;
 }
@@ -91,6 +98,9 @@ typedef  std::map<unsigned, TBVector> TIDMap;
 typedef  std::map<uint64_t, TBVector> TID64Map;
 typedef  std::map<unsigned, std::vector<char> > TIDSMap;
 typedef  std::map<uint64_t, std::vector<char> > TID64SMap;
+typedef  bm::sparse_vector<unsigned, TBVector> TSVector;
+typedef  bm::sparse_vector_group_by<TSVector> TGroupBy;
+typedef  std::map<unsigned, TGroupBy::group_stat> TGroupStatMap;
 
 
 bm::chrono_taker::duration_map_type  timing_map;
@@ -172,6 +182,10 @@ struct LineItem
     
     TIDMap     lineitem_order_bvmap;    // order index
     TIDSMap    lineitem_order_smap;     // order index (compressed)
+    
+    TSVector   lineitem_quantity_sv;    // L_QUANTITY column
+    TSVector   lineitem_shipyear_sv;    // ship year column
+    TIDMap     lineitem_shipyear_bvmap; // ship year index
 };
 
 
@@ -593,6 +607,8 @@ void GenerateLineItemIdx(LineItem& litem, const Order& ord, const Customer& cust
                 bv_supp[li_id] = true;
                 bv_litem[li_id] = true;
                 bv_order[li_id] = true;
+                litem.lineitem_quantity_sv.push_back(1 + rand() % 50);
+                litem.lineitem_shipyear_sv.push_back(unsigned(order_year));
                 ++li_id;
             }
         }
@@ -614,6 +630,8 @@ void GenerateLineItemIdx(LineItem& litem, const Order& ord, const Customer& cust
                 bv_supp[li_id] = true;
                 bv_litem[li_id] = true;
                 bv_order[li_id] = true;
+                litem.lineitem_quantity_sv.push_back(1 + rand() % 50);
+                litem.lineitem_shipyear_sv.push_back(unsigned(order_year));
 
                 if (rand()%3 == 0)
                 {
@@ -663,6 +681,22 @@ void GenerateLineItemIdx(LineItem& litem, const Order& ord, const Customer& cust
                         litem.lineitem_order_bvmap,
                         litem.lineitem_order_smap);
 
+    // ship year index: OR of the shipdate index vectors of the year
+    for (TID64SMap::const_iterator it = litem.lineitem_shipdate_smap.begin();
+         it != litem.lineitem_shipdate_smap.end();
+         ++it)
+    {
+        unsigned year = unsigned(it->first >> 32);
+        const std::vector<char>& buf_vect = it->second;
+        bm::deserialize(litem.lineitem_shipyear_bvmap[year],
+                        (unsigned char*)&buf_vect[0]);
+    } // for
+    OptimizeIDMap(litem.lineitem_shipyear_bvmap);
+    
+    BM_DECLARE_TEMP_BLOCK(tb)
+    litem.lineitem_quantity_sv.optimize(tb);
+    litem.lineitem_shipyear_sv.optimize(tb);
+
     std::cout
       << "Lineitems count = " << litem.lineitem_total_bv->count() << std::endl
       << "Lineitems shipdate index size = " << litem.lineitem_shipdate_smap.size() << std::endl
@@ -672,6 +706,58 @@ void GenerateLineItemIdx(LineItem& litem, const Order& ord, const Customer& cust
 
 }
 
+// Query:
+// SELECT shipyear, COUNT(*), SUM(L_QUANTITY) FROM LINEITEM
+//   WHERE L_QUANTITY > 25
+//   GROUP BY shipyear
+//
+// runs GROUP BY over the ship year column and over the ship year index
+//
+void QueryQuantityByYear(const LineItem& litem)
+{
+    bm::sparse_vector_scanner<TSVector> scanner;
+    TGroupBy gb;
+    TBVector bv_filter;
+    TGroupStatMap res_sv, res_idx;
+    
+    {
+        bm::chrono_taker tt("Q1. WHERE L_QUANTITY > 25", 1, &timing_map);
+        scanner.find_gt(litem.lineitem_quantity_sv, 25, bv_filter);
+    }
+    {
+        bm::chrono_taker tt("Q1. GROUP BY shipyear (sparse vector)", 1, &timing_map);
+        gb.group_by(litem.lineitem_shipyear_sv, bv_filter,
+                    litem.lineitem_quantity_sv, res_sv);
+    }
+    {
+        bm::chrono_taker tt("Q1. GROUP BY shipyear (id map)", 1, &timing_map);
+        gb.group_by_map(litem.lineitem_shipyear_bvmap, bv_filter,
+                        litem.lineitem_quantity_sv, res_idx);
+    }
+    
+    std::cout << "Q1. shipyear; count; sum(quantity)" << std::endl;
+    for (TGroupStatMap::const_iterator it = res_sv.begin();
+         it != res_sv.end();
+         ++it)
+    {
+        const TGroupBy::group_stat& st = it->second;
+        std::cout << it->first << "; " << st.count << "; " << st.sum
+                  << std::endl;
+        
+        const TGroupBy::group_stat& st_idx = res_idx[it->first];
+        if (st.count != st_idx.count || st.sum != st_idx.sum)
+        {
+            std::cerr << "GROUP BY results mismatch!" << std::endl;
+            exit(1);
+        }
+    } // for
+    if (res_sv.size() != res_idx.size())
+    {
+        std::cerr << "GROUP BY groups mismatch!" << std::endl;
+        exit(1);
+    }
+}
+
 int main(int argc, char *argv[])
 {
     Suppliers supp;
@@ -687,17 +773,17 @@ int main(int argc, char *argv[])
 */
     try
     {
-    /*
         auto ret = parse_args(argc, argv);
         if (ret != 0)
             return ret;
-    */
         
         GenerateSuppliersIdx(supp);
         GenerateCustomersIdx(cust);
         GenerateOrdersIdx(ord, cust);
         GenerateLineItemIdx(lineitem, ord, cust);
         
+        QueryQuantityByYear(lineitem);
+        
         getchar();
 
         
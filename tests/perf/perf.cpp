@@ -32,6 +32,7 @@ For more information please visit:  http://bitmagic.io
 #endif
 
 #include <vector>
+#include <string>
 #include <random>
 #include <memory>
 
@@ -41,6 +42,11 @@ For more information please visit:  http://bitmagic.io
 #include "bmsparsevec.h"
 #include "bmsparsevec_algo.h"
 #include "bmsparsevec_serial.h"
+#include "bmsparsevec_compr.h"
+#include "bmstrsparsevec.h"
+#include "bmaggregator.h"
+#include "bmparallel.h"
+#include "bmview.h"
 
 //#include "bmdbg.h"
 
@@ -641,6 +647,61 @@ extern "C" {
     }
 } // extern C
 
+static
+void ImportSortedTest()
+{
+    std::vector<bm::id_t> vect_sparse, vect_dense;
+    for (bm::id_t i = 0; i < BSIZE * 2; i += 1 + (i % 100))
+        vect_sparse.push_back(i);
+    for (bm::id_t i = 0; i < BSIZE / 4; ++i)
+        if ((i % 13) != 0)
+            vect_dense.push_back(i);
+    const unsigned repeats = REPEATS / 30;
+    unsigned cnt = 0;
+    
+    {
+        TimeTaker tt("set_bit() of sorted sparse ids", repeats);
+        for (unsigned r = 0; r < repeats; ++r)
+        {
+            bvect bv(bm::BM_GAP);
+            for (size_t i = 0; i < vect_sparse.size(); ++i)
+                bv.set_bit(vect_sparse[i]);
+            cnt += bv.any();
+        }
+    }
+    {
+        TimeTaker tt("import_sorted() of sorted sparse ids", repeats);
+        for (unsigned r = 0; r < repeats; ++r)
+        {
+            bvect bv(bm::BM_GAP);
+            bv.import_sorted(&vect_sparse[0], vect_sparse.size());
+            cnt += bv.any();
+        }
+    }
+    {
+        TimeTaker tt("inserter of sorted dense ids", repeats);
+        for (unsigned r = 0; r < repeats; ++r)
+        {
+            bvect bv;
+            bvect::insert_iterator it = bv.inserter();
+            for (size_t i = 0; i < vect_dense.size(); ++i)
+                *it = vect_dense[i];
+            cnt += bv.any();
+        }
+    }
+    {
+        TimeTaker tt("import_sorted() of sorted dense ids", repeats);
+        for (unsigned r = 0; r < repeats; ++r)
+        {
+            bvect bv;
+            bv.import_sorted(&vect_dense[0], vect_dense.size());
+            cnt += bv.any();
+        }
+    }
+    char cbuf[256];
+    sprintf(cbuf, "%u ", cnt); // to fool some smart compilers like ICC
+}
+
 static
 void EnumeratorTest()
 {
@@ -777,6 +838,36 @@ void EnumeratorTest()
     
     // -----------------------------------------------
 
+    {
+        const size_t page_size = 1024;
+        bm::id_t page[page_size];
+        bvect* bvs[] = { &bv1, &bv2, &bv3, &bv4 };
+        std::vector<bm::id_t>* vs[] = { &v1, &v2, &v3, &v4 };
+
+        TimeTaker tt("bvector<>::decode()", REPEATS/10);
+        for (i = 0; i < REPEATS/10; ++i)
+        {
+            for (unsigned k = 0; k < 4; ++k)
+            {
+                bm::id_t from = 0;
+                for (;;)
+                {
+                    size_t n = bvs[k]->decode(page, page_size, from);
+                    vs[k]->insert(vs[k]->end(), page, page + n);
+                    if (n < page_size)
+                        break;
+                    from = page[n-1] + 1;
+                }
+            }
+            v1.resize(0);
+            v2.resize(0);
+            v3.resize(0);
+            v4.resize(0);
+        } // for REPEATS
+    }
+
+    // -----------------------------------------------
+
 
     delete bset;
 
@@ -1331,6 +1422,91 @@ void AndCountTest()
 }
 
 
+// GAP block with len runs (random run lengths)
+static
+void FillGapRuns(bm::gap_word_t* buf, unsigned len)
+{
+    unsigned step = 65536 / (len + 1);
+    unsigned pos = 0, i = 0;
+    while (i < len)
+    {
+        pos += 1 + unsigned(rand()) % (2 * step);
+        if (pos >= 65535)
+            break;
+        buf[++i] = (bm::gap_word_t)pos;
+    }
+    buf[++i] = 65535;
+    buf[0] = (bm::gap_word_t)((unsigned(rand()) & 1) + (i << 3));
+}
+
+static
+void GAPOperationsTest()
+{
+    const unsigned gap_cnt = 32;
+    const unsigned repeats = REPEATS * 100;
+    bm::gap_word_t (*gaps1)[bm::gap_max_buff_len] = 
+                        new bm::gap_word_t[gap_cnt][bm::gap_max_buff_len];
+    bm::gap_word_t (*gaps2)[bm::gap_max_buff_len] = 
+                        new bm::gap_word_t[gap_cnt][bm::gap_max_buff_len];
+    bm::gap_word_t tmp_buf[bm::gap_max_buff_len * 3];
+    BM_DECLARE_TEMP_BLOCK(tb)
+
+    char msg[256];
+    unsigned cnt = 0;
+    for (unsigned level = 0; level < bm::gap_levels; ++level)
+    {
+        // operands are filled to ~90% of the GAP level capacity
+        unsigned len = bm::gap_len_table<true>::_len[level] * 9 / 10;
+        for (unsigned k = 0; k < gap_cnt; ++k)
+        {
+            FillGapRuns(gaps1[k], len);
+            FillGapRuns(gaps2[k], len);
+        }
+        
+        {
+        sprintf(msg, "GAP AND/OR/XOR/SUB operations, GAP level %u", level);
+        TimeTaker tt(msg, repeats);
+        for (unsigned i = 0; i < repeats; ++i)
+        {
+            const bm::gap_word_t* g1 = gaps1[i % gap_cnt];
+            const bm::gap_word_t* g2 = gaps2[(i / gap_cnt) % gap_cnt];
+            unsigned dsize;
+            cnt += bm::gap_operation_and(g1, g2, tmp_buf, dsize)[1];
+            cnt += bm::gap_operation_or(g1, g2, tmp_buf, dsize)[1];
+            cnt += bm::gap_operation_xor(g1, g2, tmp_buf, dsize)[1];
+            cnt += bm::gap_operation_sub(g1, g2, tmp_buf, dsize)[1];
+        }
+        }
+        {
+        sprintf(msg, "GAP AND/OR/XOR/SUB COUNT, GAP level %u", level);
+        TimeTaker tt(msg, repeats);
+        for (unsigned i = 0; i < repeats; ++i)
+        {
+            const bm::gap_word_t* g1 = gaps1[i % gap_cnt];
+            const bm::gap_word_t* g2 = gaps2[(i / gap_cnt) % gap_cnt];
+            cnt += bm::gap_count_and(g1, g2);
+            cnt += bm::gap_count_or(g1, g2);
+            cnt += bm::gap_count_xor(g1, g2);
+            cnt += bm::gap_count_sub(g1, g2);
+        }
+        }
+        {
+        sprintf(msg, "GAP to bit-block conversion, GAP level %u", level);
+        TimeTaker tt(msg, repeats);
+        for (unsigned i = 0; i < repeats; ++i)
+        {
+            bm::gap_convert_to_bitset(tb, gaps1[i % gap_cnt]);
+            cnt += tb[i % bm::set_block_size];
+        }
+        }
+    } // for level
+
+    delete [] gaps1;
+    delete [] gaps2;
+
+    sprintf(msg, "%u", cnt); // to keep the results alive
+}
+
 static
 void TI_MetricTest()
 {
@@ -1749,6 +1925,28 @@ void SparseVectorAccessTest()
     }
 
 
+    {
+        TimeTaker tt("sparse_vector push_back() test", REPEATS/10 );
+        for (unsigned i = 0; i < REPEATS/10; ++i)
+        {
+            svect sv3;
+            for (unsigned j = 0; j < 20000000; ++j)
+                sv3.push_back(j & 0xFFFF);
+        }
+    }
+    
+    {
+        TimeTaker tt("sparse_vector back_insert_iterator test", REPEATS/10 );
+        for (unsigned i = 0; i < REPEATS/10; ++i)
+        {
+            svect sv3;
+            svect::back_insert_iterator bi = sv3.get_back_inserter();
+            for (unsigned j = 0; j < 20000000; ++j)
+                bi = j & 0xFFFF;
+            bi.flush();
+        }
+    }
+
     unsigned long long cnt = 0;
     {
         TimeTaker tt("sparse_vector random element access test", REPEATS/10 );
@@ -1762,6 +1960,34 @@ void SparseVectorAccessTest()
         }
     }
     
+    {
+        TimeTaker tt("sparse_vector get() of sorted index list test", REPEATS/10 );
+        for (unsigned i = 0; i < REPEATS/10; ++i)
+        {
+            for (unsigned j = 256000; j < 190000000/2; j += 3)
+                cnt += sv1.get(j);
+        }
+    }
+    
+    {
+        const unsigned buf_size = 65536;
+        std::vector<unsigned> idx(buf_size);
+        std::vector<unsigned> vals(buf_size);
+        TimeTaker tt("sparse_vector gather() of sorted index list test", REPEATS/10 );
+        for (unsigned i = 0; i < REPEATS/10; ++i)
+        {
+            for (unsigned j = 256000; j < 190000000/2; )
+            {
+                unsigned n = 0;
+                for (; n < buf_size && j < 190000000/2; ++n, j += 3)
+                    idx[n] = j;
+                sv1.gather(vals.data(), idx.data(), n);
+                for (unsigned k = 0; k < n; ++k)
+                    cnt += vals[k];
+            }
+        }
+    }
+    
     {
         TimeTaker tt("sparse_vector extract test", REPEATS );
         for (unsigned i = 0; i < REPEATS/10; ++i)
@@ -1778,6 +2004,775 @@ void SparseVectorAccessTest()
 }
 
 
+static
+void SparseVectorScannerTest()
+{
+    svect   sv1;
+
+    FillSparseIntervals(sv1);
+    BM_DECLARE_TEMP_BLOCK(tb)
+    sv1.optimize(tb);
+    
+    bm::sparse_vector_scanner<svect> scanner;
+    bvect bv_res;
+    unsigned long long cnt = 0;
+    
+    {
+        TimeTaker tt("sparse_vector scanner find_eq() test", REPEATS/10 );
+        for (unsigned i = 0; i < REPEATS/10; ++i)
+        {
+            scanner.find_eq(sv1, 0xFFE, bv_res);
+            cnt += bv_res.count();
+            scanner.find_eq(sv1, unsigned(rand()) % 128000, bv_res);
+            cnt += bv_res.count();
+        }
+    }
+    
+    {
+        TimeTaker tt("sparse_vector scanner find_zero() test", REPEATS/10 );
+        for (unsigned i = 0; i < REPEATS/10; ++i)
+        {
+            scanner.find_zero(sv1, bv_res);
+            cnt += bv_res.count();
+        }
+    }
+    
+    {
+        TimeTaker tt("sparse_vector scanner find_lt()/find_range() test", REPEATS/10 );
+        for (unsigned i = 0; i < REPEATS/10; ++i)
+        {
+            scanner.find_lt(sv1, 0xFFE, bv_res);
+            cnt += bv_res.count();
+            unsigned from = unsigned(rand()) % 128000;
+            scanner.find_range(sv1, from, from + 1000, bv_res);
+            cnt += bv_res.count();
+        }
+    }
+    
+    {
+        unsigned vals[16];
+        TimeTaker tt("sparse_vector scanner find_in() test (16 values)", REPEATS/10 );
+        for (unsigned i = 0; i < REPEATS/10; ++i)
+        {
+            for (unsigned j = 0; j < 16; ++j)
+                vals[j] = unsigned(rand()) % 128000;
+            scanner.find_in(sv1, vals, 16, bv_res);
+            cnt += bv_res.count();
+        }
+    }
+    
+    char buf[256];
+    sprintf(buf, "%i", (int)cnt); // to fool some smart compilers like ICC
+}
+
+static
+void SparseVectorAggregatesTest()
+{
+    svect   sv1;
+
+    FillSparseIntervals(sv1);
+    BM_DECLARE_TEMP_BLOCK(tb)
+    sv1.optimize(tb);
+    
+    bvect bv_mask;
+    for (unsigned i = 0; i < sv1.size(); i += 3)
+        bv_mask.set_bit(i);
+    bv_mask.optimize(tb);
+    
+    unsigned long long cnt = 0;
+    const unsigned repeats = REPEATS / 10;
+    
+    {
+        TimeTaker tt("sparse_vector<> masked SUM enumerator/get() test", repeats / 10);
+        for (unsigned i = 0; i < repeats / 10; ++i)
+        {
+            bvect::enumerator en = bv_mask.first();
+            for (; en.valid(); ++en)
+                cnt += sv1.get(*en);
+        }
+    }
+    
+    {
+        TimeTaker tt("sparse_vector<> bit-sliced masked SUM test", repeats);
+        for (unsigned i = 0; i < repeats; ++i)
+            cnt += bm::sparse_vector_sum(sv1, bv_mask);
+    }
+    
+    {
+        TimeTaker tt("sparse_vector<> bit-sliced masked MIN/MAX test", repeats);
+        for (unsigned i = 0; i < repeats; ++i)
+        {
+            unsigned v;
+            if (bm::sparse_vector_min(sv1, bv_mask, v))
+                cnt += v;
+            if (bm::sparse_vector_max(sv1, bv_mask, v))
+                cnt += v;
+        }
+    }
+    
+    char buf[256];
+    sprintf(buf, "%i", (int)cnt); // to fool some smart compilers like ICC
+}
+
+static
+void RSCSparseVectorAccessTest()
+{
+    typedef bm::rsc_sparse_vector<unsigned, svect> rsc_svect;
+    
+    svect sv1(bm::use_null);
+    for (unsigned i = 0; i < BSIZE / 2; i += 7)
+        sv1.set(i, i & 0xFFFF);
+    BM_DECLARE_TEMP_BLOCK(tb)
+    sv1.optimize(tb);
+    
+    rsc_svect csv1;
+    csv1.load_from(sv1);
+    csv1.optimize(tb);
+    
+    unsigned long long cnt = 0;
+    const unsigned repeats = REPEATS / 10;
+    const unsigned sz = sv1.size();
+    
+    {
+        TimeTaker tt("sparse_vector<> NULL-able random get() test", repeats);
+        for (unsigned r = 0; r < repeats; ++r)
+            for (unsigned i = r; i < sz; i += 1013)
+                cnt += sv1.get(i);
+    }
+    {
+        TimeTaker tt("rsc_sparse_vector<> random get() test", repeats);
+        for (unsigned r = 0; r < repeats; ++r)
+            for (unsigned i = r; i < sz; i += 1013)
+                cnt += csv1.get(i);
+    }
+    
+    std::vector<unsigned> arr(65536);
+    {
+        TimeTaker tt("sparse_vector<> NULL-able decode() test", repeats / 10);
+        for (unsigned r = 0; r < repeats / 10; ++r)
+            for (unsigned i = 0; i < sz; i += unsigned(arr.size()))
+            {
+                sv1.decode(&arr[0], i, unsigned(arr.size()));
+                cnt += arr[r & 0xFFFF];
+            }
+    }
+    {
+        TimeTaker tt("rsc_sparse_vector<> decode() test", repeats / 10);
+        for (unsigned r = 0; r < repeats / 10; ++r)
+            for (unsigned i = 0; i < sz; i += unsigned(arr.size()))
+            {
+                csv1.decode(&arr[0], i, unsigned(arr.size()));
+                cnt += arr[r & 0xFFFF];
+            }
+    }
+    
+    char buf[256];
+    sprintf(buf, "%i", (int)cnt); // to fool some smart compilers like ICC
+}
+
+static
+void RemapSparseVectorTest()
+{
+    typedef bm::remap_sparse_vector<unsigned, svect> remap_svect;
+    
+    svect sv1;
+    {
+        std::vector<unsigned> vals;
+        for (unsigned i = 0; i < BSIZE / 20; ++i)
+            vals.push_back(0x7F000000 + (unsigned(rand()) % 300) * 4099);
+        sv1.import(&vals[0], unsigned(vals.size()));
+    }
+    BM_DECLARE_TEMP_BLOCK(tb)
+    sv1.optimize(tb);
+    
+    remap_svect rsv1;
+    rsv1.load_from(sv1);
+    rsv1.optimize(tb);
+    
+    unsigned long long cnt = 0;
+    const unsigned repeats = REPEATS / 10;
+    bm::sparse_vector_scanner<svect> scanner;
+    bvect bv_res;
+    const unsigned v = 0x7F000000 + 150 * 4099;
+    {
+        TimeTaker tt("sparse_vector<> 300 large values find_eq() test", repeats);
+        for (unsigned r = 0; r < repeats; ++r)
+        {
+            scanner.find_eq(sv1, v, bv_res);
+            cnt += bv_res.count();
+        }
+    }
+    {
+        TimeTaker tt("remap_sparse_vector<> find_eq() test", repeats);
+        for (unsigned r = 0; r < repeats; ++r)
+        {
+            scanner.find_eq(rsv1, v, bv_res);
+            cnt += bv_res.count();
+        }
+    }
+    {
+        TimeTaker tt("sparse_vector<> 300 large values find_range() test", repeats / 10);
+        for (unsigned r = 0; r < repeats / 10; ++r)
+        {
+            scanner.find_range(sv1, v, v + 100 * 4099, bv_res);
+            cnt += bv_res.count();
+        }
+    }
+    {
+        TimeTaker tt("remap_sparse_vector<> find_range() test", repeats / 10);
+        for (unsigned r = 0; r < repeats / 10; ++r)
+        {
+            scanner.find_range(rsv1, v, v + 100 * 4099, bv_res);
+            cnt += bv_res.count();
+        }
+    }
+    
+    std::vector<unsigned> arr(65536);
+    const unsigned sz = sv1.size();
+    {
+        TimeTaker tt("sparse_vector<> 300 large values decode() test", repeats / 10);
+        for (unsigned r = 0; r < repeats / 10; ++r)
+            for (unsigned i = 0; i < sz; i += unsigned(arr.size()))
+            {
+                sv1.decode(&arr[0], i, unsigned(arr.size()));
+                cnt += arr[r & 0xFFFF];
+            }
+    }
+    {
+        TimeTaker tt("remap_sparse_vector<> decode() test", repeats / 10);
+        for (unsigned r = 0; r < repeats / 10; ++r)
+            for (unsigned i = 0; i < sz; i += unsigned(arr.size()))
+            {
+                rsv1.decode(&arr[0], i, unsigned(arr.size()));
+                cnt += arr[r & 0xFFFF];
+            }
+    }
+    
+    char buf[256];
+    sprintf(buf, "%i", (int)cnt); // to fool some smart compilers like ICC
+}
+
+static
+void FORSparseVectorTest()
+{
+    typedef bm::for_sparse_vector<unsigned, svect> for_svect;
+    
+    svect sv1;
+    for_svect fsv1;
+    {
+        std::vector<unsigned> vals;
+        for (unsigned i = 0; i < BSIZE / 20; ++i)
+            vals.push_back(1500000000 + i * 3 + unsigned(rand()) % 100);
+        sv1.import(&vals[0], unsigned(vals.size()));
+        fsv1.import_back(&vals[0], unsigned(vals.size()));
+    }
+    BM_DECLARE_TEMP_BLOCK(tb)
+    sv1.optimize(tb);
+    fsv1.optimize(tb);
+    
+    unsigned long long cnt = 0;
+    const unsigned repeats = REPEATS / 10;
+    bm::sparse_vector_scanner<svect> scanner;
+    bvect bv_res;
+    const unsigned v = sv1.get(sv1.size() / 2);
+    {
+        TimeTaker tt("sparse_vector<> timestamps find_range() test", repeats / 10);
+        for (unsigned r = 0; r < repeats / 10; ++r)
+        {
+            scanner.find_range(sv1, v, v + 1000000, bv_res);
+            cnt += bv_res.count();
+        }
+    }
+    {
+        TimeTaker tt("for_sparse_vector<> find_range() test", repeats / 10);
+        for (unsigned r = 0; r < repeats / 10; ++r)
+        {
+            scanner.find_range(fsv1, v, v + 1000000, bv_res);
+            cnt += bv_res.count();
+        }
+    }
+    
+    std::vector<unsigned> arr(65536);
+    const unsigned sz = sv1.size();
+    {
+        TimeTaker tt("sparse_vector<> timestamps decode() test", repeats / 10);
+        for (unsigned r = 0; r < repeats / 10; ++r)
+            for (unsigned i = 0; i < sz; i += unsigned(arr.size()))
+            {
+                sv1.decode(&arr[0], i, unsigned(arr.size()));
+                cnt += arr[r & 0xFFFF];
+            }
+    }
+    {
+        TimeTaker tt("for_sparse_vector<> decode() test", repeats / 10);
+        for (unsigned r = 0; r < repeats / 10; ++r)
+            for (unsigned i = 0; i < sz; i += unsigned(arr.size()))
+            {
+                fsv1.decode(&arr[0], i, unsigned(arr.size()));
+                cnt += arr[r & 0xFFFF];
+            }
+    }
+    
+    char buf[256];
+    sprintf(buf, "%i", (int)cnt); // to fool some smart compilers like ICC
+}
+
+static
+void SparseVector64Test()
+{
+    typedef bm::sparse_vector<long long, bvect>          svect_i64;
+    typedef bm::sparse_vector<unsigned long long, bvect> svect_u64;
+    
+    const unsigned size = BSIZE / 20;
+    std::vector<long long> money(size);
+    std::vector<unsigned long long> ts(size);
+    for (unsigned i = 0; i < size; ++i)
+    {
+        money[i] = (long long)(rand() % 200000) - 100000; // +/- 1000.00
+        ts[i] = 1500000000000000000ull + i * 1000ull + unsigned(rand()) % 1000;
+    }
+    
+    svect_i64 sv_money;
+    svect_u64 sv_ts;
+    {
+        TimeTaker tt("sparse_vector<int64> back_insert_iterator test", 1);
+        svect_i64::back_insert_iterator bi = sv_money.get_back_inserter();
+        for (unsigned i = 0; i < size; ++i)
+            bi = money[i];
+    }
+    {
+        TimeTaker tt("sparse_vector<uint64> timestamps back_insert_iterator test", 1);
+        svect_u64::back_insert_iterator bi = sv_ts.get_back_inserter();
+        for (unsigned i = 0; i < size; ++i)
+            bi = ts[i];
+    }
+    BM_DECLARE_TEMP_BLOCK(tb)
+    sv_money.optimize(tb);
+    sv_ts.optimize(tb);
+    
+    unsigned long long cnt = 0;
+    const unsigned repeats = REPEATS / 10;
+    {
+        TimeTaker tt("sparse_vector<int64> random get() test", repeats);
+        for (unsigned r = 0; r < repeats; ++r)
+            for (unsigned i = r; i < size; i += 97)
+                cnt += (unsigned long long) sv_money.get(i);
+    }
+    {
+        TimeTaker tt("sparse_vector<uint64> timestamps random get() test", repeats);
+        for (unsigned r = 0; r < repeats; ++r)
+            for (unsigned i = r; i < size; i += 97)
+                cnt += sv_ts.get(i);
+    }
+    
+    std::vector<long long> arr(65536);
+    std::vector<unsigned long long> arr_ts(65536);
+    {
+        TimeTaker tt("sparse_vector<int64> decode() test", repeats / 10);
+        for (unsigned r = 0; r < repeats / 10; ++r)
+            for (unsigned i = 0; i < size; i += unsigned(arr.size()))
+            {
+                sv_money.decode(&arr[0], i, unsigned(arr.size()));
+                cnt += (unsigned long long) arr[r & 0xFFFF];
+            }
+    }
+    {
+        TimeTaker tt("sparse_vector<uint64> timestamps decode() test", repeats / 10);
+        for (unsigned r = 0; r < repeats / 10; ++r)
+            for (unsigned i = 0; i < size; i += unsigned(arr_ts.size()))
+            {
+                sv_ts.decode(&arr_ts[0], i, unsigned(arr_ts.size()));
+                cnt += arr_ts[r & 0xFFFF];
+            }
+    }
+    
+    bm::sparse_vector_scanner<svect_i64> scanner;
+    bvect bv_res, bv_mask;
+    bv_mask.set_range(0, size / 2);
+    {
+        TimeTaker tt("sparse_vector<int64> find_lt(), SUM() test", repeats / 10);
+        for (unsigned r = 0; r < repeats / 10; ++r)
+        {
+            scanner.find_lt(sv_money, -50000 + (long long)r, bv_res);
+            cnt += bv_res.count();
+            cnt += bm::sparse_vector_sum(sv_money, bv_mask);
+        }
+    }
+    
+    char buf[256];
+    sprintf(buf, "%i", (int)cnt); // to fool some smart compilers like ICC
+}
+
+static
+void StrSparseVectorTest()
+{
+    typedef bm::str_sparse_vector<char, bvect, 16> str_svect;
+    
+    const unsigned str_count = 1000000;
+    std::vector<std::string> str_coll;
+    std::vector<const char*> strs;
+    {
+        char buf[32];
+        for (unsigned i = 0; i < str_count; ++i)
+        {
+            sprintf(buf, "ID%u-%u", (i / 1000) * 7, i % 13);
+            str_coll.push_back(std::string(buf));
+        }
+        for (unsigned i = 0; i < str_count; ++i)
+            strs.push_back(str_coll[i].c_str());
+    }
+    
+    str_svect str_sv1, str_sv2;
+    {
+        TimeTaker tt("str_sparse_vector<> push_back() test", 1);
+        for (unsigned i = 0; i < str_count; ++i)
+            str_sv1.push_back(strs[i]);
+    }
+    {
+        TimeTaker tt("str_sparse_vector<> import() test", 1);
+        str_sv2.import(&strs[0], str_count);
+    }
+    BM_DECLARE_TEMP_BLOCK(tb)
+    str_sv2.optimize(tb);
+    
+    unsigned cnt = 0;
+    const unsigned repeats = REPEATS / 30;
+    {
+        TimeTaker tt("str_sparse_vector<> linear scan compare() test", repeats / 10);
+        for (unsigned r = 0; r < repeats / 10; ++r)
+            for (unsigned i = 0; i < str_count; ++i)
+                cnt += (str_sv2.compare(i, "ID700-5") == 0);
+    }
+    {
+        bm::sparse_vector_scanner<str_svect> scanner;
+        bvect bv_res;
+        TimeTaker tt("str_sparse_vector<> find_eq_str() test", repeats);
+        for (unsigned r = 0; r < repeats; ++r)
+        {
+            scanner.find_eq_str(str_sv2, "ID700-5", bv_res);
+            cnt += bv_res.count();
+        }
+    }
+    
+    char buf[256];
+    sprintf(buf, "%i", (int)cnt); // to fool some smart compilers like ICC
+}
+
+static
+void AggregatorTest()
+{
+    const unsigned arg_count = 128;
+    const unsigned repeats = REPEATS / 30;
+    std::vector<bvect*> bv_args;
+    for (unsigned k = 0; k < arg_count; ++k)
+    {
+        bvect* bv = new bvect();
+        unsigned fill_factor = 20 + k % 7;
+        for (unsigned i = k; i < BSIZE / 10; i += fill_factor)
+            bv->set_bit(i);
+        bv_args.push_back(bv);
+    }
+    unsigned cnt = 0;
+
+    {
+        TimeTaker tt("Pairwise OR of 128 bvectors", repeats);
+        for (unsigned r = 0; r < repeats; ++r)
+        {
+            bvect bv_target;
+            for (unsigned k = 0; k < arg_count; ++k)
+                bv_target |= *bv_args[k];
+            cnt += bv_target.any();
+        }
+    }
+    {
+        TimeTaker tt("Aggregator OR of 128 bvectors", repeats);
+        bm::aggregator<bvect> agg;
+        for (unsigned k = 0; k < arg_count; ++k)
+            agg.add(bv_args[k]);
+        for (unsigned r = 0; r < repeats; ++r)
+        {
+            bvect bv_target;
+            agg.combine_or(bv_target);
+            cnt += bv_target.any();
+        }
+    }
+    {
+        TimeTaker tt("Pairwise AND of 128 bvectors", repeats);
+        for (unsigned r = 0; r < repeats; ++r)
+        {
+            bvect bv_target(*bv_args[0]);
+            for (unsigned k = 1; k < arg_count; ++k)
+                bv_target &= *bv_args[k];
+            cnt += bv_target.any();
+        }
+    }
+    {
+        TimeTaker tt("Aggregator AND of 128 bvectors", repeats);
+        bm::aggregator<bvect> agg;
+        for (unsigned k = 0; k < arg_count; ++k)
+            agg.add(bv_args[k]);
+        for (unsigned r = 0; r < repeats; ++r)
+        {
+            bvect bv_target;
+            agg.combine_and(bv_target);
+            cnt += bv_target.any();
+        }
+    }
+    {
+        TimeTaker tt("Pairwise AND-SUB of 64+64 bvectors", repeats);
+        for (unsigned r = 0; r < repeats; ++r)
+        {
+            bvect bv_target(*bv_args[0]);
+            for (unsigned k = 1; k < arg_count / 2; ++k)
+                bv_target &= *bv_args[k];
+            for (unsigned k = arg_count / 2; k < arg_count; ++k)
+                bv_target -= *bv_args[k];
+            cnt += bv_target.any();
+        }
+    }
+    {
+        TimeTaker tt("Aggregator AND-SUB of 64+64 bvectors", repeats);
+        bm::aggregator<bvect> agg;
+        for (unsigned k = 0; k < arg_count; ++k)
+            agg.add(bv_args[k], k < arg_count / 2 ? 0 : 1);
+        for (unsigned r = 0; r < repeats; ++r)
+        {
+            bvect bv_target;
+            cnt += agg.combine_and_sub(bv_target);
+        }
+    }
+    char cbuf[256];
+    sprintf(cbuf, "%u ", cnt); // to fool some smart compilers like ICC
+
+    for (unsigned k = 0; k < arg_count; ++k)
+        delete bv_args[k];
+}
+
+static
+void ParallelOperationsTest()
+{
+    const unsigned repeats = REPEATS / 30;
+    bvect bv1, bv2;
+    for (unsigned i = 0; i < BSIZE * 10; i += 3)
+        bv1.set_bit(i);
+    for (unsigned i = 0; i < BSIZE * 10; i += 7)
+        bv2.set_bit(i);
+    bm::std_thread_executor tpool;
+    unsigned cnt = 0;
+
+    {
+        TimeTaker tt("OR of 1.5G bvectors", repeats);
+        for (unsigned r = 0; r < repeats; ++r)
+        {
+            bvect bv_target(bv1);
+            bv_target |= bv2;
+            cnt += bv_target.any();
+        }
+    }
+    {
+        TimeTaker tt("Block-parallel OR of 1.5G bvectors", repeats);
+        for (unsigned r = 0; r < repeats; ++r)
+        {
+            bvect bv_target(bv1);
+            bm::bit_or_mt(bv_target, bv2, tpool);
+            cnt += bv_target.any();
+        }
+    }
+    {
+        TimeTaker tt("AND of 1.5G bvectors", repeats);
+        for (unsigned r = 0; r < repeats; ++r)
+        {
+            bvect bv_target(bv1);
+            bv_target &= bv2;
+            cnt += bv_target.any();
+        }
+    }
+    {
+        TimeTaker tt("Block-parallel AND of 1.5G bvectors", repeats);
+        for (unsigned r = 0; r < repeats; ++r)
+        {
+            bvect bv_target(bv1);
+            bm::bit_and_mt(bv_target, bv2, tpool);
+            cnt += bv_target.any();
+        }
+    }
+    {
+        TimeTaker tt("count() of 1.5G bvector", repeats * 10);
+        for (unsigned r = 0; r < repeats * 10; ++r)
+            cnt += bv1.count();
+    }
+    {
+        TimeTaker tt("Block-parallel count() of 1.5G bvector", repeats * 10);
+        for (unsigned r = 0; r < repeats * 10; ++r)
+            cnt += bm::count_mt(bv1, tpool);
+    }
+    {
+        TimeTaker tt("optimize() of 1.5G bvector", repeats);
+        for (unsigned r = 0; r < repeats; ++r)
+        {
+            bvect bv_target(bv2);
+            bv_target.optimize();
+            cnt += bv_target.any();
+        }
+    }
+    {
+        TimeTaker tt("Block-parallel optimize() of 1.5G bvector", repeats);
+        for (unsigned r = 0; r < repeats; ++r)
+        {
+            bvect bv_target(bv2);
+            bm::optimize_mt(bv_target, tpool);
+            cnt += bv_target.any();
+        }
+    }
+    {
+        bm::serializer<bvect>::buffer buf;
+        {
+            TimeTaker tt("serialize() of 1.5G bvector", repeats);
+            bm::serializer<bvect> bv_ser;
+            for (unsigned r = 0; r < repeats; ++r)
+            {
+                bv_ser.serialize(bv2, buf, 0);
+                cnt += (unsigned)buf.size();
+            }
+        }
+        {
+            TimeTaker tt("deserialize() of 1.5G bvector", repeats);
+            for (unsigned r = 0; r < repeats; ++r)
+            {
+                bvect bv_target;
+                bm::deserialize(bv_target, buf.buf());
+                cnt += bv_target.any();
+            }
+        }
+        {
+            TimeTaker tt("Parallel serialize_mt() of 1.5G bvector", repeats);
+            for (unsigned r = 0; r < repeats; ++r)
+            {
+                bm::serialize_mt(bv2, buf, tpool);
+                cnt += (unsigned)buf.size();
+            }
+        }
+        {
+            TimeTaker tt("Parallel deserialize_mt() of 1.5G bvector", repeats);
+            for (unsigned r = 0; r < repeats; ++r)
+            {
+                bvect bv_target;
+                bm::deserialize_mt(bv_target, buf.buf(), tpool);
+                cnt += bv_target.any();
+            }
+        }
+        {
+            TimeTaker tt("Range deserialize_range() [1e9, 1.1e9] of 1.5G bvector", repeats);
+            for (unsigned r = 0; r < repeats; ++r)
+            {
+                bvect bv_target;
+                bm::deserialize_range(bv_target, buf.buf(), 
+                                      1000000000, 1100000000);
+                cnt += bv_target.any();
+            }
+        }
+    }
+    char cbuf[256];
+    sprintf(cbuf, "%u ", cnt); // to fool some smart compilers like ICC
+}
+
+static
+void BvectorViewTest()
+{
+    const unsigned repeats = REPEATS / 30;
+    bvect bv;
+    for (unsigned i = 0; i < BSIZE * 10; i += 7)
+        bv.set_bit(i);
+    bv.optimize();
+    unsigned cnt = 0;
+
+    bvect::statistics st;
+    bv.calc_stat(&st);
+    unsigned char* sbuf = new unsigned char[st.max_serialize_mem];
+    unsigned slen = bm::serialize(bv, sbuf);
+
+    bm::serializer<bvect>::buffer vbuf;
+    vbuf.resize(bm::view_image_size(bv));
+    bm::save_view(bv, vbuf.data());
+
+    {
+        TimeTaker tt("deserialize() + count() of 1.5G bvector", repeats);
+        for (unsigned r = 0; r < repeats; ++r)
+        {
+            bvect bv_target;
+            bm::deserialize(bv_target, sbuf);
+            cnt += bv_target.count();
+        }
+    }
+    {
+        TimeTaker tt("bvector_view attach() + count() of 1.5G bvector", repeats);
+        for (unsigned r = 0; r < repeats; ++r)
+        {
+            bm::bvector_view<bvect> bv_view;
+            bv_view.attach(vbuf.buf(), vbuf.size());
+            cnt += bv_view.count();
+        }
+    }
+    {
+        TimeTaker tt("bvector_view AND into target 1.5G bvector", repeats);
+        for (unsigned r = 0; r < repeats; ++r)
+        {
+            bvect bv_target;
+            bv_target.set_range(BSIZE, BSIZE * 2);
+            bm::bvector_view<bvect> bv_view;
+            bv_view.attach(vbuf.buf(), vbuf.size());
+            bv_view.combine_into(bv_target, bm::set_AND);
+            cnt += bv_target.any();
+        }
+    }
+    delete [] sbuf;
+    char cbuf[256];
+    sprintf(cbuf, "%u %u", cnt, slen); // to fool some smart compilers like ICC
+}
+
+template<class BV>
+unsigned PoolIngest(unsigned repeats)
+{
+    unsigned cnt = 0;
+    for (unsigned r = 0; r < repeats; ++r)
+    {
+        BV bv(bm::BM_GAP);
+        unsigned n = 17;
+        for (unsigned i = 0; i < 300000; ++i)
+        {
+            n = (n * 1103515245u + 12345u);
+            bv.set((n >> 4) % (65536 * 256));
+        }
+        bv.optimize();
+        cnt += bv.count();
+    }
+    return cnt;
+}
+
+static
+void PoolAllocatorTest()
+{
+    typedef bm::bvector<bm::pooled_allocator> bvect_pool;
+    const unsigned repeats = REPEATS / 10;
+    unsigned cnt = 0;
+    {
+        TimeTaker tt("GAP ingest (block_allocator)", repeats);
+        cnt += PoolIngest<bvect>(repeats);
+    }
+    bm::pooled_block_allocator::reset_stat();
+    {
+        TimeTaker tt("GAP ingest (pooled_block_allocator)", repeats);
+        cnt += PoolIngest<bvect_pool>(repeats);
+    }
+    bm::alloc_pool_stat st = bm::pooled_block_allocator::get_stat();
+    cout << "Pool hit rate: " << st.hit_rate() 
+         << " retained: " << st.retained_mem << endl;
+    bm::pooled_block_allocator::free_pools();
+
+    char cbuf[256];
+    sprintf(cbuf, "%u ", cnt); // to fool some smart compilers like ICC
+}
+
 int main(void)
 {
 //    ptest();
@@ -1800,6 +2795,8 @@ int main(void)
 
     BitBlockRotateTest();
 
+    ImportSortedTest();
+
     EnumeratorTest();
 
     EnumeratorTestGAP();
@@ -1815,11 +2812,35 @@ int main(void)
     XorCountTest();
     AndCountTest();
 
+    GAPOperationsTest();
+
     TI_MetricTest();
 
     SerializationTest();
 
     SparseVectorAccessTest();
+
+    SparseVectorScannerTest();
+
+    SparseVectorAggregatesTest();
+
+    RSCSparseVectorAccessTest();
+
+    RemapSparseVectorTest();
+
+    FORSparseVectorTest();
+
+    SparseVector64Test();
+
+    StrSparseVectorTest();
+
+    AggregatorTest();
+
+    ParallelOperationsTest();
+
+    BvectorViewTest();
+
+    PoolAllocatorTest();
     
     return 0;
 }
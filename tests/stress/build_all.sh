@@ -24,5 +24,8 @@ mv ./test ./stress_release_sse42
 make BMOPTFLAGS=-DBMAVX2OPT rebuild
 mv ./test ./stress_release_avx2
 
+make BMOPTFLAGS=-DBMAVX512OPT rebuild
+mv ./test ./stress_release_avx512
+
 make BMOPTFLAGS=-DBM64OPT rebuild
 mv ./test ./stress_release_64
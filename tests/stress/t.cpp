@@ -26,6 +26,7 @@ For more information please visit:  http://bitmagic.io
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #undef NDEBUG
 #include <cassert>
 #include <memory.h>
@@ -46,6 +47,11 @@ For more information please visit:  http://bitmagic.io
 #include <bmsparsevec_serial.h>
 #include <bmalgo_similarity.h>
 #include <bmsparsevec_util.h>
+#include <bmsparsevec_compr.h>
+#include <bmstrsparsevec.h>
+#include <bmaggregator.h>
+#include <bmparallel.h>
+#include <bmview.h>
 
 using namespace bm;
 using namespace std;
@@ -57,6 +63,9 @@ using namespace std;
 #include <bmdbg.h>
 
 #include <vector>
+#include <map>
+#include <string>
+#include <algorithm>
 
 
 #define POOL_SIZE 5000
@@ -221,7 +230,8 @@ private:
 void* pool_ptr_allocator::free_ptr_blocks_[POOL_SIZE];
 int pool_ptr_allocator::ptr_blocks_idx_ = 0;
 
-#if defined(BMSSE2OPT) || defined(BMSSE42OPT) || defined(BMAVX2OPT)
+#if defined(BMSSE2OPT) || defined(BMSSE42OPT) || defined(BMAVX2OPT) || \
+    defined(BM_SIMD_DISPATCH)
 #else
 # define MEM_DEBUG
 #endif
@@ -5174,6 +5184,144 @@ void GAPTestStress()
     cout << "----------------------------------- GAP test stress " << endl;
 }
 
+// generate GAP block with (approximately) len runs
+static
+void GenerateGapRuns(bm::gap_word_t* buf, unsigned len, unsigned start_bit)
+{
+    unsigned step = 65536 / (len + 1);
+    unsigned pos = 0, i = 0;
+    if (len > 1 && rand() % 4 == 0) // run of one bit at 0
+    {
+        buf[++i] = 0;
+        pos = 0;
+    }
+    while (i < len)
+    {
+        pos += 1 + rand() % (2 * step);
+        if (pos >= 65535)
+            break;
+        buf[++i] = (bm::gap_word_t)pos;
+    }
+    buf[++i] = 65535;
+    buf[0] = (bm::gap_word_t)((start_bit & 1) + (i << 3));
+}
+
+static
+void CheckGapMergeResult(const bm::gap_word_t* res, unsigned dsize,
+                         const bm::gap_word_t* ref, unsigned dsize_ref,
+                         const char* op_name)
+{
+    if (dsize != dsize_ref || 
+        ::memcmp(res, ref, (dsize + 1) * sizeof(bm::gap_word_t)) != 0)
+    {
+        cerr << "GAP " << op_name << " operation failed! len=" << dsize
+             << " expected len=" << dsize_ref << endl;
+        exit(1);
+    }
+}
+
+static
+void GAPLongOperationsTest()
+{
+    cout << "----------------------------------- GAP long operations test" << endl;
+
+    BM_DECLARE_TEMP_BLOCK(tb1)
+    BM_DECLARE_TEMP_BLOCK(tb2)
+    bm::gap_word_t gap1[bm::gap_max_buff_len + 3];
+    bm::gap_word_t gap2[bm::gap_max_buff_len + 3];
+    bm::gap_word_t res[bm::gap_max_buff_len * 3];
+    bm::gap_word_t ref[bm::gap_max_buff_len * 3];
+
+    const unsigned lens[] = { 1, 2, 8, 64, 255, 320, 400, 511, 512, 700, 
+                              768, 1000, 1270 };
+    const unsigned lens_cnt = sizeof(lens) / sizeof(lens[0]);
+
+    for (unsigned k = 0; k < 2000; ++k)
+    {
+        GenerateGapRuns(gap1, lens[k % lens_cnt], k & 1);
+        GenerateGapRuns(gap2, lens[(k / lens_cnt) % lens_cnt], (k >> 1) & 1);
+
+        // conversion
+        bm::gap_convert_to_bitset(tb1, gap1);
+        ::memset(tb2, 0, sizeof(tb2));
+        bm::gap_add_to_bitset(tb2, gap1);
+        if (::memcmp(tb1, tb2, sizeof(tb1)) != 0)
+        {
+            cerr << "GAP to bitset conversion failed! len=" << (*gap1 >> 3) << endl;
+            exit(1);
+        }
+        bm::gap_convert_to_bitset(tb2, gap2);
+
+        // counts against the GAP merge and against bit-blocks
+        unsigned c, c_merge, c_bit;
+        c = bm::gap_count_and(gap1, gap2);
+        c_merge = bm::gap_buff_count_op(gap1, gap2, bm::and_op);
+        c_bit = bm::bit_block_and_count(tb1, tb1 + bm::set_block_size, tb2);
+        if (c != c_merge || c != c_bit)
+        {
+            cerr << "GAP AND count failed! " << c << " " << c_merge << " " << c_bit << endl;
+            exit(1);
+        }
+        c = bm::gap_count_or(gap1, gap2);
+        c_merge = bm::gap_buff_count_op(gap1, gap2, bm::or_op);
+        c_bit = bm::bit_block_or_count(tb1, tb1 + bm::set_block_size, tb2);
+        if (c != c_merge || c != c_bit)
+        {
+            cerr << "GAP OR count failed! " << c << " " << c_merge << " " << c_bit << endl;
+            exit(1);
+        }
+        c = bm::gap_count_xor(gap1, gap2);
+        c_merge = bm::gap_buff_count_op(gap1, gap2, bm::xor_op);
+        c_bit = bm::bit_block_xor_count(tb1, tb1 + bm::set_block_size, tb2);
+        if (c != c_merge || c != c_bit)
+        {
+            cerr << "GAP XOR count failed! " << c << " " << c_merge << " " << c_bit << endl;
+            exit(1);
+        }
+        c = bm::gap_count_sub(gap1, gap2);
+        c_merge = bm::gap_buff_count_op(gap1, gap2, bm::sub_op);
+        c_bit = bm::bit_block_sub_count(tb1, tb1 + bm::set_block_size, tb2);
+        if (c != c_merge || c != c_bit)
+        {
+            cerr << "GAP SUB count failed! " << c << " " << c_merge << " " << c_bit << endl;
+            exit(1);
+        }
+
+        // bit-block to GAP conversions
+        {
+            unsigned len = bm::bit_convert_to_gap_pcnt(res, tb1, 
+                                                       bm::gap_max_buff_len * 3);
+            unsigned len_ref = bm::bit_convert_to_gap(ref, tb1, 
+                                                      bm::gap_max_bits, 
+                                                      bm::gap_max_buff_len * 3);
+            CheckGapMergeResult(res, len, ref, len_ref, "bit-block to GAP");
+            CheckGapMergeResult(res, len, gap1, *gap1 >> 3, "bit-block to GAP");
+        }
+
+        // logical operations against the GAP merge
+        unsigned dsize, dsize_ref;
+        const bm::gap_word_t* r;
+        r = bm::gap_operation_and(gap1, gap2, res, dsize);
+        bm::gap_buff_op(ref, gap1, 0, gap2, 0, bm::and_op, dsize_ref);
+        CheckGapMergeResult(r, dsize, ref, dsize_ref, "AND");
+
+        r = bm::gap_operation_or(gap1, gap2, res, dsize);
+        bm::gap_buff_op(ref, gap1, 1, gap2, 1, bm::and_op, dsize_ref);
+        bm::gap_invert(ref);
+        CheckGapMergeResult(r, dsize, ref, dsize_ref, "OR");
+
+        r = bm::gap_operation_xor(gap1, gap2, res, dsize);
+        bm::gap_buff_op(ref, gap1, 0, gap2, 0, bm::xor_op, dsize_ref);
+        CheckGapMergeResult(r, dsize, ref, dsize_ref, "XOR");
+
+        r = bm::gap_operation_sub(gap1, gap2, res, dsize);
+        bm::gap_buff_op(ref, gap1, 0, gap2, 1, bm::and_op, dsize_ref);
+        CheckGapMergeResult(r, dsize, ref, dsize_ref, "SUB");
+    } // for k
+
+    cout << "----------------------------------- GAP long operations test OK" << endl;
+}
+
 // -----------------------------------------------------------------------------
 static
 void MutationTest()
@@ -6817,6 +6965,245 @@ template<class A, class B> void CompareMiniSet(const A& ms,
     }
 }
 
+static
+void CheckImportSorted(const std::vector<bm::id_t>& ids, const bvect& bv_init)
+{
+    bvect bv1(bv_init);
+    bvect bv_control(bv_init);
+    for (size_t i = 0; i < ids.size(); ++i)
+    {
+        if (ids[i] >= bv_control.size())
+            bv_control.resize(ids[i] + 1);
+        bv_control.set(ids[i]);
+    }
+    bv1.import_sorted(ids.empty() ? 0 : &ids[0], ids.size());
+
+    int res = bv1.compare(bv_control);
+    if (res != 0 || bv1.count() != bv_control.count())
+    {
+        cerr << "import_sorted() check failed!" << endl;
+        exit(1);
+    }
+    assert(bv1.size() == bv_control.size());
+}
+
+static
+void ImportSortedTest()
+{
+    cout << "----------------------- ImportSortedTest" << endl;
+
+    {
+        std::vector<bm::id_t> ids;
+        bvect bv;
+        CheckImportSorted(ids, bv);
+        ids.push_back(0);
+        CheckImportSorted(ids, bv);
+        ids.push_back(0); ids.push_back(65535); ids.push_back(65536);
+        ids.push_back(bm::id_max - 1);
+        CheckImportSorted(ids, bv);
+    }
+    // full block, block of all but one bit, runs
+    {
+        std::vector<bm::id_t> ids;
+        for (bm::id_t i = 65536; i < 65536 * 2; ++i)
+            ids.push_back(i);
+        for (bm::id_t i = 65536 * 3; i < 65536 * 4; ++i)
+            if (i != 65536 * 3 + 100)
+                ids.push_back(i);
+        for (bm::id_t i = 65536 * 5; i < 65536 * 6; i += 3)
+            ids.push_back(i);
+        for (bm::id_t i = 65536 * 7; i < 65536 * 8; i += 1000)
+        {
+            ids.push_back(i); ids.push_back(i + 1); ids.push_back(i + 2);
+        }
+        bvect bv;
+        CheckImportSorted(ids, bv);
+
+        bvect bv_imp;
+        bv_imp.import_sorted(&ids[0], ids.size());
+        // blocks 3 and 7 are GAP, 5 - bit block, 1 - full
+        bvect::statistics st;
+        bv_imp.calc_stat(&st);
+        assert(st.gap_blocks == 2);
+        assert(st.bit_blocks == 1);
+        assert(bm::all_set<true>::is_full_block(
+                        bv_imp.get_blocks_manager().get_block(1)));
+
+        bv.set_range(65536, 65536 * 8); // full blocks in the target
+        CheckImportSorted(ids, bv);
+        bv.optimize();
+        CheckImportSorted(ids, bv);
+    }
+
+    for (unsigned k = 0; k < 40; ++k)
+    {
+        std::vector<bm::id_t> ids;
+        unsigned max_step = 1 + unsigned(rand()) % (k < 20 ? 8 : 2000);
+        bm::id_t id = unsigned(rand()) % 100000;
+        unsigned cnt = unsigned(rand()) % 300000;
+        for (unsigned i = 0; i < cnt; ++i)
+        {
+            ids.push_back(id);
+            if (rand() % 5 == 0) // runs and duplicates
+            {
+                unsigned run = unsigned(rand()) % 300;
+                for (unsigned j = 0; j < run; ++j)
+                    ids.push_back(++id);
+                ids.push_back(id);
+            }
+            id += unsigned(rand()) % max_step;
+        }
+
+        bvect bv;
+        CheckImportSorted(ids, bv);
+
+        bvect bv_gap(bm::BM_GAP);
+        CheckImportSorted(ids, bv_gap);
+
+        bvect bv_init;
+        for (unsigned i = 0; i < 100000; ++i)
+            bv_init.set(unsigned(rand()) % (id + 1));
+        if (k & 1)
+            bv_init.optimize();
+        CheckImportSorted(ids, bv_init);
+
+        bvect bv_small;
+        bv_small.resize(10);
+        CheckImportSorted(ids, bv_small);
+    }
+
+    cout << "----------------------- ImportSortedTest OK" << endl;
+}
+
+static
+void CheckBvectorDecode(const bvect& bv, size_t page_size, bm::id_t from)
+{
+    std::vector<bm::id_t> page(page_size + 1);
+    bvect::enumerator en = bv.get_enumerator(from);
+    size_t total = 0;
+    for (;;)
+    {
+        page[page_size] = 12345; // guard
+        size_t n = bv.decode(&page[0], page_size, from);
+        assert(n <= page_size);
+        assert(page[page_size] == 12345);
+        for (size_t i = 0; i < n; ++i, ++en)
+        {
+            if (!en.valid() || *en != page[i])
+            {
+                cerr << "bvector::decode() check failed! page=" << page_size 
+                     << " from=" << from << " i=" << i << endl;
+                exit(1);
+            }
+        }
+        total += n;
+        if (n < page_size || n == 0)
+            break;
+        from = page[n-1] + 1;
+        if (from == 0 || from >= bv.size())
+            break;
+    }
+    assert(!en.valid());
+    (void)total;
+}
+
+static
+void BvectorDecodeTest()
+{
+    cout << "----------------------- BvectorDecodeTest" << endl;
+
+    {
+        bvect bv;
+        bm::id_t arr[10];
+        assert(bv.decode(arr, 10) == 0);
+        bv.set(0); bv.set(31); bv.set(32); bv.set(65535); bv.set(65536);
+        bv.set(bm::id_max - 1);
+        CheckBvectorDecode(bv, 1, 0);
+        CheckBvectorDecode(bv, 3, 0);
+        CheckBvectorDecode(bv, 100, 0);
+        CheckBvectorDecode(bv, 100, 32);
+        assert(bv.decode(arr, 10, bm::id_max - 1) == 1);
+        assert(arr[0] == bm::id_max - 1);
+        bv.optimize();
+        CheckBvectorDecode(bv, 2, 0);
+
+        bv.set_range(65536 * 3, 65536 * 5 + 7); // full blocks
+        CheckBvectorDecode(bv, 65536 * 3, 0);
+        CheckBvectorDecode(bv, 1000, 65536 * 3 + 5);
+        bv.optimize();
+        CheckBvectorDecode(bv, 65537, 0);
+        CheckBvectorDecode(bv, 40, 65536 * 5);
+    }
+
+    // decode kernels with all destination capacities
+    {
+        bvect bv;
+        for (unsigned i = 0; i < 65536; ++i)
+            if ((rand() % 3) == 0)
+                bv.set(65536 + i);
+        const bm::word_t* blk = bv.get_blocks_manager().get_block(1);
+        std::vector<bm::id_t> arr(65536 + 1);
+        unsigned cnt = bv.count();
+        for (unsigned size = 0; size < 100; ++size)
+        {
+            unsigned n = bm::bit_block_decode(blk, size * 7, &arr[0], size, 
+                                              bm::id_t(65536));
+            assert(n <= size);
+            bm::id_t prev = 65536 + size * 7;
+            for (unsigned i = 0; i < n; ++i)
+            {
+                assert(arr[i] >= prev);
+                assert(bv.test(arr[i]));
+                assert(bv.count_range(prev, arr[i]) == 1);
+                prev = arr[i] + 1;
+            }
+        }
+        unsigned n = bm::bit_block_decode(blk, 0, &arr[0], 65536, bm::id_t(0));
+        assert(n == cnt);
+    }
+
+    for (unsigned k = 0; k < 40; ++k)
+    {
+        bvect bv;
+        for (unsigned j = 0; j < 24; ++j)
+        {
+            bm::id_t base = (unsigned(rand()) % 512) * 65536;
+            switch (rand() % 3)
+            {
+            case 0:
+                for (unsigned i = 0; i < 100; ++i)
+                    bv.set(base + unsigned(rand()) % 65536);
+                break;
+            case 1:
+                for (unsigned i = 0; i < 65536; ++i)
+                    if (rand() % 3)
+                        bv.set(base + i);
+                break;
+            default:
+                bv.set_range(base + unsigned(rand()) % 65536,
+                             base + unsigned(rand()) % (65536 * 3));
+                break;
+            }
+        }
+        if (k & 1)
+            bv.optimize();
+        if (k % 4 == 0)
+            bv.set_range(65536 * 2, 65536 * 4 - 1);
+
+        unsigned page_sizes[] = { 1, 31, 40, 41, 1000, 65536 * 2 };
+        for (unsigned i = 0; i < sizeof(page_sizes)/sizeof(page_sizes[0]); ++i)
+        {
+            CheckBvectorDecode(bv, page_sizes[i], 0);
+            bm::id_t from = unsigned(rand()) % (65536 * 512);
+            CheckBvectorDecode(bv, page_sizes[i] + (unsigned(rand()) % 100), from);
+        }
+        cout << "\r" << k << flush;
+    }
+    cout << endl;
+
+    cout << "----------------------- BvectorDecodeTest OK" << endl;
+}
+
 static
 void MiniSetTest()
 {
@@ -8394,6 +8781,138 @@ void CountRangeTest()
     cout << "---------------------------- CountRangeTest OK" << endl;
 }
 
+static
+void VerifyRankSelect(const bvect& bv, bm::id_t to)
+{
+    bvect::rs_index_type rs_idx;
+    bv.build_rs_index(&rs_idx);
+
+    assert(rs_idx.count() == bv.count());
+
+    for (bm::id_t i = 0; i < to; ++i)
+    {
+        bm::id_t cnt1 = bv.count_range(0, i);
+        bm::id_t cnt2 = bv.rank(i, rs_idx);
+        if (cnt1 != cnt2)
+        {
+            cerr << "VerifyRankSelect failed! rank(" << i << ")=" << cnt2
+                 << " count_range()=" << cnt1 << endl;
+            exit(1);
+        }
+        bm::id_t cnt3 = bv.count_to_test(i, rs_idx);
+        if (cnt3 != (bv.test(i) ? cnt1 : 0))
+        {
+            cerr << "VerifyRankSelect failed! count_to_test(" << i << ")=" << cnt3
+                 << " count_range()=" << cnt1 << endl;
+            exit(1);
+        }
+    }
+
+    bm::id_t pos;
+    bool found = bv.select(0, pos, rs_idx);
+    assert(!found);
+    found = bv.select(bv.count() + 1, pos, rs_idx);
+    assert(!found);
+
+    bm::id_t r = 1;
+    for (bvect::enumerator en = bv.first(); en.valid() && *en < to; ++en, ++r)
+    {
+        found = bv.select(r, pos, rs_idx);
+        if (!found || pos != *en)
+        {
+            cerr << "VerifyRankSelect failed! select(" << r << ")=" << pos
+                 << " expected=" << *en << endl;
+            exit(1);
+        }
+        assert(bv.rank(pos, rs_idx) == r);
+    }
+}
+
+static
+void RankSelectTest()
+{
+    cout << "---------------------------- RankSelectTest..." << endl;
+
+    {
+        bvect bv;
+        bvect::rs_index_type rs_idx;
+        bv.build_rs_index(&rs_idx);
+        assert(rs_idx.count() == 0);
+        assert(bv.rank(100, rs_idx) == 0);
+        bm::id_t pos;
+        assert(!bv.select(1, pos, rs_idx));
+    }
+
+    {
+        bvect bv;
+        bv.set(0);
+        bv.set(1);
+        bv.set(65535+10);
+        bv.set(65535+20);
+        bv.set(65535+21);
+        bv.set(bm::id_max - 1);
+        VerifyRankSelect(bv, 200000);
+
+        bvect::rs_index_type rs_idx;
+        bv.build_rs_index(&rs_idx);
+        assert(bv.rank(bm::id_max - 1, rs_idx) == 6);
+        bm::id_t pos;
+        bool found = bv.select(6, pos, rs_idx);
+        assert(found && pos == bm::id_max - 1);
+
+        bv.optimize();
+        VerifyRankSelect(bv, 200000);
+    }
+
+    {
+        // bit, GAP, full and empty blocks
+        bvect bv;
+        for (unsigned i = 0; i < 65536; i += 3)
+            bv.set(i);
+        bv.set_range(65536 * 2, 65536 * 3 - 1);
+        bv.set_range(65536 * 3 + 100, 65536 * 3 + 7000);
+        for (unsigned i = 65536 * 5; i < 65536 * 6; ++i)
+        {
+            if (rand() % 7 == 0)
+                bv.set(i);
+        }
+        VerifyRankSelect(bv, 65536 * 7);
+
+        bv.optimize();
+        VerifyRankSelect(bv, 65536 * 7);
+
+        bvect::rs_index_type rs_idx1;
+        bv.build_rs_index(&rs_idx1);
+        bvect::rs_index_type rs_idx2(rs_idx1);
+        assert(rs_idx2.count() == bv.count());
+        assert(rs_idx2.total_blocks() == rs_idx1.total_blocks());
+        bvect::rs_index_type rs_idx3;
+        rs_idx3.swap(rs_idx2);
+        assert(rs_idx2.count() == 0);
+        for (bm::id_t i = 0; i < 65536 * 7; i += 17)
+        {
+            assert(bv.rank(i, rs_idx3) == bv.rank(i, rs_idx1));
+        }
+    }
+
+    cout << "check inverted bvector" << endl;
+    {
+        bvect bv;
+        bv.invert();
+        bv.set(100, false);
+        bv.set(200000, false);
+        VerifyRankSelect(bv, 300000);
+
+        bvect::rs_index_type rs_idx;
+        bv.build_rs_index(&rs_idx);
+        bm::id_t pos;
+        bool found = bv.select(bv.count(), pos, rs_idx);
+        assert(found && pos == bm::id_max - 1);
+    }
+
+    cout << "---------------------------- RankSelectTest OK" << endl;
+}
+
 static
 void ExportTest()
 {
@@ -10200,1473 +10719,4736 @@ void FillSparseIntervals(std::vector<unsigned>&                       vect,
     } // for min
 }
 
-static
-void TestSparseVector_Stress(unsigned count)
+// brute force search (control)
+template<class SV>
+void FindEqControl(const SV& sv, typename SV::value_type value, bvect& bv_control)
 {
-
-    cout << "---------------------------- Bit-plain sparse vector stress" << endl;
-
-    cout << "Interval shift check.";
-    // interval shift check
-    for (unsigned i = 0; i < count; ++i)
+    bv_control.clear(true);
+    bvect::size_type sz = sv.size();
+    if (!sz)
+        return;
+    std::vector<typename SV::value_type> arr(sz);
+    sv.decode(&arr[0], 0, sz);
+    const bvect* bv_null = sv.get_null_bvector();
+    for (unsigned i = 0; i < sz; ++i)
     {
-        unsigned fill_factor = 0;
-        for (unsigned min = 0; min < 10000000; min+= rand()%100000)
+        if (arr[i] == value)
         {
-            unsigned max = min + (65535 * 10);
-            {{
-                bm::null_support null_able =
-                                (min % 2 == 0) ? bm::no_null : bm::use_null;
-                
-                std::vector<unsigned> vect;
-                bm::sparse_vector<unsigned, bvect > sv(null_able);
-            
-                FillSparseIntervals(vect, sv, min, max, fill_factor);
-                
-                bool res = CompareSparseVector(sv, vect, true);
-                if (!res)
-                {
-                    cerr << "sparse-dense vector comparison failed" << endl;
-                    exit(1);
-                }
-                
-                sv.optimize();
-                res = CompareSparseVector(sv, vect, true);
-                if (!res)
-                {
-                    cerr << "sparse-dense vector comparison failed" << endl;
-                    exit(1);
-                }
-                
-                cout << "+" << flush;
-                
-            }}
-            ++fill_factor;
-            if (fill_factor > 2) fill_factor = 0;
-        } // for min
-        
-        cout << "." << flush;
-        
-    } // for i
-    cout << endl;
-    cout << "--------------------------- Interval shift check Ok" << endl;
+            if (bv_null && !bv_null->test(i))
+                continue;
+            bv_control.set_bit_no_check(i);
+        }
+    }
+}
 
-    cout << "Join check" << endl;
-    for (unsigned i = 0; i < count; ++i)
+template<class SV>
+void CheckSparseVectorScan(const SV& sv, typename SV::value_type value)
+{
+    bm::sparse_vector_scanner<SV> scanner;
+    bvect bv_res, bv_control;
+
+    scanner.find_eq(sv, value, bv_res);
+    FindEqControl(sv, value, bv_control);
+    if (bv_res.compare(bv_control) != 0)
     {
-        unsigned fill_factor = 0;
-        for (unsigned min = 0; min < 10000000; min+= rand()%100000)
+        cerr << "Sparse vector scan failed! value=" << value 
+             << " found=" << bv_res.count() 
+             << " control=" << bv_control.count() << endl;
+        exit(1);
+    }
+    
+    bm::id_t idx;
+    bool found = scanner.find_eq(sv, value, idx);
+    if (found != bv_control.any())
+    {
+        cerr << "Sparse vector find first failed! value=" << value << endl;
+        exit(1);
+    }
+    if (found)
+    {
+        bm::id_t idx_control;
+        bool found_control = bv_control.find(0, idx_control);
+        assert(found_control);
+        if (idx != idx_control)
         {
-            unsigned max = min + (65535 * 10);
-            unsigned min2 = max + rand() % 65536;
-            unsigned max2 = min2 + (65535 * 10);
-
-            bm::null_support null_able1 =
-                            (min % 2 == 0) ? bm::no_null : bm::use_null;
+            cerr << "Sparse vector find first index mismatch! value=" << value 
+                 << " " << idx << " != " << idx_control << endl;
+            exit(1);
+        }
+    }
+}
 
-            {{
-                std::vector<unsigned> vect1;
-                std::vector<unsigned> vect2;
-                bm::sparse_vector<unsigned, bvect > sv1(null_able1);
-                bm::sparse_vector<unsigned, bvect > sv2(null_able1);
+// check range comparisons against brute force decode
+template<class SV>
+void CheckSparseVectorRangeScan(const SV& sv, 
+                                typename SV::value_type from,
+                                typename SV::value_type to)
+{
+    bm::sparse_vector_scanner<SV> scanner;
+    bvect bv_lt, bv_le, bv_gt, bv_ge, bv_range;
+    bvect bv_lt_c, bv_le_c, bv_gt_c, bv_ge_c, bv_range_c;
+    
+    scanner.find_lt(sv, from, bv_lt);
+    scanner.find_le(sv, from, bv_le);
+    scanner.find_gt(sv, from, bv_gt);
+    scanner.find_ge(sv, from, bv_ge);
+    scanner.find_range(sv, from, to, bv_range);
+    
+    bvect::size_type sz = sv.size();
+    if (sz)
+    {
+        std::vector<typename SV::value_type> arr(sz);
+        sv.decode(&arr[0], 0, sz);
+        const bvect* bv_null = sv.get_null_bvector();
+        for (unsigned i = 0; i < sz; ++i)
+        {
+            if (bv_null && !bv_null->test(i))
+                continue;
+            typename SV::value_type v = arr[i];
+            if (v < from)  bv_lt_c.set_bit_no_check(i);
+            if (v <= from) bv_le_c.set_bit_no_check(i);
+            if (v > from)  bv_gt_c.set_bit_no_check(i);
+            if (v >= from) bv_ge_c.set_bit_no_check(i);
+            if (v >= from && v <= to) bv_range_c.set_bit_no_check(i);
+        }
+    }
+    if (bv_lt.compare(bv_lt_c) != 0 || bv_le.compare(bv_le_c) != 0 ||
+        bv_gt.compare(bv_gt_c) != 0 || bv_ge.compare(bv_ge_c) != 0 ||
+        bv_range.compare(bv_range_c) != 0)
+    {
+        cerr << "Sparse vector range scan failed! from=" << from 
+             << " to=" << to << endl;
+        cerr << bv_lt.count() << " " << bv_lt_c.count() << " "
+             << bv_le.count() << " " << bv_le_c.count() << " "
+             << bv_gt.count() << " " << bv_gt_c.count() << " "
+             << bv_ge.count() << " " << bv_ge_c.count() << " "
+             << bv_range.count() << " " << bv_range_c.count() << endl;
+        exit(1);
+    }
+}
+
+static
+void TestSparseVectorScan()
+{
+    cout << " --------------- Test sparse vector scan" << endl;
+    
+    {
+        sparse_vector_u32 sv;
+        bm::sparse_vector_scanner<sparse_vector_u32> scanner;
+        bvect bv_res;
+        
+        scanner.find_eq(sv, 25, bv_res);
+        assert(!bv_res.any());
+        scanner.find_zero(sv, bv_res);
+        assert(!bv_res.any());
+        
+        sv.push_back(0);
+        sv.push_back(25);
+        sv.push_back(7);
+        sv.push_back(25);
+        sv.push_back(0);
+        
+        scanner.find_eq(sv, 25, bv_res);
+        assert(bv_res.count() == 2);
+        assert(bv_res.test(1) && bv_res.test(3));
+        scanner.find_zero(sv, bv_res);
+        assert(bv_res.count() == 2);
+        assert(bv_res.test(0) && bv_res.test(4));
+        scanner.find_eq(sv, 8, bv_res); // plain is not present
+        assert(!bv_res.any());
+        scanner.find_eq(sv, 1u << 31, bv_res);
+        assert(!bv_res.any());
+        
+        unsigned vals[] = { 7, 0, 100 };
+        scanner.find_in(sv, vals, 3, bv_res);
+        assert(bv_res.count() == 3);
+        assert(bv_res.test(0) && bv_res.test(2) && bv_res.test(4));
+        
+        bm::id_t idx;
+        bool found = scanner.find_eq(sv, 7, idx);
+        assert(found && idx == 2);
+        found = scanner.find_eq(sv, 9, idx);
+        assert(!found);
+    }
+    
+    // NULL-able vector: NULL values are not 0
+    {
+        sparse_vector_u32 sv(bm::use_null);
+        bm::sparse_vector_scanner<sparse_vector_u32> scanner;
+        bvect bv_res;
+        
+        sv.resize(100);
+        sv.set(10, 0);
+        sv.set(20, 5);
+        sv.set(30, 5);
+        sv.set(40, 0);
+        
+        scanner.find_zero(sv, bv_res);
+        assert(bv_res.count() == 2);
+        assert(bv_res.test(10) && bv_res.test(40));
+        scanner.find_eq(sv, 5, bv_res);
+        assert(bv_res.count() == 2);
+        
+        sv.set_null(20);
+        scanner.find_eq(sv, 5, bv_res);
+        assert(bv_res.count() == 1 && bv_res.test(30));
+        
+        CheckSparseVectorScan(sv, 0u);
+        CheckSparseVectorScan(sv, 5u);
+        
+        scanner.find_lt(sv, 5, bv_res);
+        assert(bv_res.count() == 2 && bv_res.test(10) && bv_res.test(40));
+        scanner.find_ge(sv, 1, bv_res);
+        assert(bv_res.count() == 1 && bv_res.test(30));
+        scanner.find_range(sv, 0, 5, bv_res);
+        assert(bv_res.count() == 3);
+        
+        CheckSparseVectorRangeScan(sv, 0u, 0u);
+        CheckSparseVectorRangeScan(sv, 5u, 4u); // empty range
+        CheckSparseVectorRangeScan(sv, 1u, ~0u);
+    }
+    
+    // range search: all values of a small domain, GAP and bit blocks
+    {
+        sparse_vector_u32 sv;
+        for (unsigned i = 0; i < 300000; ++i)
+            sv.push_back((i / 7) % 41);
+        for (unsigned i = 300000; i < 400000; ++i)
+            sv.push_back(unsigned(rand()) % 41);
+        for (unsigned k = 0; k < 2; ++k)
+        {
+            for (unsigned v = 0; v < 42; v += 3)
+                CheckSparseVectorRangeScan(sv, v, v + 5);
+            CheckSparseVectorRangeScan(sv, 0u, ~0u);
+            sv.optimize();
+        }
+    }
+    
+    // random plato patterns (GAP and bit blocks)
+    {
+        for (unsigned pass = 0; pass < 2; ++pass)
+        {
+            std::vector<unsigned> vect;
+            sparse_vector_u32 sv(pass ? bm::use_null : bm::no_null);
+            FillSparseIntervals(vect, sv, 0, 2000000, pass);
+            FillSparseIntervals(vect, sv, 5000000, 6500000, 2);
+            if (pass)
+            {
+                for (unsigned i = 0; i < 200000; i += 7)
+                    sv.set_null(i);
+            }
             
-                FillSparseIntervals(vect1, sv1, min, max, fill_factor);
-                FillSparseIntervals(vect2, sv2, min2, max2, fill_factor);
-                
-                if (rand()%2)
-                {
-                    sv1.optimize();
-                }
-                if (rand()%3 == 0)
-                {
-                    sv2.optimize();
-                }
-                bm::sparse_vector<unsigned, bvect > sv3;
-                bm::sparse_vector<unsigned, bvect > sv4(sv2);
-                
-                sv1.join(sv2);
-                sv3.join(sv1);
-                sv3.join(sv2);
-                sv4.join(sv1);
-                
-                if (sv1.size() != sv3.size() || sv2.size() != sv3.size() || sv3.size() != sv4.size())
+            for (unsigned k = 0; k < 2; ++k)
+            {
+                CheckSparseVectorScan(sv, 0u);
+                for (unsigned i = 0; i < 5; ++i)
                 {
-                    cerr << "Sparse join size error:" << sv1.size() << endl;
-                    exit(1);
+                    unsigned idx = unsigned(rand()) % sv.size();
+                    CheckSparseVectorScan(sv, sv.get(idx));
+                    CheckSparseVectorScan(sv, unsigned(rand()) % 8);
                 }
+                CheckSparseVectorScan(sv, 65535u * 3);
+                CheckSparseVectorRangeScan(sv, 3u, 5000u);
+                CheckSparseVectorRangeScan(sv, sv.get(1000), 65535u * 2);
                 
-                
-                for ( i = 0; i < sv1.size(); ++i)
+                // IN-list
                 {
-                    unsigned v1 = sv1[i];
-                    unsigned v3 = sv3[i];
-                    unsigned v4 = sv4[i];
-                    if (v1 != v3 || v1 != v4)
+                    bm::sparse_vector_scanner<sparse_vector_u32> scanner;
+                    unsigned vals[] = { 0, 1, 5, sv.get(1000) };
+                    bvect bv_res, bv_control, bv1;
+                    scanner.find_in(sv, vals, 4, bv_res);
+                    for (unsigned i = 0; i < 4; ++i)
                     {
-                        cerr << "Sparse join cmp failed:" << v1 << "!=" << v3 << "!=" << v4 << endl;
+                        FindEqControl(sv, vals[i], bv1);
+                        bv_control |= bv1;
+                    }
+                    if (bv_res.compare(bv_control) != 0)
+                    {
+                        cerr << "Sparse vector IN-list scan failed!" << endl;
                         exit(1);
                     }
-                } // for i
-                
-                bool b1 = TestEqualSparseVectors(sv1, sv3, false);
-                if (!b1)
-                {
-                    cerr << "Equal 1 comparison failed" << endl;
-                    exit(1);
-                }
-                bool b2 = TestEqualSparseVectors(sv1, sv4, false);
-                if (!b2)
-                {
-                    cerr << "Equal 2 comparison failed" << endl;
-                    exit(1);
-                }
-                
-                bool b3 = TestEqualSparseVectors(sv3, sv4, false);
-                if (!b3)
-                {
-                    cerr << "Equal 3 comparison failed" << endl;
-                    exit(1);
                 }
-                
-                
-                
-                cout << "+" << flush;
-                
-            }}
-            ++fill_factor;
-            if (fill_factor > 2) fill_factor = 0;
-        } // for min
+                sv.optimize();
+            } // for k
+            cout << "." << flush;
+        } // for pass
+    }
+    
+    cout << " --------------- Test sparse vector scan OK" << endl;
+}
+
+template<class SV>
+void CheckSparseVectorAggregates(const SV& sv, const bvect& bv_mask)
+{
+    typedef typename SV::value_type value_type;
+    bm::id_t cnt_c = 0;
+    bm::id64_t sum_c = 0;
+    value_type min_c = 0, max_c = 0;
+    
+    bvect::enumerator en = bv_mask.first();
+    for (; en.valid(); ++en)
+    {
+        bm::id_t idx = *en;
+        if (idx >= sv.size())
+            break;
+        if (sv.is_null(idx))
+            continue;
+        value_type v = sv.get(idx);
+        if (!cnt_c || v < min_c) min_c = v;
+        if (!cnt_c || v > max_c) max_c = v;
+        sum_c += v;
+        ++cnt_c;
+    }
+    
+    bm::id_t cnt = bm::sparse_vector_count(sv, bv_mask);
+    bm::id64_t sum = bm::sparse_vector_sum(sv, bv_mask);
+    value_type min_v = 0, max_v = 0;
+    bool min_found = bm::sparse_vector_min(sv, bv_mask, min_v);
+    bool max_found = bm::sparse_vector_max(sv, bv_mask, max_v);
+    
+    if (cnt != cnt_c || sum != sum_c || 
+        min_found != bool(cnt_c) || max_found != bool(cnt_c) ||
+        (cnt_c && (min_v != min_c || max_v != max_c)))
+    {
+        cerr << "Sparse vector aggregate failed! count=" << cnt << "/" << cnt_c
+             << " sum=" << sum << "/" << sum_c 
+             << " min=" << min_v << "/" << min_c 
+             << " max=" << max_v << "/" << max_c << endl;
+        exit(1);
+    }
+}
+
+static
+void TestSparseVectorAggregates()
+{
+    cout << " --------------- Test sparse vector aggregates" << endl;
+    
+    {
+        sparse_vector_u32 sv;
+        bvect bv_mask { 0, 1, 2, 10 };
+        unsigned v;
+        assert(!bm::sparse_vector_min(sv, bv_mask, v));
+        assert(!bm::sparse_vector_max(sv, bv_mask, v));
+        assert(bm::sparse_vector_sum(sv, bv_mask) == 0);
+        assert(bm::sparse_vector_count(sv, bv_mask) == 0);
         
-        cout << "." << flush;
+        sv.push_back(10);
+        sv.push_back(3);
+        sv.push_back(0);
+        sv.push_back(100);
         
-    } // for i
-    
-    cout << "--------------------------- Join check Ok" << endl;
+        assert(bm::sparse_vector_count(sv, bv_mask) == 3);
+        assert(bm::sparse_vector_sum(sv, bv_mask) == 13);
+        assert(bm::sparse_vector_min(sv, bv_mask, v) && v == 0);
+        assert(bm::sparse_vector_max(sv, bv_mask, v) && v == 10);
+        CheckSparseVectorAggregates(sv, bv_mask);
+    }
     
+    {
+        sparse_vector_u32 sv(bm::use_null);
+        sv.set(5, 7);
+        sv.set(6, 0);
+        sv.set(9, 0xFFFFFFFF);
+        
+        bvect bv_mask;
+        bv_mask.set_range(0, 8);
+        unsigned v;
+        assert(bm::sparse_vector_count(sv, bv_mask) == 2);
+        assert(bm::sparse_vector_min(sv, bv_mask, v) && v == 0);
+        assert(bm::sparse_vector_max(sv, bv_mask, v) && v == 7);
+        
+        bv_mask.set(9);
+        assert(bm::sparse_vector_sum(sv, bv_mask) == 7ull + 0xFFFFFFFFull);
+        
+        bvect bv_mask2 { 0, 1, 2 }; // all NULLs
+        assert(!bm::sparse_vector_min(sv, bv_mask2, v));
+        CheckSparseVectorAggregates(sv, bv_mask);
+        CheckSparseVectorAggregates(sv, bv_mask2);
+    }
     
+    {
+        for (unsigned pass = 0; pass < 2; ++pass)
+        {
+            std::vector<unsigned> vect;
+            sparse_vector_u32 sv(pass ? bm::use_null : bm::no_null);
+            FillSparseIntervals(vect, sv, 0, 2000000, pass);
+            if (pass)
+            {
+                for (unsigned i = 0; i < 200000; i += 7)
+                    sv.set_null(i);
+            }
+            for (unsigned k = 0; k < 2; ++k)
+            {
+                bvect bv_mask;
+                generate_bvector(bv_mask, 2000000);
+                CheckSparseVectorAggregates(sv, bv_mask);
+                
+                bvect bv_mask2;
+                bv_mask2.set_range(100000, 150000);
+                CheckSparseVectorAggregates(sv, bv_mask2);
+                
+                bvect bv_mask3;
+                bv_mask3.set_range(0, sv.size() + 100000);
+                CheckSparseVectorAggregates(sv, bv_mask3);
+                
+                sv.optimize();
+            } // for k
+            cout << "." << flush;
+        } // for pass
+    }
     
-
+    cout << " --------------- Test sparse vector aggregates OK" << endl;
 }
 
-inline
-void LoadBVDump(const char* filename, const char* filename_out=0, bool validate=false)
+template<class SV>
+void CheckSparseVectorBackInserter(SV& sv, const SV& sv_control)
 {
-    ifstream bv_file (filename, ios::in | ios::binary);
-    if (!bv_file.good())
+    if (!sv.equal(sv_control))
     {
-        cout << "Cannot open file: " << filename << endl;
+        cerr << "Back insert iterator check failed! size=" << sv.size()
+             << " control size=" << sv_control.size() << endl;
         exit(1);
     }
-
-    ofstream* bv_file_out = 0;
-
-    if (filename_out)
+    typename SV::size_type sz = sv.size();
+    for (typename SV::size_type i = 0; i < sz; i += 77)
     {
-        bv_file_out = new ofstream(filename_out, ios::out | ios::binary);
-        if (!bv_file_out->good())
+        if (sv.get(i) != sv_control.get(i) ||
+            sv.is_null(i) != sv_control.is_null(i))
         {
-            cout << "Cannot create file: " << filename_out << endl;
+            cerr << "Back insert iterator element mismatch at " << i << endl;
             exit(1);
-        }    
+        }
     }
+}
 
-
-    unsigned buffer_size = 1024*1024;
-    unsigned char* buffer = new unsigned char[buffer_size];
-
-    unsigned count = 0;
-    clock_t start = clock();
-    unsigned total_out_size = 0;
-
-    for (;1; ++count)
+template<class SV>
+void TestSparseVectorBackInserterType(bm::null_support null_able)
+{
+    typedef typename SV::value_type value_type;
+    for (unsigned pass = 0; pass < 3; ++pass)
     {
-        unsigned bv_size;
-        bv_file.read((char*)&bv_size, sizeof(bv_size));
-        if (!bv_file.good())
-            break;
-        if (bv_size == 0)
-        {
-            cout << "Warning:Zero vector in dump..." << endl;
-            continue;
-        }
-        if (buffer_size < bv_size)
+        SV sv(null_able);
+        SV sv_control(null_able);
+        
+        // unaligned start: first flush is a partial block
+        unsigned start = pass * 1000;
+        for (unsigned i = 0; i < start; ++i)
         {
-            delete [] buffer;
-            buffer_size = bv_size;
-            buffer = new unsigned char[buffer_size];
+            sv.push_back(value_type(i));
+            sv_control.push_back(value_type(i));
         }
-        bv_file.read((char*)buffer, bv_size);
         {
-            bvect bv;
-            bm::deserialize(bv, (unsigned char*)buffer);
-
-            bvect::statistics st1;
-            bv.calc_stat(&st1);
-
-            if (st1.max_serialize_mem > buffer_size)
-            {
-                delete [] buffer;
-                buffer_size = (unsigned)st1.max_serialize_mem;
-                buffer = new unsigned char[buffer_size];
-            }
-
-            unsigned blob_size = bm::serialize(bv, buffer, BM_NO_GAP_LENGTH|BM_NO_BYTE_ORDER);
-            total_out_size += blob_size;
-
-            if (blob_size > bv_size)
-            {
-                //print_stat(bv);
-                //cout << count << ". -" << blob_size-bv_size << endl;
-                //exit(1);
-            }
-            
-            if (validate)
+            typename SV::back_insert_iterator bi(sv.get_back_inserter());
+            for (unsigned i = 0; i < 65536 * 5 + 17; ++i)
             {
-                bvect bv_control;
-                bm::deserialize(bv_control, (unsigned char*)buffer);
-                if (bv_control != bv)
+                value_type v;
+                switch ((i >> 16) % 5)
                 {
-                    cout << "Serialization error!" << endl;
-                    exit(1);
+                case 0: v = value_type(i * 13); break;
+                case 1: v = 0; break;              // empty plains
+                case 2: v = value_type(~0ull); break; // FULL plains
+                case 3: v = value_type(rand()); break;
+                default: v = value_type(i & 0xFF);
                 }
-            }
-            
-            if (bv_file_out)
-            {
-                bv_file_out->write((char*)&blob_size, sizeof(blob_size));
-                bv_file_out->write((char*)buffer, blob_size);
-            }
+                if (null_able == bm::use_null && (i % 1001) == 0)
+                {
+                    bi.add_null();
+                    sv_control.resize(sv_control.size() + 1);
+                    continue;
+                }
+                *bi = v;
+                sv_control.push_back(v);
+            } // for i
+        }
+        CheckSparseVectorBackInserter(sv, sv_control);
+        
+        // append after optimization with std algorithm
+        sv.optimize();
+        std::vector<value_type> vect(200000);
+        for (unsigned i = 0; i < vect.size(); ++i)
+            vect[i] = value_type(i * 7);
+        {
+            typename SV::back_insert_iterator bi(sv.get_back_inserter());
+            std::copy(vect.begin(), vect.end(), bi);
+            bi.flush();
+        }
+        for (unsigned i = 0; i < vect.size(); ++i)
+            sv_control.push_back(vect[i]);
+        CheckSparseVectorBackInserter(sv, sv_control);
+    } // for pass
+}
 
+static
+void TestSparseVectorBackInserter()
+{
+    cout << " --------------- Test sparse vector back insert iterator" << endl;
+    
+    {
+        sparse_vector_u32 sv;
+        {
+            sparse_vector_u32::back_insert_iterator bi = sv.get_back_inserter();
+            bi = 1; bi = 2; bi = 0; bi = 10;
+            assert(!bi.empty());
+            bi.flush();
+            assert(bi.empty());
         }
-        if (count % 1000 == 0)
+        assert(sv.size() == 4);
+        assert(sv[0] == 1 && sv[1] == 2 && sv[2] == 0 && sv[3] == 10);
+    }
+    
+    // copy, assignment and move keep the insertion order
+    {
+        sparse_vector_u32 sv;
+        unsigned v = 0;
         {
-            cout << count << " out=" << total_out_size << endl;
+            sparse_vector_u32::back_insert_iterator bi = sv.get_back_inserter();
+            for (; v < 100; ++v)
+                bi = v;
+            
+            sparse_vector_u32::back_insert_iterator bi_c(bi); // copy
+            assert(bi.empty() && sv.size() == 100);
+            for (; v < 200; ++v)
+                bi_c = v;
+            
+            sparse_vector_u32::back_insert_iterator bi_a;
+            bi_a = bi_c; // assignment
+            assert(bi_c.empty() && sv.size() == 200);
+            for (; v < 300; ++v)
+                bi_a = v;
+            
+            sparse_vector_u32::back_insert_iterator bi_m(std::move(bi_a));
+            assert(bi_a.empty() && !bi_m.empty());
+            for (; v < 400; ++v)
+                bi_m = v;
+            
+            // STL algorithms pass output iterator by value
+            std::vector<unsigned> vect(70000);
+            for (unsigned i = 0; i < vect.size(); ++i)
+                vect[i] = v++;
+            bi_m = std::copy(vect.begin(), vect.end(), bi_m);
+            bi_m = v++; // tail
+        }
+        assert(sv.size() == v);
+        for (unsigned i = 0; i < v; ++i)
+        {
+            if (sv[i] != i)
+            {
+                cerr << "Back insert iterator copy failed at " << i 
+                     << " " << sv[i] << endl;
+                exit(1);
+            }
         }
-        //cout << count << ": size=" << bv_size << endl;
     }
+    
+    TestSparseVectorBackInserterType<sparse_vector_u32>(bm::no_null);
+    TestSparseVectorBackInserterType<sparse_vector_u32>(bm::use_null);
+    cout << "." << flush;
+    TestSparseVectorBackInserterType<bm::sparse_vector<unsigned char, bvect> >(bm::use_null);
+    TestSparseVectorBackInserterType<bm::sparse_vector<unsigned short, bvect> >(bm::no_null);
+    cout << "." << flush;
+    
+    cout << " --------------- Test sparse vector back insert iterator OK" << endl;
+}
 
-    delete [] buffer;
-    cout << "Total vectors:" << count << endl;
-    cout << "Total out size:" << total_out_size << endl;
-
-    clock_t finish = clock();
-    clock_t elapsed_clocks = finish - start;
-    double duration = (double)(elapsed_clocks) / CLOCKS_PER_SEC;
-
-    cout << endl
-         << "Serialization duration = " << duration 
-         << endl;
-
-    bv_file_out->close();
-    delete bv_file_out;
-
-}
-
-inline
-void GroupByTest(const char* filename, const char* query_filename)
+template<class SV>
+void CheckSparseVectorGather(const SV& sv, 
+                             const std::vector<typename SV::size_type>& idx)
 {
-    bvect bv_query;
-
-    unsigned count = 0;
-    unsigned group_by_count = 0;
-
-    clock_t start = clock();
-
-    // load the query vector
+    std::vector<typename SV::value_type> vals(idx.size() + 1, 7);
+    typename SV::size_type cnt = sv.gather(vals.data(), idx.data(), 
+                                           typename SV::size_type(idx.size()));
+    assert(cnt == idx.size());
+    for (size_t i = 0; i < idx.size(); ++i)
     {
-        ifstream bv_file (query_filename, ios::in | ios::binary);
-        if (!bv_file.good())
+        typename SV::value_type v = sv.get(idx[i]);
+        if (v != vals[i])
         {
-            cout << "Cannot open file: " << query_filename << endl;
+            cerr << "Sparse vector gather failed at idx=" << idx[i]
+                 << " " << vals[i] << "!=" << v << endl;
             exit(1);
         }
-        unsigned buffer_size = 400*1024*1024;
-        unsigned char* buffer = new unsigned char[buffer_size];
-
-        unsigned bv_size=0;
-        bv_file.read((char*)&bv_size, sizeof(bv_size));
-        if (bv_size == 0)
+    }
+    assert(vals[idx.size()] == 7); // no overrun
+    
+    bvect bv_idx;
+    for (size_t i = 0; i < idx.size(); ++i)
+        bv_idx.set(idx[i]);
+    std::vector<typename SV::value_type> vals2(bv_idx.count() + 1);
+    cnt = sv.gather(vals2.data(), bv_idx, bv_idx.count());
+    assert(cnt == bv_idx.count());
+    bvect::enumerator en = bv_idx.first();
+    for (size_t i = 0; en.valid(); ++en, ++i)
+    {
+        if (vals2[i] != sv.get(*en))
         {
-            cout << "Warning:Zero vector in query dump..." << endl;
-            return;
+            cerr << "Sparse vector gather (bvector) failed at idx=" << *en
+                 << endl;
+            exit(1);
         }
-        bv_file.read((char*)buffer, bv_size);
-        bm::deserialize(bv_query, (unsigned char*)buffer);
-        
-        delete [] buffer;
-
     }
+}
 
+template<class SV>
+void CheckSparseVectorGatherRandom(const SV& sv)
+{
+    std::vector<typename SV::size_type> idx;
+    CheckSparseVectorGather(sv, idx);
+    
+    idx.push_back(0);
+    CheckSparseVectorGather(sv, idx);
+    
+    idx.clear(); // dense run
+    for (typename SV::size_type i = 0; i < sv.size() && i < 100000; ++i)
+        idx.push_back(i);
+    CheckSparseVectorGather(sv, idx);
+    
+    idx.clear(); // random, with duplicates
+    for (unsigned i = 0; i < 100000; ++i)
+        idx.push_back(typename SV::size_type(rand()) % sv.size());
+    std::sort(idx.begin(), idx.end());
+    CheckSparseVectorGather(sv, idx);
+    
+    idx.clear(); // sparse
+    for (typename SV::size_type i = 0; i < sv.size(); i += 65536 + 17)
+        idx.push_back(i);
+    idx.push_back(sv.size()-1);
+    CheckSparseVectorGather(sv, idx);
+}
 
-    ifstream bv_file (filename, ios::in | ios::binary);
-    if (!bv_file.good())
+static
+void TestSparseVectorGather()
+{
+    cout << " --------------- Test sparse vector gather" << endl;
+    
     {
-        cout << "Cannot open file: " << filename << endl;
-        exit(1);
+        sparse_vector_u32 sv;
+        sv.push_back(1);
+        sv.push_back(0);
+        sv.push_back(0xFFFFFFFF);
+        sv.push_back(5);
+        unsigned idx[] = { 0, 2, 2, 3 };
+        unsigned vals[4];
+        sv.gather(vals, idx, 4);
+        assert(vals[0] == 1 && vals[1] == 0xFFFFFFFF && vals[2] == 0xFFFFFFFF);
+        assert(vals[3] == 5);
     }
+    
+    for (unsigned pass = 0; pass < 2; ++pass)
+    {
+        sparse_vector_u32 sv(pass ? bm::use_null : bm::no_null);
+        std::vector<unsigned> vect;
+        FillSparseIntervals(vect, sv, 0, 3000000, 5);
+        for (unsigned i = 200000; i < 400000; ++i) // FULL blocks
+            sv.set(i, 0xFFFFFFFF);
+        if (pass)
+        {
+            for (unsigned i = 0; i < 100000; i += 3)
+                sv.set_null(i);
+        }
+        CheckSparseVectorGatherRandom(sv);
+        sv.optimize();
+        CheckSparseVectorGatherRandom(sv);
+        cout << "." << flush;
+    }
+    
+    {
+        bm::sparse_vector<unsigned char, bvect> sv8;
+        bm::sparse_vector<unsigned long long, bvect> sv64;
+        for (unsigned i = 0; i < 300000; ++i)
+        {
+            sv8.push_back((unsigned char)(i * 7));
+            sv64.push_back((unsigned long long)(i) * 0x100000007ULL);
+        }
+        CheckSparseVectorGatherRandom(sv8);
+        CheckSparseVectorGatherRandom(sv64);
+        sv8.optimize();
+        sv64.optimize();
+        CheckSparseVectorGatherRandom(sv8);
+        CheckSparseVectorGatherRandom(sv64);
+    }
+    
+    cout << " --------------- Test sparse vector gather OK" << endl;
+}
 
+typedef bm::sparse_vector_group_by<sparse_vector_u32> sv_group_by_u32;
+typedef std::map<unsigned, sv_group_by_u32::group_stat> group_stat_map;
 
-    unsigned buffer_size = 100*1024*1024;
-    unsigned char* buffer = new unsigned char[buffer_size];
-
-    for (;1; ++count)
+static
+void GroupByControl(const sparse_vector_u32& sv_keys,
+                    const bvect&             bv_filter,
+                    const sparse_vector_u32& sv_values,
+                    group_stat_map&          res)
+{
+    bvect::enumerator en = bv_filter.first();
+    for (; en.valid(); ++en)
     {
-        unsigned bv_size;
-        bv_file.read((char*)&bv_size, sizeof(bv_size));
-        if (!bv_file.good())
+        unsigned idx = *en;
+        if (idx >= sv_keys.size())
             break;
-        if (bv_size == 0)
-        {
-            cout << "Warning:Zero vector in dump..." << endl;
+        if (sv_keys.is_null(idx))
             continue;
-        }
-        if (buffer_size < bv_size)
+        sv_group_by_u32::group_stat& st = res[sv_keys.get(idx)];
+        ++st.count;
+        if (idx < sv_values.size())
+            st.sum += sv_values.get(idx);
+    }
+}
+
+static
+void CheckGroupBy(const group_stat_map& res, const group_stat_map& res_c)
+{
+    if (res.size() != res_c.size())
+    {
+        cerr << "Group by size mismatch! " << res.size() << " control="
+             << res_c.size() << endl;
+        exit(1);
+    }
+    group_stat_map::const_iterator it = res.begin();
+    group_stat_map::const_iterator it_c = res_c.begin();
+    for (; it != res.end(); ++it, ++it_c)
+    {
+        if (it->first != it_c->first ||
+            it->second.count != it_c->second.count ||
+            it->second.sum != it_c->second.sum)
         {
-            delete [] buffer;
-            buffer_size = bv_size;
-            buffer = new unsigned char[buffer_size];
+            cerr << "Group by mismatch! key=" << it->first << "/" << it_c->first
+                 << " count=" << it->second.count << "/" << it_c->second.count
+                 << " sum=" << it->second.sum << "/" << it_c->second.sum
+                 << endl;
+            exit(1);
         }
-        bv_file.read((char*)buffer, bv_size);
-        bvect bv;
-        if (1)
-        {
-            bv.clear(true);
-            bm::deserialize(bv, (unsigned char*)buffer);
+    }
+}
 
-            unsigned bc = bm::count_and(bv, bv_query);
-            if (bc)
+static
+void CheckSparseVectorGroupBy(const sparse_vector_u32& sv_keys,
+                              const bvect&             bv_filter,
+                              const sparse_vector_u32& sv_values)
+{
+    sv_group_by_u32 gb;
+    group_stat_map res, res_c;
+    gb.group_by(sv_keys, bv_filter, sv_values, res);
+    GroupByControl(sv_keys, bv_filter, sv_values, res_c);
+    CheckGroupBy(res, res_c);
+    
+    // the same grouping via id-map of per-key bit-vectors
+    std::map<unsigned, bvect> key_map;
+    bm::sparse_vector_scanner<sparse_vector_u32> scanner;
+    for (group_stat_map::const_iterator it = res_c.begin(); it != res_c.end(); ++it)
+        scanner.find_eq(sv_keys, it->first, key_map[it->first]);
+    key_map[0xFFFFFFF]; // empty group is not reported
+    
+    group_stat_map res_m;
+    gb.group_by_map(key_map, bv_filter, sv_values, res_m);
+    CheckGroupBy(res_m, res_c);
+}
+
+static
+void TestSparseVectorGroupBy()
+{
+    cout << " --------------- Test sparse vector group by" << endl;
+    
+    {
+        sparse_vector_u32 sv_keys(bm::use_null);
+        sparse_vector_u32 sv_values;
+        sv_keys.set(0, 1); sv_values.set(0, 10);
+        sv_keys.set(1, 2); sv_values.set(1, 20);
+        sv_keys.set(2, 1); sv_values.set(2, 30);
+        sv_keys.set(4, 0); sv_values.set(4, 7);
+        sv_values.set(5, 100); // NULL key
+        
+        bvect bv_filter;
+        bv_filter.set_range(0, 10);
+        
+        sv_group_by_u32 gb;
+        group_stat_map res;
+        gb.group_by(sv_keys, bv_filter, sv_values, res);
+        assert(res.size() == 3);
+        assert(res[0].count == 1 && res[0].sum == 7);
+        assert(res[1].count == 2 && res[1].sum == 40);
+        assert(res[2].count == 1 && res[2].sum == 20);
+        CheckSparseVectorGroupBy(sv_keys, bv_filter, sv_values);
+        
+        bvect bv_filter2 { 1, 3, 5 };
+        CheckSparseVectorGroupBy(sv_keys, bv_filter2, sv_values);
+        bvect bv_filter3;
+        CheckSparseVectorGroupBy(sv_keys, bv_filter3, sv_values);
+    }
+    
+    {
+        for (unsigned pass = 0; pass < 2; ++pass)
+        {
+            const unsigned size = 3000000;
+            sparse_vector_u32 sv_keys(pass ? bm::use_null : bm::no_null);
+            sparse_vector_u32 sv_values;
+            for (unsigned i = 0; i < size; i += 3)
             {
-                ++group_by_count;
+                sv_keys.set(i, (i / 7) % 13 + (i & 0x100));
+                sv_values.set(i, i);
             }
-
-/*            
-            bv &= bv_query;
-            if (bv.any())
+            sv_keys.set(size, 0xFFFFFFFF); // high plains in one block
+            for (unsigned i = 2000000; i < 2200000; ++i) // FULL key plains
             {
-                ++group_by_count;
+                sv_keys.set(i, 5);
+                sv_values.set(i, 0xFFFFFFFF);
             }
-*/            
+            if (pass)
+            {
+                for (unsigned i = 0; i < 100000; i += 5)
+                    sv_keys.set_null(i);
+            }
+            for (unsigned k = 0; k < 2; ++k)
+            {
+                bvect bv_filter;
+                generate_bvector(bv_filter, size + 100000);
+                CheckSparseVectorGroupBy(sv_keys, bv_filter, sv_values);
+                
+                bvect bv_filter2;
+                bv_filter2.set_range(1900000, 2300000);
+                CheckSparseVectorGroupBy(sv_keys, bv_filter2, sv_values);
+                
+                sv_keys.optimize();
+                sv_values.optimize();
+            } // for k
+            cout << "." << flush;
+        } // for pass
+    }
+    
+    cout << " --------------- Test sparse vector group by OK" << endl;
+}
 
+typedef bm::rsc_sparse_vector<unsigned, sparse_vector_u32 > rsc_sparse_vector_u32;
+
+static
+void CheckRSCSparseVector(const sparse_vector_u32& sv,
+                          const rsc_sparse_vector_u32& csv)
+{
+    if (sv.size() != csv.size())
+    {
+        cerr << "RSC size mismatch " << sv.size() << " " << csv.size() << endl;
+        exit(1);
+    }
+    const bvect* bv_null = sv.get_null_bvector();
+    assert(bv_null);
+    if (bv_null->count() != csv.count_not_null())
+    {
+        cerr << "RSC NOT NULL count mismatch" << endl;
+        exit(1);
+    }
+    for (unsigned i = 0; i < sv.size(); ++i)
+    {
+        bool is_null = sv.is_null(i);
+        if (is_null != csv.is_null(i))
+        {
+            cerr << "RSC NULL mismatch at " << i << endl;
+            exit(1);
         }
+        unsigned v1 = sv.get(i);
+        unsigned v2 = csv.get(i);
+        if (v1 != v2)
+        {
+            cerr << "RSC value mismatch at " << i << " "
+                 << v1 << " " << v2 << endl;
+            exit(1);
+        }
+    } // for i
     
-    
-#if 0
-//print_stat(bv_query);
-//exit(1);
+    // range decode (row ids shifted NULLs must be exported as 0)
+    std::vector<unsigned> arr1(70000), arr2(70000);
+    unsigned sz = sv.size();
+    for (unsigned from = 0; from < sz; from += 12345)
+    {
+        unsigned len = unsigned(arr1.size());
+        unsigned d1 = (from + len > sz) ? sz - from : len;
+        sv.decode(&arr1[0], from, len);
+        unsigned d2 = csv.decode(&arr2[0], from, len);
+        if (d1 != d2)
         {
-        bvect bv(BM_GAP);
-        operation_deserializer<bvect>::deserialize(bv,
-                                                   bv_query,
-                                                   (unsigned char*)buffer,
-                                                   0,
-                                                   bm::set_AND);
-        // control			
-        if (0)
+            cerr << "RSC decode size mismatch at " << from << endl;
+            exit(1);
+        }
+        for (unsigned k = 0; k < d1; ++k)
         {
-            bvect bv_control(BM_GAP);
-            bm::deserialize(bv_control, (unsigned char*)buffer);
-            bv_control &= bv_query;
-            if (bv_control != bv)
+            if (arr1[k] != arr2[k])
             {
-                cerr << "Group by control failure" << endl;
-                cerr << bv_control.count() << endl;
-                cerr << bv.count() << endl;
+                cerr << "RSC decode mismatch at " << from + k << endl;
                 exit(1);
             }
-        }				
-
+        }
+    } // for from
+    
+    // export back to NULL-able sparse vector
+    sparse_vector_u32 sv2(bm::use_null);
+    csv.load_to(sv2);
+    if (!sv.equal(sv2, bm::use_null))
+    {
+        cerr << "RSC load_to comparison failed" << endl;
+        exit(1);
+    }
+    
+    // serialization round trip
+    BM_DECLARE_TEMP_BLOCK(tb)
+    bm::sparse_vector_serial_layout<sparse_vector_u32> sv_lay;
+    bm::sparse_vector_serialize(csv, sv_lay, tb);
+    rsc_sparse_vector_u32 csv2;
+    int res = bm::sparse_vector_deserialize(csv2, sv_lay.buf(), tb);
+    if (res != 0 || !csv2.in_sync() || !csv.equal(csv2))
+    {
+        cerr << "RSC serialization comparison failed" << endl;
+        exit(1);
+    }
+}
 
-        if (bv.any())
+void TestRSCSparseVector()
+{
+    cout << " --------------- Test rsc_sparse_vector<>" << endl;
+    
+    {
+        rsc_sparse_vector_u32 csv;
+        assert(csv.empty());
+        csv.push_back(1, 10);
+        csv.push_back(2, 20);
+        csv.push_back_null(2);
+        csv.push_back(10, 100);
+        assert(csv.size() == 11);
+        assert(csv.count_not_null() == 3);
+        assert(!csv.in_sync());
+        assert(csv.get(2) == 20); // slow access works without index
+        csv.sync();
+        assert(csv.in_sync());
+        assert(csv.is_null(0) && csv.get(0) == 0);
+        assert(csv.get(1) == 10 && csv.get(2) == 20);
+        assert(csv.is_null(3) && csv.is_null(9));
+        assert(csv.at(10) == 100);
+        unsigned idx_to;
+        assert(csv.resolve(10, &idx_to) && idx_to == 2);
+        assert(!csv.resolve(5, &idx_to));
+        
+        bool caught = false;
+        try
         {
-            ++group_by_count;
+            csv.push_back(5, 1);
         }
+        catch (std::range_error&)
+        {
+            caught = true;
         }
-#endif
-
-        if (count % 1000 == 0)
+        assert(caught);
+        caught = false;
+        try
         {
-            cout << count << endl;
+            csv.at(11);
+        }
+        catch (std::range_error&)
+        {
+            caught = true;
         }
+        assert(caught);
+        
+        unsigned arr[5];
+        unsigned d = csv.decode(arr, 8, 5);
+        assert(d == 3);
+        assert(arr[0] == 0 && arr[1] == 0 && arr[2] == 100);
+        
+        rsc_sparse_vector_u32 csv2(csv);
+        assert(csv2.in_sync() && csv2.equal(csv));
+        csv2.clear();
+        assert(csv2.empty());
+        csv2.swap(csv);
+        assert(csv.empty() && csv2.get(10) == 100);
     }
-
-    delete [] buffer;
-    cout << "Total vectors:" << count << endl;
-    cout << "Group by vectors:" << group_by_count << endl;
-
-    clock_t finish = clock();
-    clock_t elapsed_clocks = finish - start;
-    double duration = (double)(elapsed_clocks) / CLOCKS_PER_SEC;
-
-    cout << endl
-         << "Test duration = " << duration 
-         << endl;
+    
+    // load from non NULL-able vector
+    {
+        sparse_vector_u32 sv;
+        for (unsigned i = 0; i < 100000; ++i)
+            sv.push_back(i * 3);
+        rsc_sparse_vector_u32 csv;
+        csv.load_from(sv);
+        assert(csv.count_not_null() == sv.size());
+        for (unsigned i = 0; i < sv.size(); ++i)
+        {
+            assert(csv.get(i) == sv.get(i));
+        }
+    }
+    
+    for (unsigned pass = 0; pass < 3; ++pass)
+    {
+        sparse_vector_u32 sv(bm::use_null);
+        rsc_sparse_vector_u32 csv_pb;
+        unsigned step = pass == 0 ? 3 : (pass == 1 ? 1 : 97);
+        unsigned from = pass == 2 ? 65536 * 3 : 0;
+        for (unsigned i = from; i < 1500000; i += step)
+        {
+            unsigned v = rand() % 100000;
+            if (pass == 1 && (i & 0xFFFF) > 50000)
+                continue; // leave NULL holes
+            sv.set(i, v);
+            csv_pb.push_back(i, v);
+        }
+        sv.resize(1600000);
+        csv_pb.push_back_null(1600000 - csv_pb.size());
+        csv_pb.sync();
+        
+        rsc_sparse_vector_u32 csv;
+        csv.load_from(sv);
+        assert(csv.equal(csv_pb));
+        
+        CheckRSCSparseVector(sv, csv);
+        CheckRSCSparseVector(sv, csv_pb);
+        
+        csv.optimize();
+        assert(csv.in_sync());
+        CheckRSCSparseVector(sv, csv);
+        
+        rsc_sparse_vector_u32::statistics st;
+        csv.calc_stat(&st);
+        sparse_vector_u32::statistics st_sv;
+        sv.optimize(0, bvect::opt_compress, &st_sv);
+        cout << "  sv=" << st_sv.memory_used << " rsc=" << st.memory_used << endl;
+    } // for pass
+
+    // signed values (zig-zag encoded plains)
+    {
+        typedef bm::sparse_vector<int, bvect > sparse_vector_int;
+        typedef bm::rsc_sparse_vector<int, sparse_vector_int > rsc_sparse_vector_int;
+
+        sparse_vector_int sv(bm::use_null);
+        rsc_sparse_vector_int csv_pb;
+        csv_pb.push_back(1, -5);
+        sv.set(1, -5);
+        assert(csv_pb.get(1) == -5);
+        for (unsigned i = 3; i < 300000; i += 7)
+        {
+            int v = (rand() % 200001) - 100000;
+            if (i % 5 == 0)
+                v = (i & 1) ? INT_MIN : INT_MAX;
+            sv.set(i, v);
+            csv_pb.push_back(i, v);
+        }
+        sv.resize(300005);
+        csv_pb.push_back_null(300005 - csv_pb.size());
+        csv_pb.sync();
+        assert(csv_pb.get(1) == -5);
+
+        rsc_sparse_vector_int csv;
+        csv.load_from(sv);
+        assert(csv.equal(csv_pb));
+
+        sparse_vector_int sv2(bm::use_null);
+        csv_pb.load_to(sv2);
+        assert(sv2.equal(sv));
+        for (unsigned i = 0; i < sv.size(); ++i)
+        {
+            assert(sv2.get(i) == sv.get(i));
+            assert(csv_pb.get(i) == sv.get(i));
+            assert(csv_pb.is_null(i) == sv.is_null(i));
+        }
+    }
+
+    cout << " --------------- Test rsc_sparse_vector<> OK" << endl;
 }
 
+typedef bm::str_sparse_vector<char, bvect, 32> str_svect_type;
 
-inline
-void LoadVectors(const char* dir_name, unsigned from, unsigned to)
+static
+void GenerateStrings(std::vector<std::string>& str_coll, unsigned count)
 {
-    vector<bvect*>   bv_list;
-    vector<unsigned> sz_list;
+    const char* prefixes[] = { "abc", "ab", "xyz", "", "a", "zz-top" };
+    char buf[64];
+    for (unsigned i = 0; i < count; ++i)
+    {
+        unsigned r = unsigned(rand());
+        const char* pfx = prefixes[r % 6];
+        unsigned len = (r >> 4) % 20;
+        ::strcpy(buf, pfx);
+        unsigned pos = unsigned(::strlen(buf));
+        for (unsigned k = 0; k < len; ++k)
+            buf[pos++] = char('a' + (rand() % 26));
+        if (i % 11 == 0) // a few high (negative) chars
+            buf[pos++] = char(0xE5);
+        buf[pos] = 0;
+        str_coll.push_back(std::string(buf));
+    } // for i
+}
 
-    unsigned total_size = 0;
-    unsigned total_new_size = 0;
+static
+void CheckStrSparseVector(const str_svect_type& str_sv,
+                          const std::vector<std::string>& str_coll,
+                          unsigned offset = 0)
+{
+    char buf[64];
+    for (unsigned i = 0; i < str_coll.size(); ++i)
+    {
+        const std::string& s = str_coll[i];
+        unsigned len = str_sv.get(i + offset, buf, sizeof(buf));
+        if (len != s.size() || s != buf)
+        {
+            cerr << "String sparse vector mismatch at " << i + offset
+                 << " '" << s << "' '" << buf << "'" << endl;
+            exit(1);
+        }
+        if (str_sv.compare(i + offset, s.c_str()) != 0)
+        {
+            cerr << "String sparse vector compare() failed at " << i << endl;
+            exit(1);
+        }
+    } // for i
+}
 
-    for(; from <= to; ++from)
+static
+void CheckStrSparseVectorSearch(const str_svect_type& str_sv,
+                                const std::vector<std::string>& str_coll,
+                                const char* str, bool prefix)
+{
+    bm::sparse_vector_scanner<str_svect_type> scanner;
+    bvect bv_res, bv_control;
+    size_t str_len = ::strlen(str);
+    for (unsigned i = 0; i < str_coll.size(); ++i)
+    {
+        const std::string& s = str_coll[i];
+        bool found = prefix ? (s.compare(0, str_len, str) == 0) : (s == str);
+        if (found)
+            bv_control.set(i);
+    }
+    if (prefix)
+        scanner.find_eq_str_prefix(str_sv, str, bv_res);
+    else
+        scanner.find_eq_str(str_sv, str, bv_res);
+    if (bv_res.compare(bv_control) != 0)
     {
-        std::strstream fname_str;
-        fname_str << dir_name << "/" << from;
-        char* fname = fname_str.str();
-        
-        bvect* bv = new bvect;
-
-        unsigned fsize = 0;
-        LoadBVector(fname, *bv, &fsize);
-        //bv->optimize();
-        //print_stat(*bv);
-
-
-        // get new size
-        unsigned blob_size = 0;
+        cerr << "String sparse vector search failed for '" << str
+             << "' prefix=" << prefix << " " << bv_res.count() << " "
+             << bv_control.count() << endl;
+        exit(1);
+    }
+    if (!prefix)
+    {
+        unsigned idx;
+        bool found = scanner.find_eq_str(str_sv, str, idx);
+        if (found != bv_control.any() ||
+            (found && idx != bv_control.get_first()))
         {
-        bvect::statistics st1;
-        bv->calc_stat(&st1);
-
-        unsigned char* blob = new unsigned char[st1.max_serialize_mem];
-        blob_size = bm::serialize(*bv, blob, BM_NO_GAP_LENGTH|BM_NO_BYTE_ORDER);
+            cerr << "String sparse vector find first failed for '"
+                 << str << "'" << endl;
+            exit(1);
+        }
+    }
+}
 
-        if (st1.max_serialize_mem < blob_size)
+void TestStrSparseVector()
+{
+    cout << " --------------- Test str_sparse_vector<>" << endl;
+    
+    {
+        str_svect_type str_sv(bm::use_null);
+        char buf[64];
+        assert(str_sv.empty());
+        str_sv.push_back("hello");
+        str_sv.push_back("");
+        str_sv.set(3, "world");
+        assert(str_sv.size() == 4);
+        assert(str_sv.get(0, buf, sizeof(buf)) == 5 && ::strcmp(buf, "hello") == 0);
+        assert(str_sv.get(1, buf, sizeof(buf)) == 0 && buf[0] == 0);
+        assert(!str_sv.is_null(1));
+        assert(str_sv.is_null(2));
+        assert(str_sv.get(3, buf, 4) == 3 && ::strcmp(buf, "wor") == 0);
+        assert(str_sv.compare(0, "hello") == 0);
+        assert(str_sv.compare(0, "hellp") < 0);
+        assert(str_sv.compare(0, "hell") > 0);
+        assert(str_sv.compare(0, "hello!") < 0);
+        str_sv.set(0, "hi");
+        assert(str_sv.get(0, buf, sizeof(buf)) == 2 && ::strcmp(buf, "hi") == 0);
+        str_sv.set_null(3);
+        assert(str_sv.is_null(3));
+        assert(str_sv.get(3, buf, sizeof(buf)) == 0);
+        
+        const char* s32 = "0123456789abcdef0123456789ABCDEF";
+        str_sv.push_back(s32);
+        assert(str_sv.get(4, buf, sizeof(buf)) == 32 && ::strcmp(buf, s32) == 0);
+        assert(str_sv.compare(4, s32) == 0);
+        bool caught = false;
+        try
+        {
+            str_sv.push_back("0123456789abcdef0123456789ABCDEF-");
+        }
+        catch (std::range_error&)
+        {
+            caught = true;
+        }
+        assert(caught);
+        
+        str_svect_type str_sv2(str_sv);
+        assert(str_sv2.equal(str_sv));
+        str_sv2.set(1, "x");
+        assert(!str_sv2.equal(str_sv));
+        str_sv2 = str_sv;
+        assert(str_sv2.equal(str_sv));
+        str_sv2.resize(1);
+        assert(str_sv2.size() == 1);
+        str_sv2.clear();
+        assert(str_sv2.empty());
+    }
+    
+    std::vector<std::string> str_coll;
+    GenerateStrings(str_coll, 200000);
+    std::vector<const char*> strs;
+    for (unsigned i = 0; i < str_coll.size(); ++i)
+        strs.push_back(str_coll[i].c_str());
+    
+    {
+        str_svect_type str_sv_pb;
+        for (unsigned i = 0; i < str_coll.size(); ++i)
+            str_sv_pb.push_back(strs[i]);
+        CheckStrSparseVector(str_sv_pb, str_coll);
+        
+        // block transposition import
+        str_svect_type str_sv;
+        str_sv.import(&strs[0], unsigned(strs.size()));
+        CheckStrSparseVector(str_sv, str_coll);
+        assert(str_sv.equal(str_sv_pb));
+        
+        // import over existing content (row by row path)
+        str_svect_type str_sv2(str_sv);
+        str_sv2.import(&strs[0], 70000, 100);
+        std::vector<std::string> str_coll2(str_coll.begin(), str_coll.begin() + 70000);
+        CheckStrSparseVector(str_sv2, str_coll2, 100);
+        
+        BM_DECLARE_TEMP_BLOCK(tb)
+        str_svect_type::statistics st;
+        str_sv.optimize(tb, bvect::opt_compress, &st);
+        CheckStrSparseVector(str_sv, str_coll);
+        assert(str_sv.equal(str_sv_pb));
+        cout << "  strings=" << str_coll.size() << " memory=" << st.memory_used << endl;
+        
+        const char* probes[] = { "abc", "ab", "a", "", "zz-top", "xyz", "q" };
+        for (unsigned k = 0; k < sizeof(probes)/sizeof(probes[0]); ++k)
         {
-            printf("BLOB size prediction error!\n");
+            CheckStrSparseVectorSearch(str_sv, str_coll, probes[k], true);
+            CheckStrSparseVectorSearch(str_sv, str_coll, probes[k], false);
+        }
+        for (unsigned k = 0; k < 100; ++k)
+        {
+            const std::string& s = str_coll[unsigned(rand()) % str_coll.size()];
+            CheckStrSparseVectorSearch(str_sv, str_coll, s.c_str(), false);
+            CheckStrSparseVectorSearch(str_sv, str_coll,
+                                       s.substr(0, s.size() / 2).c_str(), true);
+        }
+        
+        // serialization round trip (257 plains: wide header)
+        bm::sparse_vector_serial_layout<str_svect_type> sv_lay;
+        bm::sparse_vector_serialize(str_sv, sv_lay, tb);
+        str_svect_type str_sv3;
+        int res = bm::sparse_vector_deserialize(str_sv3, sv_lay.buf(), tb);
+        if (res != 0 || !str_sv3.equal(str_sv))
+        {
+            cerr << "String sparse vector serialization failed" << endl;
             exit(1);
         }
-
-        //if (from >= 27)
+        cout << "  serialized size=" << sv_lay.size() << endl;
+    }
+    
+    // NULL-able vector with narrow plains
+    {
+        typedef bm::str_sparse_vector<char, bvect, 8> str_svect8_type;
+        str_svect8_type str_sv(bm::use_null);
+        unsigned odd_cnt = 0;
+        for (unsigned i = 0; i < 100000; i += 3)
         {
-            bvect bv_control;
-            bm::deserialize(bv_control, (unsigned char*)blob);
-            if (bv_control != *bv)
+            str_sv.set(i, (i % 2) ? "odd" : "even");
+            odd_cnt += (i % 2);
+        }
+        bm::sparse_vector_scanner<str_svect8_type> scanner;
+        bvect bv_res;
+        scanner.find_eq_str(str_sv, "odd", bv_res);
+        assert(bv_res.count() == odd_cnt);
+        scanner.find_eq_str_prefix(str_sv, "", bv_res);
+        assert(bv_res.count() == str_sv.get_null_bvector()->count());
+        scanner.find_eq_str(str_sv, "toolongstring", bv_res);
+        assert(!bv_res.any());
+        
+        bm::sparse_vector_serial_layout<str_svect8_type> sv_lay;
+        bm::sparse_vector_serialize(str_sv, sv_lay);
+        str_svect8_type str_sv2(bm::use_null);
+        int res = bm::sparse_vector_deserialize(str_sv2, sv_lay.buf());
+        assert(res == 0);
+        assert(str_sv2.equal(str_sv));
+        assert(str_sv2.is_null(1) && !str_sv2.is_null(3));
+    }
+    
+    // long strings: more character plains than the aggregator takes
+    // (search runs in chunks of characters)
+    {
+        typedef bm::str_sparse_vector<char, bvect, 400> str_svect400_type;
+        const unsigned lens[] = { 1, 100, 125, 126, 127, 253, 254, 300, 399, 400 };
+        const unsigned lens_cnt = sizeof(lens) / sizeof(lens[0]);
+        
+        std::string base(400, 'a');
+        for (unsigned k = 0; k < base.size(); ++k)
+            base[k] = char('a' + (rand() % 26));
+        
+        str_svect400_type str_sv(bm::use_null);
+        std::vector<std::string> str_coll;
+        for (unsigned i = 0; i < 3000; ++i)
+        {
+            std::string str = base.substr(0, lens[i % lens_cnt]);
+            if (i % 3) // one character differs: in one of the chunks
             {
-                cout << "Serialization error!" << endl;
-                exit(1);
+                unsigned pos = unsigned(rand()) % unsigned(str.size());
+                str[pos] = char('A' + (i % 3));
             }
+            str_sv.set(i * 2, str.c_str()); // odd elements are NULL
+            str_coll.push_back(str);
         }
-                
-        delete [] blob;
-
-        }
-
-        cout << fname << "    " 
-             << " old=" << fsize << " new=" << blob_size 
-             << " diff=" << (int)fsize - (int) blob_size
-             << endl;
-
-        bv_list.push_back(bv);
-        sz_list.push_back(fsize);
-
-        total_size += fsize;
-        total_new_size += blob_size;
-    } // for
-
-    cout << "Total size = " << total_size / (1024*1024) << "Mb" << endl;
-    cout << "  New size = " << total_new_size / (1024*1024) << "Mb" << endl;
-    cout << "Total diff = " << (total_size - total_new_size) / (1024*1024) << "Mb" << endl;
+        
+        bm::sparse_vector_scanner<str_svect400_type> scanner;
+        for (unsigned i = 0; i < 200; ++i)
+        {
+            const std::string& str = str_coll[(i * 7) % str_coll.size()];
+            bvect bv_eq, bv_pfx, bv_eq_c, bv_pfx_c;
+            for (unsigned j = 0; j < str_coll.size(); ++j)
+            {
+                if (str_coll[j] == str)
+                    bv_eq_c.set(j * 2);
+                if (str_coll[j].compare(0, str.size(), str) == 0)
+                    bv_pfx_c.set(j * 2);
+            }
+            scanner.find_eq_str(str_sv, str.c_str(), bv_eq);
+            scanner.find_eq_str_prefix(str_sv, str.c_str(), bv_pfx);
+            unsigned idx = 0;
+            bool found = scanner.find_eq_str(str_sv, str.c_str(), idx);
+            if (bv_eq.compare(bv_eq_c) != 0 || bv_pfx.compare(bv_pfx_c) != 0 ||
+                !found || idx != bv_eq_c.get_first())
+            {
+                cerr << "Long string search failed! len=" << str.size() 
+                     << " " << bv_eq.count() << " " << bv_eq_c.count() 
+                     << " " << bv_pfx.count() << " " << bv_pfx_c.count() << endl;
+                exit(1);
+            }
+        } // for i
+        
+        // no match in the last chunk only
+        std::string str = base;
+        str[399] = '0';
+        bvect bv_res;
+        scanner.find_eq_str(str_sv, str.c_str(), bv_res);
+        assert(!bv_res.any());
+        unsigned pfx_cnt = 0;
+        for (unsigned j = 0; j < str_coll.size(); ++j)
+            pfx_cnt += (str_coll[j].compare(0, 399, base, 0, 399) == 0);
+        scanner.find_eq_str_prefix(str_sv, base.substr(0, 399).c_str(), bv_res);
+        assert(pfx_cnt && bv_res.count() == pfx_cnt);
+    }
+    
+    cout << " --------------- Test str_sparse_vector<> OK" << endl;
+}
 
-    vector<unsigned char*> bv_blobs;
+typedef bm::remap_sparse_vector<unsigned, sparse_vector_u32 > remap_sparse_vector_u32;
 
-    cout << "Running serialization benchmark..." << endl;
+static
+void CheckRemapSparseVector(const sparse_vector_u32& sv,
+                            const remap_sparse_vector_u32& rsv)
+{
+    if (sv.size() != rsv.size())
     {
-    clock_t start = clock();
-
-        for (size_t i = 0; i < bv_list.size(); ++i)
+        cerr << "Remap size mismatch" << endl;
+        exit(1);
+    }
+    for (unsigned i = 0; i < sv.size(); ++i)
+    {
+        if (sv.is_null(i) != rsv.is_null(i))
         {
-            const bvect* bv = bv_list[i];
-            bvect::statistics st1;
-            bv->calc_stat(&st1);
-            unsigned char* blob = new unsigned char[st1.max_serialize_mem*2];
-            bv_blobs.push_back(blob);
-
-            for (int j = 0; j < (int)(400/(i?i:1)); ++j)
+            cerr << "Remap NULL mismatch at " << i << endl;
+            exit(1);
+        }
+        if (sv.get(i) != rsv.get(i))
+        {
+            cerr << "Remap value mismatch at " << i << " "
+                 << sv.get(i) << " " << rsv.get(i) << endl;
+            exit(1);
+        }
+    } // for i
+    
+    std::vector<unsigned> arr1(70000), arr2(70000);
+    unsigned sz = sv.size();
+    for (unsigned from = 0; from < sz; from += 23456)
+    {
+        unsigned len = unsigned(arr1.size());
+        unsigned d1 = (from + len > sz) ? sz - from : len;
+        sv.decode(&arr1[0], from, len);
+        unsigned d2 = rsv.decode(&arr2[0], from, len);
+        if (d1 != d2)
+        {
+            cerr << "Remap decode size mismatch at " << from << endl;
+            exit(1);
+        }
+        for (unsigned k = 0; k < d1; ++k)
+        {
+            if (arr1[k] != arr2[k])
             {
-                //unsigned blob_size = 
-                    bm::serialize(*bv, blob);
+                cerr << "Remap decode mismatch at " << from + k << endl;
+                exit(1);
             }
-            // delete [] blob;
         }
-
-    clock_t finish = clock();
-    clock_t elapsed_clocks = finish - start;
-    double duration = (double)(elapsed_clocks) / CLOCKS_PER_SEC;
-
-    cout << endl
-         << "Serialization duration = " << duration 
-         << endl;
+    } // for from
+    
+    // search on codes vs search on values
+    const remap_sparse_vector_u32::dictionary_type& dict = rsv.get_dictionary();
+    bm::sparse_vector_scanner<sparse_vector_u32> scanner;
+    bvect bv1, bv2;
+    for (unsigned k = 0; k < 20; ++k)
+    {
+        unsigned v = dict.empty() ? 0 : dict[unsigned(rand()) % dict.size()];
+        if (k & 1)
+            v += 1; // probably missing in the dictionary
+        scanner.find_eq(sv, v, bv1);
+        scanner.find_eq(rsv, v, bv2);
+        if (bv1.compare(bv2) != 0)
+        {
+            cerr << "Remap find_eq mismatch " << v << endl;
+            exit(1);
+        }
+        unsigned idx1 = 0, idx2 = 0;
+        bool f1 = scanner.find_eq(sv, v, idx1);
+        bool f2 = scanner.find_eq(rsv, v, idx2);
+        if (f1 != f2 || idx1 != idx2)
+        {
+            cerr << "Remap find_eq (first) mismatch " << v << endl;
+            exit(1);
+        }
+        scanner.find_lt(sv, v, bv1);
+        scanner.find_lt(rsv, v, bv2);
+        assert(bv1.compare(bv2) == 0);
+        scanner.find_le(sv, v, bv1);
+        scanner.find_le(rsv, v, bv2);
+        assert(bv1.compare(bv2) == 0);
+        scanner.find_gt(sv, v, bv1);
+        scanner.find_gt(rsv, v, bv2);
+        assert(bv1.compare(bv2) == 0);
+        scanner.find_ge(sv, v, bv1);
+        scanner.find_ge(rsv, v, bv2);
+        assert(bv1.compare(bv2) == 0);
+        unsigned v2 = v + unsigned(rand() % 1000000);
+        scanner.find_range(sv, v, v2, bv1);
+        scanner.find_range(rsv, v, v2, bv2);
+        assert(bv1.compare(bv2) == 0);
+        unsigned in_list[3] = { v, v2, 12345 };
+        scanner.find_in(sv, in_list, 3, bv1);
+        scanner.find_in(rsv, in_list, 3, bv2);
+        assert(bv1.compare(bv2) == 0);
+    } // for k
+    
+    // export back
+    sparse_vector_u32 sv2(rsv.is_nullable() ? bm::use_null : bm::no_null);
+    rsv.load_to(sv2);
+    if (!sv.equal(sv2, rsv.is_nullable() ? bm::use_null : bm::no_null))
+    {
+        cerr << "Remap load_to comparison failed" << endl;
+        exit(1);
     }
-
-    cout << "Running de-serialization benchmark..." << endl;
+    
+    // serialization round trip
+    BM_DECLARE_TEMP_BLOCK(tb)
+    bm::sparse_vector_serial_layout<sparse_vector_u32> sv_lay;
+    bm::sparse_vector_serialize(rsv, sv_lay, tb);
+    remap_sparse_vector_u32 rsv2(rsv.is_nullable() ? bm::use_null : bm::no_null);
+    int res = bm::sparse_vector_deserialize(rsv2, sv_lay.buf(), tb);
+    if (res != 0 || !rsv.equal(rsv2))
     {
-    clock_t start = clock();
+        cerr << "Remap serialization comparison failed" << endl;
+        exit(1);
+    }
+}
 
-        for (size_t i = 0; i < bv_blobs.size(); ++i)
+void TestRemapSparseVector()
+{
+    cout << " --------------- Test remap_sparse_vector<>" << endl;
+    
+    {
+        remap_sparse_vector_u32 rsv;
+        assert(rsv.empty());
+        rsv.push_back(0x7F000010);
+        rsv.push_back(0x7F000005);
+        rsv.push_back(0x7F000010);
+        assert(rsv.dictionary_size() == 2);
+        assert(rsv.get_sv().get(0) == 1); // codes follow the value order
+        assert(rsv.get(0) == 0x7F000010 && rsv.get(1) == 0x7F000005);
+        rsv.set(2, 0x7F000007); // new value in the middle: renumbering
+        assert(rsv.dictionary_size() == 3);
+        assert(rsv.get_sv().get(0) == 2);
+        assert(rsv.get(0) == 0x7F000010 && rsv.get(1) == 0x7F000005);
+        assert(rsv.at(2) == 0x7F000007);
+        unsigned code;
+        assert(rsv.remap(0x7F000007, &code) && code == 1);
+        assert(!rsv.remap(0x7F000008, &code));
+        assert(rsv.lower_code(0x7F000008) == 2);
+        assert(rsv.upper_code(0x7F000010) == 3);
+        
+        bool caught = false;
+        try
         {
-            const unsigned char* blob = bv_blobs[i];
-            for (int j = 0; j < (int)(400/(i?i:1)); ++j)
-            {
-                 bvect bv;
-                 bm::deserialize(bv, (unsigned char*)blob);
-            }
-            // delete [] blob;
+            rsv.set(3, 1);
+        }
+        catch (std::range_error&)
+        {
+            caught = true;
         }
+        assert(caught);
+        
+        bm::sparse_vector_scanner<sparse_vector_u32> scanner;
+        bvect bv;
+        scanner.find_eq(rsv, 0x7F000010, bv);
+        assert(bv.count() == 1 && bv.test(0));
+        scanner.find_gt(rsv, 0x7F000005, bv);
+        assert(bv.count() == 2 && bv.test(0) && bv.test(2));
+        scanner.find_range(rsv, 0x7F000006, 0x7F000009, bv);
+        assert(bv.count() == 1 && bv.test(2));
+        scanner.find_lt(rsv, 0x7F000005, bv);
+        assert(!bv.any());
+        
+        remap_sparse_vector_u32 rsv2;
+        rsv2.swap(rsv);
+        assert(rsv.empty() && rsv2.get(1) == 0x7F000005);
+        rsv2.clear();
+        assert(rsv2.empty() && !rsv2.dictionary_size());
+    }
+    
+    // 300 distinct large ids
+    {
+        std::vector<unsigned> vals;
+        for (unsigned i = 0; i < 1000000; ++i)
+            vals.push_back(0x7F000000 + (unsigned(rand()) % 300) * 4099);
+        sparse_vector_u32 sv;
+        sv.import(&vals[0], unsigned(vals.size()));
+        remap_sparse_vector_u32 rsv;
+        rsv.import(&vals[0], unsigned(vals.size()));
+        assert(rsv.dictionary_size() <= 300);
+        
+        unsigned plains = 0;
+        for (unsigned i = 0; i < rsv.get_sv().plains(); ++i)
+            plains += bool(rsv.get_sv().plain(i));
+        assert(plains <= 9);
+        
+        CheckRemapSparseVector(sv, rsv);
+        
+        remap_sparse_vector_u32 rsv2;
+        rsv2.load_from(sv);
+        assert(rsv2.equal(rsv));
+        
+        // import over existing rows with new values
+        std::vector<unsigned> vals2;
+        for (unsigned i = 0; i < 100000; ++i)
+            vals2.push_back(unsigned(rand()) % 1000);
+        sv.import(&vals2[0], unsigned(vals2.size()), 500000);
+        rsv.import(&vals2[0], unsigned(vals2.size()), 500000);
+        CheckRemapSparseVector(sv, rsv);
+        
+        BM_DECLARE_TEMP_BLOCK(tb)
+        sparse_vector_u32::statistics st_sv, st;
+        sv.optimize(tb, bvect::opt_compress, &st_sv);
+        rsv.optimize(tb, bvect::opt_compress, &st);
+        CheckRemapSparseVector(sv, rsv);
+        cout << "  sv=" << st_sv.memory_used << " remap=" << st.memory_used << endl;
+    }
+    
+    // NULL-able vector
+    {
+        sparse_vector_u32 sv(bm::use_null);
+        for (unsigned i = 0; i < 300000; i += 3)
+            sv.set(i, 0xFFFF0000u + (unsigned(rand()) % 100));
+        sv.resize(400000);
+        remap_sparse_vector_u32 rsv(bm::use_null);
+        rsv.load_from(sv);
+        assert(rsv.dictionary_size() <= 100);
+        CheckRemapSparseVector(sv, rsv);
+        
+        // new value: renumbering keeps NULLs
+        sv.set(3, 5);
+        rsv.set(3, 5);
+        CheckRemapSparseVector(sv, rsv);
+        
+        // NULL-able source into NOT NULL-able vector: NULLs are 0s
+        sparse_vector_u32 sv_nn;
+        for (unsigned i = 0; i < sv.size(); ++i)
+            sv_nn.push_back(sv.get(i));
+        remap_sparse_vector_u32 rsv_nn;
+        rsv_nn.load_from(sv);
+        CheckRemapSparseVector(sv_nn, rsv_nn);
+    }
 
-    clock_t finish = clock();
-    clock_t elapsed_clocks = finish - start;
-    double duration = (double)(elapsed_clocks) / CLOCKS_PER_SEC;
+    // code type overflow: signed codes hold only the positive range
+    {
+        typedef bm::sparse_vector<short, bvect > sparse_vector_i16;
+        typedef bm::remap_sparse_vector<unsigned, sparse_vector_i16 > remap_sparse_vector_i16;
+        typedef bm::sparse_vector<unsigned short, bvect > sparse_vector_u16;
+        typedef bm::remap_sparse_vector<unsigned, sparse_vector_u16 > remap_sparse_vector_u16;
 
-    cout << endl
-         << "DeSerialization duration = " << duration 
-         << endl;
-    }
+        std::vector<unsigned> vals;
+        for (unsigned i = 0; i < 32768; ++i)
+            vals.push_back(i * 7);
 
+        remap_sparse_vector_i16 rsv;
+        rsv.import(&vals[0], unsigned(vals.size()));
+        assert(rsv.dictionary_size() == 32768);
+        assert(rsv.get(32767) == 32767 * 7);
 
+        vals.resize(40000);
+        for (unsigned i = 32768; i < 40000; ++i)
+            vals[i] = i * 7;
+        bool caught = false;
+        try
+        {
+            rsv.push_back(32768 * 7);
+        }
+        catch (std::range_error&)
+        {
+            caught = true;
+        }
+        assert(caught);
+        assert(rsv.dictionary_size() == 32768 && rsv.size() == 32768);
 
+        caught = false;
+        try
+        {
+            remap_sparse_vector_i16 rsv2;
+            rsv2.import(&vals[0], unsigned(vals.size()));
+        }
+        catch (std::range_error&)
+        {
+            caught = true;
+        }
+        assert(caught);
 
-    for (size_t i = 0; i < bv_list.size(); ++i)
-    {
-        delete bv_list[i];
-    }
-    for (size_t i = 0; i < bv_blobs.size(); ++i)
-    {
-        delete [] bv_blobs[i];
+        remap_sparse_vector_u16 rsv_u;
+        rsv_u.import(&vals[0], unsigned(vals.size()));
+        assert(rsv_u.dictionary_size() == 40000);
+        for (unsigned i = 0; i < 40000; ++i)
+        {
+            assert(rsv_u.get(i) == vals[i]);
+        }
     }
 
+    cout << " --------------- Test remap_sparse_vector<> OK" << endl;
 }
 
+typedef bm::for_sparse_vector<unsigned, sparse_vector_u32 > for_sparse_vector_u32;
 
 static
-void TestSIMDUtils()
+void CheckFORSparseVector(const sparse_vector_u32& sv,
+                          const for_sparse_vector_u32& fsv)
 {
-    cout << "------------------------ Test SIMD Utils" << endl;
-#if defined(BMSSE2OPT)
-    unsigned idx;
-    cout << "----------------------------> [ SSE2 ]" << endl;
-    {
-        unsigned short buf[127] = { 65535, 127, 255, 256, 1000, 2000, 2001, 2005, 0xFF, 0, };
-        idx = bm::sse2_gap_find(buf, 65535, 1);
-        assert(idx == 0);
-        idx = bm::sse2_gap_find(buf, 0, 1);
-        assert(idx == 0);
-        idx = bm::sse2_gap_find(buf, 10, 1);
-        assert(idx == 0);
-    }
-
+    if (sv.size() != fsv.size())
     {
-        unsigned short buf[16] = { 60000, 127, 255, 256, 1000, 2000, 2001, 2005, 0xFF, 0, };
-        idx = bm::sse2_gap_find(buf, 65535, 1);
-        assert(idx == 1);
-        idx = bm::sse2_gap_find(buf, 0, 1);
-        assert(idx == 0);
-        idx = bm::sse2_gap_find(buf, 10, 1);
-        assert(idx == 0);
+        cerr << "FOR size mismatch" << endl;
+        exit(1);
     }
-
+    for (unsigned i = 0; i < sv.size(); ++i)
     {
-        unsigned short buf[16] = { 10, 65530, 127, 255, 256, 1000, 2000, 2001, 2005, 0xFF, };
-        const unsigned vsize = 2;
-        idx = bm::sse2_gap_find(buf, 0, vsize);
-        assert(idx == 0);
-        idx = bm::sse2_gap_find(buf, 65535, vsize);
-        assert(idx == vsize);
-        for (unsigned i = 0; i < vsize; ++i)
+        if (sv.is_null(i) != fsv.is_null(i))
         {
-            unsigned short v = buf[i];
-            idx = bm::sse2_gap_find(buf, v, vsize);
-            assert(idx == i);
-            idx = bm::sse2_gap_find(buf, v - 1, vsize);
-            assert(idx == i);
+            cerr << "FOR NULL mismatch at " << i << endl;
+            exit(1);
         }
-    }
-
+        if (sv.get(i) != fsv.get(i))
+        {
+            cerr << "FOR value mismatch at " << i << " "
+                 << sv.get(i) << " " << fsv.get(i) << endl;
+            exit(1);
+        }
+    } // for i
+    
+    std::vector<unsigned> arr1(70000), arr2(70000);
+    unsigned sz = sv.size();
+    for (unsigned from = 0; from < sz; from += 23456)
     {
-        unsigned short buf[16] = { 10, 256, 65530, 127, 255, 256, 1000, 2000, 2001, 2005, 0xFF, };
-        const unsigned vsize = 3;
-        idx = bm::sse2_gap_find(buf, 0, vsize);
-        assert(idx == 0);
-        idx = bm::sse2_gap_find(buf, 65535, vsize);
-        assert(idx == vsize);
-        for (unsigned i = 0; i < vsize; ++i)
+        unsigned len = unsigned(arr1.size());
+        unsigned d1 = (from + len > sz) ? sz - from : len;
+        sv.decode(&arr1[0], from, len);
+        unsigned d2 = fsv.extract_range(&arr2[0], len, from);
+        if (d1 != d2)
         {
-            unsigned short v = buf[i];
-            idx = bm::sse2_gap_find(buf, v, vsize);
-            assert(idx == i);
-            idx = bm::sse2_gap_find(buf, v - 1, vsize);
-            assert(idx == i);
+            cerr << "FOR decode size mismatch at " << from << endl;
+            exit(1);
+        }
+        for (unsigned k = 0; k < d1; ++k)
+        {
+            if (arr1[k] != arr2[k])
+            {
+                cerr << "FOR decode mismatch at " << from + k << endl;
+                exit(1);
+            }
         }
+    } // for from
+    
+    bm::sparse_vector_scanner<sparse_vector_u32> scanner;
+    bvect bv1, bv2;
+    for (unsigned k = 0; k < 20; ++k)
+    {
+        unsigned v = sz ? sv.get(unsigned(rand()) % sz) : 0;
+        if (k & 1)
+            v += 1;
+        scanner.find_eq(sv, v, bv1);
+        scanner.find_eq(fsv, v, bv2);
+        if (bv1.compare(bv2) != 0)
+        {
+            cerr << "FOR find_eq mismatch " << v << endl;
+            exit(1);
+        }
+        unsigned idx1 = 0, idx2 = 0;
+        bool f1 = scanner.find_eq(sv, v, idx1);
+        bool f2 = scanner.find_eq(fsv, v, idx2);
+        if (f1 != f2 || idx1 != idx2)
+        {
+            cerr << "FOR find_eq (first) mismatch " << v << endl;
+            exit(1);
+        }
+        scanner.find_lt(sv, v, bv1);
+        scanner.find_lt(fsv, v, bv2);
+        assert(bv1.compare(bv2) == 0);
+        scanner.find_le(sv, v, bv1);
+        scanner.find_le(fsv, v, bv2);
+        assert(bv1.compare(bv2) == 0);
+        scanner.find_gt(sv, v, bv1);
+        scanner.find_gt(fsv, v, bv2);
+        assert(bv1.compare(bv2) == 0);
+        scanner.find_ge(sv, v, bv1);
+        scanner.find_ge(fsv, v, bv2);
+        assert(bv1.compare(bv2) == 0);
+        unsigned v1 = v - unsigned(rand() % 100000);
+        unsigned v2 = v + unsigned(rand() % 100000);
+        scanner.find_range(sv, v1, v2, bv1);
+        scanner.find_range(fsv, v1, v2, bv2);
+        assert(bv1.compare(bv2) == 0);
+    } // for k
+    
+    sparse_vector_u32 sv2(fsv.is_nullable() ? bm::use_null : bm::no_null);
+    fsv.load_to(sv2);
+    if (!sv.equal(sv2, fsv.is_nullable() ? bm::use_null : bm::no_null))
+    {
+        cerr << "FOR load_to comparison failed" << endl;
+        exit(1);
     }
+    
+    // serialization round trip
+    BM_DECLARE_TEMP_BLOCK(tb)
+    bm::sparse_vector_serial_layout<sparse_vector_u32> sv_lay;
+    bm::sparse_vector_serialize(fsv, sv_lay, tb);
+    for_sparse_vector_u32 fsv2(fsv.is_nullable() ? bm::use_null : bm::no_null);
+    int res = bm::sparse_vector_deserialize(fsv2, sv_lay.buf(), tb);
+    if (res != 0 || !fsv.equal(fsv2))
     {
-        unsigned short buf[16] = { 10, 256, 258, 65500, 127, 255, 256, 1000, 2000, 2001, 2005, 0xFF, };
-        const unsigned vsize = 4;
-        idx = bm::sse2_gap_find(buf, 0, vsize);
-        assert(idx == 0);
-        idx = bm::sse2_gap_find(buf, 65535, vsize);
-        assert(idx == vsize);
-        for (unsigned i = 0; i < vsize; ++i)
-        {
-            unsigned short v = buf[i];
-            idx = bm::sse2_gap_find(buf, v, vsize);
-            assert(idx == i);
-            idx = bm::sse2_gap_find(buf, v - 1, vsize);
-            assert(idx == i);
-        }
+        cerr << "FOR serialization comparison failed" << endl;
+        exit(1);
     }
+}
 
+void TestFORSparseVector()
+{
+    cout << " --------------- Test for_sparse_vector<>" << endl;
+    
     {
-        //        unsigned short buf[16] = { 10, 256, 258, 15525, 64500, 127, 255, 256, 1000, 2000, 2001, 2005, 0xFF, };
-        unsigned short buf[16] = { 10, 20, 30, 40, 50, 127, 255, 256, 1000, 2000, 2001, 2005, 0xFF, };
-        const unsigned vsize = 5;
-        idx = bm::sse2_gap_find(buf, 0, vsize);
-        assert(idx == 0);
-        idx = bm::sse2_gap_find(buf, 65535, vsize);
-        assert(idx == vsize);
-
-        for (unsigned i = 0; i < vsize; ++i)
+        for_sparse_vector_u32 fsv;
+        assert(fsv.empty());
+        fsv.push_back(1000005);
+        fsv.push_back(1000007);
+        assert(fsv.get_bases().size() == 1 && fsv.block_base(0) == 1000005);
+        assert(fsv.get_sv().get(1) == 2);
+        fsv.push_back(1000001); // block rebase
+        assert(fsv.block_base(0) == 1000001);
+        assert(fsv.get(0) == 1000005 && fsv.get(1) == 1000007);
+        assert(fsv.at(2) == 1000001);
+        fsv.set(1, 999999);
+        assert(fsv.get(1) == 999999 && fsv.get(0) == 1000005);
+        
+        bool caught = false;
+        try
         {
-            unsigned short v = buf[i];
-            idx = bm::sse2_gap_find(buf, v, vsize);
-            assert(idx == i);
-            idx = bm::sse2_gap_find(buf, v - 1, vsize);
-            assert(idx == i);
+            fsv.set(3, 1);
         }
-    }
-
-    {
-        unsigned short buf[127] = { 2, 10, 256, 258, 15525, 65530, 127, 255, 256, 1000, 2000, 2001, 2005, 0xFF, };
-        const unsigned vsize = 6;
-        idx = bm::sse2_gap_find(buf, 0, vsize);
-        assert(idx == 0);
-        idx = bm::sse2_gap_find(buf, 65535, vsize);
-        assert(idx == vsize);
-        for (unsigned i = 0; i < vsize; ++i)
+        catch (std::range_error&)
         {
-            unsigned short v = buf[i];
-            idx = bm::sse2_gap_find(buf, v, vsize);
-            assert(idx == i);
-            idx = bm::sse2_gap_find(buf, v - 1, vsize);
-            assert(idx == i);
+            caught = true;
         }
-    }
-
+        assert(caught);
+        
+        bm::sparse_vector_scanner<sparse_vector_u32> scanner;
+        bvect bv;
+        scanner.find_eq(fsv, 1000005, bv);
+        assert(bv.count() == 1 && bv.test(0));
+        scanner.find_lt(fsv, 999999, bv);
+        assert(!bv.any());
+        scanner.find_ge(fsv, 999999, bv);
+        assert(bv.count() == 3);
+        scanner.find_range(fsv, 1000000, 1000006, bv);
+        assert(bv.count() == 2 && bv.test(0) && bv.test(2));
+        
+        for_sparse_vector_u32 fsv2;
+        fsv2.swap(fsv);
+        assert(fsv.empty() && fsv2.get(1) == 999999);
+        fsv2.clear();
+        assert(fsv2.empty() && fsv2.get_bases().empty());
+    }
+    
+    // timestamp-like column in both base modes
+    for (unsigned pass = 0; pass < 2; ++pass)
+    {
+        for_sparse_vector_u32::base_mode mode = pass ?
+                for_sparse_vector_u32::base_per_vector :
+                for_sparse_vector_u32::base_per_block;
+        std::vector<unsigned> vals;
+        for (unsigned i = 0; i < 1000000; ++i)
+            vals.push_back(1500000000 + i * 3 + unsigned(rand()) % 100);
+        sparse_vector_u32 sv;
+        sv.import(&vals[0], unsigned(vals.size()));
+        
+        for_sparse_vector_u32 fsv(bm::no_null, mode);
+        fsv.import_back(&vals[0], 300000);
+        fsv.import_back(&vals[300000], unsigned(vals.size()) - 300000);
+        CheckFORSparseVector(sv, fsv);
+        
+        unsigned plains = 0;
+        for (unsigned i = 0; i < fsv.get_sv().plains(); ++i)
+            plains += bool(fsv.get_sv().plain(i));
+        assert(plains <= (pass ? 22u : 18u));
+        
+        for_sparse_vector_u32 fsv2(bm::no_null, mode);
+        fsv2.load_from(sv);
+        assert(fsv2.equal(fsv));
+        
+        // values below the bases
+        for (unsigned i = 0; i < 1000; ++i)
+        {
+            unsigned idx = unsigned(rand()) % sv.size();
+            unsigned v = 1400000000 + unsigned(rand()) % 1000;
+            sv.set(idx, v);
+            fsv.set(idx, v);
+        }
+        CheckFORSparseVector(sv, fsv);
+        
+        BM_DECLARE_TEMP_BLOCK(tb)
+        sparse_vector_u32::statistics st_sv, st;
+        sv.optimize(tb, bvect::opt_compress, &st_sv);
+        fsv2.optimize(tb, bvect::opt_compress, &st);
+        cout << "  sv=" << st_sv.memory_used << " for=" << st.memory_used << endl;
+    } // for pass
+    
+    // NULL-able vector
     {
-        unsigned short buf[16] = { 1, 2, 10, 256, 258, 15525, 65530, 127, 255, 256, 1000, 2000, 2001, 2005, 0xFF, };
-        const unsigned vsize = 7;
-        idx = bm::sse2_gap_find(buf, 0, vsize);
-        assert(idx == 0);
-        idx = bm::sse2_gap_find(buf, 65535, vsize);
-        assert(idx == vsize);
+        sparse_vector_u32 sv(bm::use_null);
+        for (unsigned i = 0; i < 300000; i += 3)
+            sv.set(i, 0xFFFF0000u + (unsigned(rand()) % 100));
+        sv.set(200000, 10);
+        sv.resize(400000);
+        for_sparse_vector_u32 fsv(bm::use_null);
+        fsv.load_from(sv);
+        CheckFORSparseVector(sv, fsv);
+        
+        sv.set(3, 5);
+        fsv.set(3, 5);
+        CheckFORSparseVector(sv, fsv);
+        
+        // NULL-able source into NOT NULL-able vector: NULLs are 0s
+        sparse_vector_u32 sv_nn;
+        for (unsigned i = 0; i < sv.size(); ++i)
+            sv_nn.push_back(sv.get(i));
+        for_sparse_vector_u32 fsv_nn;
+        fsv_nn.load_from(sv);
+        CheckFORSparseVector(sv_nn, fsv_nn);
+    }
+
+    // max. value is a legal base (not a "no base" mark)
+    for (unsigned pass = 0; pass < 2; ++pass)
+    {
+        for_sparse_vector_u32::base_mode mode = pass ?
+                for_sparse_vector_u32::base_per_vector :
+                for_sparse_vector_u32::base_per_block;
+        for_sparse_vector_u32 fsv(bm::no_null, mode);
+        fsv.push_back(~0u);
+        fsv.push_back(~0u);
+        assert(fsv.block_base(0) == ~0u);
+        fsv.push_back(5);
+        assert(fsv.get(0) == ~0u && fsv.get(1) == ~0u && fsv.get(2) == 5);
+
+        sparse_vector_u32 sv;
+        sv.push_back(~0u);
+        sv.push_back(~0u);
+        sv.push_back(5);
+        CheckFORSparseVector(sv, fsv);
+    }
+
+    // signed values of the full range: codes are (v - base) mod 2^32
+    {
+        typedef bm::sparse_vector<int, bvect > sparse_vector_int;
+        typedef bm::for_sparse_vector<int, sparse_vector_int > for_sparse_vector_int;
+
+        const int ivals[] = { INT_MAX, INT_MIN, 0, -1, 1, INT_MAX - 1, INT_MIN + 1 };
+        const unsigned ivals_size = unsigned(sizeof(ivals) / sizeof(ivals[0]));
+
+        for_sparse_vector_int fsv;
+        for (unsigned i = 0; i < ivals_size; ++i)
+            fsv.push_back(ivals[i]);
+        assert(fsv.block_base(0) == INT_MIN);
+
+        std::vector<int> vals;
+        for (unsigned i = 0; i < 200000; ++i)
+            vals.push_back(ivals[i % ivals_size] ^ (rand() & 0xFF));
+        fsv.import_back(&vals[0], unsigned(vals.size()));
+
+        for_sparse_vector_int fsv2(bm::no_null,
+                                   for_sparse_vector_int::base_per_vector);
+        fsv2.import_back(&vals[0], unsigned(vals.size()));
+
+        for (unsigned i = 0; i < ivals_size; ++i)
+        {
+            assert(fsv.get(i) == ivals[i]);
+        }
+        std::vector<int> dec(vals.size());
+        fsv.decode(&dec[0], ivals_size, unsigned(vals.size()));
+        for (unsigned i = 0; i < vals.size(); ++i)
+        {
+            assert(fsv.get(ivals_size + i) == vals[i]);
+            assert(dec[i] == vals[i]);
+            assert(fsv2.get(i) == vals[i]);
+        }
+
+        sparse_vector_int sv;
+        fsv2.load_to(sv);
+        for_sparse_vector_int fsv3;
+        fsv3.load_from(sv);
+        for (unsigned i = 0; i < vals.size(); ++i)
+        {
+            assert(sv.get(i) == vals[i]);
+            assert(fsv3.get(i) == vals[i]);
+        }
+
+        // scanner compares signed values in signed order
+        bm::sparse_vector_scanner<sparse_vector_int> scanner;
+        bvect bv1, bv2, bv3;
+        {
+            for_sparse_vector_int fsv_s;
+            fsv_s.push_back(INT_MIN);
+            fsv_s.push_back(-10);
+            fsv_s.push_back(-1);
+            fsv_s.push_back(5);
+            fsv_s.push_back(INT_MAX);
+            assert(fsv_s.block_base(0) == INT_MIN);
+            scanner.find_gt(fsv_s, -5, bv1);
+            assert(bv1.count() == 3 && bv1.test(2) && bv1.test(3) && bv1.test(4));
+            scanner.find_lt(fsv_s, 0, bv1);
+            assert(bv1.count() == 3 && bv1.test(0) && bv1.test(1) && bv1.test(2));
+            scanner.find_range(fsv_s, -10, 5, bv1);
+            assert(bv1.count() == 3 && bv1.test(1) && bv1.test(2) && bv1.test(3));
+            scanner.find_eq(fsv_s, INT_MAX, bv1);
+            assert(bv1.count() == 1 && bv1.test(4));
+        }
+        for (unsigned k = 0; k < 20; ++k)
+        {
+            int v = (k < ivals_size) ? ivals[k] : vals[unsigned(rand()) % vals.size()];
+            scanner.find_eq(sv, v, bv1);
+            scanner.find_eq(fsv2, v, bv2);
+            scanner.find_eq(fsv3, v, bv3);
+            assert(bv1.compare(bv2) == 0 && bv1.compare(bv3) == 0);
+            unsigned idx1 = 0, idx2 = 0;
+            bool f1 = scanner.find_eq(sv, v, idx1);
+            bool f2 = scanner.find_eq(fsv2, v, idx2);
+            assert(f1 == f2 && idx1 == idx2);
+            scanner.find_lt(sv, v, bv1);
+            scanner.find_lt(fsv2, v, bv2);
+            scanner.find_lt(fsv3, v, bv3);
+            assert(bv1.compare(bv2) == 0 && bv1.compare(bv3) == 0);
+            scanner.find_le(sv, v, bv1);
+            scanner.find_le(fsv2, v, bv2);
+            scanner.find_le(fsv3, v, bv3);
+            assert(bv1.compare(bv2) == 0 && bv1.compare(bv3) == 0);
+            scanner.find_gt(sv, v, bv1);
+            scanner.find_gt(fsv2, v, bv2);
+            scanner.find_gt(fsv3, v, bv3);
+            assert(bv1.compare(bv2) == 0 && bv1.compare(bv3) == 0);
+            scanner.find_ge(sv, v, bv1);
+            scanner.find_ge(fsv2, v, bv2);
+            scanner.find_ge(fsv3, v, bv3);
+            assert(bv1.compare(bv2) == 0 && bv1.compare(bv3) == 0);
+            int v1 = (v < INT_MIN + 100000) ? INT_MIN : v - rand() % 100000;
+            int v2 = (v > INT_MAX - 100000) ? INT_MAX : v + rand() % 100000;
+            scanner.find_range(sv, v1, v2, bv1);
+            scanner.find_range(fsv2, v1, v2, bv2);
+            scanner.find_range(fsv3, v1, v2, bv3);
+            assert(bv1.compare(bv2) == 0 && bv1.compare(bv3) == 0);
+        } // for k
+    }
+
+    cout << " --------------- Test for_sparse_vector<> OK" << endl;
+}
 
-        for (unsigned i = 0; i < vsize; ++i)
-        {
-            unsigned short v = buf[i];
-            idx = bm::sse2_gap_find(buf, v, vsize);
-            assert(idx == i);
-            idx = bm::sse2_gap_find(buf, v - 1, vsize);
-            assert(idx == i || (buf[i - 1] == v - 1));
-        }
-    }
+typedef bm::sparse_vector<int32_t, bvect >  sparse_vector_i32;
+typedef bm::sparse_vector<int64_t, bvect >  sparse_vector_i64;
+typedef bm::sparse_vector<uint64_t, bvect > sparse_vector_u64;
+
+template<class SV>
+void CheckWideSparseVector(const std::vector<typename SV::value_type>& vals)
+{
+    typedef typename SV::value_type value_type;
+    unsigned size = unsigned(vals.size());
+    
+    SV sv(bm::use_null), sv_bi(bm::use_null), sv_imp(bm::use_null);
     {
-        unsigned short buf[16] = { 1, 2, 10, 256,  258, 1024, 15525, 65530,  127, 255, 256, 0xFF, };
-        const unsigned vsize = 8;
-        idx = bm::sse2_gap_find(buf, 0, vsize);
-        assert(idx == 0);
-        idx = bm::sse2_gap_find(buf, 65535, vsize);
-        assert(idx == vsize);
-        for (unsigned i = 0; i < vsize; ++i)
+        typename SV::back_insert_iterator bi = sv_bi.get_back_inserter();
+        for (unsigned i = 0; i < size; ++i)
         {
-            unsigned short v = buf[i];
-            if (i == vsize - 1)
-            {
-                assert(v != 65535);
-            }
-            idx = bm::sse2_gap_find(buf, v, vsize);
-            assert(idx == i);
-            idx = bm::sse2_gap_find(buf, v - 1, vsize);
-            assert(idx == i || (buf[i - 1] == v - 1));
+            sv.push_back(vals[i]);
+            bi = vals[i];
         }
     }
-
+    sv_imp.import(&vals[0], size);
+    assert(sv.equal(sv_bi, bm::use_null));
+    assert(sv.equal(sv_imp, bm::use_null));
+    for (unsigned i = 0; i < size; ++i)
     {
-        unsigned short buf[16] = { 6217, 6300, 6400, 6500,
-            6600, 6700, 30584, 40255,
-            50256, 60000, 61001, 65255, 65530, 12, 23, 0, };
-        const unsigned vsize = 13;
-        idx = bm::sse2_gap_find(buf, 0, vsize);
-        assert(idx == 0);
-        idx = bm::sse2_gap_find(buf, 65535, vsize);
-        assert(idx == vsize);
-
-        for (unsigned i = 0; i < vsize; ++i)
-        {
-            unsigned short v = buf[i];
-            if (i == vsize - 1)
-            {
-                assert(v != 65535);
-            }
-            idx = bm::sse2_gap_find(buf, v, vsize);
-            assert(idx == i);
-            idx = bm::sse2_gap_find(buf, v - 1, vsize);
-            assert(idx == i || (buf[i - 1] == v - 1));
-        }
+        assert(sv.get(i) == vals[i]);
+        assert(sv_bi[i] == vals[i]);
     }
-
+    
+    // decode in all extraction modes (short, medium, long ranges)
+    std::vector<value_type> arr(size);
+    unsigned offs[] = { 0, 17, 65530 };
+    unsigned sizes[] = { 5, 100, 3000, size };
+    for (unsigned i = 0; i < sizeof(offs)/sizeof(offs[0]); ++i)
     {
-        unsigned short buf[16] = { 6217, 6300, 6400, 6500,
-            6600, 6700, 30584, 40255,
-            50256, 60000, 61001, 65255,
-            65256, 65257, 65300, 65530 };
-        const unsigned vsize = 16;
-        idx = bm::sse2_gap_find(buf, 0, vsize);
-        assert(idx == 0);
-        idx = bm::sse2_gap_find(buf, 65535, vsize);
-        assert(idx == 16);
-        for (unsigned i = 0; i < vsize; ++i)
+        for (unsigned j = 0; j < sizeof(sizes)/sizeof(sizes[0]); ++j)
         {
-            unsigned short v = buf[i];
-            if (i == vsize - 1)
-            {
-                assert(v != 65535);
-            }
-            idx = bm::sse2_gap_find(buf, v, vsize);
-            assert(idx == i);
-            idx = bm::sse2_gap_find(buf, v - 1, vsize);
-            assert(idx == i || (buf[i - 1] == v - 1));
+            unsigned from = offs[i];
+            unsigned d1 = sizes[j];
+            if (from + d1 > size)
+                d1 = size - from;
+            sv.decode(&arr[0], from, d1);
+            for (unsigned k = 0; k < d1; ++k)
+                assert(arr[k] == vals[from + k]);
         }
     }
-
-#endif
-
-#if defined(BMSSE42OPT)
-    unsigned idx;
-    cout << "----------------------------> [ SSE 4.2 ]" << endl;
     
+    std::vector<unsigned> idx;
+    for (unsigned i = 0; i < size; i += 7)
+        idx.push_back(i);
+    sv.gather(&arr[0], &idx[0], unsigned(idx.size()));
+    for (unsigned i = 0; i < idx.size(); ++i)
+        assert(arr[i] == vals[idx[i]]);
+    
+    // serialization round trip
     {
         BM_DECLARE_TEMP_BLOCK(tb)
-        for (unsigned i = 0; i < bm::set_block_size; ++i)
-        {
-            tb[i] = ~0u;
-        }
-        bool all_one = sse4_is_all_one((__m128i*)tb, (__m128i*)(tb + bm::set_block_size));
-        assert(all_one);
-        
-        tb[256] = 1;
-        all_one = sse4_is_all_one((__m128i*)tb, (__m128i*)(tb + bm::set_block_size));
-        assert(!all_one);
-    }
+        sv.optimize(tb);
+        bm::sparse_vector_serial_layout<SV> sv_lay;
+        bm::sparse_vector_serialize(sv, sv_lay, tb);
+        SV sv2(bm::use_null);
+        int res = bm::sparse_vector_deserialize(sv2, sv_lay.buf(), tb);
+        assert(res == 0);
+        assert(sv2.equal(sv, bm::use_null));
+    }
+    
+    // search
+    bm::sparse_vector_scanner<SV> scanner;
+    bvect bv, bv_control;
+    value_type probes[] = { 0, value_type(7), value_type(-3), value_type(-50),
+                            vals[5], vals[size / 2] };
+    for (unsigned j = 0; j < sizeof(probes)/sizeof(probes[0]); ++j)
+    {
+        value_type v = probes[j];
+        scanner.find_eq(sv, v, bv);
+        bv_control.clear();
+        for (unsigned i = 0; i < size; ++i)
+            if (vals[i] == v)
+                bv_control.set(i);
+        assert(bv.compare(bv_control) == 0);
+        
+        scanner.find_lt(sv, v, bv);
+        bv_control.clear();
+        for (unsigned i = 0; i < size; ++i)
+            if (vals[i] < v)
+                bv_control.set(i);
+        assert(bv.compare(bv_control) == 0);
+        
+        scanner.find_ge(sv, v, bv);
+        bv_control.clear();
+        for (unsigned i = 0; i < size; ++i)
+            if (vals[i] >= v)
+                bv_control.set(i);
+        assert(bv.compare(bv_control) == 0);
+        
+        value_type from = value_type(v - 10);
+        scanner.find_range(sv, from, v, bv);
+        bv_control.clear();
+        for (unsigned i = 0; i < size; ++i)
+            if (vals[i] >= from && vals[i] <= v)
+                bv_control.set(i);
+        assert(bv.compare(bv_control) == 0);
+    } // for j
+    
+    // aggregates
+    bvect bv_mask;
+    bv_mask.set_range(1000, size / 2);
+    value_type min_c = vals[1000], max_c = vals[1000];
+    bm::id64_t sum_c = 0;
+    for (unsigned i = 1000; i <= size / 2; ++i)
+    {
+        if (vals[i] < min_c)
+            min_c = vals[i];
+        if (vals[i] > max_c)
+            max_c = vals[i];
+        sum_c += bm::id64_t(vals[i]);
+    }
+    value_type min_v, max_v;
+    assert(bm::sparse_vector_min(sv, bv_mask, min_v) && min_v == min_c);
+    assert(bm::sparse_vector_max(sv, bv_mask, max_v) && max_v == max_c);
+    assert(bm::sparse_vector_sum(sv, bv_mask) == sum_c);
+}
 
+template<class SV>
+void GenerateWideValues(std::vector<typename SV::value_type>& vals,
+                        unsigned size)
+{
+    typedef typename SV::value_type value_type;
+    vals.resize(size);
+    for (unsigned i = 0; i < size; ++i)
     {
-        BM_DECLARE_TEMP_BLOCK(tb)
-        for (unsigned i = 0; i < bm::set_block_size; ++i)
+        bm::id64_t r = bm::id64_t(rand());
+        switch ((i / 1000 + i) % 5)
         {
-            tb[i] = 0u;
+        case 0: vals[i] = 0; break;
+        case 1: vals[i] = value_type(value_type(r % 100) - value_type(50)); break;
+        case 2: vals[i] = value_type(r * 1000003ull); break;
+        case 3: vals[i] = value_type(bm::id64_t(0) - r * 977ull); break;
+        default: vals[i] = value_type((r << 33) ^ r); break;
         }
-        bool all_z = sse4_is_all_zero((__m128i*)tb, (__m128i*)(tb + bm::set_block_size));
-        assert(all_z);
-        
-        tb[256] = 1;
-        all_z = sse4_is_all_zero((__m128i*)tb, (__m128i*)(tb + bm::set_block_size));
-        assert(!all_z);
     }
+}
 
-
+static
+void TestSparseVectorWide()
+{
+    cout << " --------------- Test sparse_vector<> 64-bit and signed" << endl;
+    
+    // zig-zag encoding
     {
-        unsigned short buf[127] = { 65535, 127, 255, 256, 1000, 2000, 2001, 2005, 0xFF, 0,  };
-        idx = bm::sse4_gap_find(buf, 65535, 1);
-        assert(idx == 0);
-        idx = bm::sse4_gap_find(buf, 0, 1);
-        assert(idx == 0);
-        idx = bm::sse4_gap_find(buf, 10, 1);
-        assert(idx == 0);
+        assert(bm::sv_value_traits<int>::encode(0) == 0);
+        assert(bm::sv_value_traits<int>::encode(-1) == 1);
+        assert(bm::sv_value_traits<int>::encode(1) == 2);
+        assert(bm::sv_value_traits<int>::encode(INT_MIN) == 0xFFFFFFFFu);
+        assert(bm::sv_value_traits<int>::decode(0xFFFFFFFEu) == INT_MAX);
+        assert(bm::sv_value_traits<int64_t>::decode(
+            bm::sv_value_traits<int64_t>::encode(INT64_MIN)) == INT64_MIN);
+        assert(bm::sv_value_traits<unsigned>::encode(5u) == 5u);
     }
-
+    
+    // small negative values use only the low plains
     {
-        unsigned short buf[16] = { 60000, 127, 255, 256, 1000, 2000, 2001, 2005, 0xFF, 0, };
-        idx = bm::sse4_gap_find(buf, 65535, 1);
-        assert(idx == 1);
-        idx = bm::sse4_gap_find(buf, 0, 1);
-        assert(idx == 0);
-        idx = bm::sse4_gap_find(buf, 10, 1);
-        assert(idx == 0);
+        sparse_vector_i64 sv;
+        for (int64_t i = -100; i <= 100; ++i)
+            sv.push_back(i);
+        unsigned plains = 0;
+        for (unsigned i = 0; i < sv.plains(); ++i)
+            plains += bool(sv.plain(i));
+        assert(plains == 8);
+        assert(sv.get(0) == -100 && sv.get(200) == 100);
+        
+        sv.set(5, INT64_MIN);
+        sv.set(6, INT64_MAX);
+        assert(sv.get(5) == INT64_MIN && sv.get(6) == INT64_MAX);
+        assert(sv.get(7) == -93);
+        
+        bm::sparse_vector_scanner<sparse_vector_i64> scanner;
+        bvect bv;
+        scanner.find_lt(sv, -90, bv);
+        assert(bv.count() == 9 && bv.test(5) && !bv.test(6));
+        scanner.find_gt(sv, 99, bv);
+        assert(bv.count() == 2 && bv.test(6) && bv.test(200));
     }
-
+    
     {
-        unsigned short buf[16] = { 10, 65530, 127, 255, 256, 1000, 2000, 2001, 2005, 0xFF, };
-        const unsigned vsize = 2;
-        idx = bm::sse4_gap_find(buf, 0, vsize);
-        assert(idx == 0);
-        idx = bm::sse4_gap_find(buf, 65535, vsize);
-        assert(idx == vsize);
-        for (unsigned i = 0; i < vsize; ++i)
-        {
-            unsigned short v = buf[i];
-            idx = bm::sse4_gap_find(buf, v, vsize);
-            assert(idx == i);
-            idx = bm::sse4_gap_find(buf, v - 1, vsize);
-            assert(idx == i);
-        }
+        std::vector<int32_t> vals;
+        GenerateWideValues<sparse_vector_i32>(vals, 200000);
+        CheckWideSparseVector<sparse_vector_i32>(vals);
     }
-
     {
-        unsigned short buf[16] = { 10, 256, 65530, 127, 255, 256, 1000, 2000, 2001, 2005, 0xFF, };
-        const unsigned vsize = 3;
-        idx = bm::sse4_gap_find(buf, 0, vsize);
-        assert(idx == 0);
-        idx = bm::sse4_gap_find(buf, 65535, vsize);
-        assert(idx == vsize);
-        for (unsigned i = 0; i < vsize; ++i)
-        {
-            unsigned short v = buf[i];
-            idx = bm::sse4_gap_find(buf, v, vsize);
-            assert(idx == i);
-            idx = bm::sse4_gap_find(buf, v - 1, vsize);
-            assert(idx == i);
-        }
+        std::vector<int64_t> vals;
+        GenerateWideValues<sparse_vector_i64>(vals, 200000);
+        CheckWideSparseVector<sparse_vector_i64>(vals);
     }
     {
-        unsigned short buf[16] = { 10, 256, 258, 65500, 127, 255, 256, 1000, 2000, 2001, 2005, 0xFF, };
-        const unsigned vsize = 4;
-        idx = bm::sse4_gap_find(buf, 0, vsize);
-        assert(idx == 0);
-        idx = bm::sse4_gap_find(buf, 65535, vsize);
-        assert(idx == vsize);
-        for (unsigned i = 0; i < vsize; ++i)
-        {
-            unsigned short v = buf[i];
-            idx = bm::sse4_gap_find(buf, v, vsize);
-            assert(idx == i);
-            idx = bm::sse4_gap_find(buf, v - 1, vsize);
-            assert(idx == i);
-        }
+        std::vector<uint64_t> vals;
+        GenerateWideValues<sparse_vector_u64>(vals, 200000);
+        CheckWideSparseVector<sparse_vector_u64>(vals);
     }
     
+    // GROUP BY signed keys and values
     {
-//        unsigned short buf[16] = { 10, 256, 258, 15525, 64500, 127, 255, 256, 1000, 2000, 2001, 2005, 0xFF, };
-        unsigned short buf[16] = { 10, 20, 30, 40, 50, 127, 255, 256, 1000, 2000, 2001, 2005, 0xFF, };
-        const unsigned vsize = 5;
-        idx = bm::sse4_gap_find(buf, 0, vsize);
-        assert(idx == 0);
-        idx = bm::sse4_gap_find(buf, 65535, vsize);
-        assert(idx == vsize);
-
-        for (unsigned i = 0; i < vsize; ++i)
+        sparse_vector_i32 sv_keys, sv_vals;
+        std::map<int32_t, std::pair<unsigned, bm::id64_t> > control;
+        for (unsigned i = 0; i < 150000; ++i)
         {
-            unsigned short v = buf[i];
-            idx = bm::sse4_gap_find(buf, v, vsize);
-            assert(idx == i);
-            idx = bm::sse4_gap_find(buf, v - 1, vsize);
-            assert(idx == i);
+            int32_t key = int32_t(i % 7) - 3;
+            int32_t v = int32_t(rand() % 2000) - 1000;
+            sv_keys.push_back(key);
+            sv_vals.push_back(v);
+            if (i >= 100)
+            {
+                control[key].first++;
+                control[key].second += bm::id64_t(int64_t(v));
+            }
+        }
+        bvect bv_filter;
+        bv_filter.set_range(100, 149999);
+        
+        typedef bm::sparse_vector_group_by<sparse_vector_i32> group_by_type;
+        group_by_type group_by;
+        std::map<int32_t, group_by_type::group_stat> res;
+        group_by.group_by(sv_keys, bv_filter, sv_vals, res);
+        assert(res.size() == control.size());
+        std::map<int32_t, std::pair<unsigned, bm::id64_t> >::const_iterator it;
+        for (it = control.begin(); it != control.end(); ++it)
+        {
+            const group_by_type::group_stat& st = res[it->first];
+            assert(st.count == it->second.first);
+            assert(st.sum == it->second.second);
         }
     }
     
+    cout << " --------------- Test sparse_vector<> 64-bit and signed OK" << endl;
+}
+
+static
+void TestSparseVector_Stress(unsigned count)
+{
+
+    cout << "---------------------------- Bit-plain sparse vector stress" << endl;
+
+    cout << "Interval shift check.";
+    // interval shift check
+    for (unsigned i = 0; i < count; ++i)
+    {
+        unsigned fill_factor = 0;
+        for (unsigned min = 0; min < 10000000; min+= rand()%100000)
+        {
+            unsigned max = min + (65535 * 10);
+            {{
+                bm::null_support null_able =
+                                (min % 2 == 0) ? bm::no_null : bm::use_null;
+                
+                std::vector<unsigned> vect;
+                bm::sparse_vector<unsigned, bvect > sv(null_able);
+            
+                FillSparseIntervals(vect, sv, min, max, fill_factor);
+                
+                bool res = CompareSparseVector(sv, vect, true);
+                if (!res)
+                {
+                    cerr << "sparse-dense vector comparison failed" << endl;
+                    exit(1);
+                }
+                
+                sv.optimize();
+                res = CompareSparseVector(sv, vect, true);
+                if (!res)
+                {
+                    cerr << "sparse-dense vector comparison failed" << endl;
+                    exit(1);
+                }
+                
+                cout << "+" << flush;
+                
+            }}
+            ++fill_factor;
+            if (fill_factor > 2) fill_factor = 0;
+        } // for min
+        
+        cout << "." << flush;
+        
+    } // for i
+    cout << endl;
+    cout << "--------------------------- Interval shift check Ok" << endl;
+
+    cout << "Join check" << endl;
+    for (unsigned i = 0; i < count; ++i)
+    {
+        unsigned fill_factor = 0;
+        for (unsigned min = 0; min < 10000000; min+= rand()%100000)
+        {
+            unsigned max = min + (65535 * 10);
+            unsigned min2 = max + rand() % 65536;
+            unsigned max2 = min2 + (65535 * 10);
+
+            bm::null_support null_able1 =
+                            (min % 2 == 0) ? bm::no_null : bm::use_null;
+
+            {{
+                std::vector<unsigned> vect1;
+                std::vector<unsigned> vect2;
+                bm::sparse_vector<unsigned, bvect > sv1(null_able1);
+                bm::sparse_vector<unsigned, bvect > sv2(null_able1);
+            
+                FillSparseIntervals(vect1, sv1, min, max, fill_factor);
+                FillSparseIntervals(vect2, sv2, min2, max2, fill_factor);
+                
+                if (rand()%2)
+                {
+                    sv1.optimize();
+                }
+                if (rand()%3 == 0)
+                {
+                    sv2.optimize();
+                }
+                bm::sparse_vector<unsigned, bvect > sv3;
+                bm::sparse_vector<unsigned, bvect > sv4(sv2);
+                
+                sv1.join(sv2);
+                sv3.join(sv1);
+                sv3.join(sv2);
+                sv4.join(sv1);
+                
+                if (sv1.size() != sv3.size() || sv2.size() != sv3.size() || sv3.size() != sv4.size())
+                {
+                    cerr << "Sparse join size error:" << sv1.size() << endl;
+                    exit(1);
+                }
+                
+                
+                for ( i = 0; i < sv1.size(); ++i)
+                {
+                    unsigned v1 = sv1[i];
+                    unsigned v3 = sv3[i];
+                    unsigned v4 = sv4[i];
+                    if (v1 != v3 || v1 != v4)
+                    {
+                        cerr << "Sparse join cmp failed:" << v1 << "!=" << v3 << "!=" << v4 << endl;
+                        exit(1);
+                    }
+                } // for i
+                
+                bool b1 = TestEqualSparseVectors(sv1, sv3, false);
+                if (!b1)
+                {
+                    cerr << "Equal 1 comparison failed" << endl;
+                    exit(1);
+                }
+                bool b2 = TestEqualSparseVectors(sv1, sv4, false);
+                if (!b2)
+                {
+                    cerr << "Equal 2 comparison failed" << endl;
+                    exit(1);
+                }
+                
+                bool b3 = TestEqualSparseVectors(sv3, sv4, false);
+                if (!b3)
+                {
+                    cerr << "Equal 3 comparison failed" << endl;
+                    exit(1);
+                }
+                
+                
+                
+                cout << "+" << flush;
+                
+            }}
+            ++fill_factor;
+            if (fill_factor > 2) fill_factor = 0;
+        } // for min
+        
+        cout << "." << flush;
+        
+    } // for i
+    
+    cout << "--------------------------- Join check Ok" << endl;
+    
+    
+    
+
+}
+
+inline
+void LoadBVDump(const char* filename, const char* filename_out=0, bool validate=false)
+{
+    ifstream bv_file (filename, ios::in | ios::binary);
+    if (!bv_file.good())
+    {
+        cout << "Cannot open file: " << filename << endl;
+        exit(1);
+    }
+
+    ofstream* bv_file_out = 0;
+
+    if (filename_out)
+    {
+        bv_file_out = new ofstream(filename_out, ios::out | ios::binary);
+        if (!bv_file_out->good())
+        {
+            cout << "Cannot create file: " << filename_out << endl;
+            exit(1);
+        }    
+    }
+
+
+    unsigned buffer_size = 1024*1024;
+    unsigned char* buffer = new unsigned char[buffer_size];
+
+    unsigned count = 0;
+    clock_t start = clock();
+    unsigned total_out_size = 0;
+
+    for (;1; ++count)
+    {
+        unsigned bv_size;
+        bv_file.read((char*)&bv_size, sizeof(bv_size));
+        if (!bv_file.good())
+            break;
+        if (bv_size == 0)
+        {
+            cout << "Warning:Zero vector in dump..." << endl;
+            continue;
+        }
+        if (buffer_size < bv_size)
+        {
+            delete [] buffer;
+            buffer_size = bv_size;
+            buffer = new unsigned char[buffer_size];
+        }
+        bv_file.read((char*)buffer, bv_size);
+        {
+            bvect bv;
+            bm::deserialize(bv, (unsigned char*)buffer);
+
+            bvect::statistics st1;
+            bv.calc_stat(&st1);
+
+            if (st1.max_serialize_mem > buffer_size)
+            {
+                delete [] buffer;
+                buffer_size = (unsigned)st1.max_serialize_mem;
+                buffer = new unsigned char[buffer_size];
+            }
+
+            unsigned blob_size = bm::serialize(bv, buffer, BM_NO_GAP_LENGTH|BM_NO_BYTE_ORDER);
+            total_out_size += blob_size;
+
+            if (blob_size > bv_size)
+            {
+                //print_stat(bv);
+                //cout << count << ". -" << blob_size-bv_size << endl;
+                //exit(1);
+            }
+            
+            if (validate)
+            {
+                bvect bv_control;
+                bm::deserialize(bv_control, (unsigned char*)buffer);
+                if (bv_control != bv)
+                {
+                    cout << "Serialization error!" << endl;
+                    exit(1);
+                }
+            }
+            
+            if (bv_file_out)
+            {
+                bv_file_out->write((char*)&blob_size, sizeof(blob_size));
+                bv_file_out->write((char*)buffer, blob_size);
+            }
+
+        }
+        if (count % 1000 == 0)
+        {
+            cout << count << " out=" << total_out_size << endl;
+        }
+        //cout << count << ": size=" << bv_size << endl;
+    }
+
+    delete [] buffer;
+    cout << "Total vectors:" << count << endl;
+    cout << "Total out size:" << total_out_size << endl;
+
+    clock_t finish = clock();
+    clock_t elapsed_clocks = finish - start;
+    double duration = (double)(elapsed_clocks) / CLOCKS_PER_SEC;
+
+    cout << endl
+         << "Serialization duration = " << duration 
+         << endl;
+
+    bv_file_out->close();
+    delete bv_file_out;
+
+}
+
+inline
+void GroupByTest(const char* filename, const char* query_filename)
+{
+    bvect bv_query;
+
+    unsigned count = 0;
+    unsigned group_by_count = 0;
+
+    clock_t start = clock();
+
+    // load the query vector
+    {
+        ifstream bv_file (query_filename, ios::in | ios::binary);
+        if (!bv_file.good())
+        {
+            cout << "Cannot open file: " << query_filename << endl;
+            exit(1);
+        }
+        unsigned buffer_size = 400*1024*1024;
+        unsigned char* buffer = new unsigned char[buffer_size];
+
+        unsigned bv_size=0;
+        bv_file.read((char*)&bv_size, sizeof(bv_size));
+        if (bv_size == 0)
+        {
+            cout << "Warning:Zero vector in query dump..." << endl;
+            return;
+        }
+        bv_file.read((char*)buffer, bv_size);
+        bm::deserialize(bv_query, (unsigned char*)buffer);
+        
+        delete [] buffer;
+
+    }
+
+
+    ifstream bv_file (filename, ios::in | ios::binary);
+    if (!bv_file.good())
+    {
+        cout << "Cannot open file: " << filename << endl;
+        exit(1);
+    }
+
+
+    unsigned buffer_size = 100*1024*1024;
+    unsigned char* buffer = new unsigned char[buffer_size];
+
+    for (;1; ++count)
+    {
+        unsigned bv_size;
+        bv_file.read((char*)&bv_size, sizeof(bv_size));
+        if (!bv_file.good())
+            break;
+        if (bv_size == 0)
+        {
+            cout << "Warning:Zero vector in dump..." << endl;
+            continue;
+        }
+        if (buffer_size < bv_size)
+        {
+            delete [] buffer;
+            buffer_size = bv_size;
+            buffer = new unsigned char[buffer_size];
+        }
+        bv_file.read((char*)buffer, bv_size);
+        bvect bv;
+        if (1)
+        {
+            bv.clear(true);
+            bm::deserialize(bv, (unsigned char*)buffer);
+
+            unsigned bc = bm::count_and(bv, bv_query);
+            if (bc)
+            {
+                ++group_by_count;
+            }
+
+/*            
+            bv &= bv_query;
+            if (bv.any())
+            {
+                ++group_by_count;
+            }
+*/            
+
+        }
+    
+    
+#if 0
+//print_stat(bv_query);
+//exit(1);
+        {
+        bvect bv(BM_GAP);
+        operation_deserializer<bvect>::deserialize(bv,
+                                                   bv_query,
+                                                   (unsigned char*)buffer,
+                                                   0,
+                                                   bm::set_AND);
+        // control			
+        if (0)
+        {
+            bvect bv_control(BM_GAP);
+            bm::deserialize(bv_control, (unsigned char*)buffer);
+            bv_control &= bv_query;
+            if (bv_control != bv)
+            {
+                cerr << "Group by control failure" << endl;
+                cerr << bv_control.count() << endl;
+                cerr << bv.count() << endl;
+                exit(1);
+            }
+        }				
+
+
+        if (bv.any())
+        {
+            ++group_by_count;
+        }
+        }
+#endif
+
+        if (count % 1000 == 0)
+        {
+            cout << count << endl;
+        }
+    }
+
+    delete [] buffer;
+    cout << "Total vectors:" << count << endl;
+    cout << "Group by vectors:" << group_by_count << endl;
+
+    clock_t finish = clock();
+    clock_t elapsed_clocks = finish - start;
+    double duration = (double)(elapsed_clocks) / CLOCKS_PER_SEC;
+
+    cout << endl
+         << "Test duration = " << duration 
+         << endl;
+}
+
+
+inline
+void LoadVectors(const char* dir_name, unsigned from, unsigned to)
+{
+    vector<bvect*>   bv_list;
+    vector<unsigned> sz_list;
+
+    unsigned total_size = 0;
+    unsigned total_new_size = 0;
+
+    for(; from <= to; ++from)
+    {
+        std::strstream fname_str;
+        fname_str << dir_name << "/" << from;
+        char* fname = fname_str.str();
+        
+        bvect* bv = new bvect;
+
+        unsigned fsize = 0;
+        LoadBVector(fname, *bv, &fsize);
+        //bv->optimize();
+        //print_stat(*bv);
+
+
+        // get new size
+        unsigned blob_size = 0;
+        {
+        bvect::statistics st1;
+        bv->calc_stat(&st1);
+
+        unsigned char* blob = new unsigned char[st1.max_serialize_mem];
+        blob_size = bm::serialize(*bv, blob, BM_NO_GAP_LENGTH|BM_NO_BYTE_ORDER);
+
+        if (st1.max_serialize_mem < blob_size)
+        {
+            printf("BLOB size prediction error!\n");
+            exit(1);
+        }
+
+        //if (from >= 27)
+        {
+            bvect bv_control;
+            bm::deserialize(bv_control, (unsigned char*)blob);
+            if (bv_control != *bv)
+            {
+                cout << "Serialization error!" << endl;
+                exit(1);
+            }
+        }
+                
+        delete [] blob;
+
+        }
+
+        cout << fname << "    " 
+             << " old=" << fsize << " new=" << blob_size 
+             << " diff=" << (int)fsize - (int) blob_size
+             << endl;
+
+        bv_list.push_back(bv);
+        sz_list.push_back(fsize);
+
+        total_size += fsize;
+        total_new_size += blob_size;
+    } // for
+
+    cout << "Total size = " << total_size / (1024*1024) << "Mb" << endl;
+    cout << "  New size = " << total_new_size / (1024*1024) << "Mb" << endl;
+    cout << "Total diff = " << (total_size - total_new_size) / (1024*1024) << "Mb" << endl;
+
+    vector<unsigned char*> bv_blobs;
+
+    cout << "Running serialization benchmark..." << endl;
+    {
+    clock_t start = clock();
+
+        for (size_t i = 0; i < bv_list.size(); ++i)
+        {
+            const bvect* bv = bv_list[i];
+            bvect::statistics st1;
+            bv->calc_stat(&st1);
+            unsigned char* blob = new unsigned char[st1.max_serialize_mem*2];
+            bv_blobs.push_back(blob);
+
+            for (int j = 0; j < (int)(400/(i?i:1)); ++j)
+            {
+                //unsigned blob_size = 
+                    bm::serialize(*bv, blob);
+            }
+            // delete [] blob;
+        }
+
+    clock_t finish = clock();
+    clock_t elapsed_clocks = finish - start;
+    double duration = (double)(elapsed_clocks) / CLOCKS_PER_SEC;
+
+    cout << endl
+         << "Serialization duration = " << duration 
+         << endl;
+    }
+
+    cout << "Running de-serialization benchmark..." << endl;
+    {
+    clock_t start = clock();
+
+        for (size_t i = 0; i < bv_blobs.size(); ++i)
+        {
+            const unsigned char* blob = bv_blobs[i];
+            for (int j = 0; j < (int)(400/(i?i:1)); ++j)
+            {
+                 bvect bv;
+                 bm::deserialize(bv, (unsigned char*)blob);
+            }
+            // delete [] blob;
+        }
+
+    clock_t finish = clock();
+    clock_t elapsed_clocks = finish - start;
+    double duration = (double)(elapsed_clocks) / CLOCKS_PER_SEC;
+
+    cout << endl
+         << "DeSerialization duration = " << duration 
+         << endl;
+    }
+
+
+
+
+    for (size_t i = 0; i < bv_list.size(); ++i)
+    {
+        delete bv_list[i];
+    }
+    for (size_t i = 0; i < bv_blobs.size(); ++i)
+    {
+        delete [] bv_blobs[i];
+    }
+
+}
+
+
+static
+void TestSIMDUtils()
+{
+    cout << "------------------------ Test SIMD Utils" << endl;
+#if defined(BMSSE2OPT)
+    unsigned idx;
+    cout << "----------------------------> [ SSE2 ]" << endl;
+    {
+        unsigned short buf[127] = { 65535, 127, 255, 256, 1000, 2000, 2001, 2005, 0xFF, 0, };
+        idx = bm::sse2_gap_find(buf, 65535, 1);
+        assert(idx == 0);
+        idx = bm::sse2_gap_find(buf, 0, 1);
+        assert(idx == 0);
+        idx = bm::sse2_gap_find(buf, 10, 1);
+        assert(idx == 0);
+    }
+
+    {
+        unsigned short buf[16] = { 60000, 127, 255, 256, 1000, 2000, 2001, 2005, 0xFF, 0, };
+        idx = bm::sse2_gap_find(buf, 65535, 1);
+        assert(idx == 1);
+        idx = bm::sse2_gap_find(buf, 0, 1);
+        assert(idx == 0);
+        idx = bm::sse2_gap_find(buf, 10, 1);
+        assert(idx == 0);
+    }
+
+    {
+        unsigned short buf[16] = { 10, 65530, 127, 255, 256, 1000, 2000, 2001, 2005, 0xFF, };
+        const unsigned vsize = 2;
+        idx = bm::sse2_gap_find(buf, 0, vsize);
+        assert(idx == 0);
+        idx = bm::sse2_gap_find(buf, 65535, vsize);
+        assert(idx == vsize);
+        for (unsigned i = 0; i < vsize; ++i)
+        {
+            unsigned short v = buf[i];
+            idx = bm::sse2_gap_find(buf, v, vsize);
+            assert(idx == i);
+            idx = bm::sse2_gap_find(buf, v - 1, vsize);
+            assert(idx == i);
+        }
+    }
+
+    {
+        unsigned short buf[16] = { 10, 256, 65530, 127, 255, 256, 1000, 2000, 2001, 2005, 0xFF, };
+        const unsigned vsize = 3;
+        idx = bm::sse2_gap_find(buf, 0, vsize);
+        assert(idx == 0);
+        idx = bm::sse2_gap_find(buf, 65535, vsize);
+        assert(idx == vsize);
+        for (unsigned i = 0; i < vsize; ++i)
+        {
+            unsigned short v = buf[i];
+            idx = bm::sse2_gap_find(buf, v, vsize);
+            assert(idx == i);
+            idx = bm::sse2_gap_find(buf, v - 1, vsize);
+            assert(idx == i);
+        }
+    }
+    {
+        unsigned short buf[16] = { 10, 256, 258, 65500, 127, 255, 256, 1000, 2000, 2001, 2005, 0xFF, };
+        const unsigned vsize = 4;
+        idx = bm::sse2_gap_find(buf, 0, vsize);
+        assert(idx == 0);
+        idx = bm::sse2_gap_find(buf, 65535, vsize);
+        assert(idx == vsize);
+        for (unsigned i = 0; i < vsize; ++i)
+        {
+            unsigned short v = buf[i];
+            idx = bm::sse2_gap_find(buf, v, vsize);
+            assert(idx == i);
+            idx = bm::sse2_gap_find(buf, v - 1, vsize);
+            assert(idx == i);
+        }
+    }
+
+    {
+        //        unsigned short buf[16] = { 10, 256, 258, 15525, 64500, 127, 255, 256, 1000, 2000, 2001, 2005, 0xFF, };
+        unsigned short buf[16] = { 10, 20, 30, 40, 50, 127, 255, 256, 1000, 2000, 2001, 2005, 0xFF, };
+        const unsigned vsize = 5;
+        idx = bm::sse2_gap_find(buf, 0, vsize);
+        assert(idx == 0);
+        idx = bm::sse2_gap_find(buf, 65535, vsize);
+        assert(idx == vsize);
+
+        for (unsigned i = 0; i < vsize; ++i)
+        {
+            unsigned short v = buf[i];
+            idx = bm::sse2_gap_find(buf, v, vsize);
+            assert(idx == i);
+            idx = bm::sse2_gap_find(buf, v - 1, vsize);
+            assert(idx == i);
+        }
+    }
+
+    {
+        unsigned short buf[127] = { 2, 10, 256, 258, 15525, 65530, 127, 255, 256, 1000, 2000, 2001, 2005, 0xFF, };
+        const unsigned vsize = 6;
+        idx = bm::sse2_gap_find(buf, 0, vsize);
+        assert(idx == 0);
+        idx = bm::sse2_gap_find(buf, 65535, vsize);
+        assert(idx == vsize);
+        for (unsigned i = 0; i < vsize; ++i)
+        {
+            unsigned short v = buf[i];
+            idx = bm::sse2_gap_find(buf, v, vsize);
+            assert(idx == i);
+            idx = bm::sse2_gap_find(buf, v - 1, vsize);
+            assert(idx == i);
+        }
+    }
+
+    {
+        unsigned short buf[16] = { 1, 2, 10, 256, 258, 15525, 65530, 127, 255, 256, 1000, 2000, 2001, 2005, 0xFF, };
+        const unsigned vsize = 7;
+        idx = bm::sse2_gap_find(buf, 0, vsize);
+        assert(idx == 0);
+        idx = bm::sse2_gap_find(buf, 65535, vsize);
+        assert(idx == vsize);
+
+        for (unsigned i = 0; i < vsize; ++i)
+        {
+            unsigned short v = buf[i];
+            idx = bm::sse2_gap_find(buf, v, vsize);
+            assert(idx == i);
+            idx = bm::sse2_gap_find(buf, v - 1, vsize);
+            assert(idx == i || (buf[i - 1] == v - 1));
+        }
+    }
+    {
+        unsigned short buf[16] = { 1, 2, 10, 256,  258, 1024, 15525, 65530,  127, 255, 256, 0xFF, };
+        const unsigned vsize = 8;
+        idx = bm::sse2_gap_find(buf, 0, vsize);
+        assert(idx == 0);
+        idx = bm::sse2_gap_find(buf, 65535, vsize);
+        assert(idx == vsize);
+        for (unsigned i = 0; i < vsize; ++i)
+        {
+            unsigned short v = buf[i];
+            if (i == vsize - 1)
+            {
+                assert(v != 65535);
+            }
+            idx = bm::sse2_gap_find(buf, v, vsize);
+            assert(idx == i);
+            idx = bm::sse2_gap_find(buf, v - 1, vsize);
+            assert(idx == i || (buf[i - 1] == v - 1));
+        }
+    }
+
+    {
+        unsigned short buf[16] = { 6217, 6300, 6400, 6500,
+            6600, 6700, 30584, 40255,
+            50256, 60000, 61001, 65255, 65530, 12, 23, 0, };
+        const unsigned vsize = 13;
+        idx = bm::sse2_gap_find(buf, 0, vsize);
+        assert(idx == 0);
+        idx = bm::sse2_gap_find(buf, 65535, vsize);
+        assert(idx == vsize);
+
+        for (unsigned i = 0; i < vsize; ++i)
+        {
+            unsigned short v = buf[i];
+            if (i == vsize - 1)
+            {
+                assert(v != 65535);
+            }
+            idx = bm::sse2_gap_find(buf, v, vsize);
+            assert(idx == i);
+            idx = bm::sse2_gap_find(buf, v - 1, vsize);
+            assert(idx == i || (buf[i - 1] == v - 1));
+        }
+    }
+
+    {
+        unsigned short buf[16] = { 6217, 6300, 6400, 6500,
+            6600, 6700, 30584, 40255,
+            50256, 60000, 61001, 65255,
+            65256, 65257, 65300, 65530 };
+        const unsigned vsize = 16;
+        idx = bm::sse2_gap_find(buf, 0, vsize);
+        assert(idx == 0);
+        idx = bm::sse2_gap_find(buf, 65535, vsize);
+        assert(idx == 16);
+        for (unsigned i = 0; i < vsize; ++i)
+        {
+            unsigned short v = buf[i];
+            if (i == vsize - 1)
+            {
+                assert(v != 65535);
+            }
+            idx = bm::sse2_gap_find(buf, v, vsize);
+            assert(idx == i);
+            idx = bm::sse2_gap_find(buf, v - 1, vsize);
+            assert(idx == i || (buf[i - 1] == v - 1));
+        }
+    }
+
+#endif
+
+#if defined(BMSSE42OPT)
+    unsigned idx;
+    cout << "----------------------------> [ SSE 4.2 ]" << endl;
+    
+    {
+        BM_DECLARE_TEMP_BLOCK(tb)
+        for (unsigned i = 0; i < bm::set_block_size; ++i)
+        {
+            tb[i] = ~0u;
+        }
+        bool all_one = sse4_is_all_one((__m128i*)tb, (__m128i*)(tb + bm::set_block_size));
+        assert(all_one);
+        
+        tb[256] = 1;
+        all_one = sse4_is_all_one((__m128i*)tb, (__m128i*)(tb + bm::set_block_size));
+        assert(!all_one);
+    }
+
+    {
+        BM_DECLARE_TEMP_BLOCK(tb)
+        for (unsigned i = 0; i < bm::set_block_size; ++i)
+        {
+            tb[i] = 0u;
+        }
+        bool all_z = sse4_is_all_zero((__m128i*)tb, (__m128i*)(tb + bm::set_block_size));
+        assert(all_z);
+        
+        tb[256] = 1;
+        all_z = sse4_is_all_zero((__m128i*)tb, (__m128i*)(tb + bm::set_block_size));
+        assert(!all_z);
+    }
+
+
+    {
+        unsigned short buf[127] = { 65535, 127, 255, 256, 1000, 2000, 2001, 2005, 0xFF, 0,  };
+        idx = bm::sse4_gap_find(buf, 65535, 1);
+        assert(idx == 0);
+        idx = bm::sse4_gap_find(buf, 0, 1);
+        assert(idx == 0);
+        idx = bm::sse4_gap_find(buf, 10, 1);
+        assert(idx == 0);
+    }
+
+    {
+        unsigned short buf[16] = { 60000, 127, 255, 256, 1000, 2000, 2001, 2005, 0xFF, 0, };
+        idx = bm::sse4_gap_find(buf, 65535, 1);
+        assert(idx == 1);
+        idx = bm::sse4_gap_find(buf, 0, 1);
+        assert(idx == 0);
+        idx = bm::sse4_gap_find(buf, 10, 1);
+        assert(idx == 0);
+    }
+
+    {
+        unsigned short buf[16] = { 10, 65530, 127, 255, 256, 1000, 2000, 2001, 2005, 0xFF, };
+        const unsigned vsize = 2;
+        idx = bm::sse4_gap_find(buf, 0, vsize);
+        assert(idx == 0);
+        idx = bm::sse4_gap_find(buf, 65535, vsize);
+        assert(idx == vsize);
+        for (unsigned i = 0; i < vsize; ++i)
+        {
+            unsigned short v = buf[i];
+            idx = bm::sse4_gap_find(buf, v, vsize);
+            assert(idx == i);
+            idx = bm::sse4_gap_find(buf, v - 1, vsize);
+            assert(idx == i);
+        }
+    }
+
+    {
+        unsigned short buf[16] = { 10, 256, 65530, 127, 255, 256, 1000, 2000, 2001, 2005, 0xFF, };
+        const unsigned vsize = 3;
+        idx = bm::sse4_gap_find(buf, 0, vsize);
+        assert(idx == 0);
+        idx = bm::sse4_gap_find(buf, 65535, vsize);
+        assert(idx == vsize);
+        for (unsigned i = 0; i < vsize; ++i)
+        {
+            unsigned short v = buf[i];
+            idx = bm::sse4_gap_find(buf, v, vsize);
+            assert(idx == i);
+            idx = bm::sse4_gap_find(buf, v - 1, vsize);
+            assert(idx == i);
+        }
+    }
+    {
+        unsigned short buf[16] = { 10, 256, 258, 65500, 127, 255, 256, 1000, 2000, 2001, 2005, 0xFF, };
+        const unsigned vsize = 4;
+        idx = bm::sse4_gap_find(buf, 0, vsize);
+        assert(idx == 0);
+        idx = bm::sse4_gap_find(buf, 65535, vsize);
+        assert(idx == vsize);
+        for (unsigned i = 0; i < vsize; ++i)
+        {
+            unsigned short v = buf[i];
+            idx = bm::sse4_gap_find(buf, v, vsize);
+            assert(idx == i);
+            idx = bm::sse4_gap_find(buf, v - 1, vsize);
+            assert(idx == i);
+        }
+    }
+    
+    {
+//        unsigned short buf[16] = { 10, 256, 258, 15525, 64500, 127, 255, 256, 1000, 2000, 2001, 2005, 0xFF, };
+        unsigned short buf[16] = { 10, 20, 30, 40, 50, 127, 255, 256, 1000, 2000, 2001, 2005, 0xFF, };
+        const unsigned vsize = 5;
+        idx = bm::sse4_gap_find(buf, 0, vsize);
+        assert(idx == 0);
+        idx = bm::sse4_gap_find(buf, 65535, vsize);
+        assert(idx == vsize);
+
+        for (unsigned i = 0; i < vsize; ++i)
+        {
+            unsigned short v = buf[i];
+            idx = bm::sse4_gap_find(buf, v, vsize);
+            assert(idx == i);
+            idx = bm::sse4_gap_find(buf, v - 1, vsize);
+            assert(idx == i);
+        }
+    }
+    
+    {
+        unsigned short buf[127] = { 2, 10, 256, 258, 15525, 65530, 127, 255, 256, 1000, 2000, 2001, 2005, 0xFF, };
+        const unsigned vsize = 6;
+        idx = bm::sse4_gap_find(buf, 0, vsize);
+        assert(idx == 0);
+        idx = bm::sse4_gap_find(buf, 65535, vsize);
+        assert(idx == vsize);
+        for (unsigned i = 0; i < vsize; ++i)
+        {
+            unsigned short v = buf[i];
+            idx = bm::sse4_gap_find(buf, v, vsize);
+            assert(idx == i);
+            idx = bm::sse4_gap_find(buf, v - 1, vsize);
+            assert(idx == i);
+        }
+    }
+
+    {
+        unsigned short buf[16] = { 1, 2, 10, 256, 258, 15525, 65530, 127, 255, 256, 1000, 2000, 2001, 2005, 0xFF, };
+        const unsigned vsize = 7;
+        idx = bm::sse4_gap_find(buf, 0, vsize);
+        assert(idx == 0);
+        idx = bm::sse4_gap_find(buf, 65535, vsize);
+        assert(idx == vsize);
+
+        for (unsigned i = 0; i < vsize; ++i)
+        {
+            unsigned short v = buf[i];
+            idx = bm::sse4_gap_find(buf, v, vsize);
+            assert(idx == i);
+            idx = bm::sse4_gap_find(buf, v - 1, vsize);
+            assert(idx == i || (buf[i-1] == v-1));
+        }
+    }
+    {
+    unsigned short buf[16] = { 1, 2, 10, 256,  258, 1024, 15525, 65530,  127, 255, 256, 0xFF, };
+    const unsigned vsize = 8;
+    idx = bm::sse4_gap_find(buf, 0, vsize);
+    assert(idx == 0);
+    idx = bm::sse4_gap_find(buf, 65535, vsize);
+    assert(idx == vsize);
+    for (unsigned i = 0; i < vsize; ++i)
+    {
+        unsigned short v = buf[i];
+        if (i == vsize - 1)
+        {
+            assert(v != 65535);
+        }
+        idx = bm::sse4_gap_find(buf, v, vsize);
+        assert(idx == i);
+        idx = bm::sse4_gap_find(buf, v - 1, vsize);
+        assert(idx == i || (buf[i - 1] == v - 1));
+    }
+    }
+
+    {
+        unsigned short buf[16] = { 6217, 6300, 6400, 6500,  
+                                   6600, 6700, 30584, 40255, 
+                                   50256, 60000, 61001, 65255, 65530, 12, 23, 0,  };
+        const unsigned vsize = 13;
+        idx = bm::sse4_gap_find(buf, 0, vsize);
+        assert(idx == 0);
+        idx = bm::sse4_gap_find(buf, 65535, vsize);
+        assert(idx == vsize);
+
+        for (unsigned i = 0; i < vsize; ++i)
+        {
+            unsigned short v = buf[i];
+            if (i == vsize - 1)
+            {
+                assert(v != 65535);
+            }
+            idx = bm::sse4_gap_find(buf, v, vsize);
+            assert(idx == i);
+            idx = bm::sse4_gap_find(buf, v - 1, vsize);
+            assert(idx == i || (buf[i - 1] == v - 1));
+        }
+    }
+
+    {
+        unsigned short buf[16] = { 6217, 6300, 6400, 6500,
+            6600, 6700, 30584, 40255,
+            50256, 60000, 61001, 65255, 
+            65256, 65257, 65300, 65530  };
+        const unsigned vsize = 16;
+        idx = bm::sse4_gap_find(buf, 0, vsize);
+        assert(idx == 0);
+        idx = bm::sse4_gap_find(buf, 65535, vsize);
+        assert(idx == 16);
+        for (unsigned i = 0; i < vsize; ++i)
+        {
+            unsigned short v = buf[i];
+            if (i == vsize - 1)
+            {
+                assert(v != 65535);
+            }
+            idx = bm::sse4_gap_find(buf, v, vsize);
+            assert(idx == i);
+            idx = bm::sse4_gap_find(buf, v - 1, vsize);
+            assert(idx == i || (buf[i - 1] == v - 1));
+        }
+    }
+
+#endif
+
+#if defined(BMAVX2OPT)
+    cout << "----------------------------> [ AVX2 ]" << endl;
+    
+    {
+        BM_DECLARE_TEMP_BLOCK(tb)
+        for (unsigned i = 0; i < bm::set_block_size; ++i)
+        {
+            tb[i] = 0;
+        }
+        bool all_z = avx2_is_all_zero((__m256i*)tb, (__m256i*)(tb + bm::set_block_size));
+        assert(all_z);
+        
+        tb[256] = 1;
+        all_z = avx2_is_all_zero((__m256i*)tb, (__m256i*)(tb + bm::set_block_size));
+        assert(!all_z);
+    }
+
+    {
+        BM_DECLARE_TEMP_BLOCK(tb)
+        for (unsigned i = 0; i < bm::set_block_size; ++i)
+        {
+            tb[i] = ~0u;
+        }
+        bool all_one = avx2_is_all_one((__m256i*)tb, (__m256i*)(tb + bm::set_block_size));
+        assert(all_one);
+        
+        tb[256] = 1;
+        all_one = avx2_is_all_one((__m256i*)tb, (__m256i*)(tb + bm::set_block_size));
+        assert(!all_one);
+    }
+#endif
+
+#if defined(BMAVX512OPT)
+    cout << "----------------------------> [ AVX512 ]" << endl;
+
+    {
+        BM_DECLARE_TEMP_BLOCK(tb)
+        for (unsigned i = 0; i < bm::set_block_size; ++i)
+        {
+            tb[i] = 0;
+        }
+        bool all_z = avx512_is_all_zero((__m512i*)tb, (__m512i*)(tb + bm::set_block_size));
+        assert(all_z);
+        tb[bm::set_block_size-1] = 1;
+        all_z = avx512_is_all_zero((__m512i*)tb, (__m512i*)(tb + bm::set_block_size));
+        assert(!all_z);
+
+        for (unsigned i = 0; i < bm::set_block_size; ++i)
+        {
+            tb[i] = ~0u;
+        }
+        bool all_one = avx512_is_all_one((__m512i*)tb, (__m512i*)(tb + bm::set_block_size));
+        assert(all_one);
+        tb[257] = 1;
+        all_one = avx512_is_all_one((__m512i*)tb, (__m512i*)(tb + bm::set_block_size));
+        assert(!all_one);
+    }
+
+    {
+        BM_DECLARE_TEMP_BLOCK(tb)
+        BM_DECLARE_TEMP_BLOCK(tb2)
+        for (unsigned k = 0; k < 200; ++k)
+        {
+            unsigned density = k % 5;
+            for (unsigned i = 0; i < bm::set_block_size; ++i)
+            {
+                switch (density)
+                {
+                case 0: tb[i] = (rand() % 64) ? 0u : unsigned(rand()); break;
+                case 1: tb[i] = (rand() % 64) ? ~0u : unsigned(rand()); break;
+                case 2: tb[i] = (i / 32) & 1 ? ~0u : 0u; break;
+                case 3: tb[i] = unsigned(rand()) ^ (unsigned(rand()) << 16); break;
+                default: tb[i] = (k & 1) ? ~0u : 0u; break;
+                }
+                tb2[i] = unsigned(rand()) ^ (unsigned(rand()) << 16);
+            }
+            unsigned bc, gc;
+            bm::bit_count_change32(tb, tb + bm::set_block_size, &bc, &gc);
+            unsigned bc1;
+            unsigned gc1 = avx512_bit_block_calc_count_change(
+                (__m512i*)tb, (__m512i*)(tb + bm::set_block_size), &bc1);
+            assert(bc == bc1);
+            assert(gc == gc1);
+
+            unsigned cnt_and = 0, cnt_or = 0, cnt_xor = 0, cnt_sub = 0;
+            for (unsigned i = 0; i < bm::set_block_size; ++i)
+            {
+                cnt_and += bm::word_bitcount(tb[i] & tb2[i]);
+                cnt_or  += bm::word_bitcount(tb[i] | tb2[i]);
+                cnt_xor += bm::word_bitcount(tb[i] ^ tb2[i]);
+                cnt_sub += bm::word_bitcount(tb[i] & ~tb2[i]);
+            }
+            const __m512i* b1 = (__m512i*)tb;
+            const __m512i* b1_end = (__m512i*)(tb + bm::set_block_size);
+            const __m512i* b2 = (__m512i*)tb2;
+            assert(avx512_bit_count(b1, b1_end) == bc);
+            assert(avx512_bit_count_and(b1, b1_end, b2) == cnt_and);
+            assert(avx512_bit_count_or(b1, b1_end, b2) == cnt_or);
+            assert(avx512_bit_count_xor(b1, b1_end, b2) == cnt_xor);
+            assert(avx512_bit_count_sub(b1, b1_end, b2) == cnt_sub);
+        }
+    }
+
+    {
+        unsigned short buf[32];
+        for (unsigned k = 0; k < 1000; ++k)
+        {
+            unsigned vsize = 1 + unsigned(rand()) % 32;
+            unsigned short v = (unsigned short)(rand() % 1024);
+            for (unsigned i = 0; i < vsize; ++i)
+            {
+                v = (unsigned short)(v + 1 + rand() % 1024);
+                buf[i] = v;
+            }
+            for (unsigned i = 0; i < vsize; ++i)
+            {
+                unsigned idx = bm::avx512_gap_find(buf, buf[i], vsize);
+                assert(idx == i);
+                idx = bm::avx512_gap_find(buf, (unsigned short)(buf[i] - 1), vsize);
+                assert(idx == i || (buf[i - 1] == buf[i] - 1));
+            }
+            unsigned idx = bm::avx512_gap_find(buf, 0, vsize);
+            assert(idx == 0);
+            idx = bm::avx512_gap_find(buf, (unsigned short)(buf[vsize-1] + 1), vsize);
+            assert(idx == vsize || buf[vsize-1] == 65535);
+        }
+    }
+#endif
+
+#if defined(BM_SIMD_DISPATCH)
+    cout << "----------------------------> [ SIMD dispatch ]" << endl;
+    {
+        int cpu_level = bm::simd_dispatch<true>::cpu_level();
+        int saved_level = bm::simd_dispatch<true>::level();
+        cout << "CPU SIMD level = " << cpu_level << endl;
+
+        static unsigned tm1[bm::set_block_plain_cnt][bm::set_block_plain_size];
+        BM_DECLARE_TEMP_BLOCK(tb)
+        BM_DECLARE_TEMP_BLOCK(tb2)
+        BM_DECLARE_TEMP_BLOCK(tb3)
+
+        const int levels[] = { bm::simd_sse2, bm::simd_sse42,
+                               bm::simd_avx2, bm::simd_avx512 };
+        for (unsigned l = 0; l < sizeof(levels)/sizeof(levels[0]); ++l)
+        {
+            if (levels[l] > cpu_level)
+                break;
+            int lvl = bm::simd_dispatch<true>::set_level(levels[l]);
+            assert(lvl <= levels[l] || lvl == bm::simd_sse42);
+            assert(bm::simd_version() == lvl);
+            const bm::simd_kernels& k = bm::simd_dispatch<true>::kernels();
+            cout << "  level " << lvl << endl;
+
+            for (unsigned pass = 0; pass < 100; ++pass)
+            {
+                unsigned density = pass % 5;
+                for (unsigned i = 0; i < bm::set_block_size; ++i)
+                {
+                    switch (density)
+                    {
+                    case 0: tb[i] = (rand() % 64) ? 0u : unsigned(rand()); break;
+                    case 1: tb[i] = (rand() % 64) ? ~0u : unsigned(rand()); break;
+                    case 2: tb[i] = (i / 32) & 1 ? ~0u : 0u; break;
+                    case 3: tb[i] = unsigned(rand()) ^ (unsigned(rand()) << 16); break;
+                    default: tb[i] = (pass & 1) ? ~0u : 0u; break;
+                    }
+                    tb2[i] = unsigned(rand()) ^ (unsigned(rand()) << 16);
+                }
+                const bm::word_t* tb_end = tb + bm::set_block_size;
+
+                // bit counting
+                unsigned cnt = 0, cnt_and = 0, cnt_or = 0, cnt_xor = 0, cnt_sub = 0;
+                bool all_zero = true, all_one = true;
+                for (unsigned i = 0; i < bm::set_block_size; ++i)
+                {
+                    cnt     += bm::word_bitcount(tb[i]);
+                    cnt_and += bm::word_bitcount(tb[i] & tb2[i]);
+                    cnt_or  += bm::word_bitcount(tb[i] | tb2[i]);
+                    cnt_xor += bm::word_bitcount(tb[i] ^ tb2[i]);
+                    cnt_sub += bm::word_bitcount(tb[i] & ~tb2[i]);
+                    all_zero &= (tb[i] == 0);
+                    all_one &= (tb[i] == ~0u);
+                }
+                assert(k.bit_count(tb, tb_end) == cnt);
+                assert(k.bit_count_and(tb, tb_end, tb2) == cnt_and);
+                assert(k.bit_count_or(tb, tb_end, tb2) == cnt_or);
+                assert(k.bit_count_xor(tb, tb_end, tb2) == cnt_xor);
+                assert(k.bit_count_sub(tb, tb_end, tb2) == cnt_sub);
+                assert(k.is_all_zero(tb, tb_end) == all_zero);
+                assert(k.is_all_one(tb, tb_end) == all_one);
+
+                unsigned bc, gc, bc1;
+                bm::bit_count_change32(tb, tb_end, &bc, &gc);
+                unsigned gc1 = k.count_change(tb, tb_end, &bc1);
+                assert(bc == bc1);
+                assert(gc == gc1);
+
+                // logical operations
+                k.copy_block(tb3, tb, tb_end);
+                k.and_arr(tb3, tb2, tb2 + bm::set_block_size);
+                for (unsigned i = 0; i < bm::set_block_size; ++i)
+                    assert(tb3[i] == (tb[i] & tb2[i]));
+                k.copy_block(tb3, tb, tb_end);
+                k.or_arr(tb3, tb2, tb2 + bm::set_block_size);
+                for (unsigned i = 0; i < bm::set_block_size; ++i)
+                    assert(tb3[i] == (tb[i] | tb2[i]));
+                k.copy_block(tb3, tb, tb_end);
+                k.xor_arr(tb3, tb2, tb2 + bm::set_block_size);
+                for (unsigned i = 0; i < bm::set_block_size; ++i)
+                    assert(tb3[i] == (tb[i] ^ tb2[i]));
+                k.copy_block(tb3, tb, tb_end);
+                k.sub_arr(tb3, tb2, tb2 + bm::set_block_size);
+                for (unsigned i = 0; i < bm::set_block_size; ++i)
+                    assert(tb3[i] == (tb[i] & ~tb2[i]));
+                k.invert_arr(tb3, tb3 + bm::set_block_size);
+                for (unsigned i = 0; i < bm::set_block_size; ++i)
+                    assert(tb3[i] == ~(tb[i] & ~tb2[i]));
+                k.xor_arr_2_mask(tb3, tb, tb_end, ~0u);
+                for (unsigned i = 0; i < bm::set_block_size; ++i)
+                    assert(tb3[i] == ~tb[i]);
+                k.andnot_arr_2_mask(tb3, tb2, tb2 + bm::set_block_size, ~0u);
+                for (unsigned i = 0; i < bm::set_block_size; ++i)
+                    assert(tb3[i] == ~tb2[i]);
+                k.set_block(tb3, tb3 + bm::set_block_size, 0u);
+                assert(k.is_all_zero(tb3, tb3 + bm::set_block_size));
+
+                // bit transposition
+                k.bit_transpose32(tb, bm::set_block_size, tm1);
+                for (unsigned col = 0; col < bm::set_block_plain_size; ++col)
+                {
+                    for (unsigned j = 0; j < bm::set_block_plain_cnt; ++j)
+                    {
+                        unsigned w = bm::bit_grabber<unsigned, 32>::get(tb + col * 32, j);
+                        assert(tm1[j][col] == w);
+                    }
+                }
+
+                // prefix XOR (GAP to bit-block conversion)
+                {
+                    unsigned carry = (pass & 2) ? ~0u : 0u;
+                    k.copy_block(tb3, tb, tb_end);
+                    k.bit_xor_prefix(tb3, tb3 + bm::set_block_size, carry);
+                    unsigned acc = carry & 1u;
+                    for (unsigned i = 0; i < bm::set_block_size * 32; ++i)
+                    {
+                        acc ^= (tb[i >> 5] >> (i & 31)) & 1u;
+                        assert(((tb3[i >> 5] >> (i & 31)) & 1u) == acc);
+                    }
+                }
+            } // for pass
+
+            // GAP search
+            {
+                unsigned short buf[32];
+                for (unsigned pass = 0; pass < 1000; ++pass)
+                {
+                    unsigned vsize = 1 + unsigned(rand()) % k.gap_find_lane;
+                    unsigned short v = (unsigned short)(rand() % 1024);
+                    for (unsigned i = 0; i < vsize; ++i)
+                    {
+                        v = (unsigned short)(v + 1 + rand() % 1024);
+                        buf[i] = v;
+                    }
+                    for (unsigned i = 0; i < vsize; ++i)
+                    {
+                        unsigned idx = k.gap_find(buf, buf[i], vsize);
+                        assert(idx == i);
+                    }
+                    unsigned idx = k.gap_find(buf, 0, vsize);
+                    assert(idx == 0);
+                }
+            }
+
+            // GAP test via dispatched search
+            {
+                bm::gap_word_t gap_buf[bm::gap_max_buff_len+1] = {0,};
+                for (unsigned pass = 0; pass < 50; ++pass)
+                {
+                    bm::gap_set_all(gap_buf, bm::gap_max_bits, pass & 1);
+                    unsigned len = 1 + unsigned(rand()) % 2000;
+                    for (unsigned i = 0; i < len; ++i)
+                    {
+                        unsigned is_set;
+                        bm::gap_set_value(!(rand() & 1), gap_buf,
+                                          unsigned(rand()) % bm::gap_max_bits,
+                                          &is_set);
+                        if (bm::gap_length(gap_buf) > bm::gap_max_buff_len - 4)
+                            break;
+                    }
+                    for (unsigned i = 0; i < bm::gap_max_bits; i += 1 + rand() % 7)
+                    {
+                        assert(bm::gap_test_unr(gap_buf, i) == bm::gap_test(gap_buf, i));
+                    }
+                }
+            }
+        } // for l
+        bm::simd_dispatch<true>::set_level(saved_level);
+        assert(bm::simd_dispatch<true>::level() == saved_level);
+    }
+#endif
+    cout << "------------------------ Test SIMD Utils OK" << endl;
+}
+
+static
+void AddressResolverTest()
+{
+    bm::id_t id_to;
+    bool found;
+    
+    {
+        bvps_addr_resolver<bvect>  ares;
+        
+        found = ares.resolve(10, &id_to);
+        assert(!found);
+        assert(id_to == 0);
+        
+        bvps_addr_resolver<bvect>  ares2(ares);
+        
+        found = ares2.resolve(10, &id_to);
+        assert(!found);
+        assert(id_to == 0);
+    }
+
+    {
+        bvps_addr_resolver<bvect>  ares;
+        
+        ares.set(1000);
+        ares.set(10000);
+        ares.set(100000);
+        
+        found = ares.resolve(10, &id_to);
+        assert(!found);
+        assert(id_to == 0);
+
+        found = ares.resolve(100000, &id_to);
+        assert(found);
+        assert(id_to == 3);
+        
+        assert(ares.in_sync() == false);
+        
+        ares.optimize();
+        assert(ares.in_sync() == false);
+        
+        ares.sync();
+        assert(ares.in_sync());
+
+        found = ares.resolve(100000, &id_to);
+        assert(found);
+        assert(id_to == 3);
+        
+        bvps_addr_resolver<bvect>  ares2(ares);
+        bool same = ares.equal(ares2);
+        assert(same);
+        
+        bvps_addr_resolver<bvect>  ares3;
+        ares3.move_from(ares2);
+        same = ares.equal(ares3);
+        assert(same);
+
+    }
+    
     {
-        unsigned short buf[127] = { 2, 10, 256, 258, 15525, 65530, 127, 255, 256, 1000, 2000, 2001, 2005, 0xFF, };
-        const unsigned vsize = 6;
-        idx = bm::sse4_gap_find(buf, 0, vsize);
-        assert(idx == 0);
-        idx = bm::sse4_gap_find(buf, 65535, vsize);
-        assert(idx == vsize);
-        for (unsigned i = 0; i < vsize; ++i)
+        sv_addr_resolver<sparse_vector<bm::id_t, bvect> > ares;
+        
+        found = ares.resolve(10, &id_to);
+        assert(!found);
+        assert(id_to == 0);
+    }
+    
+    {
+        sv_addr_resolver<sparse_vector<bm::id_t, bvect> > ares;
+        
+        ares.set(1000);  // 1
+        ares.set(10000); // 2
+        ares.set(100000); // 3
+        ares.set(5);      // 4
+        
+        found = ares.resolve(10, &id_to);
+        assert(!found);
+        assert(id_to == 0);
+        
+        found = ares.resolve(1000, &id_to);
+        assert(found);
+        assert(id_to == 1);
+
+        found = ares.resolve(10000, &id_to);
+        assert(found);
+        assert(id_to == 2);
+        
+        ares.optimize();
+        
+        found = ares.resolve(5, &id_to);
+        assert(found);
+        assert(id_to == 4);
+
+    }
+
+    
+}
+
+// generate pseudo-random bit-vector, mix of blocks
+//
+void generate_bvector(bvect& bv, unsigned vector_max)
+{
+    unsigned i, j;
+    for (i = 0; i < vector_max;)
+    {
+        // generate bit-blocks
+        for (j = 0; j < 65535*8; i += 10, j++)
         {
-            unsigned short v = buf[i];
-            idx = bm::sse4_gap_find(buf, v, vsize);
-            assert(idx == i);
-            idx = bm::sse4_gap_find(buf, v - 1, vsize);
-            assert(idx == i);
+            bv.set(i);
+        }
+        if (i > vector_max)
+            break;
+        // generate GAP (compressed) blocks
+        for (j = 0; j < 65535; i += 120, j++)
+        {
+            unsigned len = rand() % 64;
+            bv.set_range(i, i + len);
+            i += len;
+            if (i > vector_max)
+                break;
         }
     }
+}
 
+extern "C" {
+    static
+    int bit_decode_func(void* handle_ptr, bm::id_t bit_idx)
     {
-        unsigned short buf[16] = { 1, 2, 10, 256, 258, 15525, 65530, 127, 255, 256, 1000, 2000, 2001, 2005, 0xFF, };
-        const unsigned vsize = 7;
-        idx = bm::sse4_gap_find(buf, 0, vsize);
-        assert(idx == 0);
-        idx = bm::sse4_gap_find(buf, 65535, vsize);
-        assert(idx == vsize);
+        std::vector<bm::id_t>* vp = (std::vector<bm::id_t>*)handle_ptr;
+        vp->push_back(bit_idx);
+        return 0;
+    }
+} // extern C
 
-        for (unsigned i = 0; i < vsize; ++i)
+
+static
+void BvectorBitForEachTest()
+{
+    cout << "------------------------ bvector BitForEach Test" << endl;
+    int res;
+    
+    {
+        cout << "test empty vector" << endl;
+        bvect bv1;
+        std::vector<unsigned> v1;
+        
+        bm::visit_each_bit(bv1, (void*)&v1, bit_decode_func);
+        if (v1.size())
         {
-            unsigned short v = buf[i];
-            idx = bm::sse4_gap_find(buf, v, vsize);
-            assert(idx == i);
-            idx = bm::sse4_gap_find(buf, v - 1, vsize);
-            assert(idx == i || (buf[i-1] == v-1));
+            cerr << "1. Failed empty vector decode " << v1.size() << endl;
+            exit(1);
+        }
+        bv1.init();
+        bm::visit_each_bit(bv1, (void*)&v1, bit_decode_func);
+        if (v1.size())
+        {
+            cerr << "2. Failed empty vector decode " << v1.size() << endl;
+            exit(1);
+        }
+        
+        bv1.set(100000, true);
+        bv1.set(100000, false);
+        
+        bm::visit_each_bit(bv1, (void*)&v1, bit_decode_func);
+        if (v1.size())
+        {
+            cerr << "3. Failed empty vector decode " << v1.size() << endl;
+            exit(1);
+        }
+
+        bv1.optimize();
+        bm::visit_each_bit(bv1, (void*)&v1, bit_decode_func);
+        if (v1.size())
+        {
+            cerr << "3. Failed empty vector decode " << v1.size() << endl;
+            exit(1);
         }
     }
+    
     {
-    unsigned short buf[16] = { 1, 2, 10, 256,  258, 1024, 15525, 65530,  127, 255, 256, 0xFF, };
-    const unsigned vsize = 8;
-    idx = bm::sse4_gap_find(buf, 0, vsize);
-    assert(idx == 0);
-    idx = bm::sse4_gap_find(buf, 65535, vsize);
-    assert(idx == vsize);
-    for (unsigned i = 0; i < vsize; ++i)
-    {
-        unsigned short v = buf[i];
-        if (i == vsize - 1)
+        bvect bv1 { 0,1,2, 10, 32, 100, 65535,
+                            65535+1, 65535+2, 65535+10, 65535+11, 65535+31,
+                            20000000 };
+        bvect bv2;
+        std::vector<unsigned> v1;
+        
+        bm::visit_each_bit(bv1, (void*)&v1, bit_decode_func);
+
         {
-            assert(v != 65535);
+            for (size_t i = 0; i < v1.size(); ++i)
+                cout << v1[i] << ", ";
+            cout << endl;
         }
-        idx = bm::sse4_gap_find(buf, v, vsize);
-        assert(idx == i);
-        idx = bm::sse4_gap_find(buf, v - 1, vsize);
-        assert(idx == i || (buf[i - 1] == v - 1));
-    }
+
+        if (v1.size() != bv1.count())
+        {
+            std::cerr << "0. Bit for each failed size test. " << v1.size()
+                      << " should be " << bv1.count() << std::endl;
+            exit(1);
+        }
+        bm::combine_or(bv2, v1.begin(), v1.end());
+        
+        res = bv2.compare(bv1);
+        if (res != 0)
+        {
+            std::cerr << "0. Bit for each failed comparison test. " << endl;
+            exit(1);
+        }
+        
+        bv1.optimize();
+        bv2.reset();
+        v1.resize(0);
+        bm::visit_each_bit(bv1, (void*)&v1, bit_decode_func);
+        
+        {
+            for (size_t i = 0; i < v1.size(); ++i)
+                cout << v1[i] << ", ";
+            cout << endl;
+        }
+
+        if (v1.size() != bv1.count())
+        {
+            std::cerr << "1. Bit for each failed size test. " << v1.size()
+                      << " should be " << bv1.count() << std::endl;
+            exit(1);
+        }
+        bm::combine_or(bv2, v1.begin(), v1.end());
+        
+        res = bv2.compare(bv1);
+        if (res != 0)
+        {
+            std::cerr << "1. Bit for each failed comparison test. " << endl;
+            exit(1);
+        }
+
     }
+    
+    {
+        bvect bv1, bv2;
+        std::vector<unsigned> v1;
+        
+        generate_bvector(bv1);
+        v1.reserve(bv1.count());
+        
+        bm::visit_each_bit(bv1, (void*)&v1, bit_decode_func);
+
+        if (v1.size() != bv1.count())
+        {
+            std::cerr << "Bit for each failed size test. " << v1.size()
+                      << " should be " << bv1.count() << std::endl;
+            exit(1);
+        }
+        bm::combine_or(bv2, v1.begin(), v1.end());
+        
+        res = bv2.compare(bv1);
+        if (res != 0)
+        {
+            std::cerr << "Bit for each failed comparison test. " << endl;
+            exit(1);
+        }
+
+        cout << "for each bit in optimized bit-vector..." << endl;
+        
+        v1.resize(0);
+        bv2.clear(true);
+        bv1.optimize();
 
-    {
-        unsigned short buf[16] = { 6217, 6300, 6400, 6500,  
-                                   6600, 6700, 30584, 40255, 
-                                   50256, 60000, 61001, 65255, 65530, 12, 23, 0,  };
-        const unsigned vsize = 13;
-        idx = bm::sse4_gap_find(buf, 0, vsize);
-        assert(idx == 0);
-        idx = bm::sse4_gap_find(buf, 65535, vsize);
-        assert(idx == vsize);
+        bm::visit_each_bit(bv1, (void*)&v1, bit_decode_func);
 
-        for (unsigned i = 0; i < vsize; ++i)
+        if (v1.size() != bv1.count())
         {
-            unsigned short v = buf[i];
-            if (i == vsize - 1)
-            {
-                assert(v != 65535);
-            }
-            idx = bm::sse4_gap_find(buf, v, vsize);
-            assert(idx == i);
-            idx = bm::sse4_gap_find(buf, v - 1, vsize);
-            assert(idx == i || (buf[i - 1] == v - 1));
+            std::cerr << "Bit for each failed size test. " << v1.size()
+                      << " should be " << bv1.count() << std::endl;
+            exit(1);
         }
-    }
-
-    {
-        unsigned short buf[16] = { 6217, 6300, 6400, 6500,
-            6600, 6700, 30584, 40255,
-            50256, 60000, 61001, 65255, 
-            65256, 65257, 65300, 65530  };
-        const unsigned vsize = 16;
-        idx = bm::sse4_gap_find(buf, 0, vsize);
-        assert(idx == 0);
-        idx = bm::sse4_gap_find(buf, 65535, vsize);
-        assert(idx == 16);
-        for (unsigned i = 0; i < vsize; ++i)
+        bm::combine_or(bv2, v1.begin(), v1.end());
+        
+        res = bv2.compare(bv1);
+        if (res != 0)
         {
-            unsigned short v = buf[i];
-            if (i == vsize - 1)
-            {
-                assert(v != 65535);
-            }
-            idx = bm::sse4_gap_find(buf, v, vsize);
-            assert(idx == i);
-            idx = bm::sse4_gap_find(buf, v - 1, vsize);
-            assert(idx == i || (buf[i - 1] == v - 1));
+            std::cerr << "Bit for each failed comparison test. " << endl;
+            exit(1);
         }
     }
+    
+    
+    cout << "------------------------ bvector BitForEach Test OK" << endl;
+}
 
-#endif
-
-#if defined(BMAVX2OPT)
-    cout << "----------------------------> [ AVX2 ]" << endl;
+static
+void FillTestBuffer(bm::compressed_buffer_collection<bvect>::buffer_type& buf)
+{
+    unsigned sz_factor = rand() % 10;
+    if (!sz_factor)
+        sz_factor = 1;
+    unsigned size = 65000 + (128000 / sz_factor);
     
+    buf.resize(size);
+    unsigned char* data = buf.data();
+    
+    for (unsigned i = 0; i < size; ++i)
     {
-        BM_DECLARE_TEMP_BLOCK(tb)
-        for (unsigned i = 0; i < bm::set_block_size; ++i)
-        {
-            tb[i] = 0;
-        }
-        bool all_z = avx2_is_all_zero((__m256i*)tb, (__m256i*)(tb + bm::set_block_size));
-        assert(all_z);
-        
-        tb[256] = 1;
-        all_z = avx2_is_all_zero((__m256i*)tb, (__m256i*)(tb + bm::set_block_size));
-        assert(!all_z);
+        data[i] = (unsigned char)i;
     }
+}
 
+static
+void GenerateCompressedBufferCollection(bm::compressed_buffer_collection<bvect>& cbc)
+{
+    unsigned sz = rand() % 10000;
+    unsigned key = 0;
+    unsigned key_factor = rand() % 128;
+    if (!key_factor)
+        key_factor = 1;
+    for (unsigned i = 0; i < sz; ++i)
     {
-        BM_DECLARE_TEMP_BLOCK(tb)
-        for (unsigned i = 0; i < bm::set_block_size; ++i)
         {
-            tb[i] = ~0u;
+            bm::compressed_buffer_collection<bvect>::buffer_type buf;
+            FillTestBuffer(buf);
+            cbc.move_buffer(key, buf);
         }
-        bool all_one = avx2_is_all_one((__m256i*)tb, (__m256i*)(tb + bm::set_block_size));
-        assert(all_one);
-        
-        tb[256] = 1;
-        all_one = avx2_is_all_one((__m256i*)tb, (__m256i*)(tb + bm::set_block_size));
-        assert(!all_one);
-    }
-#endif
-    cout << "------------------------ Test SIMD Utils OK" << endl;
+        key += key_factor;
+    } // for
+    cbc.sync();
 }
 
 static
-void AddressResolverTest()
+void TestCompressedCollection()
 {
-    bm::id_t id_to;
-    bool found;
+    cout << "------------------------ Compressed collection Test" << endl;
     
     {
-        bvps_addr_resolver<bvect>  ares;
+        bm::compressed_collection<unsigned, bvect> coll;
+        bool added;
+        unsigned v;
         
-        found = ares.resolve(10, &id_to);
+        added = coll.push_back(0, 100);
+        assert(added);
+        added = coll.push_back(10, 5);
+        assert(added);
+        added = coll.push_back(150000, 500);
+        assert(added);
+        
+        coll.sync();
+        
+        bool found;
+        bm::id_t idx;
+        
+        found = coll.resolve(0, &idx);
+        assert(found);
+        v = coll.get(idx);
+        assert(v == 100);
+
+        found = coll.resolve(10, &idx);
+        assert(found);
+        v = coll.get(idx);
+        assert(v == 5);
+
+        found = coll.resolve(150000, &idx);
+        assert(found);
+        v = coll.get(idx);
+        assert(v == 500);
+
+        found = coll.resolve(256, &idx);
         assert(!found);
-        assert(id_to == 0);
         
-        bvps_addr_resolver<bvect>  ares2(ares);
+        coll.optimize();
         
-        found = ares2.resolve(10, &id_to);
+        found = coll.resolve(0, &idx);
+        assert(found);
+        v = coll.get(idx);
+        assert(v == 100);
+
+        found = coll.resolve(10, &idx);
+        assert(found);
+        v = coll.get(idx);
+        assert(v == 5);
+
+        found = coll.resolve(150000, &idx);
+        assert(found);
+        v = coll.get(idx);
+        assert(v == 500);
+
+        found = coll.resolve(256, &idx);
         assert(!found);
-        assert(id_to == 0);
+
+    }
+    
+    {
+    bm::compressed_buffer_collection<bvect> cbc;
+    {
+        bm::compressed_buffer_collection<bvect>::buffer_type buf;
+        buf.copy_from((unsigned char*)"ABC", 3);
+        cbc.move_buffer(10, buf);
+    }
+    {
+        bm::compressed_buffer_collection<bvect>::buffer_type buf;
+        buf.copy_from((unsigned char*)"1234", 4);
+        cbc.move_buffer(15, buf);
+    }
+    cbc.sync();
+    
+    assert(cbc.size() == 2);
+    bm::compressed_buffer_collection<bvect>::statistics st;
+    cbc.calc_stat(&st);
+    
+    bm::compressed_collection_serializer<compressed_buffer_collection<bvect> > cbcs;
+    bm::compressed_buffer_collection<bvect>::buffer_type sbuf;
+    
+    cbcs.serialize(cbc, sbuf);
+    assert(sbuf.size() > 0);
+    
+    bm::compressed_buffer_collection<bvect>::buffer_type sbuf2(sbuf);
+    bm::compressed_buffer_collection<bvect> cbc2;
+    compressed_collection_deserializer<compressed_buffer_collection<bvect> > cbcd;
+    cbcd.deserialize(cbc2, sbuf2.buf());
+    
+    if (!cbc2.equal(cbc))
+    {
+        std::cerr << "Compressed collection serialization error" << endl;
+        exit(1);
     }
 
+    }
+    
     {
-        bvps_addr_resolver<bvect>  ares;
-        
-        ares.set(1000);
-        ares.set(10000);
-        ares.set(100000);
-        
-        found = ares.resolve(10, &id_to);
-        assert(!found);
-        assert(id_to == 0);
+        cout << "Compressed buffer collection stress." << endl;
+        const unsigned test_count = 160;
+        for (unsigned i = 0; i < test_count; ++i)
+        {
+            bm::compressed_buffer_collection<bvect> cbc1;
+            bm::compressed_buffer_collection<bvect> cbc2;
+            
+            GenerateCompressedBufferCollection(cbc1);
 
-        found = ares.resolve(100000, &id_to);
-        assert(found);
-        assert(id_to == 3);
-        
-        assert(ares.in_sync() == false);
-        
-        ares.optimize();
-        assert(ares.in_sync() == false);
-        
-        ares.sync();
-        assert(ares.in_sync());
+            bm::compressed_buffer_collection<bvect>::statistics st;
+            cbc1.calc_stat(&st);
+            
+            bm::compressed_collection_serializer<compressed_buffer_collection<bvect> > cbcs;
+            bm::compressed_buffer_collection<bvect>::buffer_type sbuf;
+    
+            cbcs.serialize(cbc1, sbuf);
+            
+            bm::compressed_buffer_collection<bvect>::buffer_type sbuf2(sbuf);
+            sbuf.release();
+
+            compressed_collection_deserializer<compressed_buffer_collection<bvect> > cbcd;
+            cbcd.deserialize(cbc2, sbuf2.buf());
+            
+            if (!cbc2.equal(cbc1))
+            {
+                std::cerr << "Compressed collection serialization error at step " << i << endl;
+                exit(1);
+            }
 
-        found = ares.resolve(100000, &id_to);
-        assert(found);
-        assert(id_to == 3);
-        
-        bvps_addr_resolver<bvect>  ares2(ares);
-        bool same = ares.equal(ares2);
-        assert(same);
-        
-        bvps_addr_resolver<bvect>  ares3;
-        ares3.move_from(ares2);
-        same = ares.equal(ares3);
-        assert(same);
 
-    }
-    
-    {
-        sv_addr_resolver<sparse_vector<bm::id_t, bvect> > ares;
+            cout << "\r" << i << " of " << test_count << flush;
+        } // for
         
-        found = ares.resolve(10, &id_to);
-        assert(!found);
-        assert(id_to == 0);
+        cout << endl;
     }
     
-    {
-        sv_addr_resolver<sparse_vector<bm::id_t, bvect> > ares;
-        
-        ares.set(1000);  // 1
-        ares.set(10000); // 2
-        ares.set(100000); // 3
-        ares.set(5);      // 4
-        
-        found = ares.resolve(10, &id_to);
-        assert(!found);
-        assert(id_to == 0);
-        
-        found = ares.resolve(1000, &id_to);
-        assert(found);
-        assert(id_to == 1);
-
-        found = ares.resolve(10000, &id_to);
-        assert(found);
-        assert(id_to == 2);
-        
-        ares.optimize();
-        
-        found = ares.resolve(5, &id_to);
-        assert(found);
-        assert(id_to == 4);
-
-    }
-
     
+    cout << "------------------------ Compressed collection Test OK" << endl;
 }
 
-// generate pseudo-random bit-vector, mix of blocks
-//
-void generate_bvector(bvect& bv, unsigned vector_max)
+static
+void GenerateAggregatorVector(bvect& bv, unsigned max_block)
 {
-    unsigned i, j;
-    for (i = 0; i < vector_max;)
+    switch (rand() % 4)
     {
-        // generate bit-blocks
-        for (j = 0; j < 65535*8; i += 10, j++)
+    case 0: // sparse random bits
+        for (unsigned i = 0; i < max_block * 200; ++i)
+            bv.set(unsigned(rand()) % (max_block * 65536));
+        break;
+    case 1: // dense random bits
+        for (unsigned i = 0; i < max_block * 65536; ++i)
         {
-            bv.set(i);
+            if (rand() % 3)
+                bv.set(i);
         }
-        if (i > vector_max)
-            break;
-        // generate GAP (compressed) blocks
-        for (j = 0; j < 65535; i += 120, j++)
+        break;
+    case 2: // ranges (GAP and FULL blocks)
+        for (unsigned i = 0; i < 10; ++i)
         {
-            unsigned len = rand() % 64;
-            bv.set_range(i, i + len);
-            i += len;
-            if (i > vector_max)
-                break;
+            unsigned from = unsigned(rand()) % (max_block * 65536);
+            unsigned to = from + unsigned(rand()) % (65536 * 3);
+            bv.set_range(from, to);
         }
+        break;
+    default: // all ones with holes
+        bv.set_range(0, max_block * 65536);
+        for (unsigned i = 0; i < 20; ++i)
+            bv.set(unsigned(rand()) % (max_block * 65536), false);
+        break;
     }
+    if (rand() % 2)
+        bv.optimize();
 }
 
-extern "C" {
-    static
-    int bit_decode_func(void* handle_ptr, bm::id_t bit_idx)
+static
+void CheckAggregatorResult(const bvect& bv_target, const bvect& bv_control,
+                           const char* op_name)
+{
+    int res = bv_control.compare(bv_target);
+    if (res != 0)
     {
-        std::vector<bm::id_t>* vp = (std::vector<bm::id_t>*)handle_ptr;
-        vp->push_back(bit_idx);
-        return 0;
+        cerr << "Aggregator " << op_name << " check failed!" << endl;
+        cerr << "target count=" << bv_target.count()
+             << " control count=" << bv_control.count() << endl;
+        exit(1);
     }
-} // extern C
-
+}
 
 static
-void BvectorBitForEachTest()
+void AggregatorTest()
 {
-    cout << "------------------------ bvector BitForEach Test" << endl;
-    int res;
-    
+    cout << "---------------------------- Aggregator Test" << endl;
+
+    {
+        bm::aggregator<bvect> agg;
+        bvect bv_target;
+        bv_target.set(10);
+        agg.combine_or(bv_target);
+        assert(bv_target.count() == 0);
+        bv_target.set(10);
+        agg.combine_and(bv_target);
+        assert(bv_target.count() == 0);
+
+        bvect bv1, bv2, bv3;
+        bv1.set(1); bv1.set(65536 * 3); bv1.set(bm::id_max - 1);
+        bv2.set(1); bv2.set(65536 * 3 + 1); bv2.set(bm::id_max - 1);
+        bv3.set_range(0, 65536 * 4);
+
+        agg.add(&bv1);
+        agg.combine_or(bv_target);
+        CheckAggregatorResult(bv_target, bv1, "OR(1)");
+        agg.combine_and(bv_target);
+        CheckAggregatorResult(bv_target, bv1, "AND(1)");
+
+        agg.add(&bv2);
+        agg.add(&bv3);
+        agg.combine_or(bv_target);
+        {
+            bvect bv_control(bv1);
+            bv_control |= bv2;
+            bv_control |= bv3;
+            CheckAggregatorResult(bv_target, bv_control, "OR(3)");
+        }
+        agg.combine_and(bv_target);
+        assert(bv_target.count() == 1);
+        assert(bv_target.test(1));
+
+        agg.reset();
+        agg.add(&bv3);
+        agg.add(&bv3);
+        agg.combine_and(bv_target);
+        CheckAggregatorResult(bv_target, bv3, "AND(FULL)");
+
+        agg.add(&bv1, 1);
+        bool any = agg.combine_and_sub(bv_target);
+        assert(any);
+        {
+            bvect bv_control(bv3);
+            bv_control -= bv1;
+            CheckAggregatorResult(bv_target, bv_control, "AND-SUB(FULL)");
+        }
+        bm::id_t first;
+        bool found = agg.find_first_and_sub(first);
+        assert(found && first == 0);
+
+        agg.add(&bv3, 1);
+        any = agg.combine_and_sub(bv_target);
+        assert(!any);
+        assert(!bv_target.any());
+        found = agg.find_first_and_sub(first);
+        assert(!found);
+    }
+
+    const unsigned test_count = 30;
+    const unsigned max_args = 40;
+    for (unsigned k = 0; k < test_count; ++k)
     {
-        cout << "test empty vector" << endl;
-        bvect bv1;
-        std::vector<unsigned> v1;
-        
-        bm::visit_each_bit(bv1, (void*)&v1, bit_decode_func);
-        if (v1.size())
+        unsigned arg_cnt = 1 + unsigned(rand()) % max_args;
+        unsigned max_block = 1 + unsigned(rand()) % 16;
+        std::vector<bvect*> bv_args;
+        std::vector<const bvect*> bv_cargs;
+        bm::aggregator<bvect> agg;
+        for (unsigned i = 0; i < arg_cnt; ++i)
         {
-            cerr << "1. Failed empty vector decode " << v1.size() << endl;
-            exit(1);
+            bvect* bv = new bvect(BM_GAP);
+            GenerateAggregatorVector(*bv, max_block);
+            bv_args.push_back(bv);
+            bv_cargs.push_back(bv);
+            agg.add(bv);
         }
-        bv1.init();
-        bm::visit_each_bit(bv1, (void*)&v1, bit_decode_func);
-        if (v1.size())
+
+        bvect bv_or_control, bv_and_control(*bv_args[0]);
+        for (unsigned i = 0; i < arg_cnt; ++i)
         {
-            cerr << "2. Failed empty vector decode " << v1.size() << endl;
-            exit(1);
+            bv_or_control |= *bv_args[i];
+            bv_and_control &= *bv_args[i];
         }
-        
-        bv1.set(100000, true);
-        bv1.set(100000, false);
-        
-        bm::visit_each_bit(bv1, (void*)&v1, bit_decode_func);
-        if (v1.size())
+
+        bvect bv_target;
+        agg.combine_or(bv_target);
+        CheckAggregatorResult(bv_target, bv_or_control, "OR");
+        agg.combine_and(bv_target);
+        CheckAggregatorResult(bv_target, bv_and_control, "AND");
+
+        bm::aggregator<bvect> agg2;
+        bvect bv_target2(BM_GAP);
+        agg2.combine_or(bv_target2, &bv_cargs[0], arg_cnt);
+        CheckAggregatorResult(bv_target2, bv_or_control, "OR(array)");
+        agg2.combine_and(bv_target2, &bv_cargs[0], arg_cnt);
+        CheckAggregatorResult(bv_target2, bv_and_control, "AND(array)");
+
+        // AND-SUB: first half of arguments is AND group, rest is SUB group
         {
-            cerr << "3. Failed empty vector decode " << v1.size() << endl;
-            exit(1);
+            unsigned and_cnt = (arg_cnt + 1) / 2;
+            unsigned sub_cnt = arg_cnt - and_cnt;
+            bm::aggregator<bvect> agg3;
+            bvect bv_control(*bv_args[0]);
+            for (unsigned i = 0; i < arg_cnt; ++i)
+            {
+                if (i < and_cnt)
+                {
+                    agg3.add(bv_args[i]);
+                    bv_control &= *bv_args[i];
+                }
+                else
+                {
+                    agg3.add(bv_args[i], 1);
+                    bv_control -= *bv_args[i];
+                }
+            }
+            bool any = agg3.combine_and_sub(bv_target);
+            CheckAggregatorResult(bv_target, bv_control, "AND-SUB");
+            assert(any == bv_control.any());
+
+            bvect bv_target3;
+            any = agg2.combine_and_sub(bv_target3,
+                                       &bv_cargs[0], and_cnt,
+                                       sub_cnt ? &bv_cargs[and_cnt] : 0, sub_cnt,
+                                       false);
+            CheckAggregatorResult(bv_target3, bv_control, "AND-SUB(array)");
+
+            any = agg3.combine_and_sub(bv_target3, true);
+            assert(any == bv_control.any());
+            {
+                bvect bv_sub(bv_target3);
+                bv_sub -= bv_control;
+                assert(!bv_sub.any()); // any result must be a subset
+            }
+            bm::id_t first;
+            bool found = agg3.find_first_and_sub(first);
+            assert(found == bv_control.any());
+            if (found)
+            {
+                assert(first == bv_control.get_first());
+                assert(bv_target3.get_first() == first);
+            }
         }
 
-        bv1.optimize();
-        bm::visit_each_bit(bv1, (void*)&v1, bit_decode_func);
-        if (v1.size())
+        for (unsigned i = 0; i < arg_cnt; ++i)
+            delete bv_args[i];
+
+        cout << "\r" << k << " of " << test_count << flush;
+    } // for k
+    cout << endl;
+
+    cout << "---------------------------- Aggregator Test OK" << endl;
+}
+
+// parallel operations use the default (thread safe) allocator,
+// debug allocator counters are not thread safe
+typedef bm::bvector<> bvect_mt;
+
+template<class BV>
+void GenerateParallelTestVector(BV& bv, unsigned max_top)
+{
+    unsigned max_block = max_top * bm::set_array_size;
+    for (unsigned k = 0; k < 64; ++k)
+    {
+        unsigned base = (unsigned(rand()) % max_block) * 65536;
+        switch (rand() % 4)
         {
-            cerr << "3. Failed empty vector decode " << v1.size() << endl;
-            exit(1);
+        case 0: // sparse random bits
+            for (unsigned i = 0; i < 100; ++i)
+                bv.set(base + unsigned(rand()) % 65536);
+            break;
+        case 1: // dense random bits
+            for (unsigned i = 0; i < 65536; ++i)
+            {
+                if (rand() % 3)
+                    bv.set(base + i);
+            }
+            break;
+        case 2: // range (GAP and FULL blocks)
+            bv.set_range(base + unsigned(rand()) % 65536,
+                         base + unsigned(rand()) % (65536 * 3));
+            break;
+        default: // full block
+            bv.set_range(base, base + 65535);
+            break;
         }
     }
-    
-    {
-        bvect bv1 { 0,1,2, 10, 32, 100, 65535,
-                            65535+1, 65535+2, 65535+10, 65535+11, 65535+31,
-                            20000000 };
-        bvect bv2;
-        std::vector<unsigned> v1;
-        
-        bm::visit_each_bit(bv1, (void*)&v1, bit_decode_func);
+    if (rand() % 2)
+        bv.optimize();
+}
 
-        {
-            for (size_t i = 0; i < v1.size(); ++i)
-                cout << v1[i] << ", ";
-            cout << endl;
-        }
+static
+void CheckParallelResult(const bvect_mt& bv_target, const bvect_mt& bv_control,
+                         const char* op_name)
+{
+    int res = bv_control.compare(bv_target);
+    if (res != 0)
+    {
+        cerr << "Parallel " << op_name << " check failed!" << endl;
+        cerr << "target count=" << bv_target.count()
+             << " control count=" << bv_control.count() << endl;
+        exit(1);
+    }
+}
 
-        if (v1.size() != bv1.count())
-        {
-            std::cerr << "0. Bit for each failed size test. " << v1.size()
-                      << " should be " << bv1.count() << std::endl;
-            exit(1);
-        }
-        bm::combine_or(bv2, v1.begin(), v1.end());
-        
-        res = bv2.compare(bv1);
-        if (res != 0)
-        {
-            std::cerr << "0. Bit for each failed comparison test. " << endl;
-            exit(1);
-        }
-        
-        bv1.optimize();
-        bv2.reset();
-        v1.resize(0);
-        bm::visit_each_bit(bv1, (void*)&v1, bit_decode_func);
-        
-        {
-            for (size_t i = 0; i < v1.size(); ++i)
-                cout << v1[i] << ", ";
-            cout << endl;
-        }
+static
+void ParallelOperationsTest()
+{
+    cout << "---------------------------- Parallel operations Test" << endl;
 
-        if (v1.size() != bv1.count())
-        {
-            std::cerr << "1. Bit for each failed size test. " << v1.size()
-                      << " should be " << bv1.count() << std::endl;
-            exit(1);
-        }
-        bm::combine_or(bv2, v1.begin(), v1.end());
-        
-        res = bv2.compare(bv1);
-        if (res != 0)
-        {
-            std::cerr << "1. Bit for each failed comparison test. " << endl;
-            exit(1);
-        }
+    {
+        bm::std_thread_executor tpool(4);
+        bvect_mt bv1, bv2;
+        bm::bit_or_mt(bv1, bv2, tpool);
+        assert(!bv1.any());
+        assert(bm::count_mt(bv1, tpool) == 0);
+        bm::optimize_mt(bv1, tpool);
 
+        bv2.set(10); bv2.set(bm::id_max - 1);
+        bm::bit_and_mt(bv1, bv2, tpool);
+        assert(!bv1.any());
+        bm::bit_or_mt(bv1, bv2, tpool);
+        CheckParallelResult(bv1, bv2, "OR(empty)");
+        bm::bit_xor_mt(bv1, bv2, tpool);
+        assert(!bv1.any());
     }
-    
+
+    const unsigned test_count = 20;
+    for (unsigned k = 0; k < test_count; ++k)
     {
-        bvect bv1, bv2;
-        std::vector<unsigned> v1;
-        
-        generate_bvector(bv1);
-        v1.reserve(bv1.count());
-        
-        bm::visit_each_bit(bv1, (void*)&v1, bit_decode_func);
+        bm::std_thread_executor tpool(1 + unsigned(rand()) % 8);
+        bvect_mt bv1, bv2;
+        GenerateParallelTestVector(bv1, 1 + unsigned(rand()) % 40);
+        GenerateParallelTestVector(bv2, 1 + unsigned(rand()) % 40);
+        if (rand() % 4 == 0)
+            bv2.resize(1 + unsigned(rand()) % (40 * 256 * 65536));
 
-        if (v1.size() != bv1.count())
-        {
-            std::cerr << "Bit for each failed size test. " << v1.size()
-                      << " should be " << bv1.count() << std::endl;
-            exit(1);
-        }
-        bm::combine_or(bv2, v1.begin(), v1.end());
-        
-        res = bv2.compare(bv1);
-        if (res != 0)
+        for (unsigned op = 0; op < 4; ++op)
         {
-            std::cerr << "Bit for each failed comparison test. " << endl;
-            exit(1);
-        }
+            bvect_mt bv_target(bv1);
+            bvect_mt bv_control(bv1);
+            const char* op_name;
+            switch (op)
+            {
+            case 0:
+                bm::bit_or_mt(bv_target, bv2, tpool);
+                bv_control.bit_or(bv2);
+                op_name = "OR";
+                break;
+            case 1:
+                bm::bit_and_mt(bv_target, bv2, tpool);
+                bv_control.bit_and(bv2);
+                op_name = "AND";
+                break;
+            case 2:
+                bm::bit_xor_mt(bv_target, bv2, tpool);
+                bv_control.bit_xor(bv2);
+                op_name = "XOR";
+                break;
+            default:
+                bm::bit_sub_mt(bv_target, bv2, tpool);
+                bv_control.bit_sub(bv2);
+                op_name = "SUB";
+                break;
+            }
+            CheckParallelResult(bv_target, bv_control, op_name);
+            assert(bv_target.size() == bv_control.size());
 
-        cout << "for each bit in optimized bit-vector..." << endl;
-        
-        v1.resize(0);
-        bv2.clear(true);
-        bv1.optimize();
+            bm::id_t cnt = bm::count_mt(bv_target, tpool);
+            assert(cnt == bv_control.count());
+
+            bm::optimize_mt(bv_target, tpool);
+            CheckParallelResult(bv_target, bv_control, "optimize");
+            assert(bm::count_mt(bv_target, tpool) == cnt);
+
+            bm::serializer<bvect_mt>::buffer buf;
+            bm::serialize_mt(bv_target, buf, tpool, unsigned(rand()) % 1024);
+            {
+                bvect_mt bv_deser;
+                size_t size = bm::deserialize_mt(bv_deser, buf.buf(), tpool);
+                assert(size == buf.size());
+                CheckParallelResult(bv_deser, bv_control, "serialize_mt");
+                assert(bv_deser.size() == bv_control.size());
+            }
+            {
+                bvect_mt bv_deser;
+                bm::deserialize(bv_deser, buf.buf());
+                CheckParallelResult(bv_deser, bv_control, "deserialize");
+            }
+        } // for op
+
+        cout << "\r" << k << " of " << test_count << flush;
+    } // for k
+    cout << endl;
 
-        bm::visit_each_bit(bv1, (void*)&v1, bit_decode_func);
+    cout << "---------------------------- Parallel operations Test OK" << endl;
+}
 
-        if (v1.size() != bv1.count())
+static
+void CheckChunkedSerialization(const bvect& bv, unsigned chunk_blocks)
+{
+    bm::serializer<bvect>::buffer buf;
+    bm::serialize_chunked(bv, buf, chunk_blocks);
+
+    {
+        bvect bv2;
+        unsigned size = bm::deserialize(bv2, buf.buf());
+        assert(size == buf.size());
+        int res = bv.compare(bv2);
+        if (res != 0)
         {
-            std::cerr << "Bit for each failed size test. " << v1.size()
-                      << " should be " << bv1.count() << std::endl;
+            cerr << "Chunked serialization check failed!" << endl;
             exit(1);
         }
-        bm::combine_or(bv2, v1.begin(), v1.end());
-        
-        res = bv2.compare(bv1);
+    }
+    if (bv.size() != bm::id_max) // resized vector restores its size
+    {
+        bvect bv2;
+        bv2.resize(1);
+        bm::deserialize(bv2, buf.buf());
+        assert(bv2.size() == bv.size());
+    }
+    // deserialization ORs into the target
+    {
+        bvect bv2;
+        bv2.set(0); bv2.set(65536 * 256 * 2 + 1);
+        bvect bv_control(bv);
+        bv_control |= bv2;
+        bm::deserialize(bv2, buf.buf());
+        int res = bv_control.compare(bv2);
         if (res != 0)
         {
-            std::cerr << "Bit for each failed comparison test. " << endl;
+            cerr << "Chunked serialization OR check failed!" << endl;
             exit(1);
         }
     }
-    
-    
-    cout << "------------------------ bvector BitForEach Test OK" << endl;
+    // chunks are independent streams of the regular format
+    {
+        bm::chunked_deserializer<bvect> bv_deserial;
+        unsigned chunk_count = bv_deserial.read_directory(buf.buf());
+        bvect bv_control;
+        for (unsigned k = 0; k < chunk_count; ++k)
+        {
+            const bm::serial_chunk& chunk = bv_deserial.get_chunk(k);
+            assert(chunk.nb_from < chunk.nb_to);
+            assert((chunk.nb_from % bm::set_array_size) == 0);
+            if (k)
+                assert(bv_deserial.get_chunk(k-1).nb_to <= chunk.nb_from);
+
+            bvect bv_chunk;
+            bm::deserialize(bv_chunk, buf.buf() + chunk.offset);
+            bvect bv_range(bv);
+            bm::id_t from = bm::id_t(chunk.nb_from) * 65536;
+            bm::id_t last = bm::id_t(chunk.nb_to - 1) * 65536 + 65535;
+            if (from)
+                bv_range.set_range(0, from - 1, false);
+            if (last < bv.size() - 1)
+                bv_range.set_range(last + 1, bv.size() - 1, false);
+            assert(bv_range.compare(bv_chunk) == 0);
+            bv_control |= bv_chunk;
+        }
+        assert(bv_control.compare(bv) == 0);
+        assert(bv_deserial.size() == buf.size());
+    }
 }
 
 static
-void FillTestBuffer(bm::compressed_buffer_collection<bvect>::buffer_type& buf)
+void ChunkedSerializationTest()
 {
-    unsigned sz_factor = rand() % 10;
-    if (!sz_factor)
-        sz_factor = 1;
-    unsigned size = 65000 + (128000 / sz_factor);
-    
-    buf.resize(size);
-    unsigned char* data = buf.data();
-    
-    for (unsigned i = 0; i < size; ++i)
+    cout << "---------------------------- Chunked serialization Test" << endl;
+
     {
-        data[i] = (unsigned char)i;
+        bvect bv;
+        CheckChunkedSerialization(bv, 0);
+        bv.resize(100);
+        CheckChunkedSerialization(bv, 0);
+        bv.set(10);
+        CheckChunkedSerialization(bv, 0);
+        bv.resize(bm::id_max);
+        bv.set(bm::id_max - 1);
+        bv.set_range(65536 * 256, 65536 * 256 * 3 + 10);
+        CheckChunkedSerialization(bv, 0);
+        CheckChunkedSerialization(bv, 256 * 2);
+        bv.invert();
+        CheckChunkedSerialization(bv, 0);
     }
+
+    const unsigned test_count = 20;
+    for (unsigned k = 0; k < test_count; ++k)
+    {
+        bvect bv;
+        GenerateParallelTestVector(bv, 1 + unsigned(rand()) % 40);
+        if (rand() % 4 == 0)
+            bv.resize(1 + unsigned(rand()) % (40 * 256 * 65536));
+        CheckChunkedSerialization(bv, 0);
+        CheckChunkedSerialization(bv, unsigned(rand()) % (256 * 8));
+
+        cout << "\r" << k << " of " << test_count << flush;
+    } // for k
+    cout << endl;
+
+    cout << "---------------------------- Chunked serialization Test OK" << endl;
 }
 
 static
-void GenerateCompressedBufferCollection(bm::compressed_buffer_collection<bvect>& cbc)
+void CheckRangeDeserialization(const bvect& bv, 
+                               const bm::serializer<bvect>::buffer& buf,
+                               bm::id_t from, bm::id_t to)
 {
-    unsigned sz = rand() % 10000;
-    unsigned key = 0;
-    unsigned key_factor = rand() % 128;
-    if (!key_factor)
-        key_factor = 1;
-    for (unsigned i = 0; i < sz; ++i)
-    {
+    bvect bv_range(bv);
+    bm::id_t last = bv.size() - 1;
+    if (from)
+        bv_range.set_range(0, from - 1, false);
+    if (to < last)
+        bv_range.set_range(to + 1, last, false);
+
+    bvect bv_target;
+    bv_target.set(0); bv_target.set(from); bv_target.set(to);
+    bv_target.set_range(from / 2, from / 2 + 100000);
+
+    for (unsigned i = 0; i < 4; ++i)
+    {
+        bm::set_operation op;
+        bvect bv_control(bv_target);
+        switch (i)
+        {
+        case 0: op = bm::set_OR;  bv_control.bit_or(bv_range);  break;
+        case 1: op = bm::set_AND; bv_control.bit_and(bv_range); break;
+        case 2: op = bm::set_SUB; bv_control.bit_sub(bv_range); break;
+        default: op = bm::set_XOR; bv_control.bit_xor(bv_range); break;
+        }
+        bvect bv2(bv_target);
+        bm::deserialize_range(bv2, buf.buf(), from, to, op);
+        int res = bv_control.compare(bv2);
+        if (res != 0)
         {
-            bm::compressed_buffer_collection<bvect>::buffer_type buf;
-            FillTestBuffer(buf);
-            cbc.move_buffer(key, buf);
+            cerr << "Range deserialization check failed! op=" << i 
+                 << " [" << from << ", " << to << "]" << endl;
+            exit(1);
         }
-        key += key_factor;
-    } // for
-    cbc.sync();
+    }
 }
 
 static
-void TestCompressedCollection()
+void RangeDeserializationTest()
 {
-    cout << "------------------------ Compressed collection Test" << endl;
-    
+    cout << "---------------------------- Range deserialization Test" << endl;
+
+    const unsigned test_count = 20;
+    for (unsigned k = 0; k < test_count; ++k)
     {
-        bm::compressed_collection<unsigned, bvect> coll;
-        bool added;
-        unsigned v;
-        
-        added = coll.push_back(0, 100);
-        assert(added);
-        added = coll.push_back(10, 5);
-        assert(added);
-        added = coll.push_back(150000, 500);
-        assert(added);
-        
-        coll.sync();
-        
-        bool found;
-        bm::id_t idx;
-        
-        found = coll.resolve(0, &idx);
-        assert(found);
-        v = coll.get(idx);
-        assert(v == 100);
+        bvect bv;
+        GenerateParallelTestVector(bv, 1 + unsigned(rand()) % 40);
+        bv.optimize();
 
-        found = coll.resolve(10, &idx);
-        assert(found);
-        v = coll.get(idx);
-        assert(v == 5);
+        bm::serializer<bvect>::buffer buf_chunked;
+        bm::serialize_chunked(bv, buf_chunked, unsigned(rand()) % (256 * 4));
+        bm::serializer<bvect>::buffer buf;
+        {
+            bm::serializer<bvect> bv_ser;
+            bv_ser.serialize(bv, buf, 0);
+        }
 
-        found = coll.resolve(150000, &idx);
-        assert(found);
-        v = coll.get(idx);
-        assert(v == 500);
+        bm::chunked_deserializer<bvect> bv_deserial;
+        unsigned chunk_count = bv_deserial.read_directory(buf_chunked.buf());
+        assert(bv_deserial.directory_size() <= bv_deserial.get_chunk(0).offset
+               || !chunk_count);
 
-        found = coll.resolve(256, &idx);
-        assert(!found);
-        
-        coll.optimize();
-        
-        found = coll.resolve(0, &idx);
-        assert(found);
-        v = coll.get(idx);
-        assert(v == 100);
+        for (unsigned j = 0; j < 10; ++j)
+        {
+            bm::id_t from = unsigned(rand()) % (41 * 256 * 65536);
+            bm::id_t to = from + unsigned(rand()) % (256 * 65536 * 3);
+            if (j == 0) // aligned on chunk boundaries
+            {
+                from = 256 * 65536;
+                to = 2 * 256 * 65536 - 1;
+            }
+            CheckRangeDeserialization(bv, buf_chunked, from, to);
+            CheckRangeDeserialization(bv, buf, from, to);
 
-        found = coll.resolve(10, &idx);
-        assert(found);
-        v = coll.get(idx);
-        assert(v == 5);
+            unsigned k_from, k_to;
+            unsigned cnt = bv_deserial.find_chunks(from, to, k_from, k_to);
+            assert(cnt == k_to - k_from);
+            for (unsigned c = 0; c < chunk_count; ++c)
+            {
+                const bm::serial_chunk& chunk = bv_deserial.get_chunk(c);
+                bool overlap = (chunk.nb_from <= (to >> 16)) && 
+                               ((from >> 16) < chunk.nb_to);
+                assert(overlap == (c >= k_from && c < k_to));
+            }
+        }
+        cout << "\r" << k << " of " << test_count << flush;
+    } // for k
+    cout << endl;
 
-        found = coll.resolve(150000, &idx);
-        assert(found);
-        v = coll.get(idx);
-        assert(v == 500);
+    {
+        bvect bv;
+        bv.set(bm::id_max - 1);
+        bv.set(10);
+        bm::serializer<bvect>::buffer buf;
+        bm::serialize_chunked(bv, buf);
+        CheckRangeDeserialization(bv, buf, 0, bm::id_max - 1);
+        CheckRangeDeserialization(bv, buf, 11, bm::id_max - 2);
+        CheckRangeDeserialization(bv, buf, bm::id_max - 1, bm::id_max - 1);
+    }
 
-        found = coll.resolve(256, &idx);
-        assert(!found);
+    cout << "---------------------------- Range deserialization Test OK" << endl;
+}
 
+static
+void CheckBvectorView(const bvect& bv)
+{
+    // image memory from the standard (aligned) allocator
+    bm::serializer<bvect_mt>::buffer buf;
+    size_t image_size = bm::view_image_size(bv);
+    buf.resize(image_size);
+    size_t size = bm::save_view(bv, buf.data());
+    assert(size == image_size);
+
+    bm::bvector_view<bvect> bv_view;
+    bool ok = bv_view.attach(buf.buf(), buf.size());
+    assert(ok);
+    assert(bv_view.size() == bv.size());
+    assert(bv_view.image_size() == image_size);
+
+    bm::id_t cnt = bv.count();
+    if (bv_view.count() != cnt || bv_view.any() != bv.any())
+    {
+        cerr << "bvector_view count check failed!" << endl;
+        exit(1);
     }
-    
-    {
-    bm::compressed_buffer_collection<bvect> cbc;
+
+    // enumeration
     {
-        bm::compressed_buffer_collection<bvect>::buffer_type buf;
-        buf.copy_from((unsigned char*)"ABC", 3);
-        cbc.move_buffer(10, buf);
+        bvect::enumerator en = bv.first();
+        bm::id_t n = bv_view.get_first();
+        bm::id_t i = 0;
+        for (; en.valid() && i < 100000; ++en, ++i)
+        {
+            if (*en != n)
+            {
+                cerr << "bvector_view enumeration failed! " 
+                     << *en << " " << n << endl;
+                exit(1);
+            }
+            assert(bv_view.test(n));
+            n = bv_view.get_next(n);
+        }
+        if (!en.valid())
+            assert(n == 0);
     }
+    for (unsigned i = 0; i < 10000; ++i)
     {
-        bm::compressed_buffer_collection<bvect>::buffer_type buf;
-        buf.copy_from((unsigned char*)"1234", 4);
-        cbc.move_buffer(15, buf);
+        bm::id_t n = unsigned(rand()) % (41 * 256 * 65536);
+        if (n >= bv.size())
+            continue;
+        assert(bv_view.test(n) == bv.test(n));
     }
-    cbc.sync();
-    
-    assert(cbc.size() == 2);
-    bm::compressed_buffer_collection<bvect>::statistics st;
-    cbc.calc_stat(&st);
-    
-    bm::compressed_collection_serializer<compressed_buffer_collection<bvect> > cbcs;
-    bm::compressed_buffer_collection<bvect>::buffer_type sbuf;
-    
-    cbcs.serialize(cbc, sbuf);
-    assert(sbuf.size() > 0);
-    
-    bm::compressed_buffer_collection<bvect>::buffer_type sbuf2(sbuf);
-    bm::compressed_buffer_collection<bvect> cbc2;
-    compressed_collection_deserializer<compressed_buffer_collection<bvect> > cbcd;
-    cbcd.deserialize(cbc2, sbuf2.buf());
-    
-    if (!cbc2.equal(cbc))
+
+    // combine with a target
+    for (unsigned i = 0; i < 4; ++i)
     {
-        std::cerr << "Compressed collection serialization error" << endl;
-        exit(1);
+        bvect bv_target;
+        bv_target.set(0); bv_target.set(100000);
+        bv_target.set_range(65536 * 256 * 2, 65536 * 256 * 2 + 200000);
+        bv_target.set(bm::id_max - 1);
+        bvect bv_control(bv_target);
+
+        bm::set_operation op;
+        switch (i)
+        {
+        case 0: op = bm::set_OR;  bv_control.bit_or(bv);  break;
+        case 1: op = bm::set_AND; bv_control.bit_and(bv); break;
+        case 2: op = bm::set_SUB; bv_control.bit_sub(bv); break;
+        default: op = bm::set_XOR; bv_control.bit_xor(bv); break;
+        }
+        bv_view.combine_into(bv_target, op);
+        int res = bv_control.compare(bv_target);
+        if (res != 0)
+        {
+            cerr << "bvector_view combine failed! op=" << i << endl;
+            exit(1);
+        }
+        // empty target
+        bvect bv_empty;
+        bv_view.combine_into(bv_empty, op);
+        if (op == bm::set_OR || op == bm::set_XOR)
+            assert(bv_empty.compare(bv) == 0);
+        else
+            assert(!bv_empty.any());
     }
 
+    // damaged images are rejected
+    assert(!bv_view.attach(buf.buf(), sizeof(bm::view_header) - 1));
+    assert(!bv_view.attach(buf.buf(), image_size - 1) || image_size == 0);
+    buf.data()[0] ^= 0xFF;
+    assert(!bv_view.attach(buf.buf(), buf.size()));
+    assert(!bv_view.is_attached());
+}
+
+static
+void BvectorViewTest()
+{
+    cout << "---------------------------- bvector view Test" << endl;
+
+    {
+        bvect bv;
+        CheckBvectorView(bv);
+        bv.set(10);
+        CheckBvectorView(bv);
+        bv.set_range(65536 * 256, 65536 * 256 * 3 + 10);
+        bv.set(bm::id_max - 1);
+        CheckBvectorView(bv);
+        bv.optimize();
+        CheckBvectorView(bv);
+        bv.resize(bm::id_max - 1);
+        bv.invert();
+        CheckBvectorView(bv);
     }
-    
+
+    const unsigned test_count = 20;
+    for (unsigned k = 0; k < test_count; ++k)
     {
-        cout << "Compressed buffer collection stress." << endl;
-        const unsigned test_count = 160;
-        for (unsigned i = 0; i < test_count; ++i)
-        {
-            bm::compressed_buffer_collection<bvect> cbc1;
-            bm::compressed_buffer_collection<bvect> cbc2;
-            
-            GenerateCompressedBufferCollection(cbc1);
+        bvect bv;
+        GenerateParallelTestVector(bv, 1 + unsigned(rand()) % 40);
+        if (k & 1)
+            bv.optimize();
+        if (rand() % 4 == 0)
+            bv.resize(1 + unsigned(rand()) % (40 * 256 * 65536));
+        CheckBvectorView(bv);
+
+        cout << "\r" << k << " of " << test_count << flush;
+    } // for k
+    cout << endl;
 
-            bm::compressed_buffer_collection<bvect>::statistics st;
-            cbc1.calc_stat(&st);
-            
-            bm::compressed_collection_serializer<compressed_buffer_collection<bvect> > cbcs;
-            bm::compressed_buffer_collection<bvect>::buffer_type sbuf;
-    
-            cbcs.serialize(cbc1, sbuf);
-            
-            bm::compressed_buffer_collection<bvect>::buffer_type sbuf2(sbuf);
-            sbuf.release();
+    cout << "---------------------------- bvector view Test OK" << endl;
+}
 
-            compressed_collection_deserializer<compressed_buffer_collection<bvect> > cbcd;
-            cbcd.deserialize(cbc2, sbuf2.buf());
-            
-            if (!cbc2.equal(cbc1))
+static
+void PoolAllocatorTest()
+{
+    cout << "---------------------------- Pool allocator Test" << endl;
+
+    // explicit pool
+    {
+        bm::block_pool<bm::block_allocator> pool(bm::set_block_size * 4 * 3);
+        bm::word_t* b1 = pool.allocate(bm::set_block_size, 0);
+        bm::word_t* b2 = pool.allocate(bm::set_block_size, 0);
+        bm::word_t* g1 = pool.allocate(64, 0);
+        assert(pool.get_stat().hit_cnt == 0);
+        pool.deallocate(b1, bm::set_block_size);
+        pool.deallocate(g1, 64);
+        assert(pool.get_stat().retained_blocks == 2);
+        assert(pool.get_stat().retained_mem == 
+               (bm::set_block_size + 64) * sizeof(bm::word_t));
+
+        bm::word_t* b3 = pool.allocate(bm::set_block_size, 0);
+        assert(b3 == b1);
+        bm::word_t* g2 = pool.allocate(64, 0);
+        assert(g2 == g1);
+        bm::word_t* g3 = pool.allocate(128, 0);
+        assert(pool.get_stat().hit_cnt == 2);
+        assert(pool.get_stat().retained_blocks == 0);
+
+        pool.deallocate(b2, bm::set_block_size);
+        pool.deallocate(b3, bm::set_block_size);
+        pool.deallocate(g2, 64);
+        pool.deallocate(g3, 128);
+        // retention limit is 3 bit blocks
+        assert(pool.get_stat().retained_mem <= bm::set_block_size * 4 * 3);
+        assert(pool.get_stat().free_cnt == 6);
+        assert(pool.get_stat().alloc_cnt == 6);
+
+        pool.free_pools();
+        assert(pool.get_stat().retained_blocks == 0);
+        assert(pool.get_stat().retained_mem == 0);
+    }
+
+    typedef bm::bvector<bm::pooled_allocator> bvect_pool;
+
+    bm::pooled_block_allocator::free_pools();
+    bm::pooled_block_allocator::reset_stat();
+
+    for (unsigned k = 0; k < 10; ++k)
+    {
+        bvect_pool bv1;
+        bvect bv_control;
+        for (unsigned i = 0; i < 200000; ++i)
+        {
+            unsigned n = unsigned(rand()) % (65536 * 512);
+            bv1.set(n);
+            bv_control.set(n);
+            if (i % 3 == 0)
             {
-                std::cerr << "Compressed collection serialization error at step " << i << endl;
+                bv1.set(n, false);
+                bv_control.set(n, false);
+            }
+        }
+        bvect_pool bv2(bv1);
+        bv2.optimize();
+        bv2.set_range(65536 * 10, 65536 * 20);
+        bv1.set_range(65536 * 10, 65536 * 20);
+        bv_control.set_range(65536 * 10, 65536 * 20);
+
+        assert(bv1.count() == bv_control.count());
+        assert(bv2.count() == bv_control.count());
+        bvect_pool::enumerator en1 = bv1.first();
+        bvect::enumerator en2 = bv_control.first();
+        for (; en2.valid(); ++en1, ++en2)
+        {
+            if (*en1 != *en2)
+            {
+                cerr << "Pool allocator bvector check failed!" << endl;
                 exit(1);
             }
+        }
+        assert(!en1.valid());
+        bv1 &= bv2;
+        assert(bv1.count() == bv_control.count());
+    } // for k
 
+    bm::alloc_pool_stat st = bm::pooled_block_allocator::get_stat();
+    cout << "Allocations: " << st.alloc_cnt 
+         << " pool hit rate: " << st.hit_rate() 
+         << " retained: " << st.retained_mem << endl;
+    assert(st.alloc_cnt);
+    assert(st.hit_cnt);
+    assert(st.retained_mem <= bm::alloc_pool_retain_default);
 
-            cout << "\r" << i << " of " << test_count << flush;
-        } // for
-        
-        cout << endl;
+    bm::pooled_block_allocator::free_pools();
+    st = bm::pooled_block_allocator::get_stat();
+    assert(st.retained_mem == 0 && st.retained_blocks == 0);
+
+    // blocks allocated and released on different threads
+    {
+        bvect_pool bv;
+        std::thread t([&bv]() { bv.set_range(0, 65536 * 300); bv.optimize(); });
+        t.join();
+        bv.clear(true);
     }
-    
-    
-    cout << "------------------------ Compressed collection Test OK" << endl;
+
+    cout << "---------------------------- Pool allocator Test OK" << endl;
 }
 
 int main(void)
@@ -11761,6 +15543,10 @@ int main(void)
 
      SetTest();
 
+     ImportSortedTest();
+
+     BvectorDecodeTest();
+
      BitCountChangeTest();
    
      Log2Test();
@@ -11777,6 +15563,8 @@ int main(void)
     
      CountRangeTest();
 
+     RankSelectTest();
+
      BasicFunctionalityTest();
 
      ClearAllTest();
@@ -11789,6 +15577,8 @@ int main(void)
 
      GAPTestStress();
 
+     GAPLongOperationsTest();
+
      MaxSTest();
 
      GetNextTest();
@@ -11823,6 +15613,14 @@ int main(void)
 
      DesrializationTest2();
 
+     ChunkedSerializationTest();
+
+     RangeDeserializationTest();
+
+     BvectorViewTest();
+
+     PoolAllocatorTest();
+
      BlockLevelTest();
 
      StressTest(120, 0); // OR
@@ -11834,10 +15632,34 @@ int main(void)
     
      TestSparseVectorTransform();
 
+     TestSparseVectorBackInserter();
+
+     TestSparseVectorGather();
+
+     TestSparseVectorScan();
+
+     TestSparseVectorAggregates();
+
+     TestSparseVectorGroupBy();
+
+     TestRSCSparseVector();
+
+     TestStrSparseVector();
+
+     TestRemapSparseVector();
+
+     TestFORSparseVector();
+
+     TestSparseVectorWide();
+
      TestSparseVector_Stress(2);
  
      TestCompressedCollection();
 
+     AggregatorTest();
+
+     ParallelOperationsTest();
+
      StressTest(300);
 
     finish_time = time(0);
@@ -0,0 +1,354 @@
+/*
+Copyright(c) 2002-2018 Anatoliy Kuznetsov(anatoliy_kuznetsov at yahoo.com)
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+For more information please visit:  http://bitmagic.io
+*/
+
+// 64-bit address mode stress test
+//
+#define BM64ADDR
+
+//#define BMSSE2OPT
+//#define BMSSE42OPT
+//#define BMAVX2OPT
+
+#include <stdio.h>
+#include <stdlib.h>
+#undef NDEBUG
+#include <cassert>
+#include <memory.h>
+#include <time.h>
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+#include <bm.h>
+#include <bmalgo.h>
+#include <bmserial.h>
+
+using namespace bm;
+using namespace std;
+
+typedef bm::bvector<> bvect;
+
+const bm::id_t BV64_4G  = 0x100000000ull;
+const bm::id_t BV64_1T  = 0x10000000000ull;
+
+
+static
+void CheckVector(const bvect& bv, const std::vector<bm::id_t>& vect)
+{
+    bm::id_t cnt = bv.count();
+    if (cnt != vect.size())
+    {
+        cerr << "Bit count mismatch: " << cnt << " expected: " << vect.size() << endl;
+        exit(1);
+    }
+    bvect::enumerator en = bv.first();
+    for (size_t i = 0; i < vect.size(); ++i, ++en)
+    {
+        if (!en.valid() || *en != vect[i])
+        {
+            cerr << "Enumerator mismatch at: " << i << " expected: " << vect[i] << endl;
+            exit(1);
+        }
+        if (!bv.test(vect[i]))
+        {
+            cerr << "Bit test failed: " << vect[i] << endl;
+            exit(1);
+        }
+    }
+    if (en.valid())
+    {
+        cerr << "Enumerator overrun: " << *en << endl;
+        exit(1);
+    }
+}
+
+static
+void GenerateTestVector(std::vector<bm::id_t>& vect, bm::id_t from, bm::id_t step, unsigned count)
+{
+    for (unsigned i = 0; i < count; ++i)
+    {
+        vect.push_back(from);
+        from += step;
+    }
+}
+
+
+static
+void SetTest64()
+{
+    cout << "----------------------------- SetTest64()" << endl;
+    {
+        bvect bv;
+        assert(bv.size() == bm::id_max);
+
+        bm::id_t ids[] = { 0, 65535, BV64_4G - 1, BV64_4G, BV64_4G + 1,
+                           BV64_1T, BV64_1T + 65536, bm::id_max - 1 };
+        const unsigned ids_size = sizeof(ids) / sizeof(ids[0]);
+        std::vector<bm::id_t> vect(ids, ids + ids_size);
+
+        for (unsigned i = 0; i < ids_size; ++i)
+        {
+            bool changed = bv.set_bit(ids[i]);
+            assert(changed);
+        }
+        CheckVector(bv, vect);
+
+        assert(bv.get_first() == 0);
+        assert(bv.get_next(65535) == BV64_4G - 1);
+        assert(bv.get_next(BV64_4G + 1) == BV64_1T);
+        assert(bv.get_next(bm::id_max - 1) == 0);
+
+        bm::id_t cnt = bv.count_range(BV64_4G - 1, BV64_1T);
+        assert(cnt == 4);
+        cnt = bv.count_range(BV64_4G, bm::id_max - 1);
+        assert(cnt == 5);
+
+        bv.set_bit(BV64_4G, false);
+        assert(!bv.test(BV64_4G));
+        assert(bv.count() == ids_size - 1);
+
+        bvect bv2(bv);
+        assert(bv2 == bv);
+        bv2.set_bit(BV64_1T + 1);
+        assert(bv2.compare(bv) > 0);
+    }
+
+    {
+        bvect bv(BM_GAP);
+        std::vector<bm::id_t> vect;
+        GenerateTestVector(vect, BV64_4G * 3 - 100000, 7, 100000);
+        for (size_t i = 0; i < vect.size(); ++i)
+            bv.set(vect[i]);
+        CheckVector(bv, vect);
+
+        bvect bv2;
+        bm::combine_or(bv2, vect.begin(), vect.end());
+        assert(bv2 == bv);
+
+        bv.optimize();
+        CheckVector(bv, vect);
+    }
+
+    {
+        bvect bv;
+        bvect::insert_iterator iit = bv.inserter();
+        std::vector<bm::id_t> vect;
+        GenerateTestVector(vect, BV64_1T, 65537, 1000);
+        for (size_t i = 0; i < vect.size(); ++i)
+            *iit = vect[i];
+        CheckVector(bv, vect);
+    }
+    cout << "----------------------------- SetTest64() OK" << endl;
+}
+
+static
+void RangeTest64()
+{
+    cout << "----------------------------- RangeTest64()" << endl;
+    {
+        bvect bv;
+        bm::id_t left = BV64_4G - 70000;
+        bm::id_t right = BV64_4G * 2 + 70000;
+        bv.set_range(left, right);
+
+        assert(bv.count() == right - left + 1);
+        assert(bv.count_range(left, right) == right - left + 1);
+        assert(bv.count_range(BV64_4G, BV64_4G + 9) == 10);
+        assert(bv.get_first() == left);
+        assert(!bv.test(left - 1));
+        assert(!bv.test(right + 1));
+
+        bv.set_range(BV64_4G, BV64_4G * 2 - 1, false);
+        assert(bv.count() == (BV64_4G - left) + (right - BV64_4G * 2 + 1));
+        assert(bv.get_next(BV64_4G - 1) == BV64_4G * 2);
+    }
+    {
+        bvect bv(BV64_4G * 2);
+        assert(bv.size() == BV64_4G * 2);
+        bv.set_bit(BV64_4G * 2 - 1);
+        bv.invert();
+        assert(bv.count() == BV64_4G * 2 - 1);
+        assert(!bv.test(BV64_4G * 2 - 1));
+        bv.resize(BV64_4G * 3);
+        assert(bv.count() == BV64_4G * 2 - 1);
+    }
+    cout << "----------------------------- RangeTest64() OK" << endl;
+}
+
+static
+void OperationsTest64()
+{
+    cout << "----------------------------- OperationsTest64()" << endl;
+
+    std::vector<bm::id_t> v1, v2;
+    GenerateTestVector(v1, BV64_4G - 1000, 3, 200000);
+    GenerateTestVector(v2, BV64_4G - 1000, 5, 200000);
+
+    bvect bv1, bv2;
+    for (size_t i = 0; i < v1.size(); ++i) bv1.set(v1[i]);
+    for (size_t i = 0; i < v2.size(); ++i) bv2.set(v2[i]);
+    bv2.set(BV64_1T);
+
+    std::vector<bm::id_t> vand, vor, vsub, vxor;
+    std::set_intersection(v1.begin(), v1.end(), v2.begin(), v2.end(), std::back_inserter(vand));
+    v2.push_back(BV64_1T);
+    std::set_union(v1.begin(), v1.end(), v2.begin(), v2.end(), std::back_inserter(vor));
+    std::set_difference(v1.begin(), v1.end(), v2.begin(), v2.end(), std::back_inserter(vsub));
+    std::set_symmetric_difference(v1.begin(), v1.end(), v2.begin(), v2.end(), std::back_inserter(vxor));
+
+    {
+        bvect bv(bv1);
+        bv &= bv2;
+        CheckVector(bv, vand);
+        assert(bm::count_and(bv1, bv2) == vand.size());
+    }
+    {
+        bvect bv(bv1);
+        bv |= bv2;
+        CheckVector(bv, vor);
+        assert(bm::count_or(bv1, bv2) == vor.size());
+    }
+    {
+        bvect bv(bv1);
+        bv -= bv2;
+        CheckVector(bv, vsub);
+        assert(bm::count_sub(bv1, bv2) == vsub.size());
+    }
+    {
+        bvect bv(bv1);
+        bv ^= bv2;
+        CheckVector(bv, vxor);
+        assert(bm::count_xor(bv1, bv2) == vxor.size());
+    }
+    cout << "----------------------------- OperationsTest64() OK" << endl;
+}
+
+static
+void SerializationTest64()
+{
+    cout << "----------------------------- SerializationTest64()" << endl;
+
+    std::vector<bm::id_t> vect;
+    GenerateTestVector(vect, 10, 100000, 100);
+    GenerateTestVector(vect, BV64_4G * 5, 3, 70000);
+    GenerateTestVector(vect, BV64_1T, 65536 * 3 + 1, 2000);
+
+    bvect bv(BM_GAP);
+    for (size_t i = 0; i < vect.size(); ++i)
+        bv.set(vect[i]);
+    bv.optimize();
+
+    bvect::statistics st;
+    bv.calc_stat(&st);
+
+    {
+        std::vector<unsigned char> buf(st.max_serialize_mem);
+        size_t slen = bm::serialize(bv, &buf[0]);
+        assert(slen <= st.max_serialize_mem);
+
+        bvect bv2;
+        bm::deserialize(bv2, &buf[0]);
+        CheckVector(bv2, vect);
+        assert(bv2 == bv);
+
+        bvect bv3;
+        bm::operation_deserializer<bvect>::deserialize(bv3, &buf[0], 0, bm::set_OR);
+        assert(bv3 == bv);
+
+        bm::id_t cnt =
+            bm::operation_deserializer<bvect>::deserialize(bv3, &buf[0], 0, bm::set_COUNT_AND);
+        assert(cnt == vect.size());
+    }
+    {
+        // sized vector uses the 64-bit header field
+        bvect bv_s(BV64_1T * 2);
+        for (size_t i = 0; i < vect.size(); ++i)
+            bv_s.set(vect[i]);
+        bv_s.optimize();
+        std::vector<unsigned char> buf(st.max_serialize_mem + 16);
+        bm::serialize(bv_s, &buf[0]);
+        bvect bv2(100);
+        bm::deserialize(bv2, &buf[0]);
+        assert(bv2.size() == BV64_1T * 2);
+        CheckVector(bv2, vect);
+    }
+    cout << "----------------------------- SerializationTest64() OK" << endl;
+}
+
+static
+void RankSelectTest64()
+{
+    cout << "----------------------------- RankSelectTest64()" << endl;
+
+    std::vector<bm::id_t> vect;
+    GenerateTestVector(vect, 10, 3, 1000);
+    GenerateTestVector(vect, BV64_4G - 100, 7, 50000);
+    GenerateTestVector(vect, BV64_1T, 65536 * 2 + 5, 300);
+    vect.push_back(bm::id_max - 1);
+
+    bvect bv;
+    for (size_t i = 0; i < vect.size(); ++i)
+        bv.set(vect[i]);
+    bv.set_range(BV64_4G * 7, BV64_4G * 7 + 65536 * 3);
+
+    for (unsigned pass = 0; pass < 2; ++pass)
+    {
+        bvect::rs_index_type rs_idx;
+        bv.build_rs_index(&rs_idx);
+        assert(rs_idx.count() == bv.count());
+
+        bm::id_t r = 1;
+        for (bvect::enumerator en = bv.first(); en.valid(); ++en, ++r)
+        {
+            bm::id_t pos;
+            bool found = bv.select(r, pos, rs_idx);
+            assert(found && pos == *en);
+            assert(bv.rank(pos, rs_idx) == r);
+            assert(bv.count_to_test(pos, rs_idx) == r);
+            if (r % 1000 == 0)
+                assert(bv.rank(pos, rs_idx) == bv.count_range(0, pos));
+            if (!bv.test(pos + 1))
+                assert(bv.count_to_test(pos + 1, rs_idx) == 0);
+        }
+        assert(bv.rank(BV64_1T - 1, rs_idx) == bv.count_range(0, BV64_1T - 1));
+        bv.optimize();
+    }
+    cout << "----------------------------- RankSelectTest64() OK" << endl;
+}
+
+int main(void)
+{
+    time_t      start_time = time(0);
+    time_t      finish_time;
+
+    SetTest64();
+
+    RangeTest64();
+
+    OperationsTest64();
+
+    SerializationTest64();
+
+    RankSelectTest64();
+
+    finish_time = time(0);
+    cout << "Test execution time = " << finish_time - start_time << endl;
+
+    return 0;
+}